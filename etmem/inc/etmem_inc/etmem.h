@@ -25,6 +25,9 @@ typedef enum etmem_cmd_e {
     ETMEM_CMD_STOP,
     ETMEM_CMD_SHOW,
     ETMEM_CMD_ENGINE,
+    ETMEM_CMD_TRACE_START,
+    ETMEM_CMD_TRACE_STOP,
+    ETMEM_CMD_TRACE_DUMP,
     ETMEM_CMD_HELP,
 } etmem_cmd;
 
@@ -0,0 +1,45 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a header file of the eviction arbiter across projects.
+ ******************************************************************************/
+
+#ifndef ETMEMD_ARBITER_H
+#define ETMEMD_ARBITER_H
+
+#include <stdbool.h>
+#include "etmemd_project_exp.h"
+
+#define ARB_COLD_LEVELS         8
+#define ARB_PRIORITY_MAX        7
+/* rank 0 holds the coldest pages of the projects with priority 0 */
+#define ARB_RANK_NR             (ARB_COLD_LEVELS + ARB_PRIORITY_MAX)
+
+/* the rank of a page accessed count times of max_count, the pages of a higher priority look hotter */
+int etmemd_arb_rank(int count, int max_count, int priority);
+
+/*
+ * Report the cold bytes of pid in each rank, and get the bytes it should evict, which is
+ * the part of pid in the coldest candidates of all projects to get the free memory back
+ * to sysmem_threshold of proj. The report lasts for ttl seconds, and the bytes granted are
+ * taken off from it and from the deficit of the meminfo snapshot.
+ * */
+unsigned long etmemd_arb_budget(const struct project *proj, unsigned int pid,
+                                const unsigned long bytes[ARB_RANK_NR], int ttl);
+
+/* drop all the reports of the project */
+void etmemd_arb_forget(const struct project *proj);
+
+/* swapcache reclaim is global, let only one of the projects kick it each round */
+bool etmemd_arb_swapcache_kicked(void);
+void etmemd_arb_swapcache_kick(void);
+#endif
@@ -0,0 +1,53 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a header file of the bandwidth governor of swap out and migration.
+ ******************************************************************************/
+
+#ifndef ETMEMD_BANDWIDTH_H
+#define ETMEMD_BANDWIDTH_H
+
+#include <stdbool.h>
+
+#define BW_WEIGHT_DEFAULT       1
+#define BW_WEIGHT_MAX           100
+#define BW_RATE_MAX             (1 << 20)   /* in MB/s */
+
+/* the pages are moved in chunks of this size at most when the governor is on */
+#define BW_CHUNK_SIZE           (4UL << 20)
+
+enum bw_class {
+    BW_SWAP,        /* bytes swapped out, by swap_pages, madvise or memdcd */
+    BW_MIGRATE,     /* bytes moved between numa nodes */
+    BW_CLASS_NR,
+};
+
+struct bw_share;
+
+/* set the daemon wide rate of the class in MB/s, 0 for no limit */
+int etmemd_bw_set_rate(enum bw_class cls, unsigned long rate);
+bool etmemd_bw_limited(enum bw_class cls);
+
+/*
+ * Each project owns a share of the rates in proportion to weight, the share of an
+ * idle project is left to the others.
+ * */
+struct bw_share *etmemd_bw_share_alloc(const char *name, int weight);
+void etmemd_bw_share_free(struct bw_share *share);
+
+/*
+ * Take bytes from the share, wait until the share or the spare of others has some.
+ * The share may be overdrawn by the last request, so keep bytes within BW_CHUNK_SIZE.
+ * Do nothing if share is NULL or the class has no limit.
+ * */
+void etmemd_bw_acquire(struct bw_share *share, enum bw_class cls, unsigned long bytes);
+#endif
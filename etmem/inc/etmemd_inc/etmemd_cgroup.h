@@ -0,0 +1,53 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a header file of the cgroup v2 task type.
+ ******************************************************************************/
+
+#ifndef ETMEMD_CGROUP_H
+#define ETMEMD_CGROUP_H
+
+#include <stdbool.h>
+
+#define CGROUP_TASK_TYPE        "cgroup"
+/* the value of a cgroup task is relative to CGROUP_ROOT unless it starts with '/' */
+#define CGROUP_ROOT             "/sys/fs/cgroup/"
+
+/* memory of the cgroup in KB, max is 0 if there is no limit */
+struct cgroup_mem {
+    unsigned long current;
+    unsigned long max;
+    unsigned long swap;
+    unsigned long anon;
+    unsigned long file;
+    unsigned long file_mapped;
+};
+
+struct cgroup_watch;
+
+/* check the value of a cgroup task, which should not get out of the cgroup root */
+int etmemd_cgroup_check_value(const char *value);
+
+/* watch the cgroup for the task, the cgroup may not exist yet */
+struct cgroup_watch *etmemd_cgroup_watch(const char *value);
+void etmemd_cgroup_unwatch(struct cgroup_watch **cg);
+
+/*
+ * Get the pids in the cgroup and its descendants in ascending order, which should be freed by the caller.
+ * Return 1 with the pids if all is set or they have changed since the last call, 0 without
+ * them if not, and -1 if the cgroup is empty or gone.
+ * */
+int etmemd_cgroup_get_pids(struct cgroup_watch *cg, bool all, unsigned int **pids, int *nr);
+
+/* memory of the cgroup, which is read again after it is older than MEMINFO_CACHE_MS */
+int etmemd_cgroup_get_mem(struct cgroup_watch *cg, struct cgroup_mem *mem);
+#endif
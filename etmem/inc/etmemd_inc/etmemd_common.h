@@ -22,6 +22,7 @@
 #include <sys/stat.h>
 
 #define PROC_PATH                       "/proc/"
+#define ETMEMD_ROOT_ENV                 "ETMEMD_ROOT"
 #define STATUS_FILE                     "/status"
 #define PROC_MEMINFO                    "meminfo"
 #define SWAPIN                          "SwapIN"
@@ -31,7 +32,7 @@
 #define FILE_LINE_MAX_LEN               1024
 #define KEY_VALUE_MAX_LEN               64
 #define DECIMAL_RADIX                   10
-#define ETMEMD_MAX_PARAMETER_NUM        6
+#define ETMEMD_MAX_PARAMETER_NUM        16
 
 #define BYTE_TO_KB(s)                   ((s) >> 10)
 #define KB_TO_BYTE(s)                   ((s) << 10)
@@ -74,6 +75,14 @@ int get_unsigned_int_value(const char *val, unsigned int *value);
 int get_unsigned_long_value(const char *val, unsigned long *value);
 void etmemd_safe_free(void **ptr);
 
+/*
+ * The files of /proc and /sys are looked up under the root, which is empty unless etmemd runs
+ * against a simulated tree. path is returned as it is without a root, or joined to it in buf.
+ * */
+int etmemd_set_root(const char *root);
+bool etmemd_root_set(void);
+const char *etmemd_root_path(const char *path, char *buf, size_t size);
+
 FILE *etmemd_get_proc_file(const char *pid, const char *file, const char *mode);
 int etmemd_send_ioctl_cmd(FILE *fp, struct ioctl_para *request);
 
@@ -19,7 +19,7 @@
 #include "etmemd_project.h"
 
 int etmemd_start_damon(struct project *proj);
-int etmemd_stop_damon(void);
+int etmemd_stop_damon(struct project *proj);
 int fill_engine_type_damon(struct engine *eng, GKeyFile *config);
 
 #endif
@@ -0,0 +1,73 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a header file of the scan backend based on DAMON region snapshots.
+ ******************************************************************************/
+
+#ifndef ETMEMD_DAMON_SCAN_H
+#define ETMEMD_DAMON_SCAN_H
+
+#include "etmemd_scan.h"
+#include "etmemd_project_exp.h"
+
+#define DAMON_DBGFS_PATH        "/sys/kernel/debug/damon/"
+#define DAMON_TRACEFS_PATH      "/sys/kernel/debug/tracing/"
+
+/* default monitoring attributes of DAMON, intervals in us */
+#define DAMON_DEFAULT_SAMPLE_INTERVAL   5000
+#define DAMON_DEFAULT_AGGR_INTERVAL     100000
+#define DAMON_DEFAULT_UPDATE_INTERVAL   1000000
+#define DAMON_DEFAULT_MIN_NR_REGIONS    10
+#define DAMON_DEFAULT_MAX_NR_REGIONS    1000
+
+struct damon_region {
+    uint64_t start;
+    uint64_t end;
+    unsigned int nr_accesses;       /* accesses seen in the last aggregation interval */
+    unsigned int age;
+};
+
+/* return true if the kernel has DAMON in sysfs or debugfs */
+bool damon_scan_supported(void);
+
+void damon_scan_default_attrs(struct region_scan *attrs);
+
+/*
+ * function: Take a snapshot of the regions DAMON monitors for pid and turn it into page_refs.
+ *           A kdamond is started for pid with the attrs on the first call and kept running
+ *           until damon_scan_release(), so the later calls only read the regions.
+ *
+ * in:  const struct vmas *vmas          - vmas of the process
+ *      const char *pid                  - pid of the process
+ *      const struct region_scan *attrs  - monitoring attributes of DAMON
+ *
+ * out: struct page_refs **page_refs - page_refs list sorted by address
+ *      unsigned long *use_rss       - count of the accessed pages, could be NULL
+ *
+ * return: 0 - successed to scan
+ *         -1 - failed to scan
+ * */
+int get_page_refs_by_damon(const struct vmas *vmas, const char *pid, const struct region_scan *attrs,
+                           struct page_refs **page_refs, unsigned long *use_rss);
+
+/*
+ * Add the present pages of vmas covered by regions into page_refs. The weight of a page is
+ * nr_accesses of its region scaled from [0, max_nr_accesses] to [0, MAX_ACCESS_WEIGHT], so
+ * the counts stay comparable with the other scan backends.
+ * */
+int damon_regions_to_page_refs(const struct vmas *vmas, const char *pid, const struct damon_region *regions,
+                               int nr, unsigned int max_nr_accesses, struct page_refs **page_refs,
+                               unsigned long *use_rss);
+
+/* stop monitoring pid */
+void damon_scan_release(unsigned int pid);
+#endif
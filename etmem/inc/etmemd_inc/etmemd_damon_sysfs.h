@@ -0,0 +1,97 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a header file of the DAMON sysfs interface.
+ ******************************************************************************/
+
+#ifndef ETMEMD_DAMON_SYSFS_H
+#define ETMEMD_DAMON_SYSFS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "etmemd_project_exp.h"
+
+#define DAMON_SYSFS_PATH        "/sys/kernel/mm/damon/admin/"
+#define DAMON_KDAMONDS_PATH     DAMON_SYSFS_PATH "kdamonds/"
+
+/* kdamonds created by etmemd, shared by the damon engine and the damon scan backend */
+#define DAMON_SYSFS_MAX_KDAMONDS    64
+
+enum damos_action {
+    DAMOS_WILLNEED,
+    DAMOS_COLD,
+    DAMOS_PAGEOUT,
+    DAMOS_HUGEPAGE,
+    DAMOS_NOHUGEPAGE,
+    DAMOS_STAT,
+};
+
+enum damos_wmark_metric {
+    DAMOS_WMARK_NONE = 0,
+    DAMOS_WMARK_FREE_MEM_RATE,
+};
+
+/* the scheme is applied to at most ms of time and bytes of memory each reset_interval ms, 0 for no limit */
+struct damos_quota {
+    unsigned long ms;
+    unsigned long bytes;
+    unsigned long reset_interval;
+};
+
+/*
+ * The scheme is active while the metric, in per-thousand, is between low and high, and becomes
+ * active again after it drops below mid. The metric is checked each interval us.
+ * */
+struct damos_wmarks {
+    enum damos_wmark_metric metric;
+    unsigned long interval;
+    unsigned long high;
+    unsigned long mid;
+    unsigned long low;
+};
+
+struct damos_scheme {
+    unsigned long min_sz_region;
+    unsigned long max_sz_region;
+    unsigned int min_nr_accesses;
+    unsigned int max_nr_accesses;
+    unsigned int min_age_region;
+    unsigned int max_age_region;
+    enum damos_action action;
+    struct damos_quota quota;
+    struct damos_wmarks wmarks;
+};
+
+bool damon_sysfs_exist(void);
+
+const char *damos_action_str(enum damos_action action);
+
+int damon_write_file(const char *path, const char *val, int flags);
+int damon_read_file(const char *path, char *buf, size_t size);
+int damon_read_ull(const char *path, unsigned long long *val);
+
+int kdamond_path(char *path, size_t size, int kdamond, const char *file);
+int kdamond_write(int kdamond, const char *file, const char *val);
+bool kdamond_is_on(int kdamond);
+
+/* get a kdamond not used by others, return -1 if none left */
+int kdamond_alloc(void);
+/* turn the kdamond off and give it back */
+void kdamond_free(int kdamond);
+
+/*
+ * Set the kdamond to monitor the virtual address spaces of pids with attrs, and apply the schemes.
+ * The kdamond is turned on at last.
+ * */
+int kdamond_start(int kdamond, const struct region_scan *attrs, const unsigned int *pids, int nr_pids,
+                  const struct damos_scheme *schemes, int nr_schemes);
+#endif
@@ -20,6 +20,8 @@
 #include <stdint.h>
 
 struct task_pid;
+struct page_refs;
+struct memory_grade;
 
 /*
  * engine struct
@@ -47,6 +49,8 @@ struct engine_ops {
     int (*alloc_pid_params)(struct engine *eng, struct task_pid **tk_pid);
     void (*free_pid_params)(struct engine *eng, struct task_pid **tk_pid);
     int (*eng_mgt_func)(struct engine *eng, struct task *tk, char *cmd, int fd);
+    /* decide on the pages of a scan cycle replayed without moving them, NULL if nothing to move */
+    struct memory_grade *(*replay_pages)(struct task_pid *tk_pid, struct page_refs **page_refs);
 };
 
 #endif
@@ -0,0 +1,57 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a header file of the hotness history kept across restarts of etmemd.
+ ******************************************************************************/
+
+#ifndef ETMEMD_HOTNESS_H
+#define ETMEMD_HOTNESS_H
+
+#include <stdbool.h>
+#include "etmemd_exp.h"
+#include "etmemd_scan_exp.h"
+
+#define HOTNESS_FILE_NAME       "hotness"
+
+/* the hotness of a vma is kept for each region of this size */
+#define HOTNESS_REGION_SIZE     (2UL << 20)
+/* the larger vmas, mostly reserved address space, are not kept */
+#define HOTNESS_VMA_REGIONS_MAX (1UL << 18)
+#define HOTNESS_CHECKPOINT_SEC  60
+/* a pid resumes from its history only if it covers this percent of its vmas */
+#define HOTNESS_WARM_COVERAGE   90
+
+/* keep the history in dir, which should be an absolute path */
+int etmemd_hotness_set_dir(const char *dir);
+bool etmemd_hotness_enabled(void);
+
+/* load the history checkpointed by the last etmemd of this boot */
+int etmemd_hotness_start(void);
+/* checkpoint the history at last and free it */
+void etmemd_hotness_stop(void);
+
+/*
+ * The times to scan the vmas of pid in this cycle, which is 1 if pid has the history left by
+ * the last etmemd for most of its vmas, and loop otherwise.
+ * */
+int etmemd_hotness_scan_loops(unsigned int pid, const struct vmas *vmas, int loop);
+
+/*
+ * The page_refs of pid are scanned for scanned times of loop. Add the counts of the times not
+ * scanned from the history, and keep the hotness of this cycle as the history of pid.
+ * */
+void etmemd_hotness_update(unsigned int pid, const struct vmas *vmas, struct page_refs *page_refs,
+                           int scanned, int loop);
+
+/* write the history of the live pids to the file now */
+int etmemd_hotness_checkpoint(void);
+#endif
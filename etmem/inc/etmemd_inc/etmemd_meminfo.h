@@ -0,0 +1,55 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a header file of the snapshots of /proc/meminfo and /proc/<pid>/status.
+ ******************************************************************************/
+
+#ifndef ETMEMD_MEMINFO_H
+#define ETMEMD_MEMINFO_H
+
+/* the meminfo snapshot shared by the workers is taken again after it is older than this */
+#define MEMINFO_CACHE_MS        1000
+
+/* fields of /proc/meminfo in KB */
+struct meminfo {
+    unsigned long mem_total;
+    unsigned long mem_free;
+    unsigned long mem_available;
+    unsigned long cached;
+    unsigned long swap_cached;
+    unsigned long swap_total;
+    unsigned long swap_free;
+    unsigned long seq;          /* sequence of the shared snapshot, 0 if read directly */
+};
+
+/* fields of /proc/<pid>/status in KB */
+struct pid_status {
+    unsigned long vm_rss;
+    unsigned long vm_swap;
+    unsigned long rss_anon;
+    unsigned long rss_file;
+};
+
+/*
+ * Read all the fields of /proc/meminfo or /proc/<pid>/status in one pass, the fields missing
+ * are left 0, e.g. RssAnon of old kernels. Return -1 if the file can not be read or none of
+ * the fields is found, and for meminfo if MemTotal is not found.
+ * */
+int etmemd_read_meminfo(struct meminfo *info);
+int etmemd_read_pid_status(const char *pid, struct pid_status *status);
+
+/* take a new meminfo snapshot for the workers, called at the start of each cycle */
+int etmemd_refresh_meminfo(void);
+
+/* copy of the meminfo snapshot, which is refreshed first if older than MEMINFO_CACHE_MS */
+int etmemd_get_meminfo(struct meminfo *info);
+#endif
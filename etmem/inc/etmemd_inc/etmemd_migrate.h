@@ -18,6 +18,7 @@
 
 #include "etmemd.h"
 #include "etmemd_task.h"
+#include "etmemd_project_exp.h"
 
 #define COLD_PAGE   "/swap_pages"
 
@@ -26,7 +27,26 @@
 #define SWAP_LIMIT      200
 #define SWAP_ADDR_LEN   20
 
-int etmemd_grade_migrate(const char* pid, const struct memory_grade *memory_grade);
+/* the same as etmemd_grade_evict without a pidfd held, proj may be NULL for no bandwidth limit */
+int etmemd_grade_migrate(const char* pid, const struct memory_grade *memory_grade, struct project *proj);
+
+/*
+ * function: Evict the cold pages of memory_grade with the backend of the project.
+ *
+ * in:  const char *pid                   - pid of the target process
+ *      int pidfd                         - pidfd held for pid, which process_madvise is done
+ *                                          on, -1 to open one for pid
+ *      struct memory_grade *memory_grade - graded pages, only cold_pages are evicted
+ *      struct project *proj              - evict_backend and bandwidth share of the project,
+ *                                          EVICT_AUTO without bandwidth limit if NULL. EVICT_AUTO
+ *                                          uses swap_pages if etmem_swap.ko is loaded, otherwise
+ *                                          MADV_PAGEOUT
+ *
+ * out: 0  - successed to evict
+ *      -1 - failed to evict
+ * */
+int etmemd_grade_evict(const char *pid, int pidfd, const struct memory_grade *memory_grade, struct project *proj);
+enum evict_backend etmemd_resolve_evict_backend(enum evict_backend backend);
 int etmemd_reclaim_swapcache(const struct task_pid *tk_pid);
 unsigned long check_should_migrate(const struct task_pid *tk_pid);
 #endif
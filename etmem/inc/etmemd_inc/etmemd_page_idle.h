@@ -0,0 +1,43 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a header file of the scan backend based on pagemap and page_idle.
+ ******************************************************************************/
+
+#ifndef ETMEMD_PAGE_IDLE_H
+#define ETMEMD_PAGE_IDLE_H
+
+#include "etmemd_scan.h"
+
+#define PAGE_IDLE_BITMAP        "/sys/kernel/mm/page_idle/bitmap"
+
+/*
+ * function: Scan the vmas of pid once through /proc/<pid>/pagemap and the page_idle bitmap,
+ *           the result is merged into page_refs the same way as get_page_refs() does.
+ *           The pages found are marked idle again, so the next call reports the accesses
+ *           in between.
+ *
+ * in:  const struct vmas *vmas    - vmas of the process
+ *      const char *pid            - pid of the process
+ *
+ * out: struct page_refs **page_refs - page_refs list sorted by address
+ *      unsigned long *use_rss       - count of the accessed pages, could be NULL
+ *
+ * return: 0 - successed to scan
+ *         -1 - failed to scan
+ * */
+int get_page_refs_by_page_idle(const struct vmas *vmas, const char *pid, struct page_refs **page_refs,
+                               unsigned long *use_rss);
+
+/* return true if the kernel has idle page tracking */
+bool page_idle_supported(void);
+#endif
@@ -100,4 +100,7 @@ enum opt_result etmemd_project_remove_task(GKeyFile *config);
 
 void etmemd_stop_all_projects(void);
 
+/* call func on the tasks of all the projects in turn, until it returns non-zero */
+int etmemd_project_for_each_task(int (*func)(struct task *tk, void *data), void *data);
+
 #endif
@@ -18,16 +18,28 @@
 
 #include <sys/queue.h>
 #include <stdbool.h>
+#include <glib.h>
 
 enum scan_type {
     PAGE_SCAN = 0,
     REGION_SCAN,
 };
 
-struct page_scan {
-    int interval;
-    int loop;
-    int sleep;
+/* how slide evicts the cold pages */
+enum evict_backend {
+    EVICT_AUTO = 0,
+    EVICT_SWAP_PAGES,       /* /proc/<pid>/swap_pages of etmem_swap.ko */
+    EVICT_PAGEOUT,          /* process_madvise(MADV_PAGEOUT) */
+    EVICT_COLD,             /* process_madvise(MADV_COLD) */
+};
+
+/* how page scan gets the access of pages */
+enum scan_backend {
+    SCAN_BACKEND_AUTO = 0,
+    SCAN_BACKEND_IDLE_PAGES,    /* /proc/<pid>/idle_pages of etmem_scan.ko */
+    SCAN_BACKEND_PAGE_IDLE,     /* /proc/<pid>/pagemap and /sys/kernel/mm/page_idle/bitmap */
+    SCAN_BACKEND_PAGEMAP_SCAN,  /* PAGEMAP_SCAN ioctl of /proc/<pid>/pagemap with soft dirty */
+    SCAN_BACKEND_DAMON,         /* region snapshots of a kdamond monitoring the process */
 };
 
 struct region_scan {
@@ -38,6 +50,26 @@ struct region_scan {
     unsigned long max_nr_regions;
 };
 
+/* kick the scan cycles of a project when the memory stall goes beyond threshold in window */
+struct psi_trigger {
+    char *file;                 /* /proc/pressure/memory or memory.pressure of a cgroup */
+    bool full;                  /* stall of all tasks instead of some */
+    unsigned long threshold;    /* us, 0 to disable */
+    unsigned long window;       /* us */
+    int backoff;                /* at most backoff times interval between cycles without pressure */
+};
+
+struct psi_monitor;
+
+struct page_scan {
+    int interval;
+    int loop;
+    int sleep;
+    enum scan_backend backend;
+    struct region_scan damon;   /* monitoring attributes of SCAN_BACKEND_DAMON */
+    struct psi_trigger psi;
+};
+
 struct project {
     char *name;
     enum scan_type type;
@@ -45,9 +77,14 @@ struct project {
     int sysmem_threshold;
     int swapcache_high_wmark;
     int swapcache_low_wmark;
+    enum evict_backend evict_backend;
+    int bw_weight;
+    int priority;
     bool start;
     bool wmark_set;
     struct engine *engs;
+    struct psi_monitor *psi_monitor;
+    struct bw_share *bw_share;
 
     SLIST_ENTRY(project) entry;
 };
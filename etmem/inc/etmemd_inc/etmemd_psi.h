@@ -0,0 +1,49 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a header file of the memory pressure (PSI) monitor of projects.
+ ******************************************************************************/
+
+#ifndef ETMEMD_PSI_H
+#define ETMEMD_PSI_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include "etmemd_project_exp.h"
+#include "etmemd_threadtimer.h"
+
+#define PSI_MEMORY_FILE             "/proc/pressure/memory"
+
+/* limits of the window of a PSI trigger set by the kernel, in us. Without CAP_SYS_RESOURCE
+ * the window must also be a multiple of 2 seconds, so is the default */
+#define PSI_WINDOW_MIN              500000
+#define PSI_WINDOW_MAX              10000000
+#define PSI_DEFAULT_WINDOW          2000000
+#define PSI_DEFAULT_BACKOFF         4
+#define PSI_MAX_BACKOFF             64
+
+void etmemd_psi_default_trigger(struct psi_trigger *trigger);
+int etmemd_psi_check_trigger(const struct psi_trigger *trigger);
+
+/*
+ * Start to poll the PSI trigger of proj if it is set. The timers added are kicked when the
+ * stall crosses the threshold, and their expired time is doubled for each quiet period up
+ * to backoff times the interval, until the pressure comes back.
+ * The timers keep their own interval if the trigger can not be set.
+ * */
+int etmemd_psi_start(struct project *proj);
+void etmemd_psi_stop(struct project *proj);
+
+/* add or remove a timer of the tasks of proj, nothing is done if proj has no PSI monitor */
+void etmemd_psi_add_timer(struct project *proj, timer_thread *timer);
+void etmemd_psi_del_timer(struct project *proj, timer_thread *timer);
+#endif
@@ -0,0 +1,123 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a header file of the scan record, which keeps what etmemd reads in a file.
+ ******************************************************************************/
+
+#ifndef ETMEMD_RECORD_H
+#define ETMEMD_RECORD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "etmemd_exp.h"
+#include "etmemd_scan_exp.h"
+#include "etmemd_meminfo.h"
+
+#define RECORD_MAGIC            "ETMREC"
+#define RECORD_VERSION          1
+#define RECORD_COMM_LEN         16
+
+enum record_type {
+    RECORD_CONFIG = 1,      /* config file of an obj add or del */
+    RECORD_VMAS,            /* vmas of a pid, which starts a scan cycle of it */
+    RECORD_SCAN,            /* one buffer read from idle_pages of a pid */
+    RECORD_MEMINFO,
+    RECORD_PID_STATUS,
+    RECORD_TYPE_END,
+};
+
+/* layout of the file, all in the byte order of the host */
+struct record_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t page_size[PAGE_TYPE_INVAL];    /* the buffers of idle_pages are parsed by them */
+};
+
+/* followed by len bytes of payload, aligned to 8 */
+struct record_entry {
+    uint32_t type;
+    uint32_t pid;
+    uint64_t time_ns;                       /* CLOCK_MONOTONIC */
+    uint64_t len;
+};
+
+struct record_config {
+    uint32_t cmd;                           /* OBJ_ADD or OBJ_DEL */
+    uint32_t reserved;
+    char data[];                            /* the key file */
+};
+
+struct record_vma {
+    uint64_t start;
+    uint64_t end;
+    uint64_t offset;
+    uint64_t inode;
+    uint32_t stat;                          /* bit i for vma->stat[i] */
+    uint32_t reserved;
+};
+
+struct record_vmas {
+    char comm[RECORD_COMM_LEN];
+    uint64_t nr;
+    struct record_vma vma[];
+};
+
+struct record_scan {
+    uint64_t start;                         /* where the buffer is read from */
+    unsigned char buf[];
+};
+
+struct record_meminfo {
+    uint64_t mem_total;
+    uint64_t mem_free;
+    uint64_t mem_available;
+    uint64_t cached;
+    uint64_t swap_cached;
+    uint64_t swap_total;
+    uint64_t swap_free;
+};
+
+struct record_pid_status {
+    uint64_t vm_rss;
+    uint64_t vm_swap;
+    uint64_t rss_anon;
+    uint64_t rss_file;
+};
+
+/* record what etmemd reads to file since etmemd_record_start */
+int etmemd_record_set_file(const char *file);
+bool etmemd_record_set(void);
+int etmemd_record_start(void);
+void etmemd_record_stop(void);
+
+/* nothing is done by them unless etmemd_record_start is called */
+void etmemd_record_config(unsigned int cmd, const char *data, size_t len);
+void etmemd_record_vmas(const char *pid, const struct vmas *vmas);
+void etmemd_record_scan(unsigned int pid, uint64_t start, const unsigned char *buf, size_t len);
+void etmemd_record_meminfo(const struct meminfo *info);
+void etmemd_record_pid_status(const char *pid, const struct pid_status *status);
+
+/* the whole file is mapped by the reader, and the entries are read one by one */
+struct record_reader {
+    const unsigned char *map;
+    size_t size;
+    size_t pos;
+};
+
+int etmemd_record_open(const char *file, struct record_reader *reader);
+void etmemd_record_close(struct record_reader *reader);
+
+/* return 1 with the next entry and its payload, 0 at the end of the file, -1 if it is broken */
+int etmemd_record_next(struct record_reader *reader, const struct record_entry **entry, const void **payload);
+#endif
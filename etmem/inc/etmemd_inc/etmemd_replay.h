@@ -0,0 +1,39 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a header file of the replay of a scan record.
+ ******************************************************************************/
+
+#ifndef ETMEMD_REPLAY_H
+#define ETMEMD_REPLAY_H
+
+#include <stdbool.h>
+#include "etmemd_meminfo.h"
+
+/* replay the record file, with the projects in config instead of those recorded if it is set */
+int etmemd_replay_set_file(const char *file);
+int etmemd_replay_set_config(const char *config);
+bool etmemd_replay_set(void);
+bool etmemd_replay_config_set(void);
+void etmemd_replay_clear(void);
+
+/*
+ * Feed each scan cycle in the record through the engines of the tasks it belongs to, and print
+ * what they decide and the time each stage takes. No process is touched.
+ * */
+int etmemd_replay(void);
+
+/* the memory samples of the cycle replayed, read in place of /proc while replaying */
+bool etmemd_replay_running(void);
+int etmemd_replay_meminfo(struct meminfo *info);
+int etmemd_replay_pid_status(const char *pid, struct pid_status *status);
+#endif
@@ -17,6 +17,8 @@
 #ifndef ETMEMD_RPC_H
 #define ETMEMD_RPC_H
 #include <stdbool.h>
+#include <glib.h>
+#include "etmemd_project.h"
 
 enum cmd_type {
     OBJ_ADD = 0,
@@ -25,6 +27,9 @@ enum cmd_type {
     MIG_STOP,
     PROJ_SHOW,
     ENG_CMD,
+    TRACE_START,
+    TRACE_STOP,
+    TRACE_DUMP,
 };
 
 enum rpc_decode_type {
@@ -57,4 +62,7 @@ bool etmemd_sock_name_set(void);
 void etmemd_sock_name_free(void);
 int etmemd_deal_systemctl(void);
 
+/* add or remove the objects in the loaded config file, as "etmem obj add/del" does */
+enum opt_result etmemd_obj_cmd(GKeyFile *config, enum cmd_type type);
+
 #endif
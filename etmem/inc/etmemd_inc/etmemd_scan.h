@@ -20,6 +20,7 @@
 #include "etmemd.h"
 #include "etmemd_task.h"
 #include "etmemd_scan_exp.h"
+#include "etmemd_project_exp.h"
 #include "etmemd_common.h"
 
 #define VMA_SEG_CNT_MAX         6
@@ -32,6 +33,9 @@
 #define MAPS_FILE               "/maps"
 #define IDLE_SCAN_FILE          "/idle_pages"
 
+#define PAGEMAP_FILE            "/pagemap"
+#define CLEAR_REFS_FILE         "/clear_refs"
+
 #define SMAPS_FILE              "/smaps"
 #define VMFLAG_HEAD             "VmFlags"
 
@@ -40,6 +44,39 @@
 #define VMA_SCAN_ADD_FLAGS      _IOW(IDLE_SCAN_MAGIC, 0x2, unsigned int)
 #define ALL_SCAN_FLAGS          (SCAN_AS_HUGE | SCAN_IGN_HOST | VMA_SCAN_FLAG)
 
+/* PAGEMAP_SCAN of linux 6.7, and soft dirty category of linux 6.9 */
+#ifndef PAGEMAP_SCAN
+struct page_region {
+    u_int64_t start;
+    u_int64_t end;
+    u_int64_t categories;
+};
+
+struct pm_scan_arg {
+    u_int64_t size;
+    u_int64_t flags;
+    u_int64_t start;
+    u_int64_t end;
+    u_int64_t walk_end;
+    u_int64_t vec;
+    u_int64_t vec_len;
+    u_int64_t max_pages;
+    u_int64_t category_inverted;
+    u_int64_t category_mask;
+    u_int64_t category_anyof_mask;
+    u_int64_t return_mask;
+};
+
+#define PAGEMAP_SCAN            _IOWR('f', 16, struct pm_scan_arg)
+#define PAGE_IS_PRESENT         (1 << 3)
+#define PAGE_IS_PFNZERO         (1 << 5)
+#define PAGE_IS_HUGE            (1 << 6)
+#endif
+#ifndef PAGE_IS_SOFT_DIRTY
+#define PAGE_IS_SOFT_DIRTY      (1 << 7)
+#endif
+#define PAGEMAP_SCAN_RETURN_MASK (PAGE_IS_PRESENT | PAGE_IS_PFNZERO | PAGE_IS_HUGE | PAGE_IS_SOFT_DIRTY)
+
 enum page_idle_type {
     PTE_ACCESS = 0,     /* 4k page */
     PMD_ACCESS,         /* 2M page */
@@ -66,6 +103,7 @@ struct walk_address {
     uint64_t walk_start;                /* walk address start */
     uint64_t walk_end;                  /* walk address end */
     uint64_t last_walk_end;             /* last walk address end */
+    unsigned int pid;                   /* pid of the idle_pages walked, for the scan record and trace */
 };
 
 /* the caller need to judge value returned by etmemd_do_scan(), NULL means fail. */
@@ -77,6 +115,29 @@ void free_vmas(struct vmas *vmas);
 struct page_refs **walk_vmas(int fd, struct walk_address *walk_address, struct page_refs **pf, unsigned long *use_rss);
 int get_page_refs(const struct vmas *vmas, const char *pid, struct page_refs **page_refs,
                   unsigned long *use_rss, struct ioctl_para *ioctl_para);
+struct page_refs **update_page_refs(u_int64_t addr, int weight, enum page_type type, struct page_refs **page_refs);
+
+/*
+ * Parse a buffer read from idle_pages into the page_refs list from *pos, and move *pos past the
+ * last page updated, so the next buffer of higher addresses goes on from there.
+ * */
+int etmemd_parse_scan_buf(const unsigned char *buf, size_t size, struct page_refs ***pos);
+
+bool pagemap_scan_supported(void);
+int get_page_refs_by_pagemap_scan(const struct vmas *vmas, const char *pid, struct page_refs **page_refs,
+                                  unsigned long *use_rss);
+
+/*
+ * SCAN_BACKEND_AUTO resolves to idle_pages if etmem_scan.ko is loaded, otherwise page_idle if the
+ * kernel has it. pagemap_scan, which only sees writes, is used only if set, and falls back to
+ * idle_pages like damon if not supported.
+ * */
+enum scan_backend etmemd_resolve_scan_backend(enum scan_backend backend);
+
+/* scan the vmas once with a resolved backend, ioctl_para is only used by idle_pages */
+int etmemd_get_page_refs_by_backend(enum scan_backend backend, const struct page_scan *page_scan,
+                                    const struct vmas *vmas, const char *pid, struct page_refs **page_refs,
+                                    unsigned long *use_rss, struct ioctl_para *ioctl_para);
 
 int split_vmflags(char ***vmflags_array, char *vmflags);
 struct vmas *get_vmas_with_flags(const char *pid, char **vmflags_array, int vmflags_num, bool is_anon_only);
@@ -25,6 +25,7 @@
 
 struct task_pid {
     unsigned int pid;
+    int pidfd;              /* handle of the process, -1 if pidfd is not supported */
     float rt_swapin_rate;   /* real time swapin rate */
     void *params;           /* pid personal parameter */
     struct task *tk;        /* point to its task */
@@ -41,6 +42,9 @@ void etmemd_free_task_struct(struct task **tk);
 
 void free_task_pid_mem(struct task_pid **tk_pid);
 
+/* false once the process exits, even if its pid is used by another process later */
+bool etmemd_task_pid_alive(const struct task_pid *tk_pid);
+
 void etmemd_print_tasks(int fd, const struct task *tk, char *engine_name, bool started);
 
 struct task *etmemd_add_task(GKeyFile *config);
@@ -23,6 +23,7 @@ struct timer_thread_t;
 typedef struct timer_thread_t timer_thread;
 struct thread_pool_t;
 typedef struct thread_pool_t thread_pool;
+struct cgroup_watch;
 
 struct task {
     char *type;
@@ -37,6 +38,7 @@ struct task {
     pthread_t task_pt;
     timer_thread *timer_inst;
     thread_pool *threadpool_inst;
+    struct cgroup_watch *cgroup;    /* only for the task of cgroup type */
 
     struct task *next;
 };
@@ -22,6 +22,7 @@ typedef struct timer_thread_t {
     pthread_mutex_t cond_mutex;
     pthread_cond_t cond;
     bool down;
+    bool kicked;            /* protected by cond_mutex */
     user_functional functor;
     void *user_param;
     int expired_time;
@@ -43,6 +44,17 @@ int thread_timer_start(timer_thread* inst, void *(*executor)(void *arg), void *a
  * */
 void thread_timer_stop(timer_thread* inst);
 
+/*
+ * Run the timer now instead of waiting for the expired time,
+ * the wait restarts from the end of the run
+ * */
+void thread_timer_kick(timer_thread* inst);
+
+/*
+ * Change the expired time, which takes effect from the next wait
+ * */
+void thread_timer_set_expired_time(timer_thread* inst, int seconds);
+
 /*
  * Destroy the timer instance
  * */
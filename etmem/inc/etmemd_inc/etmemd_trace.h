@@ -0,0 +1,66 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a header file of the tracer of the stages of each scan cycle.
+ ******************************************************************************/
+
+#ifndef ETMEMD_TRACE_H
+#define ETMEMD_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* events kept for each thread, the oldest are overwritten */
+#define TRACE_BUF_EVENTS        8192
+
+enum trace_stage {
+    TRACE_CYCLE = 0,            /* a cycle of the timer of a task */
+    TRACE_GET_PIDS,
+    TRACE_POOL_WAIT,            /* polling for the workers of the cycle to finish */
+    TRACE_CHECK_SWAP,
+    TRACE_SCAN,
+    TRACE_GET_VMAS,
+    TRACE_READ_IDLE,            /* read of idle_pages for a vma */
+    TRACE_PARSE,
+    TRACE_SCAN_SLEEP,
+    TRACE_SORT,
+    TRACE_POLICY,
+    TRACE_EVICT,
+    TRACE_RECLAIM_SWAPCACHE,
+    TRACE_STAGE_END,
+};
+
+struct trace_event {
+    uint64_t time_ns;           /* CLOCK_MONOTONIC */
+    uint32_t tid;
+    uint32_t pid;               /* the task pid, 0 for none */
+    uint16_t stage;
+    uint16_t phase;             /* 'B' or 'E' */
+};
+
+/* nothing is recorded by begin and end until start */
+void etmemd_trace_start(void);
+void etmemd_trace_stop(void);
+bool etmemd_trace_enabled(void);
+
+void etmemd_trace_begin(enum trace_stage stage, unsigned int pid);
+void etmemd_trace_end(enum trace_stage stage, unsigned int pid);
+
+/*
+ * Write the events recorded since the last dump to fd as Chrome trace-event JSON, which is
+ * loaded by Perfetto or chrome://tracing.
+ * */
+int etmemd_trace_dump(int fd);
+
+/* free the buffers of the threads exited and of the caller */
+void etmemd_trace_exit(void);
+#endif
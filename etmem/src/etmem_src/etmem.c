@@ -22,6 +22,7 @@
 #include "etmem_obj.h"
 #include "etmem_project.h"
 #include "etmem_engine.h"
+#include "etmem_trace.h"
 
 SLIST_HEAD(etmem_obj_list, etmem_obj) g_etmem_objs;
 
@@ -32,8 +33,8 @@ static void usage(void)
             "    etmem OBJECT COMMAND\n"
             "    etmem help\n"
             "\nParameters:\n"
-            "    OBJECT  := { project | obj | engine }\n"
-            "    COMMAND := { add | del | start | stop | show | eng_cmd | help }\n");
+            "    OBJECT  := { project | obj | engine | trace }\n"
+            "    COMMAND := { add | del | start | stop | show | eng_cmd | dump | help }\n");
 }
 
 static struct etmem_obj *etmem_obj_get(const char *name)
@@ -120,6 +121,7 @@ int main(int argc, char *argv[])
     project_init();
     obj_init();
     engine_init();
+    trace_init();
 
     if (parse_args(argc, argv, &conf, &obj) != 0) {
         if (conf.obj != NULL && strcmp(conf.obj, "help") == 0 &&
@@ -145,6 +147,7 @@ int main(int argc, char *argv[])
     }
 
 out:
+    trace_exit();
     engine_exit();
     obj_exit();
     project_exit();
@@ -0,0 +1,140 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a source file of the etmem trace function.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include "securec.h"
+#include "etmem.h"
+#include "etmem_trace.h"
+#include "etmem_rpc.h"
+#include "etmem_common.h"
+
+static void trace_help(void)
+{
+    fprintf(stdout,
+            "\nUsage:\n"
+            "    etmem trace start [options]\n"
+            "    etmem trace stop [options]\n"
+            "    etmem trace dump [options]\n"
+            "    etmem trace help\n"
+            "\nOptions:\n"
+            "    -s|--socket <socket_name> Socket name to connect\n"
+            "\nNotes:\n"
+            "    1. Socket name must be given.\n"
+            "    2. dump prints the stages traced since the last dump as Chrome trace-event JSON,\n"
+            "       e.g. etmem trace dump -s etmemd_socket > trace.json, which is opened by Perfetto.\n");
+}
+
+struct trace_cmd_item {
+    char *cmd_name;
+    enum etmem_cmd_e cmd;
+};
+
+static struct trace_cmd_item g_trace_cmd_items[] = {
+    {"start", ETMEM_CMD_TRACE_START},
+    {"stop", ETMEM_CMD_TRACE_STOP},
+    {"dump", ETMEM_CMD_TRACE_DUMP},
+};
+
+static int trace_parse_cmd(struct etmem_conf *conf, struct mem_proj *proj)
+{
+    unsigned i;
+    char *cmd = NULL;
+
+    cmd = conf->argv[0];
+    for (i = 0; i < ARRAY_SIZE(g_trace_cmd_items); i++) {
+        if (strcmp(cmd, g_trace_cmd_items[i].cmd_name) == 0) {
+            proj->cmd = g_trace_cmd_items[i].cmd;
+            return 0;
+        }
+    }
+
+    printf("trace cmd %s is not supported\n", cmd);
+    return -1;
+}
+
+static int trace_parse_args(const struct etmem_conf *conf, struct mem_proj *proj)
+{
+    int opt;
+    int params_cnt = 0;
+    struct option opts[] = {
+        {"socket", required_argument, NULL, 's'},
+        {NULL, 0, NULL, 0},
+    };
+
+    while ((opt = getopt_long(conf->argc, conf->argv, "s:", opts, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                proj->sock_name = optarg;
+                break;
+            case '?':
+                /* fallthrough */
+            default:
+                printf("invalid option: %s\n", conf->argv[optind]);
+                return -EINVAL;
+        }
+        params_cnt++;
+    }
+
+    return etmem_parse_check_result(params_cnt, conf->argc);
+}
+
+static int trace_do_cmd(struct etmem_conf *conf)
+{
+    struct mem_proj proj;
+    int ret;
+
+    ret = memset_s(&proj, sizeof(struct mem_proj), 0, sizeof(struct mem_proj));
+    if (ret != EOK) {
+        printf("memset_s for mem_proj failed.\n");
+        return ret;
+    }
+
+    ret = trace_parse_cmd(conf, &proj);
+    if (ret != 0) {
+        return ret;
+    }
+
+    ret = trace_parse_args(conf, &proj);
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (proj.sock_name == NULL || strlen(proj.sock_name) == 0) {
+        printf("socket name to connect must be given, please check.\n");
+        return -EINVAL;
+    }
+
+    return etmem_rpc_client(&proj);
+}
+
+static struct etmem_obj g_etmem_trace = {
+    .name = "trace",
+    .help = trace_help,
+    .do_cmd = trace_do_cmd,
+};
+
+void trace_init(void)
+{
+    etmem_register_obj(&g_etmem_trace);
+}
+
+void trace_exit(void)
+{
+    etmem_unregister_obj(&g_etmem_trace);
+}
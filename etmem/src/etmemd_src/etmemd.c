@@ -21,6 +21,10 @@
 #include "etmemd_common.h"
 #include "etmemd_project.h"
 #include "etmemd_scan.h"
+#include "etmemd_hotness.h"
+#include "etmemd_record.h"
+#include "etmemd_replay.h"
+#include "etmemd_trace.h"
 
 int main(int argc, char *argv[])
 {
@@ -40,11 +44,26 @@ int main(int argc, char *argv[])
         return -1;
     }
 
+    if (etmemd_replay_set()) {
+        return etmemd_replay();
+    }
+
+    if (etmemd_record_start() != 0) {
+        return -1;
+    }
+
+    if (etmemd_hotness_start() != 0) {
+        etmemd_log(ETMEMD_LOG_WARN, "start without hotness history\n");
+    }
+
     etmemd_handle_signal();
     if (etmemd_rpc_server() != 0) {
         printf("fail to start rpc server of etmemd\n");
     }
 
     etmemd_stop_all_projects();
+    etmemd_trace_exit();
+    etmemd_hotness_stop();
+    etmemd_record_stop();
     return 0;
 }
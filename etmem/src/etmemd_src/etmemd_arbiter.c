@@ -0,0 +1,232 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: Share the eviction needed by the host among the coldest pages of all projects.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/queue.h>
+
+#include "securec.h"
+#include "etmemd_log.h"
+#include "etmemd_common.h"
+#include "etmemd_meminfo.h"
+#include "etmemd_arbiter.h"
+
+#define MSEC_PER_SEC            1000
+#define NSEC_PER_MSEC           1000000
+
+struct arb_report {
+    const struct project *proj;
+    unsigned int pid;
+    time_t expire;
+    unsigned long bytes[ARB_RANK_NR];
+    SLIST_ENTRY(arb_report) entry;
+};
+
+static SLIST_HEAD(arb_report_list, arb_report) g_reports = SLIST_HEAD_INITIALIZER(g_reports);
+static pthread_mutex_t g_arb_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct timespec g_swapcache_kick;
+/* bytes granted since the meminfo snapshot of seq, which are not freed in it yet */
+static unsigned long g_granted;
+static unsigned long g_granted_seq;
+
+static time_t arb_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+int etmemd_arb_rank(int count, int max_count, int priority)
+{
+    int level;
+
+    if (max_count <= 0 || count < 0) {
+        level = 0;
+    } else if (count >= max_count) {
+        level = ARB_COLD_LEVELS - 1;
+    } else {
+        level = count * ARB_COLD_LEVELS / max_count;
+    }
+
+    if (priority < 0) {
+        priority = 0;
+    } else if (priority > ARB_PRIORITY_MAX) {
+        priority = ARB_PRIORITY_MAX;
+    }
+
+    return level + priority;
+}
+
+static void arb_prune_locked(time_t now)
+{
+    struct arb_report *report = SLIST_FIRST(&g_reports);
+    struct arb_report *next = NULL;
+
+    while (report != NULL) {
+        next = SLIST_NEXT(report, entry);
+        if (report->expire < now) {
+            SLIST_REMOVE(&g_reports, report, arb_report, entry);
+            free(report);
+        }
+        report = next;
+    }
+}
+
+static struct arb_report *arb_get_report_locked(const struct project *proj, unsigned int pid)
+{
+    struct arb_report *report = NULL;
+
+    SLIST_FOREACH(report, &g_reports, entry) {
+        if (report->proj == proj && report->pid == pid) {
+            return report;
+        }
+    }
+
+    report = (struct arb_report *)calloc(1, sizeof(struct arb_report));
+    if (report == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for arbiter report fail\n");
+        return NULL;
+    }
+    report->proj = proj;
+    report->pid = pid;
+    SLIST_INSERT_HEAD(&g_reports, report, entry);
+    return report;
+}
+
+/* bytes to evict to get the free memory back to sysmem_threshold of proj, in the view of snapshot seq */
+static unsigned long get_sysmem_deficit(const struct project *proj, unsigned long *seq)
+{
+    struct meminfo info;
+    unsigned long target;
+
+    /* no snapshot, which is older than any granted */
+    *seq = 0;
+    if (etmemd_get_meminfo(&info) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "get meminfo fail\n");
+        return 0;
+    }
+
+    *seq = info.seq;
+    target = info.mem_total / 100 * (unsigned long)proj->sysmem_threshold;
+    return target > info.mem_free ? KB_TO_BYTE(target - info.mem_free) : 0;
+}
+
+unsigned long etmemd_arb_budget(const struct project *proj, unsigned int pid,
+                                const unsigned long bytes[ARB_RANK_NR], int ttl)
+{
+    unsigned long total[ARB_RANK_NR] = {0};
+    unsigned long budget = 0;
+    unsigned long covered = 0;
+    unsigned long deficit, seq, take;
+    struct arb_report *report = NULL;
+    struct arb_report *iter = NULL;
+    time_t now = arb_now();
+    int r;
+
+    deficit = get_sysmem_deficit(proj, &seq);
+
+    pthread_mutex_lock(&g_arb_mtx);
+    /* a new snapshot has seen the pages granted before freed */
+    if (seq > g_granted_seq) {
+        g_granted_seq = seq;
+        g_granted = 0;
+    }
+    deficit = deficit > g_granted ? deficit - g_granted : 0;
+
+    arb_prune_locked(now);
+
+    report = arb_get_report_locked(proj, pid);
+    if (report == NULL) {
+        pthread_mutex_unlock(&g_arb_mtx);
+        /* evict on its own as if there were no arbiter */
+        return deficit;
+    }
+    if (memcpy_s(report->bytes, sizeof(report->bytes), bytes, sizeof(report->bytes)) != EOK) {
+        etmemd_log(ETMEMD_LOG_ERR, "copy arbiter report of pid %u fail\n", pid);
+    }
+    report->expire = now + ttl;
+
+    SLIST_FOREACH(iter, &g_reports, entry) {
+        for (r = 0; r < ARB_RANK_NR; r++) {
+            total[r] += iter->bytes[r];
+        }
+    }
+
+    /* cut the ranks from the coldest one until deficit is covered, the last rank is shared in proportion */
+    for (r = 0; r < ARB_RANK_NR && covered < deficit; r++) {
+        if (covered + total[r] <= deficit) {
+            take = report->bytes[r];
+        } else {
+            take = (unsigned long)((double)report->bytes[r] * (deficit - covered) / total[r]);
+        }
+        covered += total[r];
+        budget += take;
+        /* the pages granted are gone, the others need not count on them any more */
+        report->bytes[r] -= take;
+    }
+    g_granted += budget;
+
+    pthread_mutex_unlock(&g_arb_mtx);
+    return budget;
+}
+
+void etmemd_arb_forget(const struct project *proj)
+{
+    struct arb_report *report = NULL;
+    struct arb_report *next = NULL;
+
+    pthread_mutex_lock(&g_arb_mtx);
+    report = SLIST_FIRST(&g_reports);
+    while (report != NULL) {
+        next = SLIST_NEXT(report, entry);
+        if (report->proj == proj) {
+            SLIST_REMOVE(&g_reports, report, arb_report, entry);
+            free(report);
+        }
+        report = next;
+    }
+    pthread_mutex_unlock(&g_arb_mtx);
+}
+
+bool etmemd_arb_swapcache_kicked(void)
+{
+    struct timespec now;
+    struct timespec kick;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&g_arb_mtx);
+    kick = g_swapcache_kick;
+    pthread_mutex_unlock(&g_arb_mtx);
+
+    if (kick.tv_sec == 0 && kick.tv_nsec == 0) {
+        return false;
+    }
+
+    /* the kernel has not reclaimed the swapcache before the next meminfo snapshot */
+    return (now.tv_sec - kick.tv_sec) * MSEC_PER_SEC + (now.tv_nsec - kick.tv_nsec) / NSEC_PER_MSEC <
+           MEMINFO_CACHE_MS;
+}
+
+void etmemd_arb_swapcache_kick(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&g_arb_mtx);
+    g_swapcache_kick = now;
+    pthread_mutex_unlock(&g_arb_mtx);
+}
@@ -0,0 +1,207 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: Token buckets of swap out and migration bandwidth shared by the projects.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/queue.h>
+
+#include "etmemd_log.h"
+#include "etmemd_bandwidth.h"
+
+#define BW_BURST_SEC            1
+#define BW_MIN_WAIT_US          10000
+#define BW_MAX_WAIT_US          1000000
+#define USEC_PER_SEC            1000000
+#define NSEC_PER_SEC            1000000000
+#define MB_TO_BYTE(mb)          ((double)(mb) * (1 << 20))
+
+struct bw_share {
+    const char *name;
+    int weight;
+    double tokens[BW_CLASS_NR];
+    SLIST_ENTRY(bw_share) entry;
+};
+
+struct bw_governor {
+    double rate[BW_CLASS_NR];   /* bytes per second, 0 for no limit */
+    double spare[BW_CLASS_NR];  /* refilled tokens the full shares could not hold */
+    int total_weight;
+    struct timespec last;
+    pthread_mutex_t mtx;
+    SLIST_HEAD(bw_share_list, bw_share) shares;
+};
+
+static struct bw_governor g_bw = {
+    .mtx = PTHREAD_MUTEX_INITIALIZER,
+    .shares = SLIST_HEAD_INITIALIZER(g_bw.shares),
+};
+
+int etmemd_bw_set_rate(enum bw_class cls, unsigned long rate)
+{
+    if (cls >= BW_CLASS_NR || rate > BW_RATE_MAX) {
+        etmemd_log(ETMEMD_LOG_ERR, "bandwidth %lu MB/s must not be larger than %d\n", rate, BW_RATE_MAX);
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_bw.mtx);
+    g_bw.rate[cls] = MB_TO_BYTE(rate);
+    g_bw.spare[cls] = 0;
+    pthread_mutex_unlock(&g_bw.mtx);
+    return 0;
+}
+
+bool etmemd_bw_limited(enum bw_class cls)
+{
+    bool limited;
+
+    pthread_mutex_lock(&g_bw.mtx);
+    limited = g_bw.rate[cls] > 0;
+    pthread_mutex_unlock(&g_bw.mtx);
+    return limited;
+}
+
+static double share_rate(const struct bw_share *share, enum bw_class cls)
+{
+    return g_bw.rate[cls] * share->weight / g_bw.total_weight;
+}
+
+/* hand out the tokens since last refill by weight, the overflow of full shares goes to spare */
+static void bw_refill_locked(void)
+{
+    struct bw_share *share = NULL;
+    struct timespec now;
+    double elapsed, cap, add;
+    int cls;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = (double)(now.tv_sec - g_bw.last.tv_sec) + (double)(now.tv_nsec - g_bw.last.tv_nsec) / NSEC_PER_SEC;
+    g_bw.last = now;
+    if (elapsed <= 0) {
+        return;
+    }
+
+    for (cls = 0; cls < BW_CLASS_NR; cls++) {
+        if (g_bw.rate[cls] == 0) {
+            continue;
+        }
+
+        add = g_bw.rate[cls] * elapsed;
+        SLIST_FOREACH(share, &g_bw.shares, entry) {
+            cap = share_rate(share, cls) * BW_BURST_SEC;
+            share->tokens[cls] += share_rate(share, cls) * elapsed;
+            if (share->tokens[cls] > cap) {
+                g_bw.spare[cls] += share->tokens[cls] - cap;
+                share->tokens[cls] = cap;
+            }
+            add -= share_rate(share, cls) * elapsed;
+        }
+
+        /* nothing is left to the spare by weight, but all the rate when there is no share */
+        g_bw.spare[cls] += add > 0 ? add : 0;
+        cap = g_bw.rate[cls] * BW_BURST_SEC;
+        if (g_bw.spare[cls] > cap) {
+            g_bw.spare[cls] = cap;
+        }
+    }
+}
+
+struct bw_share *etmemd_bw_share_alloc(const char *name, int weight)
+{
+    struct bw_share *share = NULL;
+
+    if (weight < 1 || weight > BW_WEIGHT_MAX) {
+        etmemd_log(ETMEMD_LOG_ERR, "bandwidth weight %d must be between 1 and %d\n", weight, BW_WEIGHT_MAX);
+        return NULL;
+    }
+
+    share = (struct bw_share *)calloc(1, sizeof(struct bw_share));
+    if (share == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for bandwidth share fail\n");
+        return NULL;
+    }
+    share->name = name;
+    share->weight = weight;
+
+    pthread_mutex_lock(&g_bw.mtx);
+    bw_refill_locked();
+    SLIST_INSERT_HEAD(&g_bw.shares, share, entry);
+    g_bw.total_weight += weight;
+    pthread_mutex_unlock(&g_bw.mtx);
+    return share;
+}
+
+void etmemd_bw_share_free(struct bw_share *share)
+{
+    if (share == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_bw.mtx);
+    bw_refill_locked();
+    SLIST_REMOVE(&g_bw.shares, share, bw_share, entry);
+    g_bw.total_weight -= share->weight;
+    pthread_mutex_unlock(&g_bw.mtx);
+    free(share);
+}
+
+void etmemd_bw_acquire(struct bw_share *share, enum bw_class cls, unsigned long bytes)
+{
+    double *tokens = NULL;
+    double wait_us, move;
+    bool waited = false;
+
+    if (share == NULL || cls >= BW_CLASS_NR) {
+        return;
+    }
+    tokens = &share->tokens[cls];
+
+    while (true) {
+        pthread_mutex_lock(&g_bw.mtx);
+        if (g_bw.rate[cls] == 0) {
+            pthread_mutex_unlock(&g_bw.mtx);
+            return;
+        }
+
+        bw_refill_locked();
+        if (*tokens + g_bw.spare[cls] > 0) {
+            *tokens -= (double)bytes;
+            if (*tokens < 0) {
+                move = g_bw.spare[cls] < -*tokens ? g_bw.spare[cls] : -*tokens;
+                g_bw.spare[cls] -= move;
+                *tokens += move;
+            }
+            pthread_mutex_unlock(&g_bw.mtx);
+            break;
+        }
+
+        /* wait until the own share pays the debt back */
+        wait_us = -*tokens / share_rate(share, cls) * USEC_PER_SEC;
+        pthread_mutex_unlock(&g_bw.mtx);
+
+        if (!waited) {
+            etmemd_log(ETMEMD_LOG_DEBUG, "bandwidth of %s is used up, wait for %.0f us\n", share->name, wait_us);
+            waited = true;
+        }
+        if (wait_us < BW_MIN_WAIT_US) {
+            wait_us = BW_MIN_WAIT_US;
+        } else if (wait_us > BW_MAX_WAIT_US) {
+            wait_us = BW_MAX_WAIT_US;
+        }
+        usleep((useconds_t)wait_us);
+    }
+}
@@ -0,0 +1,579 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: Get the pids and the memory of a cgroup v2 for the cgroup task type.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/inotify.h>
+
+#include "securec.h"
+#include "etmemd_common.h"
+#include "etmemd_log.h"
+#include "etmemd_meminfo.h"
+#include "etmemd_cgroup.h"
+
+#define CGROUP_FILE_BUF_LEN     4096
+#define CGROUP_PROCS            "cgroup.procs"
+#define CGROUP_EVENTS           "cgroup.events"
+#define CGROUP_POPULATED        "populated"
+#define CGROUP_MEM_CURRENT      "memory.current"
+#define CGROUP_MEM_MAX          "memory.max"
+#define CGROUP_MEM_SWAP         "memory.swap.current"
+#define CGROUP_MEM_STAT         "memory.stat"
+#define CGROUP_NO_LIMIT         "max"
+#define MSEC_PER_SEC            1000
+#define NSEC_PER_MSEC           1000000
+
+struct cgroup_watch {
+    char path[PATH_MAX];        /* directory of the cgroup, ends with '/' */
+    int fd;                     /* inotify of cgroup.events, -1 if not watched */
+    bool populated;
+
+    char *procs;                /* cgroup.procs last time */
+    size_t procs_len;
+
+    pthread_mutex_t mtx;        /* protect the memory snapshot for the workers */
+    struct cgroup_mem mem;
+    struct timespec mem_time;
+    bool mem_valid;
+};
+
+struct stat_field {
+    const char *key;
+    size_t len;
+    size_t offset;
+};
+
+#define STAT_FIELD(key, member) {(key), sizeof(key) - 1, offsetof(struct cgroup_mem, member)}
+
+static const struct stat_field g_mem_stat_fields[] = {
+    STAT_FIELD("anon", anon),
+    STAT_FIELD("file", file),
+    STAT_FIELD("file_mapped", file_mapped),
+};
+
+int etmemd_cgroup_check_value(const char *value)
+{
+    if (value == NULL || strlen(value) == 0 || strstr(value, "..") != NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "invalid cgroup %s, it should be under %s\n",
+                   value == NULL ? "" : value, CGROUP_ROOT);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int cgroup_file(const struct cgroup_watch *cg, const char *name, char *file, size_t size)
+{
+    char root_path[PATH_MAX] = {0};
+    const char *root = etmemd_root_path("/", root_path, sizeof(root_path));
+
+    /* cg->path starts with '/', so the root is joined to it without that */
+    if (root == NULL || snprintf_s(file, size, size - 1, "%s%s%s", root, cg->path + 1, name) <= 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "snprintf path of %s%s fail\n", cg->path, name);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* the files may be gone with the cgroup at any time, so that is not an error */
+static char *read_cgroup_file(const struct cgroup_watch *cg, const char *name, size_t *len)
+{
+    char file[PATH_MAX] = {0};
+    size_t size = CGROUP_FILE_BUF_LEN;
+    size_t total = 0;
+    char *buf = NULL;
+    char *tmp = NULL;
+    ssize_t ret = 0;
+    int fd;
+
+    if (cgroup_file(cg, name, file, sizeof(file)) != 0) {
+        return NULL;
+    }
+
+    fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        etmemd_log(ETMEMD_LOG_DEBUG, "open %s fail, error: %d\n", file, errno);
+        return NULL;
+    }
+
+    buf = (char *)malloc(size);
+    while (buf != NULL) {
+        ret = read(fd, buf + total, size - 1 - total);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            break;
+        }
+        total += (size_t)ret;
+        if (total < size - 1) {
+            continue;
+        }
+        /* cgroup.procs grows with the pids */
+        size *= 2;
+        tmp = (char *)realloc(buf, size);
+        if (tmp == NULL) {
+            free(buf);
+            buf = NULL;
+            break;
+        }
+        buf = tmp;
+    }
+    close(fd);
+
+    if (buf == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for reading %s fail\n", file);
+        return NULL;
+    }
+    if (ret < 0) {
+        etmemd_log(ETMEMD_LOG_DEBUG, "read %s fail, error: %d\n", file, errno);
+        free(buf);
+        return NULL;
+    }
+
+    buf[total] = '\0';
+    if (len != NULL) {
+        *len = total;
+    }
+    return buf;
+}
+
+/* lines are "key value", fill the matched fields of mem */
+static void parse_mem_stat(char *buf, struct cgroup_mem *mem)
+{
+    char *line = buf;
+    char *space = NULL;
+    char *end = NULL;
+    size_t i;
+
+    while (line != NULL && *line != '\0') {
+        end = strchr(line, '\n');
+        space = strchr(line, ' ');
+        if (space != NULL && (end == NULL || space < end)) {
+            for (i = 0; i < ARRAY_SIZE(g_mem_stat_fields); i++) {
+                if (g_mem_stat_fields[i].len == (size_t)(space - line) &&
+                    memcmp(g_mem_stat_fields[i].key, line, g_mem_stat_fields[i].len) == 0) {
+                    *(unsigned long *)((char *)mem + g_mem_stat_fields[i].offset) =
+                        BYTE_TO_KB(strtoul(space + 1, NULL, DECIMAL_RADIX));
+                    break;
+                }
+            }
+        }
+        line = end != NULL ? end + 1 : NULL;
+    }
+}
+
+/* read the file of a single value in KB, which is 0 if it is "max" */
+static int read_cgroup_kb(const struct cgroup_watch *cg, const char *name, unsigned long *val)
+{
+    char *buf = read_cgroup_file(cg, name, NULL);
+
+    if (buf == NULL) {
+        return -1;
+    }
+
+    if (strncmp(buf, CGROUP_NO_LIMIT, strlen(CGROUP_NO_LIMIT)) == 0) {
+        *val = 0;
+    } else {
+        *val = BYTE_TO_KB(strtoul(buf, NULL, DECIMAL_RADIX));
+    }
+
+    free(buf);
+    return 0;
+}
+
+static int read_cgroup_mem(const struct cgroup_watch *cg, struct cgroup_mem *mem)
+{
+    char *buf = NULL;
+
+    if (memset_s(mem, sizeof(struct cgroup_mem), 0, sizeof(struct cgroup_mem)) != EOK) {
+        etmemd_log(ETMEMD_LOG_ERR, "memset cgroup memory fail\n");
+        return -1;
+    }
+
+    if (read_cgroup_kb(cg, CGROUP_MEM_CURRENT, &mem->current) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "get memory of cgroup %s fail\n", cg->path);
+        return -1;
+    }
+
+    /* no limit in the root cgroup, and no swap without swap accounting */
+    (void)read_cgroup_kb(cg, CGROUP_MEM_MAX, &mem->max);
+    (void)read_cgroup_kb(cg, CGROUP_MEM_SWAP, &mem->swap);
+
+    buf = read_cgroup_file(cg, CGROUP_MEM_STAT, NULL);
+    if (buf == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "get memory stat of cgroup %s fail\n", cg->path);
+        return -1;
+    }
+    parse_mem_stat(buf, mem);
+    free(buf);
+
+    return 0;
+}
+
+static bool read_populated(const struct cgroup_watch *cg)
+{
+    char *buf = read_cgroup_file(cg, CGROUP_EVENTS, NULL);
+    char *field = NULL;
+    bool populated = false;
+
+    if (buf == NULL) {
+        return false;
+    }
+
+    field = strstr(buf, CGROUP_POPULATED " ");
+    if (field != NULL) {
+        populated = strtoul(field + strlen(CGROUP_POPULATED " "), NULL, DECIMAL_RADIX) != 0;
+    }
+
+    free(buf);
+    return populated;
+}
+
+/*
+ * cgroup.events is modified when the cgroup gets populated or empty, and the watch
+ * is removed with the cgroup. Without cgroup.events, cgroup.procs is read each time.
+ * */
+static void watch_events(struct cgroup_watch *cg)
+{
+    char file[PATH_MAX] = {0};
+
+    cg->populated = true;
+    if (cgroup_file(cg, CGROUP_EVENTS, file, sizeof(file)) != 0) {
+        return;
+    }
+
+    cg->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (cg->fd < 0) {
+        etmemd_log(ETMEMD_LOG_WARN, "init inotify for cgroup %s fail, error: %d\n", cg->path, errno);
+        return;
+    }
+
+    if (inotify_add_watch(cg->fd, file, IN_MODIFY | IN_DELETE_SELF) < 0) {
+        etmemd_log(ETMEMD_LOG_DEBUG, "watch %s fail, error: %d\n", file, errno);
+        close(cg->fd);
+        cg->fd = -1;
+        return;
+    }
+
+    cg->populated = read_populated(cg);
+}
+
+static void unwatch_events(struct cgroup_watch *cg)
+{
+    if (cg->fd >= 0) {
+        close(cg->fd);
+        cg->fd = -1;
+    }
+}
+
+static void check_events(struct cgroup_watch *cg)
+{
+    char buf[sizeof(struct inotify_event) + NAME_MAX + 1]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *event = NULL;
+    bool modified = false;
+    bool gone = false;
+    ssize_t len;
+    char *ptr = NULL;
+
+    while ((len = read(cg->fd, buf, sizeof(buf))) > 0) {
+        for (ptr = buf; ptr < buf + len; ptr += sizeof(struct inotify_event) + event->len) {
+            event = (const struct inotify_event *)ptr;
+            if ((event->mask & (IN_DELETE_SELF | IN_IGNORED)) != 0) {
+                gone = true;
+            } else if ((event->mask & IN_MODIFY) != 0) {
+                modified = true;
+            }
+        }
+    }
+
+    /* watch it again in case the cgroup is created again */
+    if (gone) {
+        etmemd_log(ETMEMD_LOG_DEBUG, "cgroup %s is removed\n", cg->path);
+        unwatch_events(cg);
+        watch_events(cg);
+        return;
+    }
+
+    if (modified) {
+        cg->populated = read_populated(cg);
+    }
+}
+
+struct cgroup_watch *etmemd_cgroup_watch(const char *value)
+{
+    struct cgroup_watch *cg = NULL;
+    const char *root = value[0] == '/' ? "" : CGROUP_ROOT;
+    size_t len;
+
+    if (etmemd_cgroup_check_value(value) != 0) {
+        return NULL;
+    }
+
+    cg = (struct cgroup_watch *)calloc(1, sizeof(struct cgroup_watch));
+    if (cg == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for cgroup watch fail\n");
+        return NULL;
+    }
+
+    len = strlen(value);
+    if (snprintf_s(cg->path, sizeof(cg->path), sizeof(cg->path) - 1, "%s%s%s", root, value,
+                   value[len - 1] == '/' ? "" : "/") <= 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "snprintf path of cgroup %s fail\n", value);
+        free(cg);
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&cg->mtx, NULL) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "init mutex of cgroup watch fail\n");
+        free(cg);
+        return NULL;
+    }
+
+    cg->fd = -1;
+    watch_events(cg);
+    return cg;
+}
+
+void etmemd_cgroup_unwatch(struct cgroup_watch **cg)
+{
+    if (*cg == NULL) {
+        return;
+    }
+
+    unwatch_events(*cg);
+    pthread_mutex_destroy(&(*cg)->mtx);
+    free((*cg)->procs);
+    free(*cg);
+    *cg = NULL;
+}
+
+static void forget_procs(struct cgroup_watch *cg)
+{
+    free(cg->procs);
+    cg->procs = NULL;
+    cg->procs_len = 0;
+}
+
+static int cmp_pid(const void *a, const void *b)
+{
+    unsigned int pa = *(const unsigned int *)a;
+    unsigned int pb = *(const unsigned int *)b;
+
+    return pa < pb ? -1 : (pa > pb ? 1 : 0);
+}
+
+static int parse_procs(const char *buf, unsigned int **pids, int *nr)
+{
+    const char *ptr = buf;
+    char *end = NULL;
+    unsigned long pid;
+    int lines = 1;
+    int n = 0;
+    int nr_uniq;
+    int i;
+
+    for (ptr = buf; *ptr != '\0'; ptr++) {
+        if (*ptr == '\n') {
+            lines++;
+        }
+    }
+
+    *pids = (unsigned int *)calloc(lines, sizeof(unsigned int));
+    if (*pids == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for cgroup pids fail\n");
+        return -1;
+    }
+
+    for (ptr = buf; *ptr != '\0' && n < lines; ptr = end) {
+        pid = strtoul(ptr, &end, DECIMAL_RADIX);
+        if (end == ptr || pid == 0 || pid > UINT_MAX) {
+            break;
+        }
+        (*pids)[n++] = (unsigned int)pid;
+        while (*end == '\n') {
+            end++;
+        }
+    }
+
+    if (n == 0) {
+        free(*pids);
+        *pids = NULL;
+        return -1;
+    }
+
+    /* a process with threads in several threaded cgroups is listed in each of them */
+    qsort(*pids, n, sizeof(unsigned int), cmp_pid);
+    for (i = 1, nr_uniq = 1; i < n; i++) {
+        if ((*pids)[i] != (*pids)[nr_uniq - 1]) {
+            (*pids)[nr_uniq++] = (*pids)[i];
+        }
+    }
+    *nr = nr_uniq;
+    return 0;
+}
+
+static int append_procs(char **procs, size_t *len, const char *buf, size_t buf_len)
+{
+    char *tmp = (char *)realloc(*procs, *len + buf_len + 1);
+
+    if (tmp == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for cgroup procs fail\n");
+        return -1;
+    }
+
+    if (buf_len > 0 && memcpy_s(tmp + *len, buf_len + 1, buf, buf_len) != EOK) {
+        etmemd_log(ETMEMD_LOG_ERR, "memcpy cgroup procs fail\n");
+        *procs = tmp;
+        return -1;
+    }
+    *len += buf_len;
+    tmp[*len] = '\0';
+    *procs = tmp;
+    return 0;
+}
+
+/*
+ * cgroup.procs only lists the processes of the cgroup itself, and with no internal processes in
+ * cgroup v2 they are mostly in the descendants, so add theirs after it. dir is relative to
+ * cg->path and ends with '/' unless it is empty. The descendants may be removed at any time.
+ * */
+static int read_cgroup_procs(const struct cgroup_watch *cg, const char *dir, char **procs, size_t *len)
+{
+    char name[PATH_MAX] = {0};
+    char *buf = NULL;
+    size_t buf_len = 0;
+    struct dirent *entry = NULL;
+    DIR *cg_dir = NULL;
+    int ret;
+
+    if (snprintf_s(name, sizeof(name), sizeof(name) - 1, "%s%s", dir, CGROUP_PROCS) <= 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "snprintf path of %s%s fail\n", cg->path, dir);
+        return -1;
+    }
+    buf = read_cgroup_file(cg, name, &buf_len);
+    if (buf == NULL) {
+        return dir[0] == '\0' ? -1 : 0;
+    }
+    ret = append_procs(procs, len, buf, buf_len);
+    free(buf);
+    if (ret != 0 || cgroup_file(cg, dir, name, sizeof(name)) != 0) {
+        return -1;
+    }
+
+    cg_dir = opendir(name);
+    if (cg_dir == NULL) {
+        return 0;
+    }
+    while ((entry = readdir(cg_dir)) != NULL) {
+        if (entry->d_type != DT_DIR || strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (snprintf_s(name, sizeof(name), sizeof(name) - 1, "%s%s/", dir, entry->d_name) <= 0) {
+            etmemd_log(ETMEMD_LOG_ERR, "snprintf path of %s%s%s fail\n", cg->path, dir, entry->d_name);
+            ret = -1;
+            break;
+        }
+        ret = read_cgroup_procs(cg, name, procs, len);
+        if (ret != 0) {
+            break;
+        }
+    }
+    closedir(cg_dir);
+    return ret;
+}
+
+int etmemd_cgroup_get_pids(struct cgroup_watch *cg, bool all, unsigned int **pids, int *nr)
+{
+    char *procs = NULL;
+    size_t len = 0;
+
+    if (cg->fd >= 0) {
+        check_events(cg);
+    } else {
+        watch_events(cg);
+    }
+
+    /* nothing to do for an empty cgroup until it gets populated */
+    if (!cg->populated) {
+        forget_procs(cg);
+        return -1;
+    }
+
+    if (read_cgroup_procs(cg, "", &procs, &len) != 0) {
+        free(procs);
+        forget_procs(cg);
+        return -1;
+    }
+
+    /* the pids joining or leaving a populated cgroup are not notified, compare them instead */
+    if (!all && cg->procs != NULL && len == cg->procs_len && memcmp(procs, cg->procs, len) == 0) {
+        free(procs);
+        return 0;
+    }
+
+    forget_procs(cg);
+    if (parse_procs(procs, pids, nr) != 0) {
+        free(procs);
+        return -1;
+    }
+
+    cg->procs = procs;
+    cg->procs_len = len;
+    return 1;
+}
+
+static long elapsed_ms(const struct timespec *from, const struct timespec *to)
+{
+    return (to->tv_sec - from->tv_sec) * MSEC_PER_SEC + (to->tv_nsec - from->tv_nsec) / NSEC_PER_MSEC;
+}
+
+int etmemd_cgroup_get_mem(struct cgroup_watch *cg, struct cgroup_mem *mem)
+{
+    struct cgroup_mem tmp;
+    struct timespec now;
+    int ret = 0;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "clock get time fail\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&cg->mtx);
+    if (!cg->mem_valid || elapsed_ms(&cg->mem_time, &now) > MEMINFO_CACHE_MS) {
+        ret = read_cgroup_mem(cg, &tmp);
+        if (ret == 0) {
+            cg->mem = tmp;
+            cg->mem_time = now;
+            cg->mem_valid = true;
+        }
+    }
+    if (ret == 0) {
+        *mem = cg->mem;
+    }
+    pthread_mutex_unlock(&cg->mtx);
+    return ret;
+}
@@ -29,6 +29,13 @@
 #include "etmemd_common.h"
 #include "etmemd_rpc.h"
 #include "etmemd_log.h"
+#include "etmemd_bandwidth.h"
+#include "etmemd_hotness.h"
+#include "etmemd_record.h"
+#include "etmemd_replay.h"
+
+/* the root of /proc and /sys, without the trailing '/' */
+static char g_root[PATH_MAX] = {0};
 
 static void usage(void)
 {
@@ -38,9 +45,33 @@ static void usage(void)
            "    -l|--log-level <log-level>  Log level\n"
            "    -s|--socket <sockect name>  Socket name to listen to\n"
            "    -m|--mode-systemctl         mode used to start(systemctl)\n"        
+           "    -S|--swap-bandwidth <MB/s>  Max swap out bandwidth of all projects\n"
+           "    -M|--migrate-bandwidth <MB/s>  Max numa migration bandwidth of all projects\n"
+           "    -w|--warm-state <dir>       Keep the page hotness in dir to resume from after restart\n"
+           "    -r|--record <file>          Record what is scanned to file\n"
+           "    -R|--replay <file>          Replay the record file through the engines and exit\n"
+           "    -c|--replay-config <file>   Replay with the projects in file instead of those recorded\n"
+           "    -P|--root <dir>             Look up /proc and /sys under dir, " ETMEMD_ROOT_ENV " by default\n"
            "    -h|--help                   Show this message\n");
 }
 
+static int etmemd_parse_bandwidth(enum bw_class cls, const char *val)
+{
+    unsigned long rate;
+
+    if (get_unsigned_long_value(val, &rate) != 0) {
+        printf("error: invalid bandwidth %s\n", val);
+        return -1;
+    }
+
+    if (etmemd_bw_set_rate(cls, rate) != 0) {
+        printf("error: bandwidth %s must not be larger than %d MB/s\n", val, BW_RATE_MAX);
+        return -1;
+    }
+
+    return 0;
+}
+
 static int etmemd_parse_opts_valid(int opt, bool *is_help)
 {
     int ret;
@@ -70,6 +101,27 @@ static int etmemd_parse_opts_valid(int opt, bool *is_help)
         case 'm':
             ret = etmemd_deal_systemctl();
             break;
+        case 'S':
+            ret = etmemd_parse_bandwidth(BW_SWAP, optarg);
+            break;
+        case 'M':
+            ret = etmemd_parse_bandwidth(BW_MIGRATE, optarg);
+            break;
+        case 'w':
+            ret = etmemd_hotness_set_dir(optarg);
+            break;
+        case 'r':
+            ret = etmemd_record_set_file(optarg);
+            break;
+        case 'R':
+            ret = etmemd_replay_set_file(optarg);
+            break;
+        case 'c':
+            ret = etmemd_replay_set_config(optarg);
+            break;
+        case 'P':
+            ret = etmemd_set_root(optarg);
+            break;
         case '?':
             printf("error: parse parameters failed\n");
             /* fallthrough */
@@ -92,7 +144,22 @@ static int etmemd_parse_check_result(int params_cnt, int argc, const bool *is_he
         return -1;
     }
 
-    if (!etmemd_sock_name_set() && !(*is_help)) {
+    if (*is_help) {
+        return 0;
+    }
+
+    if (etmemd_replay_set() && etmemd_record_set()) {
+        printf("error: record and replay can not be done together\n");
+        return -1;
+    }
+
+    if (!etmemd_replay_set() && etmemd_replay_config_set()) {
+        printf("error: replay config is only used with replay\n");
+        return -1;
+    }
+
+    /* the replay takes no command, so it listens to nothing */
+    if (!etmemd_sock_name_set() && !etmemd_replay_set()) {
         printf("error: socket name of rpc to listen must be provided\n");
         usage();
         return -1;
@@ -103,13 +170,23 @@ static int etmemd_parse_check_result(int params_cnt, int argc, const bool *is_he
 
 int etmemd_parse_cmdline(int argc, char *argv[], bool *is_help)
 {
-    const char *op_str = "s:l:mh";
+    const char *op_str = "s:l:mS:M:w:r:R:c:P:h";
+    const char *opt_pos = NULL;
+    const char *root = NULL;
+    unsigned int opts_seen = 0;
     int params_cnt = 0;
     int opt, ret;
     struct option long_options[] = {
         {"socket", required_argument, NULL, 's'},
         {"log-level", required_argument, NULL, 'l'},
         {"mode-systemctl", no_argument, NULL, 'm'},
+        {"swap-bandwidth", required_argument, NULL, 'S'},
+        {"migrate-bandwidth", required_argument, NULL, 'M'},
+        {"warm-state", required_argument, NULL, 'w'},
+        {"record", required_argument, NULL, 'r'},
+        {"replay", required_argument, NULL, 'R'},
+        {"replay-config", required_argument, NULL, 'c'},
+        {"root", required_argument, NULL, 'P'},
         {"help", no_argument, NULL, 'h'},
         {NULL, 0, NULL, 0},
     };
@@ -120,6 +197,15 @@ int etmemd_parse_cmdline(int argc, char *argv[], bool *is_help)
     }
 
     while ((opt = getopt_long(argc, argv, op_str, long_options, NULL)) != -1) {
+        /* each option is given once at most */
+        opt_pos = strchr(op_str, opt);
+        if (opt_pos != NULL) {
+            if ((opts_seen & (1U << (opt_pos - op_str))) != 0) {
+                printf("error: parse parameter -%c repeated\n", opt);
+                return -1;
+            }
+            opts_seen |= 1U << (opt_pos - op_str);
+        }
         ret = etmemd_parse_opts_valid(opt, is_help);
         if (ret != 0) {
             return -1;
@@ -130,8 +216,18 @@ int etmemd_parse_cmdline(int argc, char *argv[], bool *is_help)
         }
     }
 
+    /* the option takes precedence over the environment */
+    root = getenv(ETMEMD_ROOT_ENV);
+    if (!(*is_help) && !etmemd_root_set() && root != NULL && root[0] != '\0' && etmemd_set_root(root) != 0) {
+        etmemd_sock_name_free();
+        return -1;
+    }
+
     if (etmemd_parse_check_result(params_cnt, argc, is_help) != 0) {
         etmemd_sock_name_free();
+        etmemd_record_stop();
+        etmemd_replay_clear();
+        g_root[0] = '\0';
         return -1;
     }
 
@@ -246,12 +342,60 @@ static int get_status_num(char *getline, char *value, size_t value_len)
     return 0;
 }
 
+int etmemd_set_root(const char *root)
+{
+    size_t len;
+
+    if (root == NULL || root[0] != '/') {
+        printf("error: root %s must be an absolute path\n", root == NULL ? "" : root);
+        return -1;
+    }
+
+    /* the paths joined to it start with '/' */
+    len = strlen(root);
+    while (len > 0 && root[len - 1] == '/') {
+        len--;
+    }
+
+    /* "/" is the root of the host */
+    if (len == 0) {
+        g_root[0] = '\0';
+        return 0;
+    }
+
+    if (len >= sizeof(g_root) || strncpy_s(g_root, sizeof(g_root), root, len) != EOK) {
+        printf("error: root %s is too long\n", root);
+        return -1;
+    }
+
+    return 0;
+}
+
+bool etmemd_root_set(void)
+{
+    return g_root[0] != '\0';
+}
+
+const char *etmemd_root_path(const char *path, char *buf, size_t size)
+{
+    if (g_root[0] == '\0') {
+        return path;
+    }
+
+    if (snprintf_s(buf, size, size - 1, "%s%s", g_root, path) <= 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "snprintf path of %s under root fail\n", path);
+        return NULL;
+    }
+
+    return buf;
+}
+
 static char *etmemd_get_proc_file_str(const char *pid, const char *file)
 {
     char *file_name = NULL;
     size_t file_str_size;
 
-    file_str_size = strlen(PROC_PATH) + strlen(file) + 1 + (pid == NULL ? 0 : strlen(pid));
+    file_str_size = strlen(g_root) + strlen(PROC_PATH) + strlen(file) + 1 + (pid == NULL ? 0 : strlen(pid));
     file_name = (char *)calloc(file_str_size, sizeof(char));
     if (file_name == NULL) {
         etmemd_log(ETMEMD_LOG_ERR, "malloc for %s path fail\n", file);
@@ -259,7 +403,7 @@ static char *etmemd_get_proc_file_str(const char *pid, const char *file)
     }
 
     if (snprintf_s(file_name, file_str_size, file_str_size - 1, 
-                    "%s%s%s", PROC_PATH, pid == NULL ? "" : pid, file) == -1) {
+                    "%s%s%s%s", g_root, PROC_PATH, pid == NULL ? "" : pid, file) == -1) {
         etmemd_log(ETMEMD_LOG_ERR, "snprintf for %s fail\n", file);
         free(file_name);
         return NULL;
@@ -28,7 +28,9 @@
 #include "etmemd_engine.h"
 #include "etmemd_cslide.h"
 #include "etmemd_scan.h"
+#include "etmemd_damon_scan.h"
 #include "etmemd_migrate.h"
+#include "etmemd_bandwidth.h"
 #include "etmemd_file.h"
 
 #define HUGE_1M_SIZE    (1 << 20)
@@ -148,6 +150,8 @@ struct cslide_eng_params {
         int interval;
         int sleep;
     };
+    const struct page_scan *page_scan;
+    struct bw_share *bw_share;
     struct cslide_params_factory factory;
     struct node_pages_info *host_pages_info;
     bool finish;
@@ -228,12 +232,15 @@ static void destroy_sys_mem(struct sys_mem *mem)
 
 static int read_hugepage_num(char *path)
 {
+    char root_path[PATH_MAX] = {0};
+    const char *file = NULL;
     FILE *f = NULL;
     char *line = NULL;
     size_t line_len = 0;
     int nr = -1;
 
-    f = fopen(path, "r");
+    file = etmemd_root_path(path, root_path, sizeof(root_path));
+    f = file == NULL ? NULL : fopen(file, "r");
     if (f == NULL) {
         etmemd_log(ETMEMD_LOG_ERR, "open file %s failed\n", path);
         return -1;
@@ -621,6 +628,10 @@ static void free_pid_params(struct cslide_pid_params *params)
     int count = params->count;
     int i;
 
+    if (params->eng_params != NULL && params->eng_params->page_scan->backend == SCAN_BACKEND_DAMON) {
+        damon_scan_release(params->pid);
+    }
+
     free(params->node_pages_info);
     params->node_pages_info = NULL;
     free(params->memory_grade);
@@ -1269,7 +1280,73 @@ static void cslide_free_vmas(struct cslide_pid_params *params)
     params->vmas = NULL;
 }
 
-static int cslide_scan_vmas(struct cslide_pid_params *params)
+/* move the page_refs of one scan into the lists of the vmas they belong to, both sorted by address */
+static void cslide_merge_vma_page_refs(struct cslide_pid_params *params, struct page_refs *page_refs)
+{
+    struct vmas *vmas = params->vmas;
+    struct page_refs **pf = NULL;
+    struct page_refs *next = NULL;
+    uint64_t i = 0;
+
+    if (vmas->vma_cnt > 0) {
+        pf = &params->vma_pf[0].page_refs;
+    }
+
+    while (page_refs != NULL) {
+        next = page_refs->next;
+        while (i < vmas->vma_cnt && page_refs->addr >= params->vma_pf[i].vma->end) {
+            i++;
+            if (i < vmas->vma_cnt) {
+                pf = &params->vma_pf[i].page_refs;
+            }
+        }
+        if (i == vmas->vma_cnt) {
+            etmemd_free_page_refs(page_refs);
+            return;
+        }
+        if (page_refs->addr < params->vma_pf[i].vma->start) {
+            free(page_refs);
+            page_refs = next;
+            continue;
+        }
+
+        while (*pf != NULL && (*pf)->addr < page_refs->addr) {
+            pf = &(*pf)->next;
+        }
+        if (*pf != NULL && (*pf)->addr == page_refs->addr) {
+            (*pf)->count += page_refs->count;
+            free(page_refs);
+        } else {
+            page_refs->next = *pf;
+            *pf = page_refs;
+            pf = &page_refs->next;
+        }
+        page_refs = next;
+    }
+}
+
+static int cslide_scan_vmas_by_backend(struct cslide_pid_params *params, enum scan_backend backend)
+{
+    char pid[PID_STR_MAX_LEN] = {0};
+    struct page_refs *page_refs = NULL;
+
+    if (snprintf_s(pid, PID_STR_MAX_LEN, PID_STR_MAX_LEN - 1, "%u", params->pid) <= 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "snpintf pid %u fail\n", params->pid);
+        return -1;
+    }
+
+    if (etmemd_get_page_refs_by_backend(backend, params->eng_params->page_scan, params->vmas, pid,
+                                        &page_refs, NULL, NULL) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "task %u scan vmas fail\n", params->pid);
+        etmemd_free_page_refs(page_refs);
+        return -1;
+    }
+
+    cslide_merge_vma_page_refs(params, page_refs);
+    return 0;
+}
+
+static int cslide_scan_vmas(struct cslide_pid_params *params, enum scan_backend backend)
 {
     char pid[PID_STR_MAX_LEN] = {0};
     struct vmas *vmas = params->vmas;
@@ -1285,6 +1362,10 @@ static int cslide_scan_vmas(struct cslide_pid_params *params)
         .ioctl_parameter = task_params->scan_flags,
     };
 
+    if (backend != SCAN_BACKEND_IDLE_PAGES) {
+        return cslide_scan_vmas_by_backend(params, backend);
+    }
+
     if (snprintf_s(pid, PID_STR_MAX_LEN, PID_STR_MAX_LEN - 1, "%u", params->pid) <= 0) {
         etmemd_log(ETMEMD_LOG_ERR, "snpintf pid %u fail\n", params->pid);
         return -1;
@@ -1313,6 +1394,7 @@ static int cslide_scan_vmas(struct cslide_pid_params *params)
         vma = vma_pf->vma;
         walk_address.walk_start = vma->start;
         walk_address.walk_end = vma->end;
+        walk_address.pid = params->pid;
         if (walk_vmas(fd, &walk_address, &vma_pf->page_refs, NULL) == NULL) {
             etmemd_log(ETMEMD_LOG_ERR, "task %u scan vma start %llu end %llu fail\n",
                     params->pid, vma->start, vma->end);
@@ -1330,8 +1412,10 @@ static int cslide_scan_vmas(struct cslide_pid_params *params)
 static int cslide_do_scan(struct cslide_eng_params *eng_params)
 {
     struct cslide_pid_params *iter = NULL;
+    enum scan_backend backend;
     int i;
 
+    backend = etmemd_resolve_scan_backend(eng_params->page_scan->backend);
     factory_foreach_working_pid_params(iter, &eng_params->factory) {
         if (cslide_get_vmas(iter) != 0) {
             etmemd_log(ETMEMD_LOG_ERR, "cslide get vmas fail\n");
@@ -1344,7 +1428,7 @@ static int cslide_do_scan(struct cslide_eng_params *eng_params)
             if (iter->vmas == NULL) {
                 continue;
             }
-            if (cslide_scan_vmas(iter) != 0) {
+            if (cslide_scan_vmas(iter, backend) != 0) {
                 etmemd_log(ETMEMD_LOG_ERR, "cslide scan vmas fail\n");
                 return -1;
             }
@@ -1356,8 +1440,10 @@ static int cslide_do_scan(struct cslide_eng_params *eng_params)
 }
 
 // error return -1; success return moved pages number
-static int do_migrate_pages(unsigned int pid, struct page_refs *page_refs, int node)
+static int do_migrate_pages(unsigned int pid, struct page_refs *page_refs, int node, struct bw_share *share)
 {
+    bool governed = share != NULL && etmemd_bw_limited(BW_MIGRATE);
+    unsigned long batch_bytes = 0;
     int batch_size = BATCHSIZE;
     int ret;
     void **pages = NULL;
@@ -1370,6 +1456,12 @@ static int do_migrate_pages(unsigned int pid, struct page_refs *page_refs, int n
         return 0;
     }
 
+    /* the pids under a simulated root are not processes of the host */
+    if (etmemd_root_set()) {
+        etmemd_log(ETMEMD_LOG_ERR, "pages of task %u are not moved under root\n", pid);
+        return -1;
+    }
+
     nodes = malloc(sizeof(int) * batch_size);
     if (nodes == NULL) {
         etmemd_log(ETMEMD_LOG_ERR, "malloc nodes fail\n");
@@ -1392,9 +1484,11 @@ static int do_migrate_pages(unsigned int pid, struct page_refs *page_refs, int n
     while (page_refs != NULL) {
         pages[actual_num] = (void *)page_refs->addr;
         nodes[actual_num] = node;
+        batch_bytes += (unsigned long)page_type_to_size(page_refs->type);
         actual_num++;
         page_refs = page_refs->next;
-        if (actual_num == batch_size || page_refs == NULL) {
+        if (actual_num == batch_size || page_refs == NULL || (governed && batch_bytes >= BW_CHUNK_SIZE)) {
+            etmemd_bw_acquire(share, BW_MIGRATE, batch_bytes);
             ret = move_pages(pid, actual_num, pages, nodes, status, MPOL_MF_MOVE_ALL);
             if (ret != 0) {
                 etmemd_log(ETMEMD_LOG_ERR, "task %d move_pages fail with %d errno %d\n", pid, ret, errno);
@@ -1403,6 +1497,7 @@ static int do_migrate_pages(unsigned int pid, struct page_refs *page_refs, int n
             }
             moved += actual_num;
             actual_num = 0;
+            batch_bytes = 0;
         }
     }
 
@@ -1417,11 +1512,12 @@ free_nodes:
     return moved;
 }
 
-static int migrate_single_task(unsigned int pid, const struct memory_grade *memory_grade, int hot_node, int cold_node)
+static int migrate_single_task(unsigned int pid, const struct memory_grade *memory_grade, int hot_node, int cold_node,
+                               struct bw_share *share)
 {
     int moved;
 
-    moved = do_migrate_pages(pid, memory_grade->cold_pages, cold_node);
+    moved = do_migrate_pages(pid, memory_grade->cold_pages, cold_node, share);
     if (moved == -1) {
         etmemd_log(ETMEMD_LOG_ERR, "task %u migrate cold pages fail\n", pid);
         return -1;
@@ -1431,7 +1527,7 @@ static int migrate_single_task(unsigned int pid, const struct memory_grade *memo
                 pid, HUGE_2M_TO_KB((unsigned int)moved), hot_node, cold_node);
     }
 
-    moved = do_migrate_pages(pid, memory_grade->hot_pages, hot_node);
+    moved = do_migrate_pages(pid, memory_grade->hot_pages, hot_node, share);
     if (moved == -1) {
         etmemd_log(ETMEMD_LOG_ERR, "task %u migrate hot pages fail\n", pid);
         return -1;
@@ -1458,7 +1554,8 @@ static int cslide_do_migrate(struct cslide_eng_params *eng_params)
             if (numa_run_on_node(bind_node) != 0) {
                 etmemd_log(ETMEMD_LOG_INFO, "fail to run on node %d to migrate memory\n", bind_node);
             }
-            ret = migrate_single_task(iter->pid, &iter->memory_grade[i], pair->hot_node, pair->cold_node);
+            ret = migrate_single_task(iter->pid, &iter->memory_grade[i], pair->hot_node, pair->cold_node,
+                                      eng_params->bw_share);
             if (ret != 0) {
                 goto exit;
             }
@@ -2090,6 +2187,8 @@ static int cslide_fill_eng(GKeyFile *config, struct engine *eng)
     params->loop = page_scan->loop;
     params->interval = page_scan->interval;
     params->sleep = page_scan->sleep;
+    params->page_scan = page_scan;
+    params->bw_share = eng->proj->bw_share;
     if (parse_file_config(config, ENG_GROUP, cslide_eng_config_items,
         ARRAY_SIZE(cslide_eng_config_items), (void *)params) != 0) {
         etmemd_log(ETMEMD_LOG_ERR, "cslide fill engine params fail\n");
@@ -2119,6 +2218,32 @@ static void cslide_clear_eng(struct engine *eng)
     eng->params = NULL;
 }
 
+/*
+ * The numa node of each page and the free memory of each node are not in the record, so only the
+ * split of the pages by hot_threshold is replayed, before do_filter moves them between nodes.
+ * */
+static struct memory_grade *cslide_replay_pages(struct task_pid *tk_pid, struct page_refs **page_refs)
+{
+    struct cslide_eng_params *eng_params = (struct cslide_eng_params *)tk_pid->tk->eng->params;
+    struct memory_grade *memory_grade = NULL;
+
+    memory_grade = (struct memory_grade *)calloc(1, sizeof(struct memory_grade));
+    if (memory_grade == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for memory grade fail\n");
+        return NULL;
+    }
+
+    while (*page_refs != NULL) {
+        if ((*page_refs)->count >= eng_params->hot_threshold) {
+            *page_refs = add_page_refs_into_memory_grade(*page_refs, &memory_grade->hot_pages);
+            continue;
+        }
+        *page_refs = add_page_refs_into_memory_grade(*page_refs, &memory_grade->cold_pages);
+    }
+
+    return memory_grade;
+}
+
 struct engine_ops g_cslide_eng_ops = {
     .fill_eng_params = cslide_fill_eng,
     .clear_eng_params = cslide_clear_eng,
@@ -2129,6 +2254,7 @@ struct engine_ops g_cslide_eng_ops = {
     .start_task = cslide_start_task,
     .stop_task = cslide_stop_task,
     .eng_mgt_func = cslide_engine_do_cmd,
+    .replay_pages = cslide_replay_pages,
 };
 
 int fill_engine_type_cslide(struct engine *eng, GKeyFile *config)
@@ -15,6 +15,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 #include <unistd.h>
 
 #include "securec.h"
@@ -25,6 +26,7 @@
 #include "etmemd_task.h"
 #include "etmemd_task_exp.h"
 #include "etmemd_scan.h"
+#include "etmemd_damon_sysfs.h"
 #include "etmemd_damon.h"
 
 #define KERNEL_DAMON_PATH "/sys/kernel/debug/damon/"
@@ -35,18 +37,16 @@
 
 #define ON_LEN 2
 #define OFF_LEN 3
-#define INT_MAX_LEN 10
+#define INT_MAX_LEN 20
 #define NUM_OF_ATTRS 5
 #define NUM_OF_SCHEMES 7
+/* scheme of debugfs with quotas and watermarks, since 5.16 */
+#define NUM_OF_SCHEMES_EXT 18
+/* weights of size, access frequency and age for prioritizing regions under quotas in debugfs */
+#define DAMOS_DBGFS_QUOTA_WEIGHTS "0 1 1"
 
-enum damos_action {
-    DAMOS_WILLNEED,
-    DAMOS_COLD,
-    DAMOS_PAGEOUT,
-    DAMOS_HUGEPAGE,
-    DAMOS_NOHUGEPAGE,
-    DAMOS_STAT,
-};
+#define DAMON_MAX_SCHEMES 8
+#define DAMOS_WMARK_MAX 1000
 
 struct action_item {
     char *action_str;
@@ -54,18 +54,25 @@ struct action_item {
 };
 
 struct damon_eng_params {
-    unsigned long min_sz_region;
-    unsigned long max_sz_region;
-    unsigned int min_nr_accesses;
-    unsigned int max_nr_accesses;
-    unsigned int min_age_region;
-    unsigned int max_age_region;
-    enum damos_action action;
+    struct damos_scheme schemes[DAMON_MAX_SCHEMES];
+    int nr_schemes;
+    struct damos_quota quota;
+    struct damos_wmarks wmarks;
+    int kdamond;        /* kdamond of the project on sysfs, kept by the first engine of the project */
+};
+
+/* pids monitored by a project, the first pid of each task in all its engines */
+struct damon_targets {
+    unsigned int *pids;
+    int nr;
 };
 
 static bool check_damon_exist(void)
 {
-    if (access(KERNEL_DAMON_PATH, F_OK) != 0) {
+    char root_path[PATH_MAX] = {0};
+    const char *path = etmemd_root_path(KERNEL_DAMON_PATH, root_path, sizeof(root_path));
+
+    if (path == NULL || access(path, F_OK) != 0) {
         return false;
     }
     return true;
@@ -73,6 +80,8 @@ static bool check_damon_exist(void)
 
 static FILE *get_damon_file(const char *file)
 {
+    char root_path[PATH_MAX] = {0};
+    const char *path = NULL;
     char *file_name = NULL;
     size_t file_str_size;
     FILE *fp = NULL;
@@ -90,7 +99,8 @@ static FILE *get_damon_file(const char *file)
         goto out;
     }
 
-    fp = fopen(file_name, "r+");
+    path = etmemd_root_path(file_name, root_path, sizeof(root_path));
+    fp = path == NULL ? NULL : fopen(path, "r+");
     if (fp == NULL) {
         etmemd_log(ETMEMD_LOG_ERR, "open file %s fail\n", file_name);
     }
@@ -104,6 +114,11 @@ static bool is_engs_valid(struct project *proj)
 {
     struct engine *eng = proj->engs;
 
+    if (eng == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "no damon engine in project %s\n", proj->name);
+        return false;
+    }
+
     while (eng != NULL) {
         if (strcmp(eng->name, "damon") != 0) {
             etmemd_log(ETMEMD_LOG_ERR, "engine type %s not supported, only support damon engine in region scan\n",
@@ -131,59 +146,90 @@ static int get_damon_pids_val_and_num(struct task *tk, int *nr_tasks)
     return 0;
 }
 
-static char *get_damon_pids_str(struct task *tk, const int nr_tasks)
+static int get_damon_targets(struct project *proj, struct damon_targets *targets)
+{
+    struct engine *eng = NULL;
+    struct task *tk = NULL;
+    int nr_tasks = 0;
+
+    for (eng = proj->engs; eng != NULL; eng = eng->next) {
+        if (get_damon_pids_val_and_num(eng->tasks, &nr_tasks) != 0) {
+            return -1;
+        }
+    }
+
+    if (nr_tasks == 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "no task to monitor in project %s\n", proj->name);
+        return -1;
+    }
+
+    targets->pids = (unsigned int *)calloc(nr_tasks, sizeof(unsigned int));
+    if (targets->pids == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for pids in damon fail\n");
+        return -1;
+    }
+
+    targets->nr = 0;
+    for (eng = proj->engs; eng != NULL; eng = eng->next) {
+        for (tk = eng->tasks; tk != NULL; tk = tk->next) {
+            if (tk->pids != NULL) {
+                targets->pids[targets->nr++] = tk->pids->pid;
+            }
+        }
+    }
+
+    if (targets->nr == 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "get all task pids fail in damon\n");
+        free(targets->pids);
+        targets->pids = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+static char *get_damon_pids_str(const struct damon_targets *targets)
 {
     char *pids = NULL;
     size_t pids_size;
     char tmp_pid[PID_STR_MAX_LEN + 2] = {0}; // plus 2 for space and '\0' follow pid
+    int i;
 
-    pids_size = (PID_STR_MAX_LEN + 1) * nr_tasks + 1;
+    pids_size = (PID_STR_MAX_LEN + 1) * targets->nr + 1;
     pids = (char *)calloc(pids_size, sizeof(char));
     if (pids == NULL) {
         etmemd_log(ETMEMD_LOG_ERR, "malloc for pids in damon fail\n");
         return NULL;
     }
 
-    while (tk != NULL) {
+    for (i = 0; i < targets->nr; i++) {
         if (snprintf_s(tmp_pid, PID_STR_MAX_LEN + 2, PID_STR_MAX_LEN + 1,
-                       "%u ", tk->pids->pid) == -1) {
-            etmemd_log(ETMEMD_LOG_WARN, "snprintf pid %u in damon fail\n", tk->pids->pid);
-            tk = tk->next;
+                       "%u ", targets->pids[i]) == -1) {
+            etmemd_log(ETMEMD_LOG_WARN, "snprintf pid %u in damon fail\n", targets->pids[i]);
             continue;
         }
 
         if (strcat_s(pids, pids_size, tmp_pid) != EOK) {
             etmemd_log(ETMEMD_LOG_WARN, "strcat pid %s fail\n", tmp_pid);
         }
-        tk = tk->next;
     }
 
     return pids;
 }
 
-static int set_damon_target_ids(struct project *proj)
+static int set_damon_target_ids(const struct damon_targets *targets)
 {
     FILE *fp = NULL;
-    int nr_tasks = 0;
-    struct task *tk = proj->engs->tasks;
     char *pids_str = NULL;
     size_t pids_len;
     int ret = -1;
 
-    if (!is_engs_valid(proj)) {
-        goto out;
-    }
-
     fp = get_damon_file(DAMON_PARAM_TARGET_IDS);
     if (fp == NULL) {
         goto out;
     }
 
-    if (get_damon_pids_val_and_num(tk, &nr_tasks) != 0) {
-        goto out_close;
-    }
-
-    pids_str = get_damon_pids_str(tk, nr_tasks);
+    pids_str = get_damon_pids_str(targets);
     if (pids_str == NULL) {
         goto out_close;
     }
@@ -265,27 +311,72 @@ out:
     return ret;
 }
 
+static bool damos_scheme_limited(const struct damos_scheme *scheme)
+{
+    return scheme->quota.ms != 0 || scheme->quota.bytes != 0 || scheme->wmarks.metric != DAMOS_WMARK_NONE;
+}
+
+/* one scheme each line, the old 7 fields format is kept unless quotas or watermarks are set */
+static int append_damon_scheme_str(char *schemes, size_t schemes_size, const struct damos_scheme *scheme)
+{
+    size_t len = strlen(schemes);
+    int ret;
+
+    if (!damos_scheme_limited(scheme)) {
+        ret = snprintf_s(schemes + len, schemes_size - len, schemes_size - len - 1,
+                         "%lu %lu %u %u %u %u %d\n",
+                         scheme->min_sz_region, scheme->max_sz_region,
+                         scheme->min_nr_accesses, scheme->max_nr_accesses,
+                         scheme->min_age_region, scheme->max_age_region,
+                         scheme->action);
+    } else {
+        ret = snprintf_s(schemes + len, schemes_size - len, schemes_size - len - 1,
+                         "%lu %lu %u %u %u %u %d %lu %lu %lu %s %d %lu %lu %lu %lu\n",
+                         scheme->min_sz_region, scheme->max_sz_region,
+                         scheme->min_nr_accesses, scheme->max_nr_accesses,
+                         scheme->min_age_region, scheme->max_age_region,
+                         scheme->action, scheme->quota.ms, scheme->quota.bytes,
+                         scheme->quota.reset_interval, DAMOS_DBGFS_QUOTA_WEIGHTS,
+                         scheme->wmarks.metric, scheme->wmarks.interval,
+                         scheme->wmarks.high, scheme->wmarks.mid, scheme->wmarks.low);
+    }
+
+    if (ret == -1) {
+        etmemd_log(ETMEMD_LOG_ERR, "snprintf for schemes fail\n");
+        return -1;
+    }
+
+    return 0;
+}
+
 static char *get_damon_schemes_str(struct project *proj)
 {
     char *schemes = NULL;
     size_t schemes_size;
-    struct damon_eng_params *params = (struct damon_eng_params *)proj->engs->params;
+    struct engine *eng = NULL;
+    struct damon_eng_params *params = NULL;
+    int nr_schemes = 0;
+    int i;
+
+    for (eng = proj->engs; eng != NULL; eng = eng->next) {
+        nr_schemes += ((struct damon_eng_params *)eng->params)->nr_schemes;
+    }
 
-    schemes_size = (INT_MAX_LEN + 1) * NUM_OF_SCHEMES;
+    schemes_size = (INT_MAX_LEN + 1) * NUM_OF_SCHEMES_EXT * nr_schemes + 1;
     schemes = (char *)calloc(schemes_size, sizeof(char));
     if (schemes == NULL) {
         etmemd_log(ETMEMD_LOG_ERR, "malloc for schemes in damon fail\n");
         return NULL;
     }
 
-    if (snprintf_s(schemes, schemes_size, schemes_size - 1, "%lu %lu %u %u %u %u %d",
-                   params->min_sz_region, params->max_sz_region,
-                   params->min_nr_accesses, params->max_nr_accesses,
-                   params->min_age_region, params->max_age_region,
-                   params->action) == -1) {
-        etmemd_log(ETMEMD_LOG_ERR, "snprintf for schemes fail\n");
-        free(schemes);
-        return NULL;
+    for (eng = proj->engs; eng != NULL; eng = eng->next) {
+        params = (struct damon_eng_params *)eng->params;
+        for (i = 0; i < params->nr_schemes; i++) {
+            if (append_damon_scheme_str(schemes, schemes_size, &params->schemes[i]) != 0) {
+                free(schemes);
+                return NULL;
+            }
+        }
     }
 
     return schemes;
@@ -375,21 +466,17 @@ out:
     return ret;
 }
 
-int etmemd_start_damon(struct project *proj)
+/* debugfs has only one monitoring context, which is shared by all the projects */
+static int start_damon_dbgfs(struct project *proj, const struct damon_targets *targets)
 {
     bool start = true;
 
-    if (proj == NULL) {
-        etmemd_log(ETMEMD_LOG_ERR, "proj should not be NULL\n");
-        return -1;
-    }
-
     if (!check_damon_exist()) {
         etmemd_log(ETMEMD_LOG_ERR, "kernel damon module not exist\n");
         return -1;
     }
 
-    if (set_damon_target_ids(proj) != 0) {
+    if (set_damon_target_ids(targets) != 0) {
         etmemd_log(ETMEMD_LOG_ERR, "set damon pids fail\n");
         return -1;
     }
@@ -412,10 +499,117 @@ int etmemd_start_damon(struct project *proj)
     return 0;
 }
 
-int etmemd_stop_damon(void)
+static struct damos_scheme *get_project_schemes(struct project *proj, int *nr_schemes)
+{
+    struct damos_scheme *schemes = NULL;
+    struct damon_eng_params *params = NULL;
+    struct engine *eng = NULL;
+    int nr = 0;
+
+    for (eng = proj->engs; eng != NULL; eng = eng->next) {
+        nr += ((struct damon_eng_params *)eng->params)->nr_schemes;
+    }
+
+    schemes = (struct damos_scheme *)calloc(nr, sizeof(struct damos_scheme));
+    if (schemes == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for schemes in damon fail\n");
+        return NULL;
+    }
+
+    nr = 0;
+    for (eng = proj->engs; eng != NULL; eng = eng->next) {
+        params = (struct damon_eng_params *)eng->params;
+        if (memcpy_s(schemes + nr, params->nr_schemes * sizeof(struct damos_scheme),
+                     params->schemes, params->nr_schemes * sizeof(struct damos_scheme)) != EOK) {
+            etmemd_log(ETMEMD_LOG_ERR, "copy schemes of engine fail\n");
+            free(schemes);
+            return NULL;
+        }
+        nr += params->nr_schemes;
+    }
+
+    *nr_schemes = nr;
+    return schemes;
+}
+
+/* every project gets a kdamond of its own on sysfs */
+static int start_damon_sysfs(struct project *proj, const struct damon_targets *targets)
+{
+    struct damon_eng_params *params = (struct damon_eng_params *)proj->engs->params;
+    struct damos_scheme *schemes = NULL;
+    int nr_schemes = 0;
+    int ret;
+
+    schemes = get_project_schemes(proj, &nr_schemes);
+    if (schemes == NULL) {
+        return -1;
+    }
+
+    if (params->kdamond < 0) {
+        params->kdamond = kdamond_alloc();
+        if (params->kdamond < 0) {
+            free(schemes);
+            return -1;
+        }
+    }
+
+    ret = kdamond_start(params->kdamond, (struct region_scan *)proj->scan_param,
+                        targets->pids, targets->nr, schemes, nr_schemes);
+    if (ret != 0) {
+        kdamond_free(params->kdamond);
+        params->kdamond = -1;
+    }
+
+    free(schemes);
+    return ret;
+}
+
+int etmemd_start_damon(struct project *proj)
+{
+    struct damon_targets targets = {0};
+    int ret;
+
+    if (proj == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "proj should not be NULL\n");
+        return -1;
+    }
+
+    if (!is_engs_valid(proj)) {
+        return -1;
+    }
+
+    if (get_damon_targets(proj, &targets) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "set damon pids fail\n");
+        return -1;
+    }
+
+    if (damon_sysfs_exist()) {
+        ret = start_damon_sysfs(proj, &targets);
+    } else {
+        ret = start_damon_dbgfs(proj, &targets);
+    }
+
+    free(targets.pids);
+    return ret;
+}
+
+int etmemd_stop_damon(struct project *proj)
 {
+    struct damon_eng_params *params = NULL;
     bool start = false;
 
+    if (proj == NULL || proj->engs == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "proj should not be NULL\n");
+        return -1;
+    }
+
+    params = (struct damon_eng_params *)proj->engs->params;
+    if (params->kdamond >= 0) {
+        kdamond_free(params->kdamond);
+        params->kdamond = -1;
+        return 0;
+    }
+
     if (!check_damon_exist()) {
         etmemd_log(ETMEMD_LOG_ERR, "kernel damon module not exist\n");
         return -1;
@@ -434,7 +628,7 @@ static int fill_min_size(void *obj, void *val)
     struct damon_eng_params *params = (struct damon_eng_params *)obj;
     unsigned long min_size = parse_to_ulong(val);
 
-    params->min_sz_region = min_size;
+    params->schemes[0].min_sz_region = min_size;
     return 0;
 }
 
@@ -443,7 +637,7 @@ static int fill_max_size(void *obj, void *val)
     struct damon_eng_params *params = (struct damon_eng_params *)obj;
     unsigned long max_size = parse_to_ulong(val);
 
-    params->max_sz_region = max_size;
+    params->schemes[0].max_sz_region = max_size;
     return 0;
 }
 
@@ -452,7 +646,7 @@ static int fill_min_acc(void *obj, void *val)
     struct damon_eng_params *params = (struct damon_eng_params *)obj;
     unsigned int min_acc = parse_to_uint(val);
 
-    params->min_nr_accesses = min_acc;
+    params->schemes[0].min_nr_accesses = min_acc;
     return 0;
 }
 
@@ -461,7 +655,7 @@ static int fill_max_acc(void *obj, void *val)
     struct damon_eng_params *params = (struct damon_eng_params *)obj;
     unsigned int max_acc = parse_to_uint(val);
 
-    params->max_nr_accesses = max_acc;
+    params->schemes[0].max_nr_accesses = max_acc;
     return 0;
 }
 
@@ -470,7 +664,7 @@ static int fill_min_age(void *obj, void *val)
     struct damon_eng_params *params = (struct damon_eng_params *)obj;
     unsigned int min_age = parse_to_uint(val);
 
-    params->min_age_region = min_age;
+    params->schemes[0].min_age_region = min_age;
     return 0;
 }
 
@@ -479,7 +673,7 @@ static int fill_max_age(void *obj, void *val)
     struct damon_eng_params *params = (struct damon_eng_params *)obj;
     unsigned int max_age = parse_to_uint(val);
 
-    params->max_age_region = max_age;
+    params->schemes[0].max_age_region = max_age;
     return 0;
 }
 
@@ -492,24 +686,175 @@ static struct action_item damon_action_items[] = {
     {"stat", DAMOS_STAT},
 };
 
-static int fill_action(void *obj, void *val)
+static int parse_action(const char *action, enum damos_action *type)
 {
-    struct damon_eng_params *params = (struct damon_eng_params *)obj;
-    char *action = (char *)val;
     unsigned int i;
 
     for (i = 0; i < ARRAY_SIZE(damon_action_items); i++) {
         if (strcmp(action, damon_action_items[i].action_str) == 0) {
-            params->action = damon_action_items[i].action_type;
-            free(action);
+            *type = damon_action_items[i].action_type;
             return 0;
         }
     }
 
-    free(action);
+    etmemd_log(ETMEMD_LOG_ERR, "damon action %s not supported\n", action);
     return -1;
 }
 
+static int fill_action(void *obj, void *val)
+{
+    struct damon_eng_params *params = (struct damon_eng_params *)obj;
+    char *action = (char *)val;
+    int ret;
+
+    ret = parse_action(action, &params->schemes[0].action);
+    free(action);
+    return ret;
+}
+
+static int fill_quota_ms(void *obj, void *val)
+{
+    struct damon_eng_params *params = (struct damon_eng_params *)obj;
+    unsigned long ms = parse_to_ulong(val);
+
+    params->quota.ms = ms;
+    return 0;
+}
+
+static int fill_quota_bytes(void *obj, void *val)
+{
+    struct damon_eng_params *params = (struct damon_eng_params *)obj;
+    unsigned long bytes = parse_to_ulong(val);
+
+    params->quota.bytes = bytes;
+    return 0;
+}
+
+static int fill_quota_reset_interval(void *obj, void *val)
+{
+    struct damon_eng_params *params = (struct damon_eng_params *)obj;
+    unsigned long reset_interval = parse_to_ulong(val);
+
+    params->quota.reset_interval = reset_interval;
+    return 0;
+}
+
+static int fill_wmark_metric(void *obj, void *val)
+{
+    struct damon_eng_params *params = (struct damon_eng_params *)obj;
+    char *metric = (char *)val;
+    int ret = 0;
+
+    if (strcmp(metric, "none") == 0) {
+        params->wmarks.metric = DAMOS_WMARK_NONE;
+    } else if (strcmp(metric, "free_mem_rate") == 0) {
+        params->wmarks.metric = DAMOS_WMARK_FREE_MEM_RATE;
+    } else {
+        etmemd_log(ETMEMD_LOG_ERR, "invalid wmark_metric %s, must be none or free_mem_rate\n", metric);
+        ret = -1;
+    }
+
+    free(metric);
+    return ret;
+}
+
+static int fill_wmark_interval(void *obj, void *val)
+{
+    struct damon_eng_params *params = (struct damon_eng_params *)obj;
+    unsigned long interval = parse_to_ulong(val);
+
+    params->wmarks.interval = interval;
+    return 0;
+}
+
+static int fill_wmark_high(void *obj, void *val)
+{
+    struct damon_eng_params *params = (struct damon_eng_params *)obj;
+    unsigned long high = parse_to_ulong(val);
+
+    params->wmarks.high = high;
+    return 0;
+}
+
+static int fill_wmark_mid(void *obj, void *val)
+{
+    struct damon_eng_params *params = (struct damon_eng_params *)obj;
+    unsigned long mid = parse_to_ulong(val);
+
+    params->wmarks.mid = mid;
+    return 0;
+}
+
+static int fill_wmark_low(void *obj, void *val)
+{
+    struct damon_eng_params *params = (struct damon_eng_params *)obj;
+    unsigned long low = parse_to_ulong(val);
+
+    params->wmarks.low = low;
+    return 0;
+}
+
+/* min_size,max_size,min_acc,max_acc,min_age,max_age,action */
+static int parse_scheme(char *scheme_str, struct damos_scheme *scheme)
+{
+    char *fields[NUM_OF_SCHEMES] = {NULL};
+    char *saveptr = NULL;
+    char *field_delim = " ,";
+    int i = 0;
+
+    for (fields[i] = strtok_r(scheme_str, field_delim, &saveptr); fields[i] != NULL;
+            fields[i] = strtok_r(NULL, field_delim, &saveptr)) {
+        if (++i == NUM_OF_SCHEMES) {
+            break;
+        }
+    }
+
+    if (i != NUM_OF_SCHEMES || strtok_r(NULL, field_delim, &saveptr) != NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "scheme must be %d fields separated by ','\n", NUM_OF_SCHEMES);
+        return -1;
+    }
+
+    if (get_unsigned_long_value(fields[0], &scheme->min_sz_region) != 0 ||
+        get_unsigned_long_value(fields[1], &scheme->max_sz_region) != 0 ||
+        get_unsigned_int_value(fields[2], &scheme->min_nr_accesses) != 0 ||
+        get_unsigned_int_value(fields[3], &scheme->max_nr_accesses) != 0 ||
+        get_unsigned_int_value(fields[4], &scheme->min_age_region) != 0 ||
+        get_unsigned_int_value(fields[5], &scheme->max_age_region) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "invalid number in scheme\n");
+        return -1;
+    }
+
+    return parse_action(fields[6], &scheme->action);
+}
+
+/* more schemes after the one of min_size...action, separated by ';' */
+static int fill_schemes(void *obj, void *val)
+{
+    struct damon_eng_params *params = (struct damon_eng_params *)obj;
+    char *schemes_str = (char *)val;
+    char *scheme = NULL;
+    char *saveptr = NULL;
+    char *scheme_delim = ";";
+    int ret = -1;
+
+    for (scheme = strtok_r(schemes_str, scheme_delim, &saveptr); scheme != NULL;
+            scheme = strtok_r(NULL, scheme_delim, &saveptr)) {
+        if (params->nr_schemes == DAMON_MAX_SCHEMES) {
+            etmemd_log(ETMEMD_LOG_ERR, "at most %d schemes for one damon engine\n", DAMON_MAX_SCHEMES);
+            goto out;
+        }
+        if (parse_scheme(scheme, &params->schemes[params->nr_schemes]) != 0) {
+            goto out;
+        }
+        params->nr_schemes++;
+    }
+    ret = 0;
+
+out:
+    free(val);
+    return ret;
+}
+
 static struct config_item damon_eng_config_items[] = {
     {"min_size", INT_VAL, fill_min_size, false},
     {"max_size", INT_VAL, fill_max_size, false},
@@ -518,8 +863,52 @@ static struct config_item damon_eng_config_items[] = {
     {"min_age", INT_VAL, fill_min_age, false},
     {"max_age", INT_VAL, fill_max_age, false},
     {"action", STR_VAL, fill_action, false},
+    {"schemes", STR_VAL, fill_schemes, true},
+    {"quota_ms", INT_VAL, fill_quota_ms, true},
+    {"quota_bytes", INT_VAL, fill_quota_bytes, true},
+    {"quota_reset_interval", INT_VAL, fill_quota_reset_interval, true},
+    {"wmark_metric", STR_VAL, fill_wmark_metric, true},
+    {"wmark_interval", INT_VAL, fill_wmark_interval, true},
+    {"wmark_high", INT_VAL, fill_wmark_high, true},
+    {"wmark_mid", INT_VAL, fill_wmark_mid, true},
+    {"wmark_low", INT_VAL, fill_wmark_low, true},
 };
 
+static int check_damon_eng_params(struct damon_eng_params *params)
+{
+    struct damos_wmarks *wmarks = &params->wmarks;
+    struct damos_scheme *scheme = NULL;
+    int i;
+
+    if (params->quota.reset_interval == 0 && (params->quota.ms != 0 || params->quota.bytes != 0)) {
+        etmemd_log(ETMEMD_LOG_ERR, "quota_reset_interval must be set with quota_ms or quota_bytes\n");
+        return -1;
+    }
+
+    if (wmarks->metric != DAMOS_WMARK_NONE &&
+        (wmarks->interval == 0 || wmarks->high > DAMOS_WMARK_MAX ||
+         wmarks->high < wmarks->mid || wmarks->mid < wmarks->low)) {
+        etmemd_log(ETMEMD_LOG_ERR, "watermarks need wmark_interval > 0 and %d >= high >= mid >= low\n",
+                   DAMOS_WMARK_MAX);
+        return -1;
+    }
+
+    for (i = 0; i < params->nr_schemes; i++) {
+        scheme = &params->schemes[i];
+        if (scheme->min_sz_region > scheme->max_sz_region ||
+            scheme->min_nr_accesses > scheme->max_nr_accesses ||
+            scheme->min_age_region > scheme->max_age_region) {
+            etmemd_log(ETMEMD_LOG_ERR, "min of scheme %d is larger than max\n", i);
+            return -1;
+        }
+        /* quotas and watermarks are shared by all the schemes of the engine */
+        scheme->quota = params->quota;
+        scheme->wmarks = params->wmarks;
+    }
+
+    return 0;
+}
+
 static int damon_fill_eng(GKeyFile *config, struct engine *eng)
 {
     struct damon_eng_params *params = calloc(1, sizeof(struct damon_eng_params));
@@ -528,6 +917,8 @@ static int damon_fill_eng(GKeyFile *config, struct engine *eng)
         etmemd_log(ETMEMD_LOG_ERR, "alloc damon engine params fail\n");
         return -1;
     }
+    params->nr_schemes = 1;
+    params->kdamond = -1;
 
     if (parse_file_config(config, ENG_GROUP, damon_eng_config_items,
         ARRAY_SIZE(damon_eng_config_items), (void *)params) != 0) {
@@ -536,6 +927,11 @@ static int damon_fill_eng(GKeyFile *config, struct engine *eng)
         return -1;
     }
 
+    if (check_damon_eng_params(params) != 0) {
+        free(params);
+        return -1;
+    }
+
     eng->params = (void *)params;
     return 0;
 }
@@ -548,6 +944,9 @@ static void damon_clear_eng(struct engine *eng)
         return;
     }
 
+    if (eng_params->kdamond >= 0) {
+        kdamond_free(eng_params->kdamond);
+    }
     free(eng_params);
     eng->params = NULL;
 }
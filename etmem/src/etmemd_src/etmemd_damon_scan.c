@@ -0,0 +1,568 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: Scan backend that turns DAMON region snapshots into page_refs.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#include "securec.h"
+#include "etmemd_common.h"
+#include "etmemd_log.h"
+#include "etmemd_damon_sysfs.h"
+#include "etmemd_damon_scan.h"
+
+#define DAMON_TRIED_REGIONS         "contexts/0/schemes/0/tried_regions"
+
+/* aggregation intervals monitored for one snapshot through debugfs */
+#define DAMON_DBGFS_SNAPSHOT_AGGRS  2
+#define DAMON_TRACE_EVENT           "damon_aggregated: "
+
+#define DAMON_PATH_MAX_LEN          256
+#define DAMON_VAL_MAX_LEN           64
+#define DAMON_TRACE_LINE_MAX_LEN    256
+#define DAMON_REGIONS_INIT          64
+
+#define PAGEMAP_PRESENT             (1ULL << 63)
+#define PAGEMAP_PFN_MASK            ((1ULL << 55) - 1)
+/* pages handled by one pagemap read */
+#define DAMON_PAGEMAP_BATCH         4096
+
+struct damon_snapshot {
+    struct damon_region *regions;
+    int nr;
+    int size;
+};
+
+/* the kdamond monitoring each pid scanned, pid 0 if the entry is free */
+struct damon_scan_target {
+    unsigned int pid;
+    int kdamond;
+};
+
+static struct damon_scan_target g_scan_targets[DAMON_SYSFS_MAX_KDAMONDS];
+static pthread_mutex_t g_damon_scan_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_damon_dbgfs_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+/* a stat scheme matching every region, only to collect tried_regions */
+static const struct damos_scheme g_damon_scan_scheme = {
+    .min_sz_region = 0,
+    .max_sz_region = ULONG_MAX,
+    .min_nr_accesses = 0,
+    .max_nr_accesses = UINT_MAX,
+    .min_age_region = 0,
+    .max_age_region = UINT_MAX,
+    .action = DAMOS_STAT,
+};
+
+bool damon_scan_supported(void)
+{
+    char root_path[PATH_MAX] = {0};
+    const char *path = etmemd_root_path(DAMON_DBGFS_PATH "monitor_on", root_path, sizeof(root_path));
+
+    return damon_sysfs_exist() || (path != NULL && access(path, F_OK) == 0);
+}
+
+void damon_scan_default_attrs(struct region_scan *attrs)
+{
+    attrs->sample_interval = DAMON_DEFAULT_SAMPLE_INTERVAL;
+    attrs->aggr_interval = DAMON_DEFAULT_AGGR_INTERVAL;
+    attrs->update_interval = DAMON_DEFAULT_UPDATE_INTERVAL;
+    attrs->min_nr_regions = DAMON_DEFAULT_MIN_NR_REGIONS;
+    attrs->max_nr_regions = DAMON_DEFAULT_MAX_NR_REGIONS;
+}
+
+static int damon_snapshot_add(struct damon_snapshot *snap, const struct damon_region *region)
+{
+    struct damon_region *regions = NULL;
+    int size;
+
+    if (snap->nr == snap->size) {
+        size = snap->size == 0 ? DAMON_REGIONS_INIT : snap->size * 2;
+        regions = (struct damon_region *)realloc(snap->regions, size * sizeof(struct damon_region));
+        if (regions == NULL) {
+            etmemd_log(ETMEMD_LOG_ERR, "realloc for damon regions fail\n");
+            return -1;
+        }
+        snap->regions = regions;
+        snap->size = size;
+    }
+
+    snap->regions[snap->nr++] = *region;
+    return 0;
+}
+
+static int cmp_damon_region(const void *a, const void *b)
+{
+    const struct damon_region *region_a = (const struct damon_region *)a;
+    const struct damon_region *region_b = (const struct damon_region *)b;
+
+    if (region_a->start == region_b->start) {
+        return 0;
+    }
+
+    return region_a->start < region_b->start ? -1 : 1;
+}
+
+static int damon_sysfs_get_kdamond(unsigned int pid, const struct region_scan *attrs)
+{
+    struct damon_scan_target *target = NULL;
+    int kdamond = -1;
+    int i;
+
+    if (pthread_mutex_lock(&g_damon_scan_mtx) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "lock damon scan fail\n");
+        return -1;
+    }
+
+    for (i = 0; i < DAMON_SYSFS_MAX_KDAMONDS; i++) {
+        if (g_scan_targets[i].pid == pid) {
+            target = &g_scan_targets[i];
+            break;
+        }
+        if (g_scan_targets[i].pid == 0 && target == NULL) {
+            target = &g_scan_targets[i];
+        }
+    }
+
+    if (target == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "no kdamond left to monitor pid %u\n", pid);
+        goto unlock;
+    }
+
+    if (target->pid == 0) {
+        target->kdamond = kdamond_alloc();
+        if (target->kdamond < 0) {
+            goto unlock;
+        }
+        target->pid = pid;
+    } else if (kdamond_is_on(target->kdamond)) {
+        kdamond = target->kdamond;
+        goto unlock;
+    }
+
+    /* a kdamond stops by itself when its process exits, restart it for the pid reused */
+    if (kdamond_start(target->kdamond, attrs, &pid, 1, &g_damon_scan_scheme, 1) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "fail to start kdamond %d for pid %u\n", target->kdamond, pid);
+        kdamond_free(target->kdamond);
+        target->pid = 0;
+        goto unlock;
+    }
+    kdamond = target->kdamond;
+
+unlock:
+    pthread_mutex_unlock(&g_damon_scan_mtx);
+    return kdamond;
+}
+
+static int damon_sysfs_read_region(const char *dir, const char *name, struct damon_region *region)
+{
+    const char *files[] = {"start", "end", "nr_accesses", "age"};
+    unsigned long long vals[ARRAY_SIZE(files)];
+    char path[DAMON_PATH_MAX_LEN] = {0};
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(files); i++) {
+        if (snprintf_s(path, sizeof(path), sizeof(path) - 1, "%s/%s/%s", dir, name, files[i]) <= 0) {
+            etmemd_log(ETMEMD_LOG_ERR, "snprintf path of damon region %s fail\n", name);
+            return -1;
+        }
+        if (damon_read_ull(path, &vals[i]) != 0) {
+            return -1;
+        }
+    }
+
+    region->start = vals[0];
+    region->end = vals[1];
+    region->nr_accesses = (unsigned int)vals[2];
+    region->age = (unsigned int)vals[3];
+    return 0;
+}
+
+static int damon_sysfs_snapshot(unsigned int pid, const struct region_scan *attrs, struct damon_snapshot *snap)
+{
+    char root_path[PATH_MAX] = {0};
+    char dir[DAMON_PATH_MAX_LEN] = {0};
+    const char *path = NULL;
+    struct damon_region region;
+    struct dirent *entry = NULL;
+    DIR *regions_dir = NULL;
+    int kdamond;
+    int ret = 0;
+
+    kdamond = damon_sysfs_get_kdamond(pid, attrs);
+    if (kdamond < 0) {
+        return -1;
+    }
+
+    /* the kernel fills tried_regions after the next aggregation */
+    if (kdamond_write(kdamond, "state", "update_schemes_tried_regions") != 0 ||
+        kdamond_path(dir, sizeof(dir), kdamond, DAMON_TRIED_REGIONS) != 0) {
+        return -1;
+    }
+
+    path = etmemd_root_path(dir, root_path, sizeof(root_path));
+    regions_dir = path == NULL ? NULL : opendir(path);
+    if (regions_dir == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "open dir %s fail\n", dir);
+        return -1;
+    }
+
+    while ((entry = readdir(regions_dir)) != NULL) {
+        if (!isdigit((unsigned char)entry->d_name[0])) {
+            continue;
+        }
+        if (damon_sysfs_read_region(dir, entry->d_name, &region) != 0 ||
+            damon_snapshot_add(snap, &region) != 0) {
+            ret = -1;
+            break;
+        }
+    }
+
+    closedir(regions_dir);
+    return ret;
+}
+
+static int damon_dbgfs_set_monitor(const char *on)
+{
+    return damon_write_file(DAMON_DBGFS_PATH "monitor_on", on, 0);
+}
+
+static int damon_dbgfs_setup(unsigned int pid, const struct region_scan *attrs)
+{
+    char val[DAMON_VAL_MAX_LEN] = {0};
+    char state[DAMON_VAL_MAX_LEN] = {0};
+
+    if (damon_read_file(DAMON_DBGFS_PATH "monitor_on", state, sizeof(state)) != 0) {
+        return -1;
+    }
+    if (strcmp(state, "on") == 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "DAMON debugfs is busy with other monitoring\n");
+        return -1;
+    }
+
+    if (snprintf_s(val, sizeof(val), sizeof(val) - 1, "%u", pid) <= 0 ||
+        damon_write_file(DAMON_DBGFS_PATH "target_ids", val, 0) != 0) {
+        return -1;
+    }
+
+    if (snprintf_s(val, sizeof(val), sizeof(val) - 1, "%lu %lu %lu %lu %lu",
+                   attrs->sample_interval, attrs->aggr_interval, attrs->update_interval,
+                   attrs->min_nr_regions, attrs->max_nr_regions) <= 0 ||
+        damon_write_file(DAMON_DBGFS_PATH "attrs", val, 0) != 0) {
+        return -1;
+    }
+
+    /* clear the trace buffer and enable the event printing the regions of each aggregation */
+    if (damon_write_file(DAMON_TRACEFS_PATH "trace", "", O_TRUNC) != 0 ||
+        damon_write_file(DAMON_TRACEFS_PATH "events/damon/damon_aggregated/enable", "1", 0) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* keep the regions of the last aggregation traced, the addresses restart from the lowest for each one */
+static int damon_dbgfs_parse_trace(struct damon_snapshot *snap)
+{
+    char line[DAMON_TRACE_LINE_MAX_LEN] = {0};
+    char root_path[PATH_MAX] = {0};
+    const char *path = NULL;
+    struct damon_region region;
+    unsigned long target_id;
+    unsigned int nr_regions;
+    uint64_t last_start = 0;
+    FILE *fp = NULL;
+    char *event = NULL;
+    int ret = 0;
+
+    path = etmemd_root_path(DAMON_TRACEFS_PATH "trace", root_path, sizeof(root_path));
+    fp = path == NULL ? NULL : fopen(path, "r");
+    if (fp == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "open %strace fail\n", DAMON_TRACEFS_PATH);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        event = strstr(line, DAMON_TRACE_EVENT);
+        if (event == NULL) {
+            continue;
+        }
+        if (sscanf_s(event + strlen(DAMON_TRACE_EVENT), "target_id=%lu nr_regions=%u %lu-%lu: %u %u",
+                     &target_id, &nr_regions, &region.start, &region.end,
+                     &region.nr_accesses, &region.age) != 6) {
+            continue;
+        }
+        if (snap->nr > 0 && region.start <= last_start) {
+            snap->nr = 0;
+        }
+        last_start = region.start;
+        if (damon_snapshot_add(snap, &region) != 0) {
+            ret = -1;
+            break;
+        }
+    }
+
+    fclose(fp);
+    return ret;
+}
+
+/* debugfs has no file for the regions, so monitor pid for a while and read them from the trace event */
+static int damon_dbgfs_snapshot(unsigned int pid, const struct region_scan *attrs, struct damon_snapshot *snap)
+{
+    int ret = -1;
+
+    if (pthread_mutex_lock(&g_damon_dbgfs_mtx) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "lock damon debugfs fail\n");
+        return -1;
+    }
+
+    if (damon_dbgfs_setup(pid, attrs) != 0) {
+        goto unlock;
+    }
+
+    if (damon_dbgfs_set_monitor("on") != 0) {
+        goto disable_event;
+    }
+    usleep((useconds_t)(attrs->aggr_interval * DAMON_DBGFS_SNAPSHOT_AGGRS));
+    if (damon_dbgfs_set_monitor("off") != 0) {
+        goto disable_event;
+    }
+
+    ret = damon_dbgfs_parse_trace(snap);
+
+disable_event:
+    damon_write_file(DAMON_TRACEFS_PATH "events/damon/damon_aggregated/enable", "0", 0);
+unlock:
+    pthread_mutex_unlock(&g_damon_dbgfs_mtx);
+    return ret;
+}
+
+static int damon_weight(unsigned int nr_accesses, unsigned int max_nr_accesses)
+{
+    unsigned int weight;
+
+    if (nr_accesses == 0) {
+        return IDLE_TYPE_WEIGHT;
+    }
+    if (nr_accesses >= max_nr_accesses) {
+        return MAX_ACCESS_WEIGHT;
+    }
+
+    /* round up, so a region accessed at all is not taken as idle */
+    weight = (nr_accesses * MAX_ACCESS_WEIGHT + max_nr_accesses - 1) / max_nr_accesses;
+    return (int)weight;
+}
+
+/* treat the pages as a huge page if they map the pfns of one aligned huge page in order */
+static bool is_huge_page(const uint64_t *entries, unsigned int nr)
+{
+    uint64_t pfn;
+    unsigned int i;
+
+    if ((entries[0] & PAGEMAP_PRESENT) == 0) {
+        return false;
+    }
+
+    pfn = entries[0] & PAGEMAP_PFN_MASK;
+    if (pfn == 0 || pfn % nr != 0) {
+        return false;
+    }
+
+    for (i = 1; i < nr; i++) {
+        if ((entries[i] & PAGEMAP_PRESENT) == 0 || (entries[i] & PAGEMAP_PFN_MASK) != pfn + i) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static struct page_refs **record_damon_range(int pagemap_fd, uint64_t *entries, uint64_t start, uint64_t end,
+                                             int weight, struct page_refs **pf, unsigned long *use_rss)
+{
+    uint64_t pte_size = page_type_to_size(PTE_TYPE);
+    unsigned int pages_per_pmd = (unsigned int)(page_type_to_size(PMD_TYPE) / pte_size);
+    uint64_t addr = start;
+    unsigned int nr, i;
+    ssize_t len;
+
+    while (addr < end) {
+        /* end the batch at a huge page boundary so huge pages are never split between batches */
+        nr = DAMON_PAGEMAP_BATCH - (unsigned int)((addr / pte_size) % pages_per_pmd);
+        if (nr > (end - addr) / pte_size) {
+            nr = (unsigned int)((end - addr) / pte_size);
+        }
+
+        len = pread(pagemap_fd, entries, nr * sizeof(uint64_t), (off_t)(addr / pte_size * sizeof(uint64_t)));
+        if (len <= 0) {
+            etmemd_log(ETMEMD_LOG_ERR, "read pagemap at %llx fail, error: %d\n", addr, errno);
+            return NULL;
+        }
+        nr = (unsigned int)(len / sizeof(uint64_t));
+
+        for (i = 0; i < nr;) {
+            if ((addr / pte_size) % pages_per_pmd == 0 && i + pages_per_pmd <= nr &&
+                is_huge_page(entries + i, pages_per_pmd)) {
+                pf = update_page_refs(addr, weight, PMD_TYPE, pf);
+                if (use_rss != NULL && weight > 0) {
+                    *use_rss += pages_per_pmd;
+                }
+                i += pages_per_pmd;
+                addr += pages_per_pmd * pte_size;
+            } else {
+                if ((entries[i] & PAGEMAP_PRESENT) != 0) {
+                    pf = update_page_refs(addr, weight, PTE_TYPE, pf);
+                    if (use_rss != NULL && weight > 0) {
+                        (*use_rss)++;
+                    }
+                }
+                i++;
+                addr += pte_size;
+            }
+            if (pf == NULL) {
+                return NULL;
+            }
+        }
+    }
+
+    return pf;
+}
+
+int damon_regions_to_page_refs(const struct vmas *vmas, const char *pid, const struct damon_region *regions,
+                               int nr, unsigned int max_nr_accesses, struct page_refs **page_refs,
+                               unsigned long *use_rss)
+{
+    uint64_t pte_size = page_type_to_size(PTE_TYPE);
+    char root_path[PATH_MAX] = {0};
+    char path[DAMON_PATH_MAX_LEN] = {0};
+    const char *file = NULL;
+    struct page_refs **pf = page_refs;
+    const struct vma *vma = NULL;
+    uint64_t *entries = NULL;
+    uint64_t start, end;
+    int pagemap_fd;
+    int i = 0;
+    int j;
+    int ret = 0;
+
+    if (snprintf_s(path, sizeof(path), sizeof(path) - 1, "%s%s%s", PROC_PATH, pid, PAGEMAP_FILE) <= 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "snprintf pagemap path for pid %s fail\n", pid);
+        return -1;
+    }
+
+    file = etmemd_root_path(path, root_path, sizeof(root_path));
+    pagemap_fd = file == NULL ? -1 : open(file, O_RDONLY);
+    if (pagemap_fd < 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "open %s fail, errno %d\n", path, errno);
+        return -1;
+    }
+
+    entries = (uint64_t *)malloc(DAMON_PAGEMAP_BATCH * sizeof(uint64_t));
+    if (entries == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for pagemap entries fail\n");
+        close(pagemap_fd);
+        return -1;
+    }
+
+    /* both vmas and regions are sorted by address, walk them together */
+    for (vma = vmas->vma_list; vma != NULL && ret == 0; vma = vma->next) {
+        while (i < nr && regions[i].end <= vma->start) {
+            i++;
+        }
+        for (j = i; j < nr && regions[j].start < vma->end; j++) {
+            start = regions[j].start > vma->start ? regions[j].start : vma->start;
+            end = regions[j].end < vma->end ? regions[j].end : vma->end;
+            start = (start + pte_size - 1) & ~(pte_size - 1);
+            end &= ~(pte_size - 1);
+            if (start >= end) {
+                continue;
+            }
+            pf = record_damon_range(pagemap_fd, entries, start, end,
+                                    damon_weight(regions[j].nr_accesses, max_nr_accesses), pf, use_rss);
+            if (pf == NULL) {
+                ret = -1;
+                break;
+            }
+        }
+    }
+
+    free(entries);
+    close(pagemap_fd);
+    return ret;
+}
+
+int get_page_refs_by_damon(const struct vmas *vmas, const char *pid, const struct region_scan *attrs,
+                           struct page_refs **page_refs, unsigned long *use_rss)
+{
+    struct damon_snapshot snap = {0};
+    unsigned int max_nr_accesses;
+    unsigned int pid_num;
+    int ret;
+
+    if (get_unsigned_int_value(pid, &pid_num) != 0 || pid_num == 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "invalid pid %s for damon scan\n", pid);
+        return -1;
+    }
+
+    if (damon_sysfs_exist()) {
+        ret = damon_sysfs_snapshot(pid_num, attrs, &snap);
+    } else {
+        ret = damon_dbgfs_snapshot(pid_num, attrs, &snap);
+    }
+    if (ret != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "get damon regions of pid %s fail\n", pid);
+        free(snap.regions);
+        return -1;
+    }
+
+    qsort(snap.regions, snap.nr, sizeof(struct damon_region), cmp_damon_region);
+    /* nr_accesses counts the samples found accessed in one aggregation interval */
+    max_nr_accesses = (unsigned int)(attrs->aggr_interval / attrs->sample_interval);
+    if (max_nr_accesses == 0) {
+        max_nr_accesses = 1;
+    }
+
+    ret = damon_regions_to_page_refs(vmas, pid, snap.regions, snap.nr, max_nr_accesses, page_refs, use_rss);
+    free(snap.regions);
+    return ret;
+}
+
+void damon_scan_release(unsigned int pid)
+{
+    int i;
+
+    if (pthread_mutex_lock(&g_damon_scan_mtx) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "lock damon scan fail\n");
+        return;
+    }
+
+    for (i = 0; i < DAMON_SYSFS_MAX_KDAMONDS; i++) {
+        if (g_scan_targets[i].pid != pid) {
+            continue;
+        }
+        kdamond_free(g_scan_targets[i].kdamond);
+        g_scan_targets[i].pid = 0;
+    }
+
+    pthread_mutex_unlock(&g_damon_scan_mtx);
+}
@@ -0,0 +1,403 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: Access to the kdamonds of the DAMON sysfs interface.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "securec.h"
+#include "etmemd_common.h"
+#include "etmemd_log.h"
+#include "etmemd_damon_sysfs.h"
+
+#define DAMON_PATH_MAX_LEN      256
+#define DAMON_VAL_MAX_LEN       64
+#define DAMON_CTX_PATH          "contexts/0/"
+
+struct damon_sysfs_item {
+    const char *file;
+    unsigned long val;
+};
+
+static const char *g_damos_action_strs[] = {
+    [DAMOS_WILLNEED] = "willneed",
+    [DAMOS_COLD] = "cold",
+    [DAMOS_PAGEOUT] = "pageout",
+    [DAMOS_HUGEPAGE] = "hugepage",
+    [DAMOS_NOHUGEPAGE] = "nohugepage",
+    [DAMOS_STAT] = "stat",
+};
+
+static const char *g_damos_wmark_metric_strs[] = {
+    [DAMOS_WMARK_NONE] = "none",
+    [DAMOS_WMARK_FREE_MEM_RATE] = "free_mem_rate",
+};
+
+static bool g_kdamond_used[DAMON_SYSFS_MAX_KDAMONDS];
+static int g_nr_kdamonds = -1;
+static pthread_mutex_t g_kdamond_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+bool damon_sysfs_exist(void)
+{
+    char root_path[PATH_MAX] = {0};
+    const char *path = etmemd_root_path(DAMON_KDAMONDS_PATH "nr_kdamonds", root_path, sizeof(root_path));
+
+    return path != NULL && access(path, F_OK) == 0;
+}
+
+const char *damos_action_str(enum damos_action action)
+{
+    return g_damos_action_strs[action];
+}
+
+int damon_write_file(const char *path, const char *val, int flags)
+{
+    ssize_t len = (ssize_t)strlen(val);
+    char root_path[PATH_MAX] = {0};
+    const char *file = etmemd_root_path(path, root_path, sizeof(root_path));
+    int fd;
+
+    fd = file == NULL ? -1 : open(file, O_WRONLY | flags);
+    if (fd < 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "open %s fail, error: %d\n", path, errno);
+        return -1;
+    }
+
+    if (write(fd, val, len) != len) {
+        etmemd_log(ETMEMD_LOG_ERR, "write %s to %s fail, error: %d\n", val, path, errno);
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    return 0;
+}
+
+static int damon_write_ul(const char *path, unsigned long val)
+{
+    char buf[DAMON_VAL_MAX_LEN] = {0};
+
+    if (snprintf_s(buf, sizeof(buf), sizeof(buf) - 1, "%lu", val) <= 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "snprintf value %lu fail\n", val);
+        return -1;
+    }
+
+    return damon_write_file(path, buf, 0);
+}
+
+int damon_read_file(const char *path, char *buf, size_t size)
+{
+    char root_path[PATH_MAX] = {0};
+    const char *file = etmemd_root_path(path, root_path, sizeof(root_path));
+    ssize_t len;
+    int fd;
+
+    fd = file == NULL ? -1 : open(file, O_RDONLY);
+    if (fd < 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "open %s fail, error: %d\n", path, errno);
+        return -1;
+    }
+
+    len = read(fd, buf, size - 1);
+    close(fd);
+    if (len < 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "read %s fail, error: %d\n", path, errno);
+        return -1;
+    }
+
+    buf[len] = '\0';
+    if (len > 0 && buf[len - 1] == '\n') {
+        buf[len - 1] = '\0';
+    }
+    return 0;
+}
+
+int damon_read_ull(const char *path, unsigned long long *val)
+{
+    char buf[DAMON_VAL_MAX_LEN] = {0};
+    char *end = NULL;
+
+    if (damon_read_file(path, buf, sizeof(buf)) != 0) {
+        return -1;
+    }
+
+    errno = 0;
+    *val = strtoull(buf, &end, 0);
+    if (errno != 0 || end == buf) {
+        etmemd_log(ETMEMD_LOG_ERR, "invalid value %s of %s\n", buf, path);
+        return -1;
+    }
+
+    return 0;
+}
+
+int kdamond_path(char *path, size_t size, int kdamond, const char *file)
+{
+    if (snprintf_s(path, size, size - 1, DAMON_KDAMONDS_PATH "%d/%s", kdamond, file) <= 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "snprintf path of kdamond %d file %s fail\n", kdamond, file);
+        return -1;
+    }
+
+    return 0;
+}
+
+int kdamond_write(int kdamond, const char *file, const char *val)
+{
+    char path[DAMON_PATH_MAX_LEN] = {0};
+
+    if (kdamond_path(path, sizeof(path), kdamond, file) != 0) {
+        return -1;
+    }
+
+    return damon_write_file(path, val, 0);
+}
+
+static int kdamond_write_ul(int kdamond, const char *file, unsigned long val)
+{
+    char path[DAMON_PATH_MAX_LEN] = {0};
+
+    if (kdamond_path(path, sizeof(path), kdamond, file) != 0) {
+        return -1;
+    }
+
+    return damon_write_ul(path, val);
+}
+
+bool kdamond_is_on(int kdamond)
+{
+    char path[DAMON_PATH_MAX_LEN] = {0};
+    char state[DAMON_VAL_MAX_LEN] = {0};
+
+    if (kdamond_path(path, sizeof(path), kdamond, "state") != 0 ||
+        damon_read_file(path, state, sizeof(state)) != 0) {
+        return false;
+    }
+
+    return strcmp(state, "on") == 0;
+}
+
+/* nr_kdamonds can only be written when no kdamond is running, so all of them are made at once */
+static int init_kdamonds(void)
+{
+    unsigned long long nr;
+
+    if (g_nr_kdamonds >= 0) {
+        return 0;
+    }
+
+    if (damon_read_ull(DAMON_KDAMONDS_PATH "nr_kdamonds", &nr) == 0 && nr == DAMON_SYSFS_MAX_KDAMONDS) {
+        g_nr_kdamonds = DAMON_SYSFS_MAX_KDAMONDS;
+        return 0;
+    }
+
+    if (damon_write_ul(DAMON_KDAMONDS_PATH "nr_kdamonds", DAMON_SYSFS_MAX_KDAMONDS) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "fail to make kdamonds, some kdamond may be running\n");
+        return -1;
+    }
+
+    g_nr_kdamonds = DAMON_SYSFS_MAX_KDAMONDS;
+    return 0;
+}
+
+int kdamond_alloc(void)
+{
+    int kdamond = -1;
+    int i;
+
+    if (pthread_mutex_lock(&g_kdamond_mtx) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "lock kdamonds fail\n");
+        return -1;
+    }
+
+    if (init_kdamonds() != 0) {
+        goto unlock;
+    }
+
+    for (i = 0; i < g_nr_kdamonds; i++) {
+        if (!g_kdamond_used[i]) {
+            g_kdamond_used[i] = true;
+            kdamond = i;
+            break;
+        }
+    }
+    if (kdamond < 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "all the %d kdamonds are in use\n", g_nr_kdamonds);
+    }
+
+unlock:
+    pthread_mutex_unlock(&g_kdamond_mtx);
+    return kdamond;
+}
+
+void kdamond_free(int kdamond)
+{
+    if (kdamond < 0 || kdamond >= DAMON_SYSFS_MAX_KDAMONDS) {
+        return;
+    }
+
+    if (kdamond_is_on(kdamond) && kdamond_write(kdamond, "state", "off") != 0) {
+        etmemd_log(ETMEMD_LOG_WARN, "turn kdamond %d off fail\n", kdamond);
+    }
+
+    if (pthread_mutex_lock(&g_kdamond_mtx) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "lock kdamonds fail\n");
+        return;
+    }
+    g_kdamond_used[kdamond] = false;
+    pthread_mutex_unlock(&g_kdamond_mtx);
+}
+
+static int kdamond_write_items(int kdamond, const char *dir, const struct damon_sysfs_item *items, size_t nr)
+{
+    char file[DAMON_PATH_MAX_LEN] = {0};
+    size_t i;
+
+    for (i = 0; i < nr; i++) {
+        if (snprintf_s(file, sizeof(file), sizeof(file) - 1, "%s%s", dir, items[i].file) <= 0) {
+            etmemd_log(ETMEMD_LOG_ERR, "snprintf path of %s fail\n", items[i].file);
+            return -1;
+        }
+        if (kdamond_write_ul(kdamond, file, items[i].val) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int kdamond_set_targets(int kdamond, const unsigned int *pids, int nr_pids)
+{
+    char file[DAMON_PATH_MAX_LEN] = {0};
+    int i;
+
+    if (kdamond_write_ul(kdamond, DAMON_CTX_PATH "targets/nr_targets", (unsigned long)nr_pids) != 0) {
+        return -1;
+    }
+
+    for (i = 0; i < nr_pids; i++) {
+        if (snprintf_s(file, sizeof(file), sizeof(file) - 1, DAMON_CTX_PATH "targets/%d/pid_target", i) <= 0) {
+            etmemd_log(ETMEMD_LOG_ERR, "snprintf path of target %d fail\n", i);
+            return -1;
+        }
+        if (kdamond_write_ul(kdamond, file, pids[i]) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int kdamond_set_scheme(int kdamond, int idx, const struct damos_scheme *scheme)
+{
+    const struct damon_sysfs_item items[] = {
+        {"access_pattern/sz/min", scheme->min_sz_region},
+        {"access_pattern/sz/max", scheme->max_sz_region},
+        {"access_pattern/nr_accesses/min", scheme->min_nr_accesses},
+        {"access_pattern/nr_accesses/max", scheme->max_nr_accesses},
+        {"access_pattern/age/min", scheme->min_age_region},
+        {"access_pattern/age/max", scheme->max_age_region},
+        {"quotas/ms", scheme->quota.ms},
+        {"quotas/bytes", scheme->quota.bytes},
+        {"quotas/reset_interval_ms", scheme->quota.reset_interval},
+        {"watermarks/interval_us", scheme->wmarks.interval},
+        {"watermarks/high", scheme->wmarks.high},
+        {"watermarks/mid", scheme->wmarks.mid},
+        {"watermarks/low", scheme->wmarks.low},
+    };
+    char dir[DAMON_PATH_MAX_LEN] = {0};
+    char file[DAMON_PATH_MAX_LEN] = {0};
+
+    if (snprintf_s(dir, sizeof(dir), sizeof(dir) - 1, DAMON_CTX_PATH "schemes/%d/", idx) <= 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "snprintf path of scheme %d fail\n", idx);
+        return -1;
+    }
+
+    if (kdamond_write_items(kdamond, dir, items, ARRAY_SIZE(items)) != 0) {
+        return -1;
+    }
+
+    if (snprintf_s(file, sizeof(file), sizeof(file) - 1, "%saction", dir) <= 0 ||
+        kdamond_write(kdamond, file, damos_action_str(scheme->action)) != 0) {
+        return -1;
+    }
+
+    if (snprintf_s(file, sizeof(file), sizeof(file) - 1, "%swatermarks/metric", dir) <= 0 ||
+        kdamond_write(kdamond, file, g_damos_wmark_metric_strs[scheme->wmarks.metric]) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int kdamond_start(int kdamond, const struct region_scan *attrs, const unsigned int *pids, int nr_pids,
+                  const struct damos_scheme *schemes, int nr_schemes)
+{
+    const struct damon_sysfs_item attr_items[] = {
+        {"monitoring_attrs/intervals/sample_us", attrs->sample_interval},
+        {"monitoring_attrs/intervals/aggr_us", attrs->aggr_interval},
+        {"monitoring_attrs/intervals/update_us", attrs->update_interval},
+        {"monitoring_attrs/nr_regions/min", attrs->min_nr_regions},
+        {"monitoring_attrs/nr_regions/max", attrs->max_nr_regions},
+    };
+    char root_path[PATH_MAX] = {0};
+    char path[DAMON_PATH_MAX_LEN] = {0};
+    char ops[DAMON_VAL_MAX_LEN] = {0};
+    const char *file = NULL;
+    int i;
+
+    if (kdamond_is_on(kdamond) && kdamond_write(kdamond, "state", "off") != 0) {
+        return -1;
+    }
+
+    if (kdamond_write_ul(kdamond, "contexts/nr_contexts", 1) != 0) {
+        return -1;
+    }
+
+    /* avail_operations only exists since 6.1 */
+    if (kdamond_path(path, sizeof(path), kdamond, DAMON_CTX_PATH "avail_operations") == 0 &&
+        (file = etmemd_root_path(path, root_path, sizeof(root_path))) != NULL &&
+        access(file, F_OK) == 0 && damon_read_file(path, ops, sizeof(ops)) == 0 &&
+        strstr(ops, "vaddr") == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "DAMON of the kernel can not monitor virtual address spaces\n");
+        return -1;
+    }
+
+    if (kdamond_write(kdamond, DAMON_CTX_PATH "operations", "vaddr") != 0 ||
+        kdamond_write_items(kdamond, DAMON_CTX_PATH, attr_items, ARRAY_SIZE(attr_items)) != 0 ||
+        kdamond_set_targets(kdamond, pids, nr_pids) != 0) {
+        return -1;
+    }
+
+    if (kdamond_write_ul(kdamond, DAMON_CTX_PATH "schemes/nr_schemes", (unsigned long)nr_schemes) != 0) {
+        return -1;
+    }
+    for (i = 0; i < nr_schemes; i++) {
+        if (kdamond_set_scheme(kdamond, i, &schemes[i]) != 0) {
+            return -1;
+        }
+    }
+
+    if (kdamond_write(kdamond, "state", "on") != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "fail to turn kdamond %d on\n", kdamond);
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,832 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: Keep the hotness of the scanned pids in a file, so a new etmemd resumes from it.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/queue.h>
+
+#include "securec.h"
+#include "etmemd_common.h"
+#include "etmemd_log.h"
+#include "etmemd_hotness.h"
+
+#define HOTNESS_MAGIC           "ETMHOT"
+#define HOTNESS_VERSION         1
+#define HOTNESS_BOOT_ID_LEN     40
+#define HOTNESS_BOOT_ID_FILE    "/proc/sys/kernel/random/boot_id"
+#define HOTNESS_STAT_FILE       "/stat"
+#define HOTNESS_STAT_BUF_LEN    1024
+/* starttime is the 22nd field of /proc/<pid>/stat, and the 20th after comm */
+#define HOTNESS_STARTTIME_FIELD 20
+#define HOTNESS_FNV_OFFSET      14695981039346656037ULL
+#define HOTNESS_FNV_PRIME       1099511628211ULL
+
+/* the hotness of a region is the average count of its pages in 0 - HOTNESS_HOT of loop */
+#define HOTNESS_HOT             254
+#define HOTNESS_UNKNOWN         255
+
+#define ALIGN_8(s)              (((s) + 7) & ~(size_t)7)
+
+/* layout of the file, all in the byte order of the host */
+struct hotness_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t nr_pids;
+    uint64_t size;                          /* size of the whole file */
+    uint64_t checksum;                      /* of all the bytes after the header */
+    char boot_id[HOTNESS_BOOT_ID_LEN];
+};
+
+/* followed by nr_vmas struct hotness_vma_rec, then the regions of all the vmas aligned to 8 */
+struct hotness_pid_rec {
+    uint64_t start_time;
+    int64_t stamp;
+    uint32_t pid;
+    uint32_t nr_vmas;
+};
+
+struct hotness_vma_rec {
+    uint64_t start;
+    uint64_t end;
+};
+
+struct hot_vma {
+    uint64_t start;
+    uint64_t end;
+    size_t nr_regions;
+    uint8_t *regions;
+};
+
+struct hot_pid {
+    unsigned int pid;
+    uint64_t start_time;
+    time_t stamp;
+    bool warm;                  /* loaded from the file and not used yet */
+    size_t nr_vmas;
+    struct hot_vma *vmas;       /* sorted by start */
+    SLIST_ENTRY(hot_pid) entry;
+};
+
+static char g_hotness_file[PATH_MAX];
+static char g_hotness_tmp[PATH_MAX];
+static bool g_hotness_enabled = false;
+static char g_boot_id[HOTNESS_BOOT_ID_LEN];
+static time_t g_last_checkpoint;
+static bool g_checkpointing = false;
+static SLIST_HEAD(hot_pid_list, hot_pid) g_hot_pids = SLIST_HEAD_INITIALIZER(g_hot_pids);
+static pthread_mutex_t g_hotness_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+int etmemd_hotness_set_dir(const char *dir)
+{
+    if (dir == NULL || dir[0] != '/') {
+        etmemd_log(ETMEMD_LOG_ERR, "hotness dir should be an absolute path\n");
+        return -1;
+    }
+
+    if (snprintf_s(g_hotness_file, PATH_MAX, PATH_MAX - 1, "%s/%s", dir, HOTNESS_FILE_NAME) <= 0 ||
+        snprintf_s(g_hotness_tmp, PATH_MAX, PATH_MAX - 1, "%s/.%s.tmp", dir, HOTNESS_FILE_NAME) <= 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "hotness dir %s is too long\n", dir);
+        return -1;
+    }
+
+    g_hotness_enabled = true;
+    return 0;
+}
+
+bool etmemd_hotness_enabled(void)
+{
+    return g_hotness_enabled;
+}
+
+static uint64_t hotness_checksum(const uint8_t *buf, size_t len)
+{
+    uint64_t hash = HOTNESS_FNV_OFFSET;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash = (hash ^ buf[i]) * HOTNESS_FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/* both files read are of /proc */
+static int read_small_file(const char *path, char *buf, size_t size)
+{
+    char root_path[PATH_MAX] = {0};
+    const char *file = etmemd_root_path(path, root_path, sizeof(root_path));
+    ssize_t len;
+    int fd;
+
+    fd = file == NULL ? -1 : open(file, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    len = read(fd, buf, size - 1);
+    close(fd);
+    if (len <= 0) {
+        return -1;
+    }
+
+    buf[len] = '\0';
+    return 0;
+}
+
+/* the pid is the same process as long as its start time is */
+static int get_pid_start_time(unsigned int pid, uint64_t *start_time)
+{
+    char path[PATH_MAX] = {0};
+    char buf[HOTNESS_STAT_BUF_LEN];
+    char *field = NULL;
+    int i;
+
+    if (snprintf_s(path, PATH_MAX, PATH_MAX - 1, "%s%u%s", PROC_PATH, pid, HOTNESS_STAT_FILE) <= 0) {
+        return -1;
+    }
+
+    if (read_small_file(path, buf, sizeof(buf)) != 0) {
+        return -1;
+    }
+
+    /* comm may contain spaces and ')' */
+    field = strrchr(buf, ')');
+    for (i = 0; field != NULL && i < HOTNESS_STARTTIME_FIELD; i++) {
+        field = strchr(field + 1, ' ');
+    }
+    if (field == NULL) {
+        return -1;
+    }
+
+    *start_time = strtoull(field + 1, NULL, DECIMAL_RADIX);
+    return 0;
+}
+
+static size_t vma_regions(uint64_t start, uint64_t end)
+{
+    return (size_t)((end - start + HOTNESS_REGION_SIZE - 1) / HOTNESS_REGION_SIZE);
+}
+
+static void free_hot_pid(struct hot_pid *hp)
+{
+    size_t i;
+
+    for (i = 0; i < hp->nr_vmas; i++) {
+        free(hp->vmas[i].regions);
+    }
+    free(hp->vmas);
+    free(hp);
+}
+
+static struct hot_pid *find_hot_pid_locked(unsigned int pid)
+{
+    struct hot_pid *hp = NULL;
+
+    SLIST_FOREACH(hp, &g_hot_pids, entry) {
+        if (hp->pid == pid) {
+            return hp;
+        }
+    }
+
+    return NULL;
+}
+
+static void put_hot_pid_locked(struct hot_pid *hp)
+{
+    struct hot_pid *old = find_hot_pid_locked(hp->pid);
+
+    if (old != NULL) {
+        SLIST_REMOVE(&g_hot_pids, old, hot_pid, entry);
+        free_hot_pid(old);
+    }
+    SLIST_INSERT_HEAD(&g_hot_pids, hp, entry);
+}
+
+static const struct hot_vma *find_hot_vma(const struct hot_pid *hp, uint64_t addr)
+{
+    size_t lo = 0;
+    size_t hi = hp->nr_vmas;
+    size_t mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (addr < hp->vmas[mid].start) {
+            hi = mid;
+        } else if (addr >= hp->vmas[mid].end) {
+            lo = mid + 1;
+        } else {
+            return &hp->vmas[mid];
+        }
+    }
+
+    return NULL;
+}
+
+static bool vma_kept(const struct vma *vma)
+{
+    return vma->end > vma->start && vma_regions(vma->start, vma->end) <= HOTNESS_VMA_REGIONS_MAX;
+}
+
+/* the history covers the vma only if the vma stays the same */
+static bool hot_vma_match(const struct hot_pid *hp, const struct vma *vma)
+{
+    const struct hot_vma *hv = find_hot_vma(hp, vma->start);
+
+    return hv != NULL && hv->start == vma->start && hv->end == vma->end;
+}
+
+int etmemd_hotness_scan_loops(unsigned int pid, const struct vmas *vmas, int loop)
+{
+    struct hot_pid *hp = NULL;
+    const struct vma *vma = NULL;
+    uint64_t start_time = 0;
+    uint64_t total = 0;
+    uint64_t covered = 0;
+    int old_state;
+    int loops = loop;
+
+    if (!g_hotness_enabled || loop <= 1 || get_pid_start_time(pid, &start_time) != 0) {
+        return loop;
+    }
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
+    pthread_mutex_lock(&g_hotness_mtx);
+    hp = find_hot_pid_locked(pid);
+    if (hp == NULL || !hp->warm || hp->start_time != start_time) {
+        goto unlock;
+    }
+
+    for (vma = vmas->vma_list; vma != NULL; vma = vma->next) {
+        if (!vma_kept(vma)) {
+            continue;
+        }
+        total += vma->end - vma->start;
+        if (hot_vma_match(hp, vma)) {
+            covered += vma->end - vma->start;
+        }
+    }
+
+    if (total > 0 && covered * 100 >= total * HOTNESS_WARM_COVERAGE) {
+        loops = 1;
+        etmemd_log(ETMEMD_LOG_DEBUG, "pid %u resumes from its hotness history\n", pid);
+    } else {
+        hp->warm = false;
+    }
+
+unlock:
+    pthread_mutex_unlock(&g_hotness_mtx);
+    pthread_setcancelstate(old_state, NULL);
+    return loops;
+}
+
+/* the counts of the loops not scanned are taken from the history, or guessed from the scanned */
+static void warm_page_refs_locked(const struct hot_pid *hp, struct page_refs *page_refs, int scanned, int loop)
+{
+    const struct hot_vma *hv = NULL;
+    uint8_t hot;
+    int count;
+
+    for (; page_refs != NULL; page_refs = page_refs->next) {
+        hv = find_hot_vma(hp, page_refs->addr);
+        hot = hv == NULL ? HOTNESS_UNKNOWN : hv->regions[(page_refs->addr - hv->start) / HOTNESS_REGION_SIZE];
+        if (hot == HOTNESS_UNKNOWN) {
+            count = page_refs->count + page_refs->count * (loop - scanned) / scanned;
+        } else {
+            count = page_refs->count + (hot * (loop - scanned) + HOTNESS_HOT / 2) / HOTNESS_HOT;
+        }
+        /* the counts are sorted into loop + 1 lists */
+        if (page_refs->count <= loop && count > loop) {
+            count = loop;
+        }
+        page_refs->count = count;
+    }
+}
+
+static struct hot_pid *alloc_hot_pid(unsigned int pid, const struct vmas *vmas)
+{
+    struct hot_pid *hp = NULL;
+    const struct vma *vma = NULL;
+    struct hot_vma *hv = NULL;
+
+    hp = (struct hot_pid *)calloc(1, sizeof(struct hot_pid));
+    if (hp == NULL) {
+        return NULL;
+    }
+    hp->pid = pid;
+    hp->stamp = time(NULL);
+
+    hp->vmas = (struct hot_vma *)calloc(vmas->vma_cnt > 0 ? vmas->vma_cnt : 1, sizeof(struct hot_vma));
+    if (hp->vmas == NULL) {
+        free(hp);
+        return NULL;
+    }
+
+    /* the vmas from /proc/<pid>/maps are sorted already */
+    for (vma = vmas->vma_list; vma != NULL; vma = vma->next) {
+        if (!vma_kept(vma)) {
+            continue;
+        }
+        hv = &hp->vmas[hp->nr_vmas];
+        hv->start = vma->start;
+        hv->end = vma->end;
+        hv->nr_regions = vma_regions(vma->start, vma->end);
+        hv->regions = (uint8_t *)malloc(hv->nr_regions);
+        if (hv->regions == NULL) {
+            free_hot_pid(hp);
+            return NULL;
+        }
+        hp->nr_vmas++;
+    }
+
+    return hp;
+}
+
+static int fill_hot_pid(struct hot_pid *hp, const struct page_refs *page_refs, int loop)
+{
+    const struct hot_vma *hv = NULL;
+    uint32_t *sums = NULL;
+    uint32_t *pages = NULL;
+    size_t total = 0;
+    size_t base, idx, i;
+    size_t *bases = NULL;
+
+    for (i = 0; i < hp->nr_vmas; i++) {
+        total += hp->vmas[i].nr_regions;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    sums = (uint32_t *)calloc(total, sizeof(uint32_t));
+    pages = (uint32_t *)calloc(total, sizeof(uint32_t));
+    bases = (size_t *)calloc(hp->nr_vmas, sizeof(size_t));
+    if (sums == NULL || pages == NULL || bases == NULL) {
+        free(sums);
+        free(pages);
+        free(bases);
+        return -1;
+    }
+
+    for (i = 1; i < hp->nr_vmas; i++) {
+        bases[i] = bases[i - 1] + hp->vmas[i - 1].nr_regions;
+    }
+
+    for (; page_refs != NULL; page_refs = page_refs->next) {
+        hv = find_hot_vma(hp, page_refs->addr);
+        if (hv == NULL) {
+            continue;
+        }
+        idx = bases[hv - hp->vmas] + (page_refs->addr - hv->start) / HOTNESS_REGION_SIZE;
+        sums[idx] += (uint32_t)(page_refs->count > loop ? loop : page_refs->count);
+        pages[idx]++;
+    }
+
+    for (i = 0; i < hp->nr_vmas; i++) {
+        base = bases[i];
+        for (idx = 0; idx < hp->vmas[i].nr_regions; idx++) {
+            hp->vmas[i].regions[idx] = pages[base + idx] == 0 ? HOTNESS_UNKNOWN :
+                (uint8_t)((uint64_t)sums[base + idx] * HOTNESS_HOT / ((uint64_t)pages[base + idx] * loop));
+        }
+    }
+
+    free(sums);
+    free(pages);
+    free(bases);
+    return 0;
+}
+
+static void try_checkpoint(void)
+{
+    bool due = false;
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&g_hotness_mtx);
+    if (!g_checkpointing && now - g_last_checkpoint >= HOTNESS_CHECKPOINT_SEC) {
+        g_checkpointing = true;
+        due = true;
+    }
+    pthread_mutex_unlock(&g_hotness_mtx);
+
+    if (!due) {
+        return;
+    }
+
+    if (etmemd_hotness_checkpoint() != 0) {
+        etmemd_log(ETMEMD_LOG_WARN, "checkpoint hotness to %s fail\n", g_hotness_file);
+    }
+
+    pthread_mutex_lock(&g_hotness_mtx);
+    g_checkpointing = false;
+    g_last_checkpoint = now;
+    pthread_mutex_unlock(&g_hotness_mtx);
+}
+
+void etmemd_hotness_update(unsigned int pid, const struct vmas *vmas, struct page_refs *page_refs,
+                           int scanned, int loop)
+{
+    struct hot_pid *old = NULL;
+    struct hot_pid *hp = NULL;
+    int old_state;
+
+    if (!g_hotness_enabled || loop <= 0 || scanned <= 0) {
+        return;
+    }
+
+    /* nothing below is a cancellation point, so the lists are always consistent */
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
+
+    hp = alloc_hot_pid(pid, vmas);
+    if (hp == NULL || get_pid_start_time(pid, &hp->start_time) != 0) {
+        etmemd_log(ETMEMD_LOG_DEBUG, "keep hotness of pid %u fail\n", pid);
+        goto out;
+    }
+
+    pthread_mutex_lock(&g_hotness_mtx);
+    old = find_hot_pid_locked(pid);
+    if (scanned < loop && old != NULL && old->warm && old->start_time == hp->start_time) {
+        warm_page_refs_locked(old, page_refs, scanned, loop);
+    }
+    pthread_mutex_unlock(&g_hotness_mtx);
+
+    if (fill_hot_pid(hp, page_refs, loop) != 0) {
+        etmemd_log(ETMEMD_LOG_DEBUG, "summarize hotness of pid %u fail\n", pid);
+        goto out;
+    }
+
+    pthread_mutex_lock(&g_hotness_mtx);
+    put_hot_pid_locked(hp);
+    pthread_mutex_unlock(&g_hotness_mtx);
+    hp = NULL;
+
+    try_checkpoint();
+
+out:
+    if (hp != NULL) {
+        free_hot_pid(hp);
+    }
+    pthread_setcancelstate(old_state, NULL);
+}
+
+static size_t hot_pid_rec_size(const struct hot_pid *hp)
+{
+    size_t size = sizeof(struct hotness_pid_rec) + hp->nr_vmas * sizeof(struct hotness_vma_rec);
+    size_t regions = 0;
+    size_t i;
+
+    for (i = 0; i < hp->nr_vmas; i++) {
+        regions += hp->vmas[i].nr_regions;
+    }
+
+    return size + ALIGN_8(regions);
+}
+
+static uint8_t *put_hot_pid_rec(uint8_t *ptr, const struct hot_pid *hp)
+{
+    struct hotness_pid_rec *rec = (struct hotness_pid_rec *)ptr;
+    struct hotness_vma_rec *vrec = NULL;
+    uint8_t *regions = NULL;
+    size_t i;
+
+    rec->start_time = hp->start_time;
+    rec->stamp = (int64_t)hp->stamp;
+    rec->pid = hp->pid;
+    rec->nr_vmas = (uint32_t)hp->nr_vmas;
+
+    vrec = (struct hotness_vma_rec *)(rec + 1);
+    regions = (uint8_t *)(vrec + hp->nr_vmas);
+    for (i = 0; i < hp->nr_vmas; i++) {
+        vrec[i].start = hp->vmas[i].start;
+        vrec[i].end = hp->vmas[i].end;
+        if (memcpy_s(regions, hp->vmas[i].nr_regions, hp->vmas[i].regions, hp->vmas[i].nr_regions) != EOK) {
+            return NULL;
+        }
+        regions += hp->vmas[i].nr_regions;
+    }
+
+    return ptr + hot_pid_rec_size(hp);
+}
+
+/* drop the pids gone, and copy the others into a buffer laid out as the file */
+static uint8_t *snapshot_hot_pids(size_t *size)
+{
+    struct hot_pid *hp = NULL;
+    struct hot_pid *next = NULL;
+    struct hotness_header *header = NULL;
+    uint64_t start_time;
+    uint32_t nr_pids = 0;
+    uint8_t *buf = NULL;
+    uint8_t *ptr = NULL;
+
+    *size = sizeof(struct hotness_header);
+
+    pthread_mutex_lock(&g_hotness_mtx);
+    for (hp = SLIST_FIRST(&g_hot_pids); hp != NULL; hp = next) {
+        next = SLIST_NEXT(hp, entry);
+        if (get_pid_start_time(hp->pid, &start_time) != 0 || start_time != hp->start_time) {
+            SLIST_REMOVE(&g_hot_pids, hp, hot_pid, entry);
+            free_hot_pid(hp);
+            continue;
+        }
+        *size += hot_pid_rec_size(hp);
+        nr_pids++;
+    }
+
+    buf = (uint8_t *)calloc(1, *size);
+    if (buf == NULL) {
+        goto unlock;
+    }
+
+    ptr = buf + sizeof(struct hotness_header);
+    SLIST_FOREACH(hp, &g_hot_pids, entry) {
+        ptr = put_hot_pid_rec(ptr, hp);
+        if (ptr == NULL) {
+            free(buf);
+            buf = NULL;
+            goto unlock;
+        }
+    }
+
+unlock:
+    pthread_mutex_unlock(&g_hotness_mtx);
+    if (buf == NULL) {
+        return NULL;
+    }
+
+    header = (struct hotness_header *)buf;
+    if (memcpy_s(header->magic, sizeof(header->magic), HOTNESS_MAGIC, strlen(HOTNESS_MAGIC)) != EOK ||
+        memcpy_s(header->boot_id, sizeof(header->boot_id), g_boot_id, sizeof(g_boot_id)) != EOK) {
+        free(buf);
+        return NULL;
+    }
+    header->version = HOTNESS_VERSION;
+    header->nr_pids = nr_pids;
+    header->size = *size;
+    header->checksum = hotness_checksum(buf + sizeof(struct hotness_header), *size - sizeof(struct hotness_header));
+    return buf;
+}
+
+static int write_hotness_file(const uint8_t *buf, size_t size)
+{
+    void *map = NULL;
+    int fd;
+    int ret = -1;
+
+    fd = open(g_hotness_tmp, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "open %s fail, error: %d\n", g_hotness_tmp, errno);
+        return -1;
+    }
+
+    if (ftruncate(fd, (off_t)size) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "truncate %s fail, error: %d\n", g_hotness_tmp, errno);
+        goto close_fd;
+    }
+
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        etmemd_log(ETMEMD_LOG_ERR, "mmap %s fail, error: %d\n", g_hotness_tmp, errno);
+        goto close_fd;
+    }
+
+    if (memcpy_s(map, size, buf, size) == EOK && msync(map, size, MS_SYNC) == 0) {
+        ret = 0;
+    }
+    munmap(map, size);
+
+close_fd:
+    close(fd);
+    if (ret != 0) {
+        unlink(g_hotness_tmp);
+        return -1;
+    }
+
+    /* the file is replaced as a whole, never seen half written */
+    if (rename(g_hotness_tmp, g_hotness_file) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "rename %s fail, error: %d\n", g_hotness_tmp, errno);
+        unlink(g_hotness_tmp);
+        return -1;
+    }
+
+    return 0;
+}
+
+int etmemd_hotness_checkpoint(void)
+{
+    uint8_t *buf = NULL;
+    size_t size;
+    int old_state;
+    int ret;
+
+    if (!g_hotness_enabled) {
+        return 0;
+    }
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
+    buf = snapshot_hot_pids(&size);
+    if (buf == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "snapshot hotness fail\n");
+        pthread_setcancelstate(old_state, NULL);
+        return -1;
+    }
+
+    ret = write_hotness_file(buf, size);
+    free(buf);
+    pthread_setcancelstate(old_state, NULL);
+    return ret;
+}
+
+static struct hot_pid *load_hot_pid(const uint8_t **ptr, const uint8_t *end)
+{
+    const struct hotness_pid_rec *rec = (const struct hotness_pid_rec *)*ptr;
+    const struct hotness_vma_rec *vrec = NULL;
+    const uint8_t *regions = NULL;
+    struct hot_pid *hp = NULL;
+    struct hot_vma *hv = NULL;
+    size_t nr_regions = 0;
+    size_t i;
+
+    if ((size_t)(end - *ptr) < sizeof(struct hotness_pid_rec) ||
+        rec->nr_vmas > (size_t)(end - *ptr - sizeof(struct hotness_pid_rec)) / sizeof(struct hotness_vma_rec)) {
+        return NULL;
+    }
+
+    vrec = (const struct hotness_vma_rec *)(rec + 1);
+    for (i = 0; i < rec->nr_vmas; i++) {
+        if (vrec[i].end <= vrec[i].start || (i > 0 && vrec[i].start < vrec[i - 1].end) ||
+            vma_regions(vrec[i].start, vrec[i].end) > HOTNESS_VMA_REGIONS_MAX) {
+            return NULL;
+        }
+        nr_regions += vma_regions(vrec[i].start, vrec[i].end);
+    }
+
+    regions = (const uint8_t *)(vrec + rec->nr_vmas);
+    if ((size_t)(end - regions) < ALIGN_8(nr_regions)) {
+        return NULL;
+    }
+
+    hp = (struct hot_pid *)calloc(1, sizeof(struct hot_pid));
+    if (hp == NULL) {
+        return NULL;
+    }
+    hp->vmas = (struct hot_vma *)calloc(rec->nr_vmas > 0 ? rec->nr_vmas : 1, sizeof(struct hot_vma));
+    if (hp->vmas == NULL) {
+        free(hp);
+        return NULL;
+    }
+    hp->pid = rec->pid;
+    hp->start_time = rec->start_time;
+    hp->stamp = (time_t)rec->stamp;
+    hp->warm = true;
+
+    for (i = 0; i < rec->nr_vmas; i++) {
+        hv = &hp->vmas[i];
+        hv->start = vrec[i].start;
+        hv->end = vrec[i].end;
+        hv->nr_regions = vma_regions(hv->start, hv->end);
+        hv->regions = (uint8_t *)malloc(hv->nr_regions);
+        if (hv->regions == NULL || memcpy_s(hv->regions, hv->nr_regions, regions, hv->nr_regions) != EOK) {
+            free(hv->regions);
+            free_hot_pid(hp);
+            return NULL;
+        }
+        hp->nr_vmas++;
+        regions += hv->nr_regions;
+    }
+
+    *ptr = (const uint8_t *)(vrec + rec->nr_vmas) + ALIGN_8(nr_regions);
+    return hp;
+}
+
+/* the file is trusted only if it is whole and written in this boot, and so are the pids */
+static int load_hotness_map(const uint8_t *map, size_t size)
+{
+    const struct hotness_header *header = (const struct hotness_header *)map;
+    const uint8_t *ptr = map + sizeof(struct hotness_header);
+    struct hot_pid *hp = NULL;
+    uint32_t i;
+
+    if (size < sizeof(struct hotness_header) || memcmp(header->magic, HOTNESS_MAGIC, strlen(HOTNESS_MAGIC)) != 0 ||
+        header->version != HOTNESS_VERSION || header->size != size ||
+        header->checksum != hotness_checksum(ptr, size - sizeof(struct hotness_header))) {
+        etmemd_log(ETMEMD_LOG_WARN, "%s is broken, start without hotness history\n", g_hotness_file);
+        return -1;
+    }
+
+    if (memcmp(header->boot_id, g_boot_id, sizeof(g_boot_id)) != 0) {
+        etmemd_log(ETMEMD_LOG_INFO, "%s is left by the last boot, start without hotness history\n",
+                   g_hotness_file);
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_hotness_mtx);
+    for (i = 0; i < header->nr_pids; i++) {
+        hp = load_hot_pid(&ptr, map + size);
+        if (hp == NULL) {
+            etmemd_log(ETMEMD_LOG_WARN, "record %u of %s is broken\n", i, g_hotness_file);
+            break;
+        }
+        put_hot_pid_locked(hp);
+    }
+    pthread_mutex_unlock(&g_hotness_mtx);
+
+    return 0;
+}
+
+int etmemd_hotness_start(void)
+{
+    struct stat st;
+    void *map = NULL;
+    char *dir_end = NULL;
+    char dir[PATH_MAX] = {0};
+    int fd;
+    int ret;
+
+    if (!g_hotness_enabled) {
+        return 0;
+    }
+
+    if (read_small_file(HOTNESS_BOOT_ID_FILE, g_boot_id, sizeof(g_boot_id)) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "read %s fail\n", HOTNESS_BOOT_ID_FILE);
+        return -1;
+    }
+    g_boot_id[strcspn(g_boot_id, "\n")] = '\0';
+    g_last_checkpoint = time(NULL);
+
+    if (strcpy_s(dir, PATH_MAX, g_hotness_file) != EOK) {
+        return -1;
+    }
+    dir_end = strrchr(dir, '/');
+    *dir_end = '\0';
+    if (mkdir(dir, S_IRWXU) != 0 && errno != EEXIST) {
+        etmemd_log(ETMEMD_LOG_ERR, "mkdir %s fail, error: %d\n", dir, errno);
+        return -1;
+    }
+
+    fd = open(g_hotness_file, O_RDONLY);
+    if (fd < 0) {
+        etmemd_log(ETMEMD_LOG_INFO, "no hotness history in %s\n", g_hotness_file);
+        return 0;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        etmemd_log(ETMEMD_LOG_ERR, "mmap %s fail, error: %d\n", g_hotness_file, errno);
+        return 0;
+    }
+
+    ret = load_hotness_map((const uint8_t *)map, (size_t)st.st_size);
+    munmap(map, (size_t)st.st_size);
+    if (ret == 0) {
+        etmemd_log(ETMEMD_LOG_INFO, "hotness history loaded from %s\n", g_hotness_file);
+    }
+
+    return 0;
+}
+
+void etmemd_hotness_stop(void)
+{
+    struct hot_pid *hp = NULL;
+
+    if (!g_hotness_enabled) {
+        return;
+    }
+
+    if (etmemd_hotness_checkpoint() != 0) {
+        etmemd_log(ETMEMD_LOG_WARN, "checkpoint hotness to %s fail\n", g_hotness_file);
+    }
+
+    pthread_mutex_lock(&g_hotness_mtx);
+    while (!SLIST_EMPTY(&g_hot_pids)) {
+        hp = SLIST_FIRST(&g_hot_pids);
+        SLIST_REMOVE_HEAD(&g_hot_pids, entry);
+        free_hot_pid(hp);
+    }
+    pthread_mutex_unlock(&g_hotness_mtx);
+}
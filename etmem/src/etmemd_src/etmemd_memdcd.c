@@ -30,6 +30,7 @@
 #include "etmemd_pool_adapter.h"
 #include "etmemd_file.h"
 #include "etmemd_memdcd.h"
+#include "etmemd_bandwidth.h"
 
 #define MAX_VMA_NUM 512
 #define RESP_MSG_MAX_LEN 10
@@ -161,8 +162,11 @@ CLOSE_SOCK:
     return ret;
 }
 
-static int memdcd_do_migrate(unsigned int pid, struct page_refs *page_refs_list, const char sock_path[])
+static int memdcd_do_migrate(unsigned int pid, struct page_refs *page_refs_list, const char sock_path[],
+                             struct bw_share *share)
 {
+    bool governed = share != NULL && etmemd_bw_limited(BW_SWAP);
+    unsigned long msg_bytes = 0;
     int count = 0, total_count = 0;
     int ret = 0;
     struct swap_vma_with_count *swap_vma = NULL;
@@ -199,21 +203,25 @@ static int memdcd_do_migrate(unsigned int pid, struct page_refs *page_refs_list,
         swap_vma->vma_addrs[count].vma.start_addr = page_refs->addr;
         swap_vma->vma_addrs[count].vma.vma_len = page_type_to_size(page_refs->type);
         swap_vma->vma_addrs[count].count = page_refs->count;
+        msg_bytes += swap_vma->vma_addrs[count].vma.vma_len;
         count++;
         page_refs = page_refs->next;
 
-        if (count < MAX_VMA_NUM) {
+        /* memdcd swaps the pages of each message out, so keep the messages small if governed */
+        if (count < MAX_VMA_NUM && !(governed && msg_bytes >= BW_CHUNK_SIZE)) {
             continue;
         }
         if (page_refs == NULL) {
             break;
         }
         swap_vma->length = count * sizeof(struct vma_addr_with_count);
+        etmemd_bw_acquire(share, BW_SWAP, msg_bytes);
         if (send_data_to_memdcd(pid, msg, sock_path) != 0) {
             ret = -1;
             goto FREE_SWAP;
         }
         count = 0;
+        msg_bytes = 0;
         msg->memory_msg.vma.status = MEMDCD_SEND_PROCESS;
         if (memset_s(swap_vma->vma_addrs, sizeof(swap_vma->vma_addrs),
                     0, sizeof(swap_vma->vma_addrs)) != EOK) {
@@ -226,6 +234,7 @@ static int memdcd_do_migrate(unsigned int pid, struct page_refs *page_refs_list,
     if (msg->memory_msg.vma.status != MEMDCD_SEND_START)
         msg->memory_msg.vma.status = MEMDCD_SEND_END;
     swap_vma->length = count * sizeof(struct vma_addr_with_count);
+    etmemd_bw_acquire(share, BW_SWAP, msg_bytes);
     if (send_data_to_memdcd(pid, msg, sock_path) != 0) {
         ret = -1;
     }
@@ -244,6 +253,7 @@ static struct page_refs *memdcd_do_scan(const struct task_pid *tpid, const struc
     char pid[PID_STR_MAX_LEN] = {0};
     char *us = "us";
     struct page_scan *page_scan = NULL;
+    enum scan_backend backend;
 
     if(tpid == NULL) {
         etmemd_log(ETMEMD_LOG_ERR, "task pid is null\n");
@@ -268,9 +278,11 @@ static struct page_refs *memdcd_do_scan(const struct task_pid *tpid, const struc
         return NULL;
     }
 
-    /* loop for scanning idle_pages to get result of memory access. */
+    backend = etmemd_resolve_scan_backend(page_scan->backend);
+
+    /* loop for scanning to get result of memory access. */
     for (i = 0; i < page_scan->loop; i++) {
-        ret = get_page_refs(vmas, pid, &page_refs, NULL, 0);
+        ret = etmemd_get_page_refs_by_backend(backend, page_scan, vmas, pid, &page_refs, NULL, NULL);
         if (ret != 0) {
             etmemd_log(ETMEMD_LOG_ERR, "scan operation failed\n");
             /* free page_refs nodes already exist */
@@ -297,7 +309,8 @@ static void *memdcd_executor(void *arg)
     pthread_cleanup_push(clean_page_refs_unexpected, &page_refs);
     page_refs = memdcd_do_scan(tk_pid, tk_pid->tk);
     if (page_refs != NULL) {
-        if (memdcd_do_migrate(tk_pid->pid, page_refs, memdcd_params->memdcd_socket) != 0) {
+        if (memdcd_do_migrate(tk_pid->pid, page_refs, memdcd_params->memdcd_socket,
+                              tk_pid->tk->eng->proj->bw_share) != 0) {
             etmemd_log(ETMEMD_LOG_WARN, "memdcd migrate for pid %u fail\n", tk_pid->pid);
         }
     }
@@ -404,6 +417,22 @@ static void memdcd_stop_task(struct engine *eng, struct task *tk)
     params->executor = NULL;
 }
 
+/* memdcd is sent all the pages with their counts, and decides on them itself */
+static struct memory_grade *memdcd_replay_pages(struct task_pid *tk_pid, struct page_refs **page_refs)
+{
+    struct memory_grade *memory_grade = NULL;
+
+    memory_grade = (struct memory_grade *)calloc(1, sizeof(struct memory_grade));
+    if (memory_grade == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for memory grade fail\n");
+        return NULL;
+    }
+
+    memory_grade->cold_pages = *page_refs;
+    *page_refs = NULL;
+    return memory_grade;
+}
+
 struct engine_ops g_memdcd_eng_ops = {
     .fill_eng_params = NULL,
     .clear_eng_params = NULL,
@@ -414,6 +443,7 @@ struct engine_ops g_memdcd_eng_ops = {
     .alloc_pid_params = NULL,
     .free_pid_params = NULL,
     .eng_mgt_func = NULL,
+    .replay_pages = memdcd_replay_pages,
 };
 
 int fill_engine_type_memdcd(struct engine *eng, GKeyFile *config)
@@ -0,0 +1,273 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: Snapshots of /proc/meminfo and /proc/<pid>/status read in one pass.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "securec.h"
+#include "etmemd_common.h"
+#include "etmemd_log.h"
+#include "etmemd_meminfo.h"
+#include "etmemd_record.h"
+#include "etmemd_replay.h"
+
+/* both files are about 1.5K, one read is enough in most cases */
+#define PROC_SNAPSHOT_BUF_LEN   8192
+#define PROC_PATH_MAX_LEN       64
+#define MSEC_PER_SEC            1000
+#define NSEC_PER_MSEC           1000000
+
+struct proc_field {
+    const char *key;
+    size_t len;
+    size_t offset;
+};
+
+#define PROC_FIELD(key, type, member) {(key), sizeof(key) - 1, offsetof(type, member)}
+
+static const struct proc_field g_meminfo_fields[] = {
+    PROC_FIELD("MemTotal", struct meminfo, mem_total),
+    PROC_FIELD("MemFree", struct meminfo, mem_free),
+    PROC_FIELD("MemAvailable", struct meminfo, mem_available),
+    PROC_FIELD("Cached", struct meminfo, cached),
+    PROC_FIELD("SwapCached", struct meminfo, swap_cached),
+    PROC_FIELD("SwapTotal", struct meminfo, swap_total),
+    PROC_FIELD("SwapFree", struct meminfo, swap_free),
+};
+
+/* VmSwap and RssAnon/RssFile are not there for kernel threads */
+static const struct proc_field g_pid_status_fields[] = {
+    PROC_FIELD("VmRSS", struct pid_status, vm_rss),
+    PROC_FIELD(VMSWAP, struct pid_status, vm_swap),
+    PROC_FIELD("RssAnon", struct pid_status, rss_anon),
+    PROC_FIELD("RssFile", struct pid_status, rss_file),
+};
+
+static struct meminfo g_meminfo;
+static struct timespec g_meminfo_time;
+static bool g_meminfo_valid = false;
+static unsigned long g_meminfo_seq;
+static pthread_mutex_t g_meminfo_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static ssize_t read_proc_file(const char *file, char *buf, size_t size)
+{
+    char root_path[PATH_MAX] = {0};
+    const char *path = NULL;
+    ssize_t total = 0;
+    ssize_t len;
+    int fd;
+
+    path = etmemd_root_path(file, root_path, sizeof(root_path));
+    if (path == NULL) {
+        return -1;
+    }
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "open %s fail, error: %d\n", path, errno);
+        return -1;
+    }
+
+    while ((size_t)total < size - 1) {
+        len = read(fd, buf + total, size - 1 - total);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            etmemd_log(ETMEMD_LOG_ERR, "read %s fail, error: %d\n", path, errno);
+            close(fd);
+            return -1;
+        }
+        if (len == 0) {
+            break;
+        }
+        total += len;
+    }
+
+    close(fd);
+    buf[total] = '\0';
+    return total;
+}
+
+/* the fields are matched by the length of the key first, so most lines cost one compare */
+static const struct proc_field *match_proc_field(const struct proc_field *fields, size_t nr,
+                                                 const char *key, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < nr; i++) {
+        if (fields[i].len == len && memcmp(fields[i].key, key, len) == 0) {
+            return &fields[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* lines are "Key:   value kB", fill the matched fields of obj and return how many are found */
+static size_t parse_proc_fields(char *buf, const struct proc_field *fields, size_t nr, void *obj)
+{
+    const struct proc_field *field = NULL;
+    char *line = buf;
+    char *colon = NULL;
+    char *end = NULL;
+    size_t found = 0;
+    unsigned long val;
+
+    while (line != NULL && *line != '\0' && found < nr) {
+        end = strchr(line, '\n');
+        colon = memchr(line, ':', end != NULL ? (size_t)(end - line) : strlen(line));
+        if (colon != NULL) {
+            field = match_proc_field(fields, nr, line, (size_t)(colon - line));
+            if (field != NULL) {
+                val = strtoul(colon + 1, NULL, DECIMAL_RADIX);
+                *(unsigned long *)((char *)obj + field->offset) = val;
+                found++;
+            }
+        }
+        line = end != NULL ? end + 1 : NULL;
+    }
+
+    return found;
+}
+
+int etmemd_read_meminfo(struct meminfo *info)
+{
+    char buf[PROC_SNAPSHOT_BUF_LEN];
+
+    if (etmemd_replay_running()) {
+        return etmemd_replay_meminfo(info);
+    }
+
+    if (read_proc_file(PROC_PATH PROC_MEMINFO, buf, sizeof(buf)) < 0) {
+        return -1;
+    }
+
+    if (memset_s(info, sizeof(struct meminfo), 0, sizeof(struct meminfo)) != EOK) {
+        etmemd_log(ETMEMD_LOG_ERR, "memset meminfo fail\n");
+        return -1;
+    }
+
+    if (parse_proc_fields(buf, g_meminfo_fields, ARRAY_SIZE(g_meminfo_fields), info) == 0 ||
+        info->mem_total == 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "parse %s%s fail\n", PROC_PATH, PROC_MEMINFO);
+        return -1;
+    }
+
+    etmemd_record_meminfo(info);
+    return 0;
+}
+
+int etmemd_read_pid_status(const char *pid, struct pid_status *status)
+{
+    char path[PROC_PATH_MAX_LEN] = {0};
+    char buf[PROC_SNAPSHOT_BUF_LEN];
+
+    if (etmemd_replay_running()) {
+        return etmemd_replay_pid_status(pid, status);
+    }
+
+    if (snprintf_s(path, sizeof(path), sizeof(path) - 1, "%s%s%s", PROC_PATH, pid, STATUS_FILE) <= 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "snprintf status path of pid %s fail\n", pid);
+        return -1;
+    }
+
+    if (read_proc_file(path, buf, sizeof(buf)) < 0) {
+        return -1;
+    }
+
+    if (memset_s(status, sizeof(struct pid_status), 0, sizeof(struct pid_status)) != EOK) {
+        etmemd_log(ETMEMD_LOG_ERR, "memset status of pid %s fail\n", pid);
+        return -1;
+    }
+
+    if (parse_proc_fields(buf, g_pid_status_fields, ARRAY_SIZE(g_pid_status_fields), status) == 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "no memory info in %s\n", path);
+        return -1;
+    }
+
+    etmemd_record_pid_status(pid, status);
+    return 0;
+}
+
+static long elapsed_ms(const struct timespec *from, const struct timespec *to)
+{
+    return (to->tv_sec - from->tv_sec) * MSEC_PER_SEC + (to->tv_nsec - from->tv_nsec) / NSEC_PER_MSEC;
+}
+
+static int refresh_meminfo_locked(const struct timespec *now)
+{
+    struct meminfo info;
+
+    if (etmemd_read_meminfo(&info) != 0) {
+        return -1;
+    }
+
+    info.seq = ++g_meminfo_seq;
+    g_meminfo = info;
+    g_meminfo_time = *now;
+    g_meminfo_valid = true;
+    return 0;
+}
+
+int etmemd_refresh_meminfo(void)
+{
+    struct timespec now;
+    int ret;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "clock get time fail\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_meminfo_mtx);
+    ret = refresh_meminfo_locked(&now);
+    pthread_mutex_unlock(&g_meminfo_mtx);
+    return ret;
+}
+
+int etmemd_get_meminfo(struct meminfo *info)
+{
+    struct timespec now;
+    int ret = 0;
+
+    /* the samples replayed change much faster than the cache expires */
+    if (etmemd_replay_running()) {
+        return etmemd_replay_meminfo(info);
+    }
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "clock get time fail\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_meminfo_mtx);
+    if (!g_meminfo_valid || elapsed_ms(&g_meminfo_time, &now) > MEMINFO_CACHE_MS) {
+        ret = refresh_meminfo_locked(&now);
+    }
+    if (ret == 0) {
+        *info = g_meminfo;
+    }
+    pthread_mutex_unlock(&g_meminfo_mtx);
+    return ret;
+}
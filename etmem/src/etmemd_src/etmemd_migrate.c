@@ -15,11 +15,16 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include "securec.h"
 #include "etmemd.h"
@@ -27,12 +32,31 @@
 #include "etmemd_project.h"
 #include "etmemd_common.h"
 #include "etmemd_slide.h"
+#include "etmemd_scan.h"
 #include "etmemd_log.h"
+#include "etmemd_meminfo.h"
+#include "etmemd_bandwidth.h"
+#include "etmemd_arbiter.h"
 
 #define RECLAIM_SWAPCACHE_MAGIC         0x77
 #define RECLAIM_SWAPCACHE_ON            _IOW(RECLAIM_SWAPCACHE_MAGIC, 0x1, unsigned int)
 #define SET_SWAPCACHE_WMARK             _IOW(RECLAIM_SWAPCACHE_MAGIC, 0x2, unsigned int)
 
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open                 434
+#endif
+#ifndef __NR_process_madvise
+#define __NR_process_madvise            440
+#endif
+#ifndef MADV_COLD
+#define MADV_COLD                       20
+#endif
+#ifndef MADV_PAGEOUT
+#define MADV_PAGEOUT                    21
+#endif
+
+#define SWAP_PAGES_SELF                 PROC_PATH "self" COLD_PAGE
+
 static char *get_swap_string(struct page_refs **page_refs, int batchsize)
 {
     char *swap_str = NULL;
@@ -70,11 +94,34 @@ static char *get_swap_string(struct page_refs **page_refs, int batchsize)
     return swap_str;
 }
 
-static int etmemd_migrate_mem(const char *pid, const char *grade_path, struct page_refs *page_refs_list)
+/* count the pages from page_refs to write once, keep them within BW_CHUNK_SIZE if governed */
+static int get_swap_batch(const struct page_refs *page_refs, bool governed, unsigned long *bytes)
+{
+    unsigned long size;
+    int count = 0;
+
+    *bytes = 0;
+    for (; page_refs != NULL && count < SWAP_LIMIT; page_refs = page_refs->next) {
+        size = (unsigned long)page_type_to_size(page_refs->type);
+        if (governed && count > 0 && *bytes + size > BW_CHUNK_SIZE) {
+            break;
+        }
+        *bytes += size;
+        count++;
+    }
+
+    return count;
+}
+
+static int etmemd_migrate_mem(const char *pid, const char *grade_path, struct page_refs *page_refs_list,
+                              struct bw_share *share)
 {
     FILE *fp = NULL;
     char *swap_str = NULL;
     struct page_refs *page_refs = page_refs_list;
+    bool governed = share != NULL && etmemd_bw_limited(BW_SWAP);
+    unsigned long bytes;
+    int batch;
 
     if (page_refs_list == NULL) {
         return 0;
@@ -88,13 +135,16 @@ static int etmemd_migrate_mem(const char *pid, const char *grade_path, struct pa
 
     while (page_refs != NULL) {
         /* SWAP_LIMIT is the max size of batch that write to swap procfs once */
-        swap_str = get_swap_string(&page_refs, SWAP_LIMIT);
+        batch = get_swap_batch(page_refs, governed, &bytes);
+        swap_str = get_swap_string(&page_refs, batch);
         if (swap_str == NULL) {
             etmemd_log(ETMEMD_LOG_WARN, "get swap string fail once\n");
             continue;
         }
 
-        if (fputs(swap_str, fp) == EOF) {
+        etmemd_bw_acquire(share, BW_SWAP, bytes);
+        /* fp is buffered, push each chunk to the kernel once its bandwidth is taken */
+        if (fputs(swap_str, fp) == EOF || (governed && fflush(fp) == EOF)) {
             etmemd_log(ETMEMD_LOG_DEBUG, "migrate failed for pid %s, check if etmem_swap.ko installed\n", pid);
             free(swap_str);
             fclose(fp);
@@ -111,28 +161,19 @@ static int etmemd_migrate_mem(const char *pid, const char *grade_path, struct pa
 static bool check_should_reclaim_swapcache(const struct task_pid *tk_pid)
 {
     struct project *proj = tk_pid->tk->eng->proj;
-    unsigned long mem_total;
-    unsigned long swapcache_total;
-    int ret;
+    struct meminfo info;
 
     if (proj->swapcache_high_wmark == -1 || proj->swapcache_low_wmark == -1) {
         return false;
     }
 
-    ret = get_mem_from_proc_file(NULL, PROC_MEMINFO, &mem_total, "MemTotal");
-    if (ret != 0) {
-        etmemd_log(ETMEMD_LOG_ERR, "get memtotal fail\n");
+    if (etmemd_get_meminfo(&info) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "get meminfo fail\n");
         return false;
     }
 
-    ret = get_mem_from_proc_file(NULL, PROC_MEMINFO, &swapcache_total, "SwapCached");
-    if (ret != 0) {
-        etmemd_log(ETMEMD_LOG_ERR, "get swapcache_total fail\n");
-        return false;
-    }
-
-    if (swapcache_total == 0 ||
-        (mem_total / swapcache_total) >= (unsigned long)(MAX_SWAPCACHE_WMARK_VALUE / proj->swapcache_high_wmark)) {
+    if (info.swap_cached == 0 ||
+        (info.mem_total / info.swap_cached) >= (unsigned long)(MAX_SWAPCACHE_WMARK_VALUE / proj->swapcache_high_wmark)) {
         return false;
     }
 
@@ -185,6 +226,16 @@ int etmemd_reclaim_swapcache(const struct task_pid *tk_pid)
         return 0;
     }
 
+    /* the swapcache ioctls come with etmem_swap.ko, madvise backends leave it to the kernel */
+    if (etmemd_resolve_evict_backend(tk_pid->tk->eng->proj->evict_backend) != EVICT_SWAP_PAGES) {
+        return 0;
+    }
+
+    /* another project has kicked the reclaim in this round */
+    if (etmemd_arb_swapcache_kicked()) {
+        return 0;
+    }
+
     if (snprintf_s(pid_str, PID_STR_MAX_LEN, PID_STR_MAX_LEN - 1, "%u", tk_pid->pid) <= 0) {
         etmemd_log(ETMEMD_LOG_ERR, "snprintf pid fail %u", tk_pid->pid);
         return -1;
@@ -210,30 +261,263 @@ int etmemd_reclaim_swapcache(const struct task_pid *tk_pid)
         return -1;
     }
 
+    etmemd_arb_swapcache_kick();
     fclose(fp);
     return 0;
 }
 
-int etmemd_grade_migrate(const char *pid, const struct memory_grade *memory_grade)
+enum evict_backend etmemd_resolve_evict_backend(enum evict_backend backend)
+{
+    char root_path[PATH_MAX] = {0};
+    const char *path = NULL;
+    int fd;
+
+    if (backend != EVICT_AUTO) {
+        return backend;
+    }
+
+    /* swap_pages can only be opened when etmem_swap.ko is loaded */
+    path = etmemd_root_path(SWAP_PAGES_SELF, root_path, sizeof(root_path));
+    fd = path == NULL ? -1 : open(path, O_RDWR);
+    if (fd >= 0) {
+        close(fd);
+        return EVICT_SWAP_PAGES;
+    }
+
+    return EVICT_PAGEOUT;
+}
+
+static int cmp_evict_iov(const void *a, const void *b)
+{
+    const struct iovec *iov_a = (const struct iovec *)a;
+    const struct iovec *iov_b = (const struct iovec *)b;
+
+    if (iov_a->iov_base == iov_b->iov_base) {
+        return 0;
+    }
+
+    return iov_a->iov_base < iov_b->iov_base ? -1 : 1;
+}
+
+/* sort the cold pages by address and merge the adjacent ones into ranges */
+static struct iovec *get_evict_iovs(const struct page_refs *page_refs_list, int *nr)
+{
+    const struct page_refs *page_refs = NULL;
+    struct iovec *iovs = NULL;
+    int count = 0;
+    int merged = 0;
+    int i;
+
+    for (page_refs = page_refs_list; page_refs != NULL; page_refs = page_refs->next) {
+        count++;
+    }
+
+    iovs = (struct iovec *)calloc(count, sizeof(struct iovec));
+    if (iovs == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for evict iovec fail\n");
+        return NULL;
+    }
+
+    count = 0;
+    for (page_refs = page_refs_list; page_refs != NULL; page_refs = page_refs->next) {
+        if (page_refs->type >= PAGE_TYPE_INVAL) {
+            continue;
+        }
+        iovs[count].iov_base = (void *)(uintptr_t)page_refs->addr;
+        iovs[count].iov_len = (size_t)page_type_to_size(page_refs->type);
+        count++;
+    }
+
+    qsort(iovs, count, sizeof(struct iovec), cmp_evict_iov);
+    for (i = 0; i < count; i++) {
+        char *end = NULL;
+
+        if (merged > 0) {
+            end = (char *)iovs[merged - 1].iov_base + iovs[merged - 1].iov_len;
+        }
+        if (end != NULL && (char *)iovs[i].iov_base <= end) {
+            char *new_end = (char *)iovs[i].iov_base + iovs[i].iov_len;
+
+            if (new_end > end) {
+                iovs[merged - 1].iov_len += (size_t)(new_end - end);
+            }
+            continue;
+        }
+        iovs[merged++] = iovs[i];
+    }
+
+    *nr = merged;
+    return iovs;
+}
+
+/* drop the advised bytes from the head of iovs, return the count of ranges fully done */
+static int consume_evict_iovs(struct iovec *iovs, int nr, size_t bytes)
 {
-    int ret = -1;
+    int i;
+
+    for (i = 0; i < nr && bytes > 0; i++) {
+        if (bytes < iovs[i].iov_len) {
+            iovs[i].iov_base = (char *)iovs[i].iov_base + bytes;
+            iovs[i].iov_len -= bytes;
+            break;
+        }
+        bytes -= iovs[i].iov_len;
+    }
+
+    return i;
+}
+
+/*
+ * Keep the iovs advised once within BW_CHUNK_SIZE, the first one is cut if it is larger.
+ * Return the count of iovs, and the length before cut in cut_len, which is 0 if not cut.
+ * */
+static int get_madvise_batch(struct iovec *iovs, int nr, size_t *bytes, size_t *cut_len)
+{
+    int i;
+
+    *bytes = 0;
+    *cut_len = 0;
+    if (iovs[0].iov_len > BW_CHUNK_SIZE) {
+        *cut_len = iovs[0].iov_len;
+        iovs[0].iov_len = BW_CHUNK_SIZE;
+        *bytes = BW_CHUNK_SIZE;
+        return 1;
+    }
+
+    for (i = 0; i < nr; i++) {
+        if (*bytes + iovs[i].iov_len > BW_CHUNK_SIZE) {
+            break;
+        }
+        *bytes += iovs[i].iov_len;
+    }
+
+    return i;
+}
+
+static int do_process_madvise(int pidfd, const char *pid, struct iovec *iovs, int nr, int advice,
+                              struct bw_share *share)
+{
+    bool governed = share != NULL && etmemd_bw_limited(BW_SWAP);
+    unsigned long advised = 0;
+    size_t bytes, cut_len;
+    int done = 0;
+    int batch;
+    ssize_t ret;
+
+    while (done < nr) {
+        batch = nr - done > IOV_MAX ? IOV_MAX : nr - done;
+        cut_len = 0;
+        if (governed) {
+            batch = get_madvise_batch(iovs + done, batch, &bytes, &cut_len);
+            etmemd_bw_acquire(share, BW_SWAP, bytes);
+        }
+
+        ret = syscall(__NR_process_madvise, pidfd, iovs + done, (size_t)batch, advice, 0);
+        if (cut_len != 0) {
+            iovs[done].iov_len = cut_len;
+        }
+        if (ret > 0) {
+            advised += (unsigned long)ret;
+            done += consume_evict_iovs(iovs + done, batch, (size_t)ret);
+            continue;
+        }
+
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret < 0 && (errno == ENOSYS || errno == EPERM || errno == ESRCH || errno == EBADF)) {
+            etmemd_log(ETMEMD_LOG_ERR, "process_madvise for pid %s fail, errno %d\n", pid, errno);
+            return -1;
+        }
+
+        /* the range is unmapped or can not be advised, e.g. mlocked, skip it */
+        done++;
+    }
+
+    if (advised == 0) {
+        etmemd_log(ETMEMD_LOG_DEBUG, "process_madvise advised nothing for pid %s\n", pid);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int etmemd_madvise_mem(const char *pid, int held_pidfd, int advice, const struct page_refs *page_refs_list,
+                              struct bw_share *share)
+{
+    struct iovec *iovs = NULL;
+    unsigned int pid_val;
+    int pidfd = held_pidfd;
+    int nr = 0;
+    int ret;
+
+    if (page_refs_list == NULL) {
+        return 0;
+    }
+
+    if (get_unsigned_int_value(pid, &pid_val) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "invalid pid %s\n", pid);
+        return -1;
+    }
+
+    /* the pids under a simulated root are not processes of the host */
+    if (etmemd_root_set()) {
+        etmemd_log(ETMEMD_LOG_ERR, "process_madvise is not done for pid %s under root\n", pid);
+        return -1;
+    }
+
+    /* the pidfd held by the task is of the process scanned, even if the pid is reused since */
+    if (pidfd < 0) {
+        pidfd = (int)syscall(__NR_pidfd_open, (pid_t)pid_val, 0);
+        if (pidfd < 0) {
+            etmemd_log(ETMEMD_LOG_ERR, "pidfd_open for pid %s fail, errno %d\n", pid, errno);
+            return -1;
+        }
+    }
+
+    iovs = get_evict_iovs(page_refs_list, &nr);
+    if (iovs == NULL) {
+        ret = -1;
+        goto close_pidfd;
+    }
+
+    ret = nr == 0 ? 0 : do_process_madvise(pidfd, pid, iovs, nr, advice, share);
+    free(iovs);
+
+close_pidfd:
+    if (pidfd != held_pidfd) {
+        close(pidfd);
+    }
+    return ret;
+}
+
+int etmemd_grade_evict(const char *pid, int pidfd, const struct memory_grade *memory_grade, struct project *proj)
+{
+    enum evict_backend backend = proj != NULL ? proj->evict_backend : EVICT_AUTO;
+    struct bw_share *share = proj != NULL ? proj->bw_share : NULL;
+
     /*
     * Strategies will be the hot and cold condition after classification,
     * we only operate with the cold ones.
     * */
-    if (etmemd_migrate_mem(pid, COLD_PAGE, memory_grade->cold_pages) != 0) {
-        return ret;
+    switch (etmemd_resolve_evict_backend(backend)) {
+        case EVICT_PAGEOUT:
+            return etmemd_madvise_mem(pid, pidfd, MADV_PAGEOUT, memory_grade->cold_pages, share);
+        case EVICT_COLD:
+            return etmemd_madvise_mem(pid, pidfd, MADV_COLD, memory_grade->cold_pages, share);
+        default:
+            return etmemd_migrate_mem(pid, COLD_PAGE, memory_grade->cold_pages, share);
     }
+}
 
-    ret = 0;
-    return ret;
+int etmemd_grade_migrate(const char *pid, const struct memory_grade *memory_grade, struct project *proj)
+{
+    return etmemd_grade_evict(pid, -1, memory_grade, proj);
 }
 
 unsigned long check_should_migrate(const struct task_pid *tk_pid)
 {
-    int ret = -1;
-    unsigned long vm_rss;
-    unsigned long vm_swap;
+    struct pid_status status;
     unsigned long vm_cmp;
     unsigned long need_to_swap_page_num;
     char pid_str[PID_STR_MAX_LEN] = {0};
@@ -245,15 +529,8 @@ unsigned long check_should_migrate(const struct task_pid *tk_pid)
         return 0;
     }
 
-    ret = get_mem_from_proc_file(pid_str, STATUS_FILE, &vm_rss, VMRSS);
-    if (ret != 0) {
-        etmemd_log(ETMEMD_LOG_ERR, "get vmrss %s fail", pid_str);
-        return 0;
-    }
-
-    ret = get_mem_from_proc_file(pid_str, STATUS_FILE, &vm_swap, VMSWAP);
-    if (ret != 0) {
-        etmemd_log(ETMEMD_LOG_ERR, "get swapout %s fail", pid_str);
+    if (etmemd_read_pid_status(pid_str, &status) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "get status of pid %s fail", pid_str);
         return 0;
     }
 
@@ -263,14 +540,14 @@ unsigned long check_should_migrate(const struct task_pid *tk_pid)
         return 0;
     }
 
-    vm_cmp = (vm_rss + vm_swap) / 100 * slide_params->dram_percent;
-    if (vm_cmp > vm_rss) {
+    vm_cmp = (status.vm_rss + status.vm_swap) / 100 * slide_params->dram_percent;
+    if (vm_cmp > status.vm_rss) {
         etmemd_log(ETMEMD_LOG_DEBUG, "migrate too much, stop migrate this time\n");
         return 0;
     }
 
     pagesize = get_pagesize();
-    need_to_swap_page_num = KB_TO_BYTE(vm_rss - vm_cmp) / pagesize;
+    need_to_swap_page_num = KB_TO_BYTE(status.vm_rss - vm_cmp) / pagesize;
 
     return need_to_swap_page_num;
 }
@@ -0,0 +1,399 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: Etmemd scan backend based on pagemap and page_idle, for kernels without etmem_scan.ko.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "securec.h"
+#include "etmemd_common.h"
+#include "etmemd_log.h"
+#include "etmemd_page_idle.h"
+
+#define PAGEMAP_PRESENT         (1ULL << 63)
+#define PAGEMAP_PFN_MASK        ((1ULL << 55) - 1)
+#define BITMAP_WORD_BITS        64
+#define BITMAP_WORD_SIZE        sizeof(uint64_t)
+
+/* pages handled by one pagemap read */
+#define PAGE_IDLE_BATCH         4096
+/* words of the page_idle bitmap read at most once, and the gap of words read through */
+#define BITMAP_SPAN_MAX_WORDS   512
+#define BITMAP_SPAN_GAP_WORDS   8
+
+#define PATH_MAX_LEN            64
+
+struct pfn_slot {
+    uint64_t pfn;
+    unsigned int idx;
+};
+
+struct page_idle_ctx {
+    int pagemap_fd;
+    int bitmap_fd;
+    uint64_t pte_size;
+    uint64_t pmd_size;
+    unsigned int pages_per_pmd;
+    unsigned int batch;                 /* pages of one batch */
+    uint64_t *pagemap;                  /* pagemap entries of the batch */
+    uint64_t *present;                  /* bit per page of the batch */
+    uint64_t *idle;                     /* bit per page of the batch */
+    struct pfn_slot *slots;             /* present pages of the batch sorted by pfn */
+    uint64_t words[BITMAP_SPAN_MAX_WORDS];
+};
+
+bool page_idle_supported(void)
+{
+    char root_path[PATH_MAX] = {0};
+    const char *path = etmemd_root_path(PAGE_IDLE_BITMAP, root_path, sizeof(root_path));
+    int fd;
+
+    fd = path == NULL ? -1 : open(path, O_RDWR);
+    if (fd < 0) {
+        return false;
+    }
+
+    close(fd);
+    return true;
+}
+
+static inline void set_bit64(uint64_t *map, unsigned int nr)
+{
+    map[nr / BITMAP_WORD_BITS] |= 1ULL << (nr % BITMAP_WORD_BITS);
+}
+
+static inline bool test_bit64(const uint64_t *map, unsigned int nr)
+{
+    return (map[nr / BITMAP_WORD_BITS] & (1ULL << (nr % BITMAP_WORD_BITS))) != 0;
+}
+
+/* count the bits set in [start, start + nr) */
+static unsigned int count_bits64(const uint64_t *map, unsigned int start, unsigned int nr)
+{
+    unsigned int end = start + nr;
+    unsigned int count = 0;
+    unsigned int bits;
+    uint64_t word;
+
+    while (start < end) {
+        bits = BITMAP_WORD_BITS - start % BITMAP_WORD_BITS;
+        if (bits > end - start) {
+            bits = end - start;
+        }
+        word = map[start / BITMAP_WORD_BITS] >> (start % BITMAP_WORD_BITS);
+        if (bits < BITMAP_WORD_BITS) {
+            word &= (1ULL << bits) - 1;
+        }
+        count += (unsigned int)__builtin_popcountll(word);
+        start += bits;
+    }
+
+    return count;
+}
+
+static int cmp_pfn_slot(const void *a, const void *b)
+{
+    const struct pfn_slot *slot_a = (const struct pfn_slot *)a;
+    const struct pfn_slot *slot_b = (const struct pfn_slot *)b;
+
+    if (slot_a->pfn == slot_b->pfn) {
+        return 0;
+    }
+
+    return slot_a->pfn < slot_b->pfn ? -1 : 1;
+}
+
+static void page_idle_ctx_destroy(struct page_idle_ctx *ctx)
+{
+    if (ctx->pagemap_fd >= 0) {
+        close(ctx->pagemap_fd);
+    }
+    if (ctx->bitmap_fd >= 0) {
+        close(ctx->bitmap_fd);
+    }
+    free(ctx->pagemap);
+    free(ctx->present);
+    free(ctx->idle);
+    free(ctx->slots);
+    free(ctx);
+}
+
+static struct page_idle_ctx *page_idle_ctx_create(const char *pid)
+{
+    struct page_idle_ctx *ctx = NULL;
+    char root_path[PATH_MAX] = {0};
+    char path[PATH_MAX_LEN] = {0};
+    const char *file = NULL;
+    unsigned int words;
+
+    ctx = (struct page_idle_ctx *)calloc(1, sizeof(struct page_idle_ctx));
+    if (ctx == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for page idle context fail\n");
+        return NULL;
+    }
+    ctx->pagemap_fd = -1;
+    ctx->bitmap_fd = -1;
+
+    ctx->pte_size = (uint64_t)page_type_to_size(PTE_TYPE);
+    ctx->pmd_size = (uint64_t)page_type_to_size(PMD_TYPE);
+    ctx->pages_per_pmd = (unsigned int)(ctx->pmd_size / ctx->pte_size);
+    /* one batch holds at least two pmds, so that a huge page never crosses batches */
+    ctx->batch = ctx->pages_per_pmd * 2 > PAGE_IDLE_BATCH ? ctx->pages_per_pmd * 2 : PAGE_IDLE_BATCH;
+    words = (ctx->batch + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
+
+    ctx->pagemap = (uint64_t *)calloc(ctx->batch, sizeof(uint64_t));
+    ctx->present = (uint64_t *)calloc(words, sizeof(uint64_t));
+    ctx->idle = (uint64_t *)calloc(words, sizeof(uint64_t));
+    ctx->slots = (struct pfn_slot *)calloc(ctx->batch, sizeof(struct pfn_slot));
+    if (ctx->pagemap == NULL || ctx->present == NULL || ctx->idle == NULL || ctx->slots == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for page idle buffers fail\n");
+        goto err;
+    }
+
+    if (snprintf_s(path, PATH_MAX_LEN, PATH_MAX_LEN - 1, "%s%s%s", PROC_PATH, pid, PAGEMAP_FILE) <= 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "snprintf pagemap path for pid %s fail\n", pid);
+        goto err;
+    }
+
+    file = etmemd_root_path(path, root_path, sizeof(root_path));
+    ctx->pagemap_fd = file == NULL ? -1 : open(file, O_RDONLY);
+    if (ctx->pagemap_fd < 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "open %s fail, errno %d\n", path, errno);
+        goto err;
+    }
+
+    file = etmemd_root_path(PAGE_IDLE_BITMAP, root_path, sizeof(root_path));
+    ctx->bitmap_fd = file == NULL ? -1 : open(file, O_RDWR);
+    if (ctx->bitmap_fd < 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "open %s fail, errno %d, check CONFIG_IDLE_PAGE_TRACKING\n",
+                   PAGE_IDLE_BITMAP, errno);
+        goto err;
+    }
+
+    return ctx;
+
+err:
+    page_idle_ctx_destroy(ctx);
+    return NULL;
+}
+
+/* read the pagemap of [start, start + nr pages), return the pages read or -1 */
+static int read_pagemap(struct page_idle_ctx *ctx, uint64_t start, unsigned int nr, unsigned int *slot_nr)
+{
+    unsigned int words = (ctx->batch + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
+    ssize_t size;
+    unsigned int i;
+    uint64_t pfn;
+
+    size = pread(ctx->pagemap_fd, ctx->pagemap, nr * BITMAP_WORD_SIZE,
+                 (off_t)(start / ctx->pte_size * BITMAP_WORD_SIZE));
+    if (size < 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "read pagemap at %lx fail, errno %d\n", start, errno);
+        return -1;
+    }
+    nr = (unsigned int)((size_t)size / BITMAP_WORD_SIZE);
+
+    (void)memset_s(ctx->present, words * BITMAP_WORD_SIZE, 0, words * BITMAP_WORD_SIZE);
+    (void)memset_s(ctx->idle, words * BITMAP_WORD_SIZE, 0, words * BITMAP_WORD_SIZE);
+    *slot_nr = 0;
+    for (i = 0; i < nr; i++) {
+        if ((ctx->pagemap[i] & PAGEMAP_PRESENT) == 0) {
+            continue;
+        }
+
+        pfn = ctx->pagemap[i] & PAGEMAP_PFN_MASK;
+        if (pfn == 0) {
+            etmemd_log(ETMEMD_LOG_ERR, "pagemap hides pfn, CAP_SYS_ADMIN is needed\n");
+            return -1;
+        }
+        set_bit64(ctx->present, i);
+        ctx->slots[*slot_nr].pfn = pfn;
+        ctx->slots[*slot_nr].idx = i;
+        (*slot_nr)++;
+    }
+
+    return (int)nr;
+}
+
+/*
+ * Test the idle bits of the slots [begin, end) which share one span of bitmap words,
+ * then mark all of them idle with the same span.
+ */
+static void check_and_mark_span(struct page_idle_ctx *ctx, unsigned int begin, unsigned int end)
+{
+    uint64_t first = ctx->slots[begin].pfn / BITMAP_WORD_BITS;
+    uint64_t last = ctx->slots[end - 1].pfn / BITMAP_WORD_BITS;
+    size_t len = (size_t)(last - first + 1) * BITMAP_WORD_SIZE;
+    off_t offset = (off_t)(first * BITMAP_WORD_SIZE);
+    unsigned int i;
+    uint64_t bit;
+
+    /* pages out of the bitmap read as accessed, they are not on lru */
+    if (pread(ctx->bitmap_fd, ctx->words, len, offset) == (ssize_t)len) {
+        for (i = begin; i < end; i++) {
+            bit = ctx->slots[i].pfn - first * BITMAP_WORD_BITS;
+            if (test_bit64(ctx->words, (unsigned int)bit)) {
+                set_bit64(ctx->idle, ctx->slots[i].idx);
+            }
+        }
+    }
+
+    /* zero bits are ignored by the kernel, only our pages are marked */
+    (void)memset_s(ctx->words, len, 0, len);
+    for (i = begin; i < end; i++) {
+        set_bit64(ctx->words, (unsigned int)(ctx->slots[i].pfn - first * BITMAP_WORD_BITS));
+    }
+    if (pwrite(ctx->bitmap_fd, ctx->words, len, offset) != (ssize_t)len) {
+        etmemd_log(ETMEMD_LOG_DEBUG, "mark pfn %lx - %lx idle fail, errno %d\n",
+                   ctx->slots[begin].pfn, ctx->slots[end - 1].pfn, errno);
+    }
+}
+
+static void check_and_mark_idle(struct page_idle_ctx *ctx, unsigned int slot_nr)
+{
+    unsigned int begin = 0;
+    unsigned int end;
+    uint64_t first;
+    uint64_t word;
+
+    qsort(ctx->slots, slot_nr, sizeof(struct pfn_slot), cmp_pfn_slot);
+    while (begin < slot_nr) {
+        first = ctx->slots[begin].pfn / BITMAP_WORD_BITS;
+        for (end = begin + 1; end < slot_nr; end++) {
+            word = ctx->slots[end].pfn / BITMAP_WORD_BITS;
+            if (word - ctx->slots[end - 1].pfn / BITMAP_WORD_BITS > BITMAP_SPAN_GAP_WORDS ||
+                word - first >= BITMAP_SPAN_MAX_WORDS) {
+                break;
+            }
+        }
+        check_and_mark_span(ctx, begin, end);
+        begin = end;
+    }
+}
+
+/* the pages [idx, idx + pages_per_pmd) are a pmd mapped huge page */
+static bool is_huge_page(const struct page_idle_ctx *ctx, uint64_t addr, unsigned int idx, unsigned int nr)
+{
+    uint64_t pfn = ctx->pagemap[idx] & PAGEMAP_PFN_MASK;
+    unsigned int i;
+
+    if ((addr & (ctx->pmd_size - 1)) != 0 || idx + ctx->pages_per_pmd > nr ||
+        pfn % ctx->pages_per_pmd != 0 ||
+        count_bits64(ctx->present, idx, ctx->pages_per_pmd) != ctx->pages_per_pmd) {
+        return false;
+    }
+
+    for (i = 1; i < ctx->pages_per_pmd; i++) {
+        if ((ctx->pagemap[idx + i] & PAGEMAP_PFN_MASK) != pfn + i) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static struct page_refs **record_batch(struct page_idle_ctx *ctx, uint64_t start, unsigned int nr,
+                                       struct page_refs **pf, unsigned long *use_rss)
+{
+    unsigned int idx = 0;
+    uint64_t addr;
+    bool accessed;
+
+    while (idx < nr && pf != NULL) {
+        addr = start + idx * ctx->pte_size;
+        if (!test_bit64(ctx->present, idx)) {
+            idx++;
+            continue;
+        }
+
+        if (is_huge_page(ctx, addr, idx, nr)) {
+            /* page_idle tracks a huge page by its head, the tail pfns never read as idle */
+            accessed = !test_bit64(ctx->idle, idx);
+            pf = update_page_refs(addr, accessed ? READ_TYPE_WEIGHT : IDLE_TYPE_WEIGHT, PMD_TYPE, pf);
+            idx += ctx->pages_per_pmd;
+        } else {
+            accessed = !test_bit64(ctx->idle, idx);
+            pf = update_page_refs(addr, accessed ? READ_TYPE_WEIGHT : IDLE_TYPE_WEIGHT, PTE_TYPE, pf);
+            idx++;
+        }
+
+        if (accessed && use_rss != NULL) {
+            (*use_rss)++;
+        }
+    }
+
+    return pf;
+}
+
+static struct page_refs **walk_vma_page_idle(struct page_idle_ctx *ctx, const struct vma *vma,
+                                             struct page_refs **pf, unsigned long *use_rss)
+{
+    uint64_t start = vma->start;
+    uint64_t end;
+    unsigned int slot_nr;
+    int nr;
+
+    while (start < vma->end && pf != NULL) {
+        /* end batches at pmd boundaries, so that huge pages are seen as a whole */
+        end = (start & ~(ctx->pmd_size - 1)) + ctx->batch * ctx->pte_size;
+        if (end > vma->end) {
+            end = vma->end;
+        }
+
+        nr = read_pagemap(ctx, start, (unsigned int)((end - start) / ctx->pte_size), &slot_nr);
+        if (nr < 0) {
+            return NULL;
+        }
+        if (nr == 0) {
+            break;
+        }
+
+        check_and_mark_idle(ctx, slot_nr);
+        pf = record_batch(ctx, start, (unsigned int)nr, pf, use_rss);
+        start += (uint64_t)nr * ctx->pte_size;
+    }
+
+    return pf;
+}
+
+int get_page_refs_by_page_idle(const struct vmas *vmas, const char *pid, struct page_refs **page_refs,
+                               unsigned long *use_rss)
+{
+    struct page_idle_ctx *ctx = NULL;
+    struct page_refs **tmp_page_refs = page_refs;
+    struct vma *vma = NULL;
+
+    ctx = page_idle_ctx_create(pid);
+    if (ctx == NULL) {
+        return -1;
+    }
+
+    for (vma = vmas->vma_list; vma != NULL; vma = vma->next) {
+        tmp_page_refs = walk_vma_page_idle(ctx, vma, tmp_page_refs, use_rss);
+        if (tmp_page_refs == NULL) {
+            etmemd_log(ETMEMD_LOG_ERR, "walk vma %lx - %lx of pid %s by page idle fail\n",
+                       vma->start, vma->end, pid);
+            page_idle_ctx_destroy(ctx);
+            return -1;
+        }
+    }
+
+    page_idle_ctx_destroy(ctx);
+    return 0;
+}
@@ -19,6 +19,9 @@
 #include "etmemd_pool_adapter.h"
 #include "etmemd_engine.h"
 #include "etmemd_scan.h"
+#include "etmemd_psi.h"
+#include "etmemd_meminfo.h"
+#include "etmemd_trace.h"
 
 static void push_ctrl_workflow(struct task_pid **tk_pid, void *(*exector)(void *))
 {
@@ -50,9 +53,19 @@ static void *launch_threadtimer_executor(void *arg)
     int scheduing_count;
 
     if (tk->eng->proj->start) {
+        etmemd_trace_begin(TRACE_CYCLE, 0);
+        etmemd_trace_begin(TRACE_GET_PIDS, 0);
         if (etmemd_get_task_pids(tk, true) != 0) {
+            etmemd_trace_end(TRACE_GET_PIDS, 0);
+            etmemd_trace_end(TRACE_CYCLE, 0);
             return NULL;
         }
+        etmemd_trace_end(TRACE_GET_PIDS, 0);
+
+        /* all the workers of this cycle share one snapshot of meminfo */
+        if (etmemd_refresh_meminfo() != 0) {
+            etmemd_log(ETMEMD_LOG_WARN, "refresh meminfo for task %s fail\n", tk->value);
+        }
 
         push_ctrl_workflow(&tk->pids, executor->func);
 
@@ -60,6 +73,7 @@ static void *launch_threadtimer_executor(void *arg)
 
         pool_inst = tk->threadpool_inst;
         scheduing_count = __atomic_load_n(&pool_inst->scheduing_size, __ATOMIC_SEQ_CST);
+        etmemd_trace_begin(TRACE_POOL_WAIT, 0);
         while (!done) {
             execution_size = __atomic_load_n(&pool_inst->execution_size, __ATOMIC_SEQ_CST);
             if (scheduing_count != execution_size) {
@@ -68,8 +82,10 @@ static void *launch_threadtimer_executor(void *arg)
             }
             done = true;
         }
+        etmemd_trace_end(TRACE_POOL_WAIT, 0);
 
         threadpool_reset_status(&tk->threadpool_inst);
+        etmemd_trace_end(TRACE_CYCLE, 0);
     }
 
     return NULL;
@@ -106,6 +122,7 @@ int start_threadpool_work(struct task_executor *executor)
                    tk->eng->proj->name, tk->value);
         return -1;
     }
+    etmemd_psi_add_timer(tk->eng->proj, tk->timer_inst);
 
     return 0;
 }
@@ -122,6 +139,7 @@ void stop_and_delete_threadpool_work(struct task *tk)
     }
 
     /* stop the threadtimer first */
+    etmemd_psi_del_timer(tk->eng->proj, tk->timer_inst);
     thread_timer_stop(tk->timer_inst);
 
     /* destroy them then */
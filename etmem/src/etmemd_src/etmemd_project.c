@@ -26,6 +26,10 @@
 #include "etmemd_project.h"
 #include "etmemd_engine.h"
 #include "etmemd_damon.h"
+#include "etmemd_damon_scan.h"
+#include "etmemd_psi.h"
+#include "etmemd_bandwidth.h"
+#include "etmemd_arbiter.h"
 #include "etmemd_common.h"
 #include "etmemd_file.h"
 #include "etmemd_log.h"
@@ -497,10 +501,104 @@ static int fill_page_scan_sleep(void *obj, void *val)
     return 0;
 }
 
+/* scan_backend: auto/idle_pages/page_idle/pagemap_scan/damon.
+ * auto uses idle_pages if etmem_scan.ko is loaded, else page_idle or pagemap_scan */
+static int fill_page_scan_backend(void *obj, void *val)
+{
+    struct page_scan *scan = (struct page_scan *)obj;
+    char *backend = (char *)val;
+    int ret = 0;
+
+    if (strcmp(backend, "auto") == 0) {
+        scan->backend = SCAN_BACKEND_AUTO;
+    } else if (strcmp(backend, "idle_pages") == 0) {
+        scan->backend = SCAN_BACKEND_IDLE_PAGES;
+    } else if (strcmp(backend, "page_idle") == 0) {
+        scan->backend = SCAN_BACKEND_PAGE_IDLE;
+    } else if (strcmp(backend, "pagemap_scan") == 0) {
+        scan->backend = SCAN_BACKEND_PAGEMAP_SCAN;
+    } else if (strcmp(backend, "damon") == 0) {
+        scan->backend = SCAN_BACKEND_DAMON;
+    } else {
+        etmemd_log(ETMEMD_LOG_ERR,
+                   "invalid scan_backend %s, must be auto, idle_pages, page_idle, pagemap_scan or damon\n",
+                   backend);
+        ret = -1;
+    }
+
+    free(backend);
+    return ret;
+}
+
 struct config_item g_page_scan_config_items[] = {
     {"loop", INT_VAL, fill_page_scan_loop, false},
     {"interval", INT_VAL, fill_page_scan_interval, false},
     {"sleep", INT_VAL, fill_page_scan_sleep, false},
+    {"scan_backend", STR_VAL, fill_page_scan_backend, true},
+};
+
+static int fill_psi_file(void *obj, void *val)
+{
+    struct psi_trigger *psi = (struct psi_trigger *)obj;
+    char *file = (char *)val;
+
+    psi->file = file;
+    return 0;
+}
+
+static int fill_psi_type(void *obj, void *val)
+{
+    struct psi_trigger *psi = (struct psi_trigger *)obj;
+    char *type = (char *)val;
+    int ret = 0;
+
+    if (strcmp(type, "some") == 0) {
+        psi->full = false;
+    } else if (strcmp(type, "full") == 0) {
+        psi->full = true;
+    } else {
+        etmemd_log(ETMEMD_LOG_ERR, "invalid psi_type %s, must be some or full\n", type);
+        ret = -1;
+    }
+
+    free(type);
+    return ret;
+}
+
+static int fill_psi_threshold(void *obj, void *val)
+{
+    struct psi_trigger *psi = (struct psi_trigger *)obj;
+    unsigned long threshold = parse_to_ulong(val);
+
+    psi->threshold = threshold;
+    return 0;
+}
+
+static int fill_psi_window(void *obj, void *val)
+{
+    struct psi_trigger *psi = (struct psi_trigger *)obj;
+    unsigned long window = parse_to_ulong(val);
+
+    psi->window = window;
+    return 0;
+}
+
+static int fill_psi_backoff(void *obj, void *val)
+{
+    struct psi_trigger *psi = (struct psi_trigger *)obj;
+    int backoff = parse_to_int(val);
+
+    psi->backoff = backoff;
+    return 0;
+}
+
+/* PSI trigger kicking the scan cycles on memory pressure, disabled unless psi_threshold is set */
+struct config_item g_page_scan_psi_config_items[] = {
+    {"psi_file", STR_VAL, fill_psi_file, true},
+    {"psi_type", STR_VAL, fill_psi_type, true},
+    {"psi_threshold", INT_VAL, fill_psi_threshold, true},
+    {"psi_window", INT_VAL, fill_psi_window, true},
+    {"psi_backoff", INT_VAL, fill_psi_backoff, true},
 };
 
 static int fill_region_scan_samp_interval(void *obj, void *val)
@@ -568,9 +666,40 @@ struct config_item g_region_scan_config_items[] = {
     {"max_nr_regions", INT_VAL, fill_region_scan_max_nr, false},
 };
 
+/* monitoring attributes of the damon scan backend, DAMON defaults are used for the ones not set */
+struct config_item g_page_scan_damon_config_items[] = {
+    {"sample_interval", INT_VAL, fill_region_scan_samp_interval, true},
+    {"aggr_interval", INT_VAL, fill_region_scan_aggr_interval, true},
+    {"update_interval", INT_VAL, fill_region_scan_updt_interval, true},
+    {"min_nr_regions", INT_VAL, fill_region_scan_min_nr, true},
+    {"max_nr_regions", INT_VAL, fill_region_scan_max_nr, true},
+};
+
+static int check_region_scan(const struct region_scan *rg_scan)
+{
+    if (rg_scan->min_nr_regions >= rg_scan->max_nr_regions) {
+        etmemd_log(ETMEMD_LOG_ERR, "min_nr_regions %d should be smaller than max_nr_regions %d.\n",
+                   rg_scan->min_nr_regions, rg_scan->max_nr_regions);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int check_damon_scan(const struct region_scan *attrs)
+{
+    if (attrs->sample_interval == 0 || attrs->aggr_interval < attrs->sample_interval) {
+        etmemd_log(ETMEMD_LOG_ERR, "aggr_interval %lu should not be smaller than sample_interval %lu.\n",
+                   attrs->aggr_interval, attrs->sample_interval);
+        return -1;
+    }
+
+    return check_region_scan(attrs);
+}
+
 int scan_fill_by_conf(GKeyFile *config, struct project *proj)
 {
-    struct region_scan *rg_scan = NULL;
+    struct page_scan *page_scan = NULL;
 
     if (proj->type == PAGE_SCAN) {
         if (parse_file_config(config, PROJ_GROUP, g_page_scan_config_items,
@@ -578,16 +707,32 @@ int scan_fill_by_conf(GKeyFile *config, struct project *proj)
             etmemd_log(ETMEMD_LOG_ERR, "parse page scan config fail.\n");
             return -1;
         }
+        page_scan = (struct page_scan *)proj->scan_param;
+        damon_scan_default_attrs(&page_scan->damon);
+        if (parse_file_config(config, PROJ_GROUP, g_page_scan_damon_config_items,
+                              ARRAY_SIZE(g_page_scan_damon_config_items), &page_scan->damon) != 0) {
+            etmemd_log(ETMEMD_LOG_ERR, "parse damon scan config fail.\n");
+            return -1;
+        }
+        if (page_scan->backend == SCAN_BACKEND_DAMON && check_damon_scan(&page_scan->damon) != 0) {
+            return -1;
+        }
+        etmemd_psi_default_trigger(&page_scan->psi);
+        if (parse_file_config(config, PROJ_GROUP, g_page_scan_psi_config_items,
+                              ARRAY_SIZE(g_page_scan_psi_config_items), &page_scan->psi) != 0) {
+            etmemd_log(ETMEMD_LOG_ERR, "parse psi config fail.\n");
+            return -1;
+        }
+        if (etmemd_psi_check_trigger(&page_scan->psi) != 0) {
+            return -1;
+        }
     } else if (proj->type == REGION_SCAN) {
         if (parse_file_config(config, PROJ_GROUP, g_region_scan_config_items,
                               ARRAY_SIZE(g_region_scan_config_items), proj->scan_param) != 0) {
             etmemd_log(ETMEMD_LOG_ERR, "parse region scan config fail.\n");
             return -1;
         }
-        rg_scan = (struct region_scan *)proj->scan_param;
-        if (rg_scan->min_nr_regions >= rg_scan->max_nr_regions) {
-            etmemd_log(ETMEMD_LOG_ERR, "min_nr_regions %d should be smaller than max_nr_regions %d.\n",
-                       rg_scan->min_nr_regions, rg_scan->max_nr_regions);
+        if (check_region_scan((struct region_scan *)proj->scan_param) != 0) {
             return -1;
         }
     }
@@ -682,6 +827,66 @@ static int fill_project_swapcache_high_wmark(void *obj, void *val)
     return 0;
 }
 
+/* fill the project parameter: evict_backend
+ * evict_backend: auto/swap_pages/pageout/cold. auto uses swap_pages if etmem_swap.ko is loaded, else pageout */
+static int fill_project_evict_backend(void *obj, void *val)
+{
+    struct project *proj = (struct project *)obj;
+    char *backend = (char *)val;
+    int ret = 0;
+
+    if (strcmp(backend, "auto") == 0) {
+        proj->evict_backend = EVICT_AUTO;
+    } else if (strcmp(backend, "swap_pages") == 0) {
+        proj->evict_backend = EVICT_SWAP_PAGES;
+    } else if (strcmp(backend, "pageout") == 0) {
+        proj->evict_backend = EVICT_PAGEOUT;
+    } else if (strcmp(backend, "cold") == 0) {
+        proj->evict_backend = EVICT_COLD;
+    } else {
+        etmemd_log(ETMEMD_LOG_ERR, "invalid evict_backend %s, must be auto, swap_pages, pageout or cold\n",
+                   backend);
+        ret = -1;
+    }
+
+    free(backend);
+    return ret;
+}
+
+/* fill the project parameter: bw_weight
+ * bw_weight: [1, 100]. the share of the swap out and migration bandwidth of etmemd */
+static int fill_project_bw_weight(void *obj, void *val)
+{
+    struct project *proj = (struct project *)obj;
+    int bw_weight = parse_to_int(val);
+
+    if (bw_weight < 1 || bw_weight > BW_WEIGHT_MAX) {
+        etmemd_log(ETMEMD_LOG_ERR, "invaild project bw_weight value %d, it must between 1 and %d.\n",
+                   bw_weight, BW_WEIGHT_MAX);
+        return -1;
+    }
+
+    proj->bw_weight = bw_weight;
+    return 0;
+}
+
+/* fill the project parameter: priority
+ * priority: [0, 7]. the cold pages of a project with higher priority are evicted later */
+static int fill_project_priority(void *obj, void *val)
+{
+    struct project *proj = (struct project *)obj;
+    int priority = parse_to_int(val);
+
+    if (priority < 0 || priority > ARB_PRIORITY_MAX) {
+        etmemd_log(ETMEMD_LOG_ERR, "invaild project priority value %d, it must between 0 and %d.\n",
+                   priority, ARB_PRIORITY_MAX);
+        return -1;
+    }
+
+    proj->priority = priority;
+    return 0;
+}
+
 static bool check_swapcache_wmark_valid(struct project *proj)
 {
     if (proj->swapcache_high_wmark == -1 && proj->swapcache_low_wmark == -1) {
@@ -703,6 +908,9 @@ static struct config_item g_project_config_items[] = {
     {"sysmem_threshold", INT_VAL, fill_project_sysmem_threshold, true},
     {"swapcache_high_wmark", INT_VAL, fill_project_swapcache_high_wmark, true},
     {"swapcache_low_wmark", INT_VAL, fill_project_swapcache_low_wmark, true},
+    {"evict_backend", STR_VAL, fill_project_evict_backend, true},
+    {"bw_weight", INT_VAL, fill_project_bw_weight, true},
+    {"priority", INT_VAL, fill_project_priority, true},
 };
 
 static void clear_project(struct project *proj)
@@ -713,6 +921,9 @@ static void clear_project(struct project *proj)
     }
 
     if (proj->scan_param != NULL) {
+        if (proj->type == PAGE_SCAN) {
+            free(((struct page_scan *)proj->scan_param)->psi.file);
+        }
         free(proj->scan_param);
         proj->scan_param = NULL;
     }
@@ -741,6 +952,9 @@ static void do_remove_project(struct project *proj)
     while (proj->engs != NULL) {
         do_remove_engine(proj, proj->engs);
     }
+    etmemd_psi_stop(proj);
+    etmemd_arb_forget(proj);
+    etmemd_bw_share_free(proj->bw_share);
     clear_project(proj);
     free(proj);
 }
@@ -768,6 +982,7 @@ enum opt_result etmemd_project_add(GKeyFile *config)
     proj->sysmem_threshold = -1;
     proj->swapcache_high_wmark = -1;
     proj->swapcache_low_wmark = -1;
+    proj->bw_weight = BW_WEIGHT_DEFAULT;
 
     if (project_fill_by_conf(config, proj) != 0) {
         etmemd_log(ETMEMD_LOG_ERR, "fill project from configuration file fail\n");
@@ -783,6 +998,15 @@ enum opt_result etmemd_project_add(GKeyFile *config)
         return OPT_INVAL;
     }
 
+    proj->bw_share = etmemd_bw_share_alloc(proj->name, proj->bw_weight);
+    if (proj->bw_share == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "alloc bandwidth share for project %s fail\n", proj->name);
+        clear_project(proj);
+        free(proj);
+        proj = NULL;
+        return OPT_INTER_ERR;
+    }
+
     SLIST_INSERT_HEAD(&g_projects, proj, entry);
     return OPT_SUCCESS;
 }
@@ -894,8 +1118,14 @@ enum opt_result etmemd_migrate_start(const char *project_name)
 
     switch (proj->type) {
         case PAGE_SCAN:
+            /* the timers of the tasks are added to the psi monitor when they start */
+            if (etmemd_psi_start(proj) != 0) {
+                etmemd_log(ETMEMD_LOG_WARN, "psi of project %s not monitored, scan on interval only\n",
+                           project_name);
+            }
             if (start_tasks(proj) != 0) {
                 etmemd_log(ETMEMD_LOG_ERR, "some task of project %s start fail\n", project_name);
+                etmemd_psi_stop(proj);
                 return OPT_INTER_ERR;
             }
             break;
@@ -937,10 +1167,12 @@ enum opt_result etmemd_migrate_stop(const char *project_name)
 
     switch (proj->type) {
         case PAGE_SCAN:
+            etmemd_psi_stop(proj);
             stop_tasks(proj);
+            etmemd_arb_forget(proj);
             break;
         case REGION_SCAN:
-            if (etmemd_stop_damon() != 0) {
+            if (etmemd_stop_damon(proj) != 0) {
                 etmemd_log(ETMEMD_LOG_ERR, "stop damon of project %s fail\n", project_name);
                 return OPT_INTER_ERR;
             }
@@ -1000,6 +1232,27 @@ enum opt_result etmemd_project_mgt_engine(const char *project_name, const char *
     return OPT_SUCCESS;
 }
 
+int etmemd_project_for_each_task(int (*func)(struct task *tk, void *data), void *data)
+{
+    struct project *proj = NULL;
+    struct engine *eng = NULL;
+    struct task *tk = NULL;
+    int ret;
+
+    SLIST_FOREACH(proj, &g_projects, entry) {
+        for (eng = proj->engs; eng != NULL; eng = eng->next) {
+            for (tk = eng->tasks; tk != NULL; tk = tk->next) {
+                ret = func(tk, data);
+                if (ret != 0) {
+                    return ret;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
 void etmemd_stop_all_projects(void)
 {
     struct project *proj = NULL;
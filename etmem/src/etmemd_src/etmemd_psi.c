@@ -0,0 +1,298 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: Kick the scan cycles of projects on memory pressure reported by PSI triggers.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/queue.h>
+
+#include "securec.h"
+#include "etmemd_common.h"
+#include "etmemd_log.h"
+#include "etmemd_psi.h"
+
+#define PSI_TRIGGER_MAX_LEN     64
+#define MSEC_PER_SEC            1000
+
+struct psi_timer {
+    timer_thread *timer;
+    SLIST_ENTRY(psi_timer) entry;
+};
+
+struct psi_monitor {
+    const char *proj_name;
+    const struct psi_trigger *trigger;
+    int interval;
+    int backoff;                /* current times of interval between cycles */
+    int fd;
+    pthread_t thread;
+    pthread_mutex_t mtx;
+    SLIST_HEAD(psi_timer_list, psi_timer) timers;
+};
+
+void etmemd_psi_default_trigger(struct psi_trigger *trigger)
+{
+    trigger->file = NULL;
+    trigger->full = false;
+    trigger->threshold = 0;
+    trigger->window = PSI_DEFAULT_WINDOW;
+    trigger->backoff = PSI_DEFAULT_BACKOFF;
+}
+
+int etmemd_psi_check_trigger(const struct psi_trigger *trigger)
+{
+    if (trigger->threshold == 0) {
+        return 0;
+    }
+
+    if (trigger->window < PSI_WINDOW_MIN || trigger->window > PSI_WINDOW_MAX) {
+        etmemd_log(ETMEMD_LOG_ERR, "psi_window %lu must be between %d and %d\n",
+                   trigger->window, PSI_WINDOW_MIN, PSI_WINDOW_MAX);
+        return -1;
+    }
+
+    if (trigger->threshold > trigger->window) {
+        etmemd_log(ETMEMD_LOG_ERR, "psi_threshold %lu should not be larger than psi_window %lu\n",
+                   trigger->threshold, trigger->window);
+        return -1;
+    }
+
+    if (trigger->backoff < 1 || trigger->backoff > PSI_MAX_BACKOFF) {
+        etmemd_log(ETMEMD_LOG_ERR, "psi_backoff %d must be between 1 and %d\n",
+                   trigger->backoff, PSI_MAX_BACKOFF);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int psi_open_trigger(const struct psi_trigger *trigger)
+{
+    const char *file = trigger->file != NULL ? trigger->file : PSI_MEMORY_FILE;
+    char buf[PSI_TRIGGER_MAX_LEN] = {0};
+    char root_path[PATH_MAX] = {0};
+    const char *path = NULL;
+    size_t len;
+    int fd;
+
+    if (snprintf_s(buf, sizeof(buf), sizeof(buf) - 1, "%s %lu %lu", trigger->full ? "full" : "some",
+                   trigger->threshold, trigger->window) <= 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "snprintf psi trigger fail\n");
+        return -1;
+    }
+
+    path = etmemd_root_path(file, root_path, sizeof(root_path));
+    fd = path == NULL ? -1 : open(path, O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "open %s fail, error: %d\n", file, errno);
+        return -1;
+    }
+
+    /* the trigger is kept until fd is closed */
+    len = strlen(buf) + 1;
+    if (write(fd, buf, len) != (ssize_t)len) {
+        etmemd_log(ETMEMD_LOG_ERR, "write psi trigger %s to %s fail, error: %d\n", buf, file, errno);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static void psi_set_timers(struct psi_monitor *monitor, int backoff, bool kick)
+{
+    struct psi_timer *node = NULL;
+    int old_state;
+
+    /* never be cancelled with the mutex held */
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
+    pthread_mutex_lock(&monitor->mtx);
+    monitor->backoff = backoff;
+    SLIST_FOREACH(node, &monitor->timers, entry) {
+        thread_timer_set_expired_time(node->timer, monitor->interval * backoff);
+        if (kick) {
+            thread_timer_kick(node->timer);
+        }
+    }
+    pthread_mutex_unlock(&monitor->mtx);
+    pthread_setcancelstate(old_state, NULL);
+}
+
+static void *psi_monitor_routine(void *arg)
+{
+    struct psi_monitor *monitor = (struct psi_monitor *)arg;
+    struct pollfd fds = {.fd = monitor->fd, .events = POLLPRI};
+    int backoff;
+    int ret;
+
+    while (true) {
+        ret = poll(&fds, 1, monitor->interval * monitor->backoff * MSEC_PER_SEC);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            etmemd_log(ETMEMD_LOG_ERR, "poll psi of project %s fail, error: %d\n", monitor->proj_name, errno);
+            break;
+        }
+
+        /* no pressure in a whole cycle, scan less often */
+        if (ret == 0) {
+            backoff = monitor->backoff * 2;
+            if (backoff > monitor->trigger->backoff) {
+                backoff = monitor->trigger->backoff;
+            }
+            if (backoff != monitor->backoff) {
+                etmemd_log(ETMEMD_LOG_DEBUG, "no memory pressure, project %s scans every %d seconds\n",
+                           monitor->proj_name, monitor->interval * backoff);
+                psi_set_timers(monitor, backoff, false);
+            }
+            continue;
+        }
+
+        if ((fds.revents & POLLERR) != 0) {
+            etmemd_log(ETMEMD_LOG_WARN, "psi trigger of project %s is gone\n", monitor->proj_name);
+            break;
+        }
+
+        if ((fds.revents & POLLPRI) != 0) {
+            etmemd_log(ETMEMD_LOG_DEBUG, "memory pressure, kick the scans of project %s\n", monitor->proj_name);
+            psi_set_timers(monitor, 1, true);
+        }
+    }
+
+    /* leave the timers on their own interval */
+    psi_set_timers(monitor, 1, false);
+    return NULL;
+}
+
+int etmemd_psi_start(struct project *proj)
+{
+    struct page_scan *page_scan = (struct page_scan *)proj->scan_param;
+    struct psi_monitor *monitor = NULL;
+
+    if (proj->type != PAGE_SCAN || page_scan->psi.threshold == 0 || proj->psi_monitor != NULL) {
+        return 0;
+    }
+
+    monitor = (struct psi_monitor *)calloc(1, sizeof(struct psi_monitor));
+    if (monitor == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for psi monitor fail\n");
+        return -1;
+    }
+
+    monitor->proj_name = proj->name;
+    monitor->trigger = &page_scan->psi;
+    monitor->interval = page_scan->interval;
+    monitor->backoff = 1;
+    SLIST_INIT(&monitor->timers);
+
+    monitor->fd = psi_open_trigger(&page_scan->psi);
+    if (monitor->fd < 0) {
+        goto free_monitor;
+    }
+
+    if (pthread_mutex_init(&monitor->mtx, NULL) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "init mutex of psi monitor fail\n");
+        goto close_fd;
+    }
+
+    if (pthread_create(&monitor->thread, NULL, psi_monitor_routine, monitor) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "create psi monitor thread fail\n");
+        goto destroy_mtx;
+    }
+
+    proj->psi_monitor = monitor;
+    return 0;
+
+destroy_mtx:
+    pthread_mutex_destroy(&monitor->mtx);
+close_fd:
+    close(monitor->fd);
+free_monitor:
+    free(monitor);
+    return -1;
+}
+
+void etmemd_psi_stop(struct project *proj)
+{
+    struct psi_monitor *monitor = proj->psi_monitor;
+    struct psi_timer *node = NULL;
+
+    if (monitor == NULL) {
+        return;
+    }
+
+    pthread_cancel(monitor->thread);
+    pthread_join(monitor->thread, NULL);
+    proj->psi_monitor = NULL;
+
+    while (!SLIST_EMPTY(&monitor->timers)) {
+        node = SLIST_FIRST(&monitor->timers);
+        SLIST_REMOVE_HEAD(&monitor->timers, entry);
+        thread_timer_set_expired_time(node->timer, monitor->interval);
+        free(node);
+    }
+
+    pthread_mutex_destroy(&monitor->mtx);
+    close(monitor->fd);
+    free(monitor);
+}
+
+void etmemd_psi_add_timer(struct project *proj, timer_thread *timer)
+{
+    struct psi_monitor *monitor = proj->psi_monitor;
+    struct psi_timer *node = NULL;
+
+    if (monitor == NULL) {
+        return;
+    }
+
+    node = (struct psi_timer *)calloc(1, sizeof(struct psi_timer));
+    if (node == NULL) {
+        etmemd_log(ETMEMD_LOG_WARN, "malloc for psi timer fail, the task runs on its interval only\n");
+        return;
+    }
+    node->timer = timer;
+
+    pthread_mutex_lock(&monitor->mtx);
+    thread_timer_set_expired_time(timer, monitor->interval * monitor->backoff);
+    SLIST_INSERT_HEAD(&monitor->timers, node, entry);
+    pthread_mutex_unlock(&monitor->mtx);
+}
+
+void etmemd_psi_del_timer(struct project *proj, timer_thread *timer)
+{
+    struct psi_monitor *monitor = proj->psi_monitor;
+    struct psi_timer *node = NULL;
+
+    if (monitor == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&monitor->mtx);
+    SLIST_FOREACH(node, &monitor->timers, entry) {
+        if (node->timer == timer) {
+            SLIST_REMOVE(&monitor->timers, node, psi_timer, entry);
+            free(node);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&monitor->mtx);
+}
@@ -0,0 +1,394 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: Record the vmas, idle_pages buffers and memory samples read by etmemd to a file.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "securec.h"
+#include "etmemd_common.h"
+#include "etmemd_log.h"
+#include "etmemd_scan.h"
+#include "etmemd_record.h"
+
+#define RECORD_BUF_SIZE         (1UL << 20)
+#define RECORD_COMM_FILE        "/comm"
+#define NSEC_PER_SEC            1000000000ULL
+
+#define ALIGN_8(s)              (((s) + 7) & ~(size_t)7)
+
+static char *g_record_file = NULL;
+static FILE *g_record_fp = NULL;
+static bool g_recording = false;
+static pthread_mutex_t g_record_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+int etmemd_record_set_file(const char *file)
+{
+    if (g_record_file != NULL) {
+        printf("error: record file is set repeatedly\n");
+        return -1;
+    }
+
+    if (file == NULL || strlen(file) >= PATH_MAX) {
+        printf("error: record file is invalid\n");
+        return -1;
+    }
+
+    g_record_file = strdup(file);
+    if (g_record_file == NULL) {
+        printf("error: malloc for record file fail\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+bool etmemd_record_set(void)
+{
+    return g_record_file != NULL;
+}
+
+int etmemd_record_start(void)
+{
+    struct record_header header = {{0}};
+    int type;
+
+    if (g_record_file == NULL) {
+        return 0;
+    }
+
+    g_record_fp = fopen(g_record_file, "w");
+    if (g_record_fp == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "open record file %s fail, error: %d\n", g_record_file, errno);
+        return -1;
+    }
+
+    /* the buffers of idle_pages are large, so write them in big chunks */
+    if (setvbuf(g_record_fp, NULL, _IOFBF, RECORD_BUF_SIZE) != 0) {
+        etmemd_log(ETMEMD_LOG_WARN, "set buffer of record file fail\n");
+    }
+
+    if (memcpy_s(header.magic, sizeof(header.magic), RECORD_MAGIC, strlen(RECORD_MAGIC)) != EOK) {
+        goto close_fp;
+    }
+    header.version = RECORD_VERSION;
+    for (type = 0; type < PAGE_TYPE_INVAL; type++) {
+        header.page_size[type] = (uint64_t)page_type_to_size((enum page_type)type);
+    }
+
+    if (fwrite(&header, sizeof(header), 1, g_record_fp) != 1) {
+        etmemd_log(ETMEMD_LOG_ERR, "write header of record file %s fail\n", g_record_file);
+        goto close_fp;
+    }
+
+    g_recording = true;
+    etmemd_log(ETMEMD_LOG_INFO, "record scan to %s\n", g_record_file);
+    return 0;
+
+close_fp:
+    fclose(g_record_fp);
+    g_record_fp = NULL;
+    return -1;
+}
+
+void etmemd_record_stop(void)
+{
+    pthread_mutex_lock(&g_record_mtx);
+    g_recording = false;
+    if (g_record_fp != NULL) {
+        fclose(g_record_fp);
+        g_record_fp = NULL;
+    }
+    pthread_mutex_unlock(&g_record_mtx);
+
+    free(g_record_file);
+    g_record_file = NULL;
+}
+
+static uint64_t record_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+/* the payload is given in two parts, so the large buffers are not copied */
+static void record_write(uint32_t type, unsigned int pid, const void *head, size_t head_len,
+                         const void *body, size_t body_len)
+{
+    static const char pad[sizeof(uint64_t)] = {0};
+    struct record_entry entry;
+    size_t len = head_len + body_len;
+    int old_state;
+
+    entry.type = type;
+    entry.pid = pid;
+    entry.time_ns = record_time_ns();
+    entry.len = len;
+
+    /* a worker may be cancelled, never leave the mutex locked or an entry written in half */
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
+    pthread_mutex_lock(&g_record_mtx);
+    if (!g_recording) {
+        goto unlock;
+    }
+
+    if (fwrite(&entry, sizeof(entry), 1, g_record_fp) != 1 ||
+        (head_len > 0 && fwrite(head, head_len, 1, g_record_fp) != 1) ||
+        (body_len > 0 && fwrite(body, body_len, 1, g_record_fp) != 1) ||
+        (ALIGN_8(len) > len && fwrite(pad, ALIGN_8(len) - len, 1, g_record_fp) != 1)) {
+        etmemd_log(ETMEMD_LOG_ERR, "write record file fail, stop recording\n");
+        g_recording = false;
+    }
+
+unlock:
+    pthread_mutex_unlock(&g_record_mtx);
+    pthread_setcancelstate(old_state, NULL);
+}
+
+void etmemd_record_config(unsigned int cmd, const char *data, size_t len)
+{
+    struct record_config config = {0};
+
+    if (!g_recording || data == NULL) {
+        return;
+    }
+
+    config.cmd = cmd;
+    record_write(RECORD_CONFIG, 0, &config, sizeof(config), data, len);
+}
+
+static void read_comm(const char *pid, char *comm)
+{
+    FILE *fp = NULL;
+
+    fp = etmemd_get_proc_file(pid, RECORD_COMM_FILE, "r");
+    if (fp == NULL) {
+        return;
+    }
+
+    if (fgets(comm, RECORD_COMM_LEN, fp) != NULL) {
+        comm[strcspn(comm, "\n")] = '\0';
+    }
+    fclose(fp);
+}
+
+void etmemd_record_vmas(const char *pid, const struct vmas *vmas)
+{
+    struct record_vmas *rec = NULL;
+    const struct vma *vma = NULL;
+    unsigned int pid_val;
+    size_t size;
+    uint64_t i = 0;
+    int j;
+
+    if (!g_recording || get_unsigned_int_value(pid, &pid_val) != 0) {
+        return;
+    }
+
+    size = sizeof(struct record_vmas) + vmas->vma_cnt * sizeof(struct record_vma);
+    rec = (struct record_vmas *)calloc(1, size);
+    if (rec == NULL) {
+        etmemd_log(ETMEMD_LOG_WARN, "malloc for vmas record of pid %s fail\n", pid);
+        return;
+    }
+
+    read_comm(pid, rec->comm);
+    for (vma = vmas->vma_list; vma != NULL && i < vmas->vma_cnt; vma = vma->next, i++) {
+        rec->vma[i].start = vma->start;
+        rec->vma[i].end = vma->end;
+        rec->vma[i].offset = vma->offset;
+        rec->vma[i].inode = vma->inode;
+        for (j = 0; j < VMA_STAT_INIT; j++) {
+            rec->vma[i].stat |= vma->stat[j] ? (1U << j) : 0;
+        }
+    }
+    rec->nr = i;
+
+    record_write(RECORD_VMAS, pid_val, rec, sizeof(struct record_vmas) + i * sizeof(struct record_vma), NULL, 0);
+    free(rec);
+}
+
+void etmemd_record_scan(unsigned int pid, uint64_t start, const unsigned char *buf, size_t len)
+{
+    struct record_scan scan;
+
+    if (!g_recording) {
+        return;
+    }
+
+    scan.start = start;
+    record_write(RECORD_SCAN, pid, &scan, sizeof(scan), buf, len);
+}
+
+void etmemd_record_meminfo(const struct meminfo *info)
+{
+    struct record_meminfo rec;
+
+    if (!g_recording) {
+        return;
+    }
+
+    rec.mem_total = info->mem_total;
+    rec.mem_free = info->mem_free;
+    rec.mem_available = info->mem_available;
+    rec.cached = info->cached;
+    rec.swap_cached = info->swap_cached;
+    rec.swap_total = info->swap_total;
+    rec.swap_free = info->swap_free;
+    record_write(RECORD_MEMINFO, 0, &rec, sizeof(rec), NULL, 0);
+}
+
+void etmemd_record_pid_status(const char *pid, const struct pid_status *status)
+{
+    struct record_pid_status rec;
+    unsigned int pid_val;
+
+    if (!g_recording || get_unsigned_int_value(pid, &pid_val) != 0) {
+        return;
+    }
+
+    rec.vm_rss = status->vm_rss;
+    rec.vm_swap = status->vm_swap;
+    rec.rss_anon = status->rss_anon;
+    rec.rss_file = status->rss_file;
+    record_write(RECORD_PID_STATUS, pid_val, &rec, sizeof(rec), NULL, 0);
+}
+
+int etmemd_record_open(const char *file, struct record_reader *reader)
+{
+    const struct record_header *header = NULL;
+    struct stat st;
+    void *map = NULL;
+    int fd;
+    int type;
+
+    fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "open record file %s fail, error: %d\n", file, errno);
+        return -1;
+    }
+
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct record_header)) {
+        etmemd_log(ETMEMD_LOG_ERR, "record file %s is too small\n", file);
+        close(fd);
+        return -1;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        etmemd_log(ETMEMD_LOG_ERR, "mmap record file %s fail, error: %d\n", file, errno);
+        return -1;
+    }
+
+    header = (const struct record_header *)map;
+    if (memcmp(header->magic, RECORD_MAGIC, strlen(RECORD_MAGIC)) != 0 || header->version != RECORD_VERSION) {
+        etmemd_log(ETMEMD_LOG_ERR, "%s is not a record file of this version\n", file);
+        goto unmap;
+    }
+
+    /* the addresses in the buffers advance by the page sizes of the host recorded */
+    for (type = 0; type < PAGE_TYPE_INVAL; type++) {
+        if (header->page_size[type] != (uint64_t)page_type_to_size((enum page_type)type)) {
+            etmemd_log(ETMEMD_LOG_ERR, "%s is recorded with another page size\n", file);
+            goto unmap;
+        }
+    }
+
+    reader->map = (const unsigned char *)map;
+    reader->size = (size_t)st.st_size;
+    reader->pos = sizeof(struct record_header);
+    return 0;
+
+unmap:
+    munmap(map, (size_t)st.st_size);
+    return -1;
+}
+
+void etmemd_record_close(struct record_reader *reader)
+{
+    if (reader->map != NULL) {
+        munmap((void *)reader->map, reader->size);
+        reader->map = NULL;
+    }
+}
+
+static size_t record_min_len(uint32_t type)
+{
+    switch (type) {
+        case RECORD_CONFIG:
+            return sizeof(struct record_config);
+        case RECORD_VMAS:
+            return sizeof(struct record_vmas);
+        case RECORD_SCAN:
+            return sizeof(struct record_scan);
+        case RECORD_MEMINFO:
+            return sizeof(struct record_meminfo);
+        case RECORD_PID_STATUS:
+            return sizeof(struct record_pid_status);
+        default:
+            return 0;
+    }
+}
+
+int etmemd_record_next(struct record_reader *reader, const struct record_entry **entry, const void **payload)
+{
+    const struct record_entry *ent = NULL;
+    const struct record_vmas *vmas = NULL;
+    size_t left = reader->size - reader->pos;
+
+    if (left == 0) {
+        return 0;
+    }
+
+    /* etmemd may be killed while recording, the entry in half at the end is dropped */
+    ent = (const struct record_entry *)(reader->map + reader->pos);
+    if (left < sizeof(struct record_entry) || ent->len > left - sizeof(struct record_entry)) {
+        etmemd_log(ETMEMD_LOG_WARN, "drop the entry cut at offset %zu of record file\n", reader->pos);
+        reader->pos = reader->size;
+        return 0;
+    }
+
+    if (ent->type == 0 || ent->type >= RECORD_TYPE_END || ent->len < record_min_len(ent->type)) {
+        etmemd_log(ETMEMD_LOG_ERR, "broken entry at offset %zu of record file\n", reader->pos);
+        return -1;
+    }
+
+    if (ent->type == RECORD_VMAS) {
+        vmas = (const struct record_vmas *)(ent + 1);
+        if (vmas->nr > (ent->len - sizeof(struct record_vmas)) / sizeof(struct record_vma)) {
+            etmemd_log(ETMEMD_LOG_ERR, "broken vmas at offset %zu of record file\n", reader->pos);
+            return -1;
+        }
+    }
+
+    *entry = ent;
+    *payload = ent + 1;
+    reader->pos += sizeof(struct record_entry) + ALIGN_8(ent->len);
+    if (reader->pos > reader->size) {
+        reader->pos = reader->size;
+    }
+    return 1;
+}
@@ -0,0 +1,559 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: Replay a scan record through the engines offline.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/queue.h>
+#include <glib.h>
+
+#include "securec.h"
+#include "etmemd.h"
+#include "etmemd_common.h"
+#include "etmemd_log.h"
+#include "etmemd_rpc.h"
+#include "etmemd_project.h"
+#include "etmemd_engine.h"
+#include "etmemd_scan.h"
+#include "etmemd_record.h"
+#include "etmemd_replay.h"
+
+#define NSEC_PER_SEC            1000000000ULL
+#define NSEC_PER_USEC           1000ULL
+#define USEC_PER_MSEC           1000ULL
+#define BYTE_TO_KB(s)           ((s) >> 10)
+
+/* what is read of a pid since its last vmas, which is one scan cycle of an engine */
+struct replay_pid {
+    unsigned int pid;
+    struct pid_status latest;
+    bool has_latest;
+
+    bool open;
+    unsigned long cycle;
+    const struct record_vmas *vmas;
+    const struct record_entry **scans;
+    size_t nr_scans;
+    size_t max_scans;
+    struct meminfo meminfo;
+    bool has_meminfo;
+    struct pid_status status;
+    bool has_status;
+    bool status_after_scan;
+
+    SLIST_ENTRY(replay_pid) entry;
+};
+
+struct replay_stat {
+    unsigned long cycles;
+    unsigned long decisions;
+    unsigned long skipped;
+    unsigned long pages;
+    unsigned long cold_pages;
+    uint64_t cold_bytes;
+    uint64_t read_ns;
+    uint64_t parse_ns;
+    uint64_t policy_ns;
+};
+
+static char *g_replay_file = NULL;
+static char *g_replay_config = NULL;
+static bool g_replay_running = false;
+
+static struct meminfo g_replay_meminfo;
+static bool g_replay_has_meminfo = false;
+static const struct replay_pid *g_replay_cur = NULL;
+
+static struct meminfo g_latest_meminfo;
+static bool g_has_latest_meminfo = false;
+static SLIST_HEAD(replay_pid_list, replay_pid) g_replay_pids = SLIST_HEAD_INITIALIZER(g_replay_pids);
+static struct replay_stat g_replay_stat;
+
+static int replay_set_str(char **dst, const char *src, const char *what)
+{
+    if (*dst != NULL) {
+        printf("error: %s is set repeatedly\n", what);
+        return -1;
+    }
+
+    if (src == NULL || strlen(src) >= PATH_MAX) {
+        printf("error: %s is invalid\n", what);
+        return -1;
+    }
+
+    *dst = strdup(src);
+    if (*dst == NULL) {
+        printf("error: malloc for %s fail\n", what);
+        return -1;
+    }
+
+    return 0;
+}
+
+int etmemd_replay_set_file(const char *file)
+{
+    return replay_set_str(&g_replay_file, file, "replay file");
+}
+
+int etmemd_replay_set_config(const char *config)
+{
+    return replay_set_str(&g_replay_config, config, "replay config");
+}
+
+bool etmemd_replay_set(void)
+{
+    return g_replay_file != NULL;
+}
+
+bool etmemd_replay_config_set(void)
+{
+    return g_replay_config != NULL;
+}
+
+void etmemd_replay_clear(void)
+{
+    free(g_replay_file);
+    g_replay_file = NULL;
+    free(g_replay_config);
+    g_replay_config = NULL;
+}
+
+bool etmemd_replay_running(void)
+{
+    return g_replay_running;
+}
+
+int etmemd_replay_meminfo(struct meminfo *info)
+{
+    if (!g_replay_has_meminfo) {
+        return -1;
+    }
+
+    *info = g_replay_meminfo;
+    return 0;
+}
+
+int etmemd_replay_pid_status(const char *pid, struct pid_status *status)
+{
+    unsigned int pid_val;
+
+    if (g_replay_cur == NULL || !g_replay_cur->has_status || get_unsigned_int_value(pid, &pid_val) != 0 ||
+        pid_val != g_replay_cur->pid) {
+        return -1;
+    }
+
+    *status = g_replay_cur->status;
+    return 0;
+}
+
+static uint64_t replay_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+static struct replay_pid *get_replay_pid(unsigned int pid)
+{
+    struct replay_pid *rp = NULL;
+
+    SLIST_FOREACH(rp, &g_replay_pids, entry) {
+        if (rp->pid == pid) {
+            return rp;
+        }
+    }
+
+    rp = (struct replay_pid *)calloc(1, sizeof(struct replay_pid));
+    if (rp == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for replay pid %u fail\n", pid);
+        return NULL;
+    }
+
+    rp->pid = pid;
+    SLIST_INSERT_HEAD(&g_replay_pids, rp, entry);
+    return rp;
+}
+
+static bool replay_task_match(const struct task *tk, const struct replay_pid *rp)
+{
+    unsigned int pid;
+
+    if (strcmp(tk->type, "pid") == 0) {
+        return get_unsigned_int_value(tk->value, &pid) == 0 && pid == rp->pid;
+    }
+
+    if (strcmp(tk->type, "name") == 0) {
+        return strncmp(tk->value, rp->vmas->comm, RECORD_COMM_LEN - 1) == 0;
+    }
+
+    /* the pids of a cgroup are not in the record, so all of them are taken */
+    return true;
+}
+
+/* the buffers of a cycle are parsed in the order they are read, as walk_vmas does */
+static int replay_parse(const struct replay_pid *rp, struct page_refs **page_refs)
+{
+    const struct record_scan *scan = NULL;
+    struct page_refs **pos = page_refs;
+    uint64_t last_start = 0;
+    size_t i;
+
+    for (i = 0; i < rp->nr_scans; i++) {
+        scan = (const struct record_scan *)(rp->scans[i] + 1);
+        if (scan->start < last_start) {
+            pos = page_refs;
+        }
+        last_start = scan->start;
+
+        if (etmemd_parse_scan_buf(scan->buf, rp->scans[i]->len - sizeof(struct record_scan), &pos) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static unsigned long count_pages(const struct page_refs *page_refs, uint64_t *bytes)
+{
+    unsigned long nr = 0;
+
+    for (; page_refs != NULL; page_refs = page_refs->next) {
+        nr++;
+        if (bytes != NULL) {
+            *bytes += (uint64_t)page_type_to_size(page_refs->type);
+        }
+    }
+
+    return nr;
+}
+
+static void report_decision(const struct task *tk, const struct replay_pid *rp, unsigned long pages,
+                            const struct memory_grade *memory_grade, uint64_t parse_ns, uint64_t policy_ns)
+{
+    unsigned long hot, cold;
+    uint64_t cold_bytes = 0;
+
+    printf("%s/%s/%s pid %u cycle %lu: vmas %lu pages %lu ", tk->eng->proj->name, tk->eng->name, tk->name,
+           rp->pid, rp->cycle, (unsigned long)rp->vmas->nr, pages);
+    if (memory_grade == NULL) {
+        printf("skip, parse %lu us policy %lu us\n", (unsigned long)(parse_ns / NSEC_PER_USEC),
+               (unsigned long)(policy_ns / NSEC_PER_USEC));
+        g_replay_stat.skipped++;
+        return;
+    }
+
+    hot = count_pages(memory_grade->hot_pages, NULL);
+    cold = count_pages(memory_grade->cold_pages, &cold_bytes);
+    printf("hot %lu cold %lu (%lu KB), parse %lu us policy %lu us\n", hot, cold,
+           (unsigned long)BYTE_TO_KB(cold_bytes), (unsigned long)(parse_ns / NSEC_PER_USEC),
+           (unsigned long)(policy_ns / NSEC_PER_USEC));
+    g_replay_stat.decisions++;
+    g_replay_stat.cold_pages += cold;
+    g_replay_stat.cold_bytes += cold_bytes;
+}
+
+static int replay_task(struct task *tk, void *data)
+{
+    const struct replay_pid *rp = (const struct replay_pid *)data;
+    struct task_pid tk_pid = {0};
+    struct page_refs *page_refs = NULL;
+    struct memory_grade *memory_grade = NULL;
+    unsigned long pages;
+    uint64_t start, parsed, decided;
+
+    /* the ops of a thirdparty engine are built without replay_pages */
+    if (tk->eng->engine_type == THIRDPARTY_ENGINE || tk->eng->ops->replay_pages == NULL ||
+        !replay_task_match(tk, rp)) {
+        return 0;
+    }
+
+    tk_pid.pid = rp->pid;
+    tk_pid.pidfd = -1;
+    tk_pid.tk = tk;
+
+    start = replay_now_ns();
+    if (replay_parse(rp, &page_refs) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "parse cycle %lu of pid %u fail\n", rp->cycle, rp->pid);
+        etmemd_free_page_refs(page_refs);
+        return -1;
+    }
+    parsed = replay_now_ns();
+    pages = count_pages(page_refs, NULL);
+
+    memory_grade = tk->eng->ops->replay_pages(&tk_pid, &page_refs);
+    decided = replay_now_ns();
+
+    report_decision(tk, rp, pages, memory_grade, parsed - start, decided - parsed);
+    g_replay_stat.pages += pages;
+    g_replay_stat.parse_ns += parsed - start;
+    g_replay_stat.policy_ns += decided - parsed;
+
+    clean_memory_grade_unexpected(&memory_grade);
+    etmemd_free_page_refs(page_refs);
+    return 0;
+}
+
+static int close_cycle(struct replay_pid *rp)
+{
+    int ret;
+
+    if (!rp->open) {
+        return 0;
+    }
+
+    rp->open = false;
+    g_replay_stat.cycles++;
+    g_replay_meminfo = rp->meminfo;
+    g_replay_has_meminfo = rp->has_meminfo;
+    g_replay_cur = rp;
+
+    ret = etmemd_project_for_each_task(replay_task, rp);
+    g_replay_cur = NULL;
+    return ret;
+}
+
+static int open_cycle(struct replay_pid *rp, const struct record_vmas *vmas)
+{
+    if (close_cycle(rp) != 0) {
+        return -1;
+    }
+
+    rp->open = true;
+    rp->cycle++;
+    rp->vmas = vmas;
+    rp->nr_scans = 0;
+    rp->meminfo = g_latest_meminfo;
+    rp->has_meminfo = g_has_latest_meminfo;
+    rp->status = rp->latest;
+    rp->has_status = rp->has_latest;
+    rp->status_after_scan = false;
+    return 0;
+}
+
+static int add_scan(struct replay_pid *rp, const struct record_entry *entry)
+{
+    const struct record_entry **scans = NULL;
+    size_t max;
+
+    /* the buffers read without the vmas are not from a scan cycle of an engine */
+    if (!rp->open) {
+        return 0;
+    }
+
+    if (rp->nr_scans == rp->max_scans) {
+        max = rp->max_scans == 0 ? 64 : rp->max_scans * 2; /* 64 buffers are enough for most cycles */
+        scans = (const struct record_entry **)realloc(rp->scans, max * sizeof(struct record_entry *));
+        if (scans == NULL) {
+            etmemd_log(ETMEMD_LOG_ERR, "malloc for scans of pid %u fail\n", rp->pid);
+            return -1;
+        }
+        rp->scans = scans;
+        rp->max_scans = max;
+    }
+
+    rp->scans[rp->nr_scans++] = entry;
+    return 0;
+}
+
+/* slide reads the status before the scan to decide whether to scan, and after it to decide how much */
+static void add_pid_status(struct replay_pid *rp, const struct record_pid_status *rec)
+{
+    struct pid_status status;
+
+    status.vm_rss = rec->vm_rss;
+    status.vm_swap = rec->vm_swap;
+    status.rss_anon = rec->rss_anon;
+    status.rss_file = rec->rss_file;
+
+    rp->latest = status;
+    rp->has_latest = true;
+    if (!rp->open || rp->status_after_scan) {
+        return;
+    }
+
+    rp->status = status;
+    rp->has_status = true;
+    rp->status_after_scan = rp->nr_scans > 0;
+}
+
+static void set_latest_meminfo(const struct record_meminfo *rec)
+{
+    g_latest_meminfo.mem_total = rec->mem_total;
+    g_latest_meminfo.mem_free = rec->mem_free;
+    g_latest_meminfo.mem_available = rec->mem_available;
+    g_latest_meminfo.cached = rec->cached;
+    g_latest_meminfo.swap_cached = rec->swap_cached;
+    g_latest_meminfo.swap_total = rec->swap_total;
+    g_latest_meminfo.swap_free = rec->swap_free;
+    g_latest_meminfo.seq = 0;
+    g_has_latest_meminfo = true;
+}
+
+static int replay_config_data(unsigned int cmd, const char *data, size_t len)
+{
+    GKeyFile *config = NULL;
+    enum opt_result ret;
+
+    config = g_key_file_new();
+    if (config == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "get empty config file fail\n");
+        return -1;
+    }
+
+    if (g_key_file_load_from_data(config, data, (gsize)len, G_KEY_FILE_NONE, NULL) == FALSE) {
+        etmemd_log(ETMEMD_LOG_ERR, "load config recorded fail\n");
+        g_key_file_free(config);
+        return -1;
+    }
+
+    ret = etmemd_obj_cmd(config, (enum cmd_type)cmd);
+    g_key_file_free(config);
+    if (ret != OPT_SUCCESS) {
+        etmemd_log(ETMEMD_LOG_WARN, "config recorded fails to replay: %d\n", ret);
+    }
+
+    return 0;
+}
+
+static int replay_config_file(const char *file)
+{
+    gchar *data = NULL;
+    gsize len = 0;
+    int ret;
+
+    if (g_file_get_contents(file, &data, &len, NULL) == FALSE) {
+        etmemd_log(ETMEMD_LOG_ERR, "read replay config %s fail\n", file);
+        return -1;
+    }
+
+    ret = replay_config_data(OBJ_ADD, data, (size_t)len);
+    g_free(data);
+    return ret;
+}
+
+static int replay_entry(const struct record_entry *entry, const void *payload)
+{
+    const struct record_config *config = NULL;
+    struct replay_pid *rp = NULL;
+
+    switch (entry->type) {
+        case RECORD_CONFIG:
+            if (g_replay_config != NULL) {
+                return 0;
+            }
+            config = (const struct record_config *)payload;
+            return replay_config_data(config->cmd, config->data, entry->len - sizeof(struct record_config));
+        case RECORD_MEMINFO:
+            set_latest_meminfo((const struct record_meminfo *)payload);
+            return 0;
+        default:
+            break;
+    }
+
+    rp = get_replay_pid(entry->pid);
+    if (rp == NULL) {
+        return -1;
+    }
+
+    switch (entry->type) {
+        case RECORD_VMAS:
+            return open_cycle(rp, (const struct record_vmas *)payload);
+        case RECORD_SCAN:
+            return add_scan(rp, entry);
+        case RECORD_PID_STATUS:
+            add_pid_status(rp, (const struct record_pid_status *)payload);
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+static void free_replay_pids(void)
+{
+    struct replay_pid *rp = NULL;
+
+    while (!SLIST_EMPTY(&g_replay_pids)) {
+        rp = SLIST_FIRST(&g_replay_pids);
+        SLIST_REMOVE_HEAD(&g_replay_pids, entry);
+        free(rp->scans);
+        free(rp);
+    }
+}
+
+static void report_summary(uint64_t total_ns)
+{
+    printf("replay: %lu cycles, %lu decisions, %lu skipped, %lu pages, %lu cold pages (%lu KB)\n",
+           g_replay_stat.cycles, g_replay_stat.decisions, g_replay_stat.skipped, g_replay_stat.pages,
+           g_replay_stat.cold_pages, (unsigned long)BYTE_TO_KB(g_replay_stat.cold_bytes));
+    printf("replay: read %lu ms, parse %lu ms, policy %lu ms, total %lu ms\n",
+           (unsigned long)(g_replay_stat.read_ns / NSEC_PER_USEC / USEC_PER_MSEC),
+           (unsigned long)(g_replay_stat.parse_ns / NSEC_PER_USEC / USEC_PER_MSEC),
+           (unsigned long)(g_replay_stat.policy_ns / NSEC_PER_USEC / USEC_PER_MSEC),
+           (unsigned long)(total_ns / NSEC_PER_USEC / USEC_PER_MSEC));
+}
+
+int etmemd_replay(void)
+{
+    struct record_reader reader = {0};
+    const struct record_entry *entry = NULL;
+    const void *payload = NULL;
+    struct replay_pid *rp = NULL;
+    uint64_t start, read_start;
+    int ret;
+
+    if (g_replay_file == NULL) {
+        return -1;
+    }
+
+    start = replay_now_ns();
+    if (etmemd_record_open(g_replay_file, &reader) != 0) {
+        etmemd_replay_clear();
+        return -1;
+    }
+
+    g_replay_running = true;
+    if (g_replay_config != NULL && replay_config_file(g_replay_config) != 0) {
+        ret = -1;
+        goto out;
+    }
+
+    /* the time not taken by parse and policy is taken by the read of the record */
+    read_start = replay_now_ns();
+    while ((ret = etmemd_record_next(&reader, &entry, &payload)) > 0) {
+        if (replay_entry(entry, payload) != 0) {
+            ret = -1;
+            break;
+        }
+    }
+
+    SLIST_FOREACH(rp, &g_replay_pids, entry) {
+        if (ret == 0 && close_cycle(rp) != 0) {
+            ret = -1;
+        }
+    }
+    g_replay_stat.read_ns = replay_now_ns() - read_start - g_replay_stat.parse_ns - g_replay_stat.policy_ns;
+    report_summary(replay_now_ns() - start);
+
+out:
+    g_replay_running = false;
+    etmemd_stop_all_projects();
+    free_replay_pids();
+    etmemd_record_close(&reader);
+    etmemd_replay_clear();
+    return ret;
+}
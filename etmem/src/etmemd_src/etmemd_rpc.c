@@ -28,6 +28,8 @@
 #include "etmemd_common.h"
 #include "etmemd_log.h"
 #include "etmemd_file.h"
+#include "etmemd_record.h"
+#include "etmemd_trace.h"
 
 /* the max length of sun_path in struct sockaddr_un is 108 */
 #define RPC_ADDR_LEN_MAX  108
@@ -165,6 +167,28 @@ static enum opt_result do_obj_remove(GKeyFile *config)
     return do_obj_cmd(config, obj_remove_items, ARRAY_SIZE(obj_remove_items), false);
 }
 
+enum opt_result etmemd_obj_cmd(GKeyFile *config, enum cmd_type type)
+{
+    gchar *data = NULL;
+    gsize len = 0;
+
+    /* the replay of the record builds the same objects from it */
+    if (etmemd_record_set()) {
+        data = g_key_file_to_data(config, &len, NULL);
+        etmemd_record_config((unsigned int)type, data, (size_t)len);
+        g_free(data);
+    }
+
+    switch (type) {
+        case OBJ_ADD:
+            return do_obj_add(config);
+        case OBJ_DEL:
+            return do_obj_remove(config);
+        default:
+            return OPT_INVAL;
+    }
+}
+
 static enum opt_result handle_obj_cmd(char *file_name, enum cmd_type type)
 {
     GKeyFile *config = NULL;
@@ -205,16 +229,7 @@ static enum opt_result handle_obj_cmd(char *file_name, enum cmd_type type)
         goto free_file;
     }
 
-    switch (type) {
-        case OBJ_ADD:
-            ret = do_obj_add(config);
-            break;
-        case OBJ_DEL:
-            ret = do_obj_remove(config);
-            break;
-        default:
-            ret = OPT_INVAL;
-    }
+    ret = etmemd_obj_cmd(config, type);
 
 free_file:
     g_key_file_free(config);
@@ -243,6 +258,14 @@ static enum opt_result etmemd_switch_cmd(const struct server_rpc_params svr_para
             ret = etmemd_project_mgt_engine(svr_param.proj_name, svr_param.eng_name,
                                             svr_param.eng_cmd, svr_param.task_name, svr_param.sock_fd);
             return ret;
+        case TRACE_START:
+            etmemd_trace_start();
+            return OPT_SUCCESS;
+        case TRACE_STOP:
+            etmemd_trace_stop();
+            return OPT_SUCCESS;
+        case TRACE_DUMP:
+            return etmemd_trace_dump(svr_param.sock_fd) == 0 ? OPT_SUCCESS : OPT_INTER_ERR;
         default:
             etmemd_log(ETMEMD_LOG_ERR, "Invalid command.\n");
             return ret;
@@ -16,15 +16,22 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <limits.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <glib.h>
 
 #include "etmemd.h"
 #include "etmemd_scan.h"
+#include "etmemd_page_idle.h"
+#include "etmemd_damon_scan.h"
 #include "etmemd_project.h"
 #include "etmemd_engine.h"
 #include "etmemd_common.h"
 #include "etmemd_slide.h"
+#include "etmemd_hotness.h"
+#include "etmemd_record.h"
+#include "etmemd_trace.h"
 #include "etmemd_log.h"
 #include "securec.h"
 
@@ -32,6 +39,8 @@
 #define PMD_IDLE_PTES_PARAMETER 512
 #define VMFLAG_MAX_NUM 30
 #define VMFLAG_VALID_LEN 2
+#define PAGEMAP_SCAN_VEC_LEN 512
+#define CLEAR_SOFT_DIRTY "4"
 
 static bool g_exp_scan_inited = false;
 
@@ -397,6 +406,9 @@ struct vmas *get_vmas_with_flags(const char *pid, char *vmflags_array[], int vmf
     }
 
     fclose(fp);
+    if (ret_vmas != NULL) {
+        etmemd_record_vmas(pid, ret_vmas);
+    }
     return ret_vmas;
 }
 
@@ -494,10 +506,10 @@ static struct page_refs *alloc_page_refs_node(u_int64_t addr, int weight, enum p
     return pf;
 }
 
-static struct page_refs **update_page_refs(u_int64_t addr,
-                                           int weight,
-                                           enum page_type type,
-                                           struct page_refs **page_refs)
+struct page_refs **update_page_refs(u_int64_t addr,
+                                    int weight,
+                                    enum page_type type,
+                                    struct page_refs **page_refs)
 {
     struct page_refs *tmp_pf = NULL;
 
@@ -654,13 +666,18 @@ struct page_refs **walk_vmas(int fd,
         return NULL;
     }
 
+    etmemd_trace_begin(TRACE_READ_IDLE, walk_address->pid);
     recv_size = read(fd, buf, size);
+    etmemd_trace_end(TRACE_READ_IDLE, walk_address->pid);
     if (recv_size <= 0) {
         free(buf);
         return pf;
     }
+    etmemd_record_scan(walk_address->pid, walk_address->walk_start, buf, (size_t)recv_size);
 
+    etmemd_trace_begin(TRACE_PARSE, walk_address->pid);
     pf = parse_vma_result(buf, (u_int64_t)recv_size, pf, &(walk_address->last_walk_end), use_rss);
+    etmemd_trace_end(TRACE_PARSE, walk_address->pid);
 
     free(buf);
     return pf;
@@ -680,7 +697,12 @@ int get_page_refs(const struct vmas *vmas, const char *pid, struct page_refs **p
     int fd = -1;
     struct vma *vma = vmas->vma_list;
     struct page_refs **tmp_page_refs = NULL;
-    struct walk_address walk_address = {0, 0, 0};
+    struct walk_address walk_address = {0, 0, 0, 0};
+
+    if (get_unsigned_int_value(pid, &walk_address.pid) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "invalid pid %s\n", pid);
+        return -1;
+    }
 
     scan_fp = etmemd_get_proc_file(pid, IDLE_SCAN_FILE, "r");
     if (scan_fp == NULL) {
@@ -730,6 +752,186 @@ int get_page_refs(const struct vmas *vmas, const char *pid, struct page_refs **p
     return 0;
 }
 
+int etmemd_parse_scan_buf(const unsigned char *buf, size_t size, struct page_refs ***pos)
+{
+    u_int64_t end;
+
+    *pos = parse_vma_result(buf, (u_int64_t)size, *pos, &end, NULL);
+    return *pos == NULL ? -1 : 0;
+}
+
+bool pagemap_scan_supported(void)
+{
+    long pagesize = sysconf(_SC_PAGESIZE);
+    struct page_region region = {0};
+    struct pm_scan_arg arg = {
+        .size = sizeof(struct pm_scan_arg),
+        .vec = (u_int64_t)(uintptr_t)&region,
+        .vec_len = 1,
+        .category_mask = PAGE_IS_PRESENT,
+        .return_mask = PAGEMAP_SCAN_RETURN_MASK,
+    };
+    char root_path[PATH_MAX] = {0};
+    const char *path = NULL;
+    char *page = NULL;
+    long ret = -1;
+    int fd;
+
+    path = etmemd_root_path(PROC_PATH "self" PAGEMAP_FILE, root_path, sizeof(root_path));
+    fd = path == NULL ? -1 : open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    /* a new written page must be seen soft dirty, or the kernel has no CONFIG_MEM_SOFT_DIRTY */
+    page = (char *)mmap(NULL, pagesize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (page != MAP_FAILED) {
+        page[0] = 1;
+        arg.start = (u_int64_t)(uintptr_t)page;
+        arg.end = arg.start + pagesize;
+        ret = ioctl(fd, PAGEMAP_SCAN, &arg);
+        munmap(page, pagesize);
+    }
+
+    close(fd);
+    return ret == 1 && (region.categories & PAGE_IS_SOFT_DIRTY) != 0;
+}
+
+static struct page_refs **record_scan_range(u_int64_t start, u_int64_t end, enum page_idle_type type,
+                                            struct page_refs **pf, unsigned long *use_rss)
+{
+    enum page_type page_size_type = g_page_type_by_idle_kind[type];
+    u_int64_t page_size = (u_int64_t)page_type_to_size(page_size_type);
+    int nr = (int)((end - start) / page_size);
+
+    if (nr == 0) {
+        return pf;
+    }
+
+    if (use_rss != NULL) {
+        *use_rss += (unsigned long)get_process_use_rss(nr, type);
+    }
+
+    return record_parse_result(start, type, nr, pf);
+}
+
+/* split the region into pmd pages if it is huge, and the ptes around them */
+static struct page_refs **record_scan_region(const struct page_region *region,
+                                             struct page_refs **pf, unsigned long *use_rss)
+{
+    bool written = (region->categories & PAGE_IS_SOFT_DIRTY) != 0;
+    u_int64_t pmd_size = (u_int64_t)page_type_to_size(PMD_TYPE);
+    u_int64_t pmd_start = (region->start + pmd_size - 1) & ~(pmd_size - 1);
+    u_int64_t pmd_end = region->end & ~(pmd_size - 1);
+    enum page_idle_type pte_type = written ? PTE_DIRTY : PTE_IDLE;
+    enum page_idle_type pmd_type = written ? PMD_DIRTY : PMD_IDLE;
+
+    if ((region->categories & PAGE_IS_HUGE) == 0 || pmd_start >= pmd_end) {
+        return record_scan_range(region->start, region->end, pte_type, pf, use_rss);
+    }
+
+    pf = record_scan_range(region->start, pmd_start, pte_type, pf, use_rss);
+    if (pf != NULL) {
+        pf = record_scan_range(pmd_start, pmd_end, pmd_type, pf, use_rss);
+    }
+    if (pf != NULL) {
+        pf = record_scan_range(pmd_end, region->end, pte_type, pf, use_rss);
+    }
+
+    return pf;
+}
+
+static struct page_refs **pagemap_scan_vma(int fd, const struct vma *vma, struct page_region *vec,
+                                           struct page_refs **pf, unsigned long *use_rss)
+{
+    struct pm_scan_arg arg = {
+        .size = sizeof(struct pm_scan_arg),
+        .start = vma->start,
+        .end = vma->end,
+        .vec = (u_int64_t)(uintptr_t)vec,
+        .vec_len = PAGEMAP_SCAN_VEC_LEN,
+        .category_mask = PAGE_IS_PRESENT,
+        .return_mask = PAGEMAP_SCAN_RETURN_MASK,
+    };
+    long nr;
+    long i;
+
+    while (arg.start < arg.end) {
+        nr = ioctl(fd, PAGEMAP_SCAN, &arg);
+        if (nr < 0) {
+            etmemd_log(ETMEMD_LOG_ERR, "PAGEMAP_SCAN %lx - %lx fail, errno %d\n", arg.start, arg.end, errno);
+            return NULL;
+        }
+
+        /* the zero page is present but there is nothing to swap */
+        for (i = 0; i < nr && pf != NULL; i++) {
+            if ((vec[i].categories & PAGE_IS_PFNZERO) == 0) {
+                pf = record_scan_region(&vec[i], pf, use_rss);
+            }
+        }
+        if (pf == NULL || arg.walk_end <= arg.start) {
+            break;
+        }
+        arg.start = arg.walk_end;
+    }
+
+    return pf;
+}
+
+/*
+ * scan the vmas by PAGEMAP_SCAN ioctl of pagemap, one call returns the present pages of a
+ * vma chunk as regions, which are written since last scan if soft dirty is set.
+ * */
+int get_page_refs_by_pagemap_scan(const struct vmas *vmas, const char *pid, struct page_refs **page_refs,
+                                  unsigned long *use_rss)
+{
+    struct page_region *vec = NULL;
+    struct page_refs **tmp_page_refs = page_refs;
+    struct vma *vma = NULL;
+    FILE *scan_fp = NULL;
+    FILE *clear_fp = NULL;
+    int ret = 0;
+
+    scan_fp = etmemd_get_proc_file(pid, PAGEMAP_FILE, "r");
+    if (scan_fp == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "open %s file fail\n", PAGEMAP_FILE);
+        return -1;
+    }
+
+    vec = (struct page_region *)calloc(PAGEMAP_SCAN_VEC_LEN, sizeof(struct page_region));
+    if (vec == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for pagemap scan regions fail\n");
+        fclose(scan_fp);
+        return -1;
+    }
+
+    for (vma = vmas->vma_list; vma != NULL; vma = vma->next) {
+        tmp_page_refs = pagemap_scan_vma(fileno(scan_fp), vma, vec, tmp_page_refs, use_rss);
+        if (tmp_page_refs == NULL) {
+            etmemd_log(ETMEMD_LOG_ERR, "pagemap scan for pid %s fail\n", pid);
+            ret = -1;
+            goto out;
+        }
+    }
+
+    /* restart the write tracking for next scan */
+    clear_fp = etmemd_get_proc_file(pid, CLEAR_REFS_FILE, "w");
+    if (clear_fp == NULL) {
+        ret = -1;
+        goto out;
+    }
+    if (fputs(CLEAR_SOFT_DIRTY, clear_fp) == EOF) {
+        etmemd_log(ETMEMD_LOG_ERR, "clear soft dirty for pid %s fail\n", pid);
+        ret = -1;
+    }
+    fclose(clear_fp);
+
+out:
+    free(vec);
+    fclose(scan_fp);
+    return ret;
+}
+
 int etmemd_get_page_refs(const struct vmas *vmas, const char *pid, struct page_refs **page_refs, int flags)
 {
     struct ioctl_para ioctl_para;
@@ -760,14 +962,68 @@ void etmemd_free_page_refs(struct page_refs *pf)
     }
 }
 
+enum scan_backend etmemd_resolve_scan_backend(enum scan_backend backend)
+{
+    char root_path[PATH_MAX] = {0};
+    const char *path = NULL;
+    FILE *fp = NULL;
+
+    if (backend == SCAN_BACKEND_PAGEMAP_SCAN && !pagemap_scan_supported()) {
+        etmemd_log(ETMEMD_LOG_WARN, "PAGEMAP_SCAN is not supported, fall back to idle_pages\n");
+        return SCAN_BACKEND_IDLE_PAGES;
+    }
+
+    if (backend == SCAN_BACKEND_DAMON && !damon_scan_supported()) {
+        etmemd_log(ETMEMD_LOG_WARN, "DAMON is not supported, fall back to idle_pages\n");
+        return SCAN_BACKEND_IDLE_PAGES;
+    }
+
+    if (backend != SCAN_BACKEND_AUTO) {
+        return backend;
+    }
+
+    /* idle_pages can only be opened when etmem_scan.ko is loaded */
+    path = etmemd_root_path(PROC_PATH "self" IDLE_SCAN_FILE, root_path, sizeof(root_path));
+    fp = path == NULL ? NULL : fopen(path, "r");
+    if (fp != NULL) {
+        fclose(fp);
+        return SCAN_BACKEND_IDLE_PAGES;
+    }
+
+    /* pagemap_scan is never chosen, as it sees the pages only read as idle */
+    if (page_idle_supported()) {
+        return SCAN_BACKEND_PAGE_IDLE;
+    }
+
+    return SCAN_BACKEND_IDLE_PAGES;
+}
+
+int etmemd_get_page_refs_by_backend(enum scan_backend backend, const struct page_scan *page_scan,
+                                    const struct vmas *vmas, const char *pid, struct page_refs **page_refs,
+                                    unsigned long *use_rss, struct ioctl_para *ioctl_para)
+{
+    switch (backend) {
+        case SCAN_BACKEND_PAGE_IDLE:
+            return get_page_refs_by_page_idle(vmas, pid, page_refs, use_rss);
+        case SCAN_BACKEND_PAGEMAP_SCAN:
+            return get_page_refs_by_pagemap_scan(vmas, pid, page_refs, use_rss);
+        case SCAN_BACKEND_DAMON:
+            return get_page_refs_by_damon(vmas, pid, &page_scan->damon, page_refs, use_rss);
+        default:
+            return get_page_refs(vmas, pid, page_refs, use_rss, ioctl_para);
+    }
+}
+
 struct page_refs *etmemd_do_scan(const struct task_pid *tpid, const struct task *tk)
 {
     int i;
+    int loop;
     struct vmas *vmas = NULL;
     struct page_refs *page_refs = NULL;
     int ret;
     char pid[PID_STR_MAX_LEN] = {0};
     struct ioctl_para ioctl_para = {0};
+    enum scan_backend backend;
 
     if (tk == NULL) {
         etmemd_log(ETMEMD_LOG_ERR, "task struct is null for pid %u\n", tpid->pid);
@@ -782,7 +1038,9 @@ struct page_refs *etmemd_do_scan(const struct task_pid *tpid, const struct task
     }
 
     /* get vmas of target pid first. */
+    etmemd_trace_begin(TRACE_GET_VMAS, tpid->pid);
     vmas = get_vmas(pid);
+    etmemd_trace_end(TRACE_GET_VMAS, tpid->pid);
     if (vmas == NULL) {
         etmemd_log(ETMEMD_LOG_ERR, "get vmas for %s fail\n", pid);
         return NULL;
@@ -792,10 +1050,14 @@ struct page_refs *etmemd_do_scan(const struct task_pid *tpid, const struct task
     if (tk->swap_flag != 0) {
         ioctl_para.ioctl_parameter = VMA_SCAN_FLAG;
     }
+    backend = etmemd_resolve_scan_backend(page_scan->backend);
+
+    /* a pid with the hotness left by the last etmemd scans once, and takes the rest from it */
+    loop = etmemd_hotness_scan_loops(tpid->pid, vmas, page_scan->loop);
 
     /* loop for scanning idle_pages to get result of memory access. */
-    for (i = 0; i < page_scan->loop; i++) {
-        ret = get_page_refs(vmas, pid, &page_refs, NULL, &ioctl_para);
+    for (i = 0; i < loop; i++) {
+        ret = etmemd_get_page_refs_by_backend(backend, page_scan, vmas, pid, &page_refs, NULL, &ioctl_para);
         if (ret != 0) {
             etmemd_log(ETMEMD_LOG_ERR, "scan operation failed\n");
             /* free page_refs nodes already exist */
@@ -803,7 +1065,13 @@ struct page_refs *etmemd_do_scan(const struct task_pid *tpid, const struct task
             page_refs = NULL;
             break;
         }
+        etmemd_trace_begin(TRACE_SCAN_SLEEP, tpid->pid);
         sleep((unsigned)page_scan->sleep);
+        etmemd_trace_end(TRACE_SCAN_SLEEP, tpid->pid);
+    }
+
+    if (page_refs != NULL) {
+        etmemd_hotness_update(tpid->pid, vmas, page_refs, loop, page_scan->loop);
     }
 
     free_vmas(vmas);
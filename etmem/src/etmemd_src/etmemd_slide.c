@@ -25,9 +25,14 @@
 #include "etmemd_engine.h"
 #include "etmemd_slide.h"
 #include "etmemd_scan.h"
+#include "etmemd_damon_scan.h"
 #include "etmemd_migrate.h"
+#include "etmemd_trace.h"
 #include "etmemd_pool_adapter.h"
 #include "etmemd_file.h"
+#include "etmemd_meminfo.h"
+#include "etmemd_arbiter.h"
+#include "etmemd_cgroup.h"
 
 static struct memory_grade *slide_policy_interface(struct page_sort **page_sort, const struct task_pid *tpid)
 {
@@ -87,10 +92,11 @@ count_out:
     return memory_grade;
 }
 
-static int slide_do_migrate(unsigned int pid, const struct memory_grade *memory_grade)
+static int slide_do_migrate(const struct task_pid *tk_pid, const struct memory_grade *memory_grade)
 {
     int ret;
     char pid_str[PID_STR_MAX_LEN] = {0};
+    unsigned int pid = tk_pid->pid;
 
     if (memory_grade == NULL) {
         etmemd_log(ETMEMD_LOG_ERR, "memory grade for slide should not be NULL for pid %u\n", pid);
@@ -103,95 +109,185 @@ static int slide_do_migrate(unsigned int pid, const struct memory_grade *memory_
     }
 
     /* we swap the cold pages for temporary, and do other operations later */
-    ret = etmemd_grade_migrate(pid_str, memory_grade);
+    ret = etmemd_grade_evict(pid_str, tk_pid->pidfd, memory_grade, tk_pid->tk->eng->proj);
     return ret;
 }
 
+/*
+ * A cgroup task is short of memory as well when it gets close to the limit of the cgroup.
+ * Return the bytes to free to get back to threshold percent of the limit, 0 if none.
+ * */
+static unsigned long get_cgroup_deficit(struct cgroup_watch *cg, int threshold)
+{
+    struct cgroup_mem mem;
+    unsigned long free_mem, target;
+
+    if (cg == NULL || threshold <= 0 || etmemd_cgroup_get_mem(cg, &mem) != 0 || mem.max == 0) {
+        return 0;
+    }
+
+    free_mem = mem.max > mem.current ? mem.max - mem.current : 0;
+    target = mem.max / 100 * (unsigned long)threshold;
+    return target > free_mem ? KB_TO_BYTE(target - free_mem) : 0;
+}
+
 static int check_sysmem_lower_threshold(struct task_pid *tk_pid)
 {
-    unsigned long mem_total;
-    unsigned long mem_free;
+    struct meminfo info;
+    int threshold = tk_pid->tk->eng->proj->sysmem_threshold;
     int vm_cmp;
-    int ret;
 
-    ret = get_mem_from_proc_file(NULL, PROC_MEMINFO, &mem_total, "MemTotal");
-    if (ret != 0) {
-        etmemd_log(ETMEMD_LOG_ERR, "get memtotal fail\n");
+    if (etmemd_get_meminfo(&info) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "get meminfo fail\n");
         return DONT_SWAP;
     }
 
-    ret = get_mem_from_proc_file(NULL, PROC_MEMINFO, &mem_free, "MemFree");
-    if (ret != 0) {
-        etmemd_log(ETMEMD_LOG_ERR, "get memfree fail\n");
-        return DONT_SWAP;
+    /* Calculate the free memory percentage in 0 - 100 */
+    vm_cmp = (info.mem_free * 100) / info.mem_total;
+    if (vm_cmp < threshold) {
+        return DO_SWAP;
     }
 
-    /* Calculate the free memory percentage in 0 - 100 */
-    vm_cmp = (mem_free * 100) / mem_total;
-    if (vm_cmp < tk_pid->tk->eng->proj->sysmem_threshold) {
+    if (get_cgroup_deficit(tk_pid->tk->cgroup, threshold) != 0) {
         return DO_SWAP;
     }
 
     return DONT_SWAP;
 }
 
-static int check_pid_should_swap(const char *pid, unsigned long vmrss, const struct task_pid *tk_pid)
+static int check_pid_should_swap(const struct pid_status *status, const struct task_pid *tk_pid)
 {
-    unsigned long vmswap;
     unsigned long vmcmp;
-    int ret;
-
-    ret = get_mem_from_proc_file(pid, STATUS_FILE, &vmswap, "VmSwap");
-    if (ret != 0) {
-        etmemd_log(ETMEMD_LOG_ERR, "get VmSwap fail\n");
-        return DONT_SWAP;
-    }
 
     /* Calculate the total amount of memory that can be swappout for the current process
      * and check whether the memory is larger than the current swapout amount.
      * If true, continue swap-out; otherwise, abort the swap-out process. */
-    vmcmp = (vmrss + vmswap) / 100 * tk_pid->tk->eng->proj->sysmem_threshold;
-    if (vmcmp > vmswap) {
+    vmcmp = (status->vm_rss + status->vm_swap) / 100 * tk_pid->tk->eng->proj->sysmem_threshold;
+    if (vmcmp > status->vm_swap) {
         return DO_SWAP;
     }
 
     return DONT_SWAP;
 }
 
-static int check_pidmem_lower_threshold(struct task_pid *tk_pid)
+/* the memory of a cgroup task is what its cgroup charged, instead of the pid itself */
+static int get_task_pid_status(const struct task_pid *tk_pid, struct pid_status *status)
 {
-    struct slide_params *params = NULL;
-    unsigned long vmrss;
-    int ret;
     char pid_str[PID_STR_MAX_LEN] = {0};
+    struct cgroup_mem mem;
 
-    params = (struct slide_params *)tk_pid->tk->params;
-    if (params == NULL) {
-        return DONT_SWAP;
+    if (tk_pid->tk->cgroup != NULL) {
+        if (etmemd_cgroup_get_mem(tk_pid->tk->cgroup, &mem) != 0) {
+            etmemd_log(ETMEMD_LOG_ERR, "get memory of cgroup %s fail\n", tk_pid->tk->value);
+            return -1;
+        }
+        status->rss_anon = mem.anon;
+        status->rss_file = mem.file_mapped;
+        status->vm_rss = mem.anon + mem.file_mapped;
+        status->vm_swap = mem.swap;
+        return 0;
     }
 
     if (snprintf_s(pid_str, PID_STR_MAX_LEN, PID_STR_MAX_LEN - 1, "%u", tk_pid->pid) <= 0) {
         etmemd_log(ETMEMD_LOG_ERR, "snprintf pid fail %u", tk_pid->pid);
+        return -1;
+    }
+
+    if (etmemd_read_pid_status(pid_str, status) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "get status of pid %s fail\n", pid_str);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int check_pidmem_lower_threshold(struct task_pid *tk_pid)
+{
+    struct slide_params *params = NULL;
+    struct pid_status status;
+
+    params = (struct slide_params *)tk_pid->tk->params;
+    if (params == NULL) {
         return DONT_SWAP;
     }
 
-    ret = get_mem_from_proc_file(pid_str, STATUS_FILE, &vmrss, "VmRSS");
-    if (ret != 0) {
-        etmemd_log(ETMEMD_LOG_ERR, "get VmRSS fail\n");
+    if (get_task_pid_status(tk_pid, &status) != 0) {
         return DONT_SWAP;
     }
 
     if (params->swap_threshold == 0) {
-        return check_pid_should_swap(pid_str, vmrss, tk_pid);
+        return check_pid_should_swap(&status, tk_pid);
     }
 
-    if (vmrss > params->swap_threshold) {
+    if (status.vm_rss > params->swap_threshold) {
         return DO_SWAP;
     }
 
     return DONT_SWAP;
 }
 
+/*
+ * Every project would evict all of its cold pages once the host is short of free memory.
+ * Report them to the arbiter and keep those beyond the budget it gives, so the host gets
+ * back to sysmem_threshold by the coldest pages of all projects. A cgroup task short of
+ * memory below its own limit evicts at least the deficit of the cgroup, which the host
+ * does not see.
+ * */
+static void slide_arbitrate(const struct task_pid *tk_pid, struct memory_grade *memory_grade)
+{
+    struct project *proj = tk_pid->tk->eng->proj;
+    struct page_scan *page_scan = (struct page_scan *)proj->scan_param;
+    struct page_refs *ranked[ARB_RANK_NR] = {NULL};
+    unsigned long bytes[ARB_RANK_NR] = {0};
+    struct page_refs *page_refs = NULL;
+    unsigned long total = 0;
+    unsigned long budget, size, cg_deficit;
+    int max_count = page_scan->loop * WRITE_TYPE_WEIGHT;
+    int rank, ttl;
+
+    if (proj->sysmem_threshold == -1 || memory_grade->cold_pages == NULL) {
+        return;
+    }
+
+    for (page_refs = memory_grade->cold_pages; page_refs != NULL; page_refs = page_refs->next) {
+        size = (unsigned long)page_type_to_size(page_refs->type);
+        bytes[etmemd_arb_rank(page_refs->count, max_count, proj->priority)] += size;
+        total += size;
+    }
+
+    /* the report is kept for two cycles of the task */
+    ttl = 2 * (page_scan->interval + page_scan->loop * page_scan->sleep);
+    budget = etmemd_arb_budget(proj, tk_pid->pid, bytes, ttl);
+    cg_deficit = get_cgroup_deficit(tk_pid->tk->cgroup, proj->sysmem_threshold);
+    if (budget < cg_deficit) {
+        budget = cg_deficit;
+    }
+    if (budget >= total) {
+        return;
+    }
+
+    /* no cancellation point below, the pages are always back to memory_grade */
+    page_refs = memory_grade->cold_pages;
+    memory_grade->cold_pages = NULL;
+    while (page_refs != NULL) {
+        rank = etmemd_arb_rank(page_refs->count, max_count, proj->priority);
+        page_refs = add_page_refs_into_memory_grade(page_refs, &ranked[rank]);
+    }
+
+    for (rank = 0; rank < ARB_RANK_NR; rank++) {
+        page_refs = ranked[rank];
+        while (page_refs != NULL) {
+            if (budget == 0) {
+                page_refs = add_page_refs_into_memory_grade(page_refs, &memory_grade->hot_pages);
+                continue;
+            }
+            size = (unsigned long)page_type_to_size(page_refs->type);
+            budget = budget > size ? budget - size : 0;
+            page_refs = add_page_refs_into_memory_grade(page_refs, &memory_grade->cold_pages);
+        }
+    }
+}
+
 static int check_should_swap(struct task_pid *tk_pid)
 {
     if (tk_pid->tk->eng->proj->sysmem_threshold == -1) {
@@ -211,8 +307,17 @@ static void *slide_executor(void *arg)
     struct page_refs *page_refs = NULL;
     struct memory_grade *memory_grade = NULL;
     struct page_sort *page_sort = NULL;
+    int should_swap;
 
-    if (check_should_swap(tk_pid) == DONT_SWAP) {
+    /* the process may exit since the pids of the task are got */
+    if (!etmemd_task_pid_alive(tk_pid)) {
+        return NULL;
+    }
+
+    etmemd_trace_begin(TRACE_CHECK_SWAP, tk_pid->pid);
+    should_swap = check_should_swap(tk_pid);
+    etmemd_trace_end(TRACE_CHECK_SWAP, tk_pid->pid);
+    if (should_swap == DONT_SWAP) {
         return NULL;
     }
 
@@ -222,19 +327,25 @@ static void *slide_executor(void *arg)
     pthread_cleanup_push(clean_page_refs_unexpected, &page_refs);
     pthread_cleanup_push(clean_page_sort_unexpected, &page_sort);
 
+    etmemd_trace_begin(TRACE_SCAN, tk_pid->pid);
     page_refs = etmemd_do_scan(tk_pid, tk_pid->tk);
+    etmemd_trace_end(TRACE_SCAN, tk_pid->pid);
     if (page_refs == NULL) {
         etmemd_log(ETMEMD_LOG_WARN, "pid %u cannot get page refs\n", tk_pid->pid);
         goto scan_out;
     }
 
+    etmemd_trace_begin(TRACE_SORT, tk_pid->pid);
     page_sort = sort_page_refs(&page_refs, tk_pid);
+    etmemd_trace_end(TRACE_SORT, tk_pid->pid);
     if (page_sort == NULL) {
         etmemd_log(ETMEMD_LOG_ERR, "failed to alloc memory for page sort.", tk_pid->pid);
         goto scan_out;
     }
 
+    etmemd_trace_begin(TRACE_POLICY, tk_pid->pid);
     memory_grade = slide_policy_interface(&page_sort, tk_pid);
+    etmemd_trace_end(TRACE_POLICY, tk_pid->pid);
 
 scan_out:
     /* clean up page_sort linked array */
@@ -252,13 +363,24 @@ scan_out:
         goto exit;
     }
 
-    if (slide_do_migrate(tk_pid->pid, memory_grade) != 0) {
+    /* never move the pages of another process which takes the pid after scan */
+    if (!etmemd_task_pid_alive(tk_pid)) {
+        etmemd_log(ETMEMD_LOG_DEBUG, "pid %u exits after scan\n", tk_pid->pid);
+        goto exit;
+    }
+
+    slide_arbitrate(tk_pid, memory_grade);
+    etmemd_trace_begin(TRACE_EVICT, tk_pid->pid);
+    if (slide_do_migrate(tk_pid, memory_grade) != 0) {
         etmemd_log(ETMEMD_LOG_DEBUG, "slide migrate for pid %u fail\n", tk_pid->pid);
     }
+    etmemd_trace_end(TRACE_EVICT, tk_pid->pid);
 
+    etmemd_trace_begin(TRACE_RECLAIM_SWAPCACHE, tk_pid->pid);
     if (etmemd_reclaim_swapcache(tk_pid) != 0) {
         etmemd_log(ETMEMD_LOG_DEBUG, "etmemd_reclaim_swapcache pid %u fail\n", tk_pid->pid);
     }
+    etmemd_trace_end(TRACE_RECLAIM_SWAPCACHE, tk_pid->pid);
 
 exit:
     /* clean memory_grade here */
@@ -393,6 +515,36 @@ static void slide_stop_task(struct engine *eng, struct task *tk)
     params->executor = NULL;
 }
 
+/* the same decision as slide_executor on the pages replayed, which are not moved */
+static struct memory_grade *slide_replay_pages(struct task_pid *tk_pid, struct page_refs **page_refs)
+{
+    struct memory_grade *memory_grade = NULL;
+    struct page_sort *page_sort = NULL;
+
+    if (check_should_swap(tk_pid) == DONT_SWAP) {
+        return NULL;
+    }
+
+    page_sort = sort_page_refs(page_refs, tk_pid);
+    if (page_sort == NULL) {
+        return NULL;
+    }
+
+    memory_grade = slide_policy_interface(&page_sort, tk_pid);
+    clean_page_sort_unexpected(&page_sort);
+    if (memory_grade != NULL) {
+        slide_arbitrate(tk_pid, memory_grade);
+    }
+
+    return memory_grade;
+}
+
+/* the kdamond of a pid is kept until the pid leaves the task, nothing to do if it is not monitored */
+static void slide_free_pid_params(struct engine *eng, struct task_pid **tk_pid)
+{
+    damon_scan_release((*tk_pid)->pid);
+}
+
 struct engine_ops g_slide_eng_ops = {
     .fill_eng_params = NULL,
     .clear_eng_params = NULL,
@@ -401,8 +553,9 @@ struct engine_ops g_slide_eng_ops = {
     .start_task = slide_start_task,
     .stop_task = slide_stop_task,
     .alloc_pid_params = NULL,
-    .free_pid_params = NULL,
+    .free_pid_params = slide_free_pid_params,
     .eng_mgt_func = NULL,
+    .replay_pages = slide_replay_pages,
 };
 
 int fill_engine_type_slide(struct engine *eng, GKeyFile *config)
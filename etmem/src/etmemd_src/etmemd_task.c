@@ -16,11 +16,16 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <limits.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/wait.h>
 #include <sys/sysinfo.h>
+#include <sys/syscall.h>
 
 #include "securec.h"
 #include "etmemd_log.h"
@@ -28,6 +33,14 @@
 #include "etmemd_task.h"
 #include "etmemd_engine.h"
 #include "etmemd_file.h"
+#include "etmemd_cgroup.h"
+
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open         434
+#endif
+
+#define TASK_COMM_FILE          "/comm"
+#define TASK_COMM_LEN           16
 
 static int get_pid_through_pipe(char *arg_pid[], const int *pipefd)
 {
@@ -85,6 +98,9 @@ void free_task_pid_mem(struct task_pid **tk_pid)
     if (eng->ops->free_pid_params != NULL) {
         eng->ops->free_pid_params(eng, tk_pid);
     }
+    if ((*tk_pid)->pidfd >= 0) {
+        close((*tk_pid)->pidfd);
+    }
     etmemd_safe_free((void **)tk_pid);
 }
 
@@ -112,7 +128,17 @@ static struct task_pid *alloc_tkpid_node(unsigned int pid, struct task *tk)
     tk_pid->pid = pid;
     tk_pid->tk = tk;
 
+    /* the kernel before 5.3 has no pidfd, and a pid under a simulated root is not of the host,
+     * /proc/<pid> is checked instead */
+    tk_pid->pidfd = etmemd_root_set() ? -1 : (int)syscall(__NR_pidfd_open, (pid_t)pid, 0);
+    if (tk_pid->pidfd < 0) {
+        etmemd_log(ETMEMD_LOG_DEBUG, "pidfd_open for pid %u fail, error: %d\n", pid, errno);
+    }
+
     if (eng->ops->alloc_pid_params != NULL && eng->ops->alloc_pid_params(eng, &tk_pid) != 0) {
+        if (tk_pid->pidfd >= 0) {
+            close(tk_pid->pidfd);
+        }
         free(tk_pid);
         return NULL;
     }
@@ -140,7 +166,14 @@ static struct task_pid **update_task_pids(unsigned int pid, struct task_pid **cu
     }
 
     if (pid == (*current_pid)->pid) {
-        return &((*current_pid)->next);
+        if (etmemd_task_pid_alive(*current_pid)) {
+            return &((*current_pid)->next);
+        }
+        /* the pid is used by another process now, drop the state of the old one */
+        tk_tmp = *current_pid;
+        *current_pid = (*current_pid)->next;
+        free_task_pid_mem(&tk_tmp);
+        return insert_task_pids(pid, current_pid, tk);
     }
 
     if (pid > (*current_pid)->pid) {
@@ -164,7 +197,7 @@ static int fill_task_pid(struct task *tk, const char *val)
         return -1;
     }
 
-    if (tk->pids != NULL && tk->pids->pid == pid)
+    if (tk->pids != NULL && tk->pids->pid == pid && etmemd_task_pid_alive(tk->pids))
         return 0;
 
     clean_nouse_pid(&(tk->pids));
@@ -205,6 +238,100 @@ static int read_fill_child_pid_file(struct task *tk, FILE *file)
     return 0;
 }
 
+static int fill_task_cgroup_pids(struct task *tk)
+{
+    struct task_pid **current_pid = &(tk->pids);
+    unsigned int *pids = NULL;
+    int nr = 0;
+    int ret;
+    int i;
+
+    if (tk->cgroup == NULL) {
+        tk->cgroup = etmemd_cgroup_watch(tk->value);
+        if (tk->cgroup == NULL) {
+            return -1;
+        }
+    }
+
+    /* keep the pids and their params while the cgroup stays the same */
+    ret = etmemd_cgroup_get_pids(tk->cgroup, tk->pids == NULL, &pids, &nr);
+    if (ret < 0) {
+        etmemd_log(ETMEMD_LOG_DEBUG, "no pid in cgroup of task %s\n", tk->value);
+        etmemd_free_task_pids(tk);
+        return -1;
+    }
+    if (ret == 0) {
+        return 0;
+    }
+
+    for (i = 0; i < nr; i++) {
+        current_pid = update_task_pids(pids[i], current_pid, tk);
+        if (current_pid == NULL) {
+            free(pids);
+            etmemd_free_task_pids(tk);
+            return -1;
+        }
+    }
+
+    clean_nouse_pid(current_pid);
+    free(pids);
+    return 0;
+}
+
+/* a process keeps its pidfd across exec, so check it still has the name of the task */
+static bool check_task_pid_name(const char *pid, const char *name)
+{
+    char comm[TASK_COMM_LEN] = {0};
+    FILE *file = NULL;
+    bool match = false;
+
+    file = etmemd_get_proc_file(pid, TASK_COMM_FILE, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    if (fgets(comm, TASK_COMM_LEN, file) != NULL) {
+        comm[strcspn(comm, "\n")] = '\0';
+        match = strcmp(comm, name) == 0;
+    }
+
+    fclose(file);
+    return match;
+}
+
+/* pgrep looks at the processes of the host, so the lowest pid of the name is looked up under the root */
+static int get_pid_from_root_name(const char *val, char *pid)
+{
+    char root_path[PATH_MAX] = {0};
+    const char *path = etmemd_root_path(PROC_PATH, root_path, sizeof(root_path));
+    struct dirent *entry = NULL;
+    unsigned int min_pid = UINT_MAX;
+    unsigned int pid_val;
+    DIR *dir = NULL;
+
+    dir = path == NULL ? NULL : opendir(path);
+    if (dir == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "open dir %s fail\n", path == NULL ? PROC_PATH : path);
+        return -1;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (!isdigit((unsigned char)entry->d_name[0]) || get_unsigned_int_value(entry->d_name, &pid_val) != 0 ||
+            pid_val >= min_pid || !check_task_pid_name(entry->d_name, val)) {
+            continue;
+        }
+        min_pid = pid_val;
+    }
+    closedir(dir);
+
+    if (min_pid == UINT_MAX ||
+        snprintf_s(pid, PID_STR_MAX_LEN, PID_STR_MAX_LEN - 1, "%u", min_pid) <= 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
 static int get_pid_from_type_name(char *val, char *pid)
 {
     char *arg_pid[] = {"/usr/bin/pgrep", "-x", val, NULL};
@@ -212,6 +339,10 @@ static int get_pid_from_type_name(char *val, char *pid)
     int ret = -1;
     int pipefd[PIPE_FD_LEN]; /* used for pipefd[PIPE_FD_LEN] communication to obtain the task PID */
 
+    if (etmemd_root_set()) {
+        return get_pid_from_root_name(val, pid);
+    }
+
     if (pipe(pipefd) == -1) {
         return -1;
     }
@@ -276,6 +407,12 @@ static int fill_task_child_pid(struct task *tk, char *pid)
     int ret;
     int pipefd[PIPE_FD_LEN]; /* used for pipefd[PIPE_FD_LEN] communication to obtain the task PID */
 
+    /* the children under a simulated root are not known by pgrep, only the pid itself is taken */
+    if (etmemd_root_set()) {
+        etmemd_log(ETMEMD_LOG_DEBUG, "child pids of %s are not looked up under root\n", pid);
+        return 0;
+    }
+
     if (pipe(pipefd) == -1) {
         return -1;
     }
@@ -312,19 +449,64 @@ static bool check_task_pid_exists(const char *pid)
 {
     size_t file_str_size = strlen(PROC_PATH) + strlen(pid) + 1;
     char file[file_str_size];
+    char root_path[PATH_MAX] = {0};
+    const char *path = NULL;
 
     if (snprintf_s(file, file_str_size, file_str_size - 1, "%s%s", PROC_PATH, pid) == -1) {
         etmemd_log(ETMEMD_LOG_ERR, "snprintf for pid(%s) path fail\n", pid);
         return false;
     }
 
-    if (access(file, F_OK) != 0) {
+    path = etmemd_root_path(file, root_path, sizeof(root_path));
+    if (path == NULL || access(path, F_OK) != 0) {
         return false;
     }
 
     return true;
 }
 
+bool etmemd_task_pid_alive(const struct task_pid *tk_pid)
+{
+    struct pollfd fds = {.fd = tk_pid->pidfd, .events = POLLIN};
+    char pid[PID_STR_MAX_LEN] = {0};
+    int ret;
+
+    /* the pidfd gets readable once the process exits */
+    if (tk_pid->pidfd >= 0) {
+        ret = poll(&fds, 1, 0);
+        return ret == 0 || (ret < 0 && errno == EINTR);
+    }
+
+    if (snprintf_s(pid, PID_STR_MAX_LEN, PID_STR_MAX_LEN - 1, "%u", tk_pid->pid) <= 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "snprintf pid %u fail\n", tk_pid->pid);
+        return false;
+    }
+
+    return check_task_pid_exists(pid);
+}
+
+/* the target found last time is still there, no need to look for it again */
+static bool reuse_task_target(const struct task *tk, char *pid)
+{
+    if (tk->pids == NULL || !etmemd_task_pid_alive(tk->pids)) {
+        return false;
+    }
+
+    if (snprintf_s(pid, PID_STR_MAX_LEN, PID_STR_MAX_LEN - 1, "%u", tk->pids->pid) <= 0) {
+        return false;
+    }
+
+    if (strcmp(tk->type, "pid") == 0) {
+        return strcmp(tk->value, pid) == 0;
+    }
+
+    if (strcmp(tk->type, "name") == 0) {
+        return check_task_pid_name(pid, tk->value);
+    }
+
+    return false;
+}
+
 void etmemd_free_task_pids(struct task *tk)
 {
     struct task_pid *tmp_pid = NULL;
@@ -344,15 +526,24 @@ int etmemd_get_task_pids(struct task *tk, bool recursive)
 {
     char pid[PID_STR_MAX_LEN] = {0};
 
-    /* get the pid of target first */
-    if (get_pid_from_task_type(tk, pid) != 0) {
-        return -1;
+    /* all the processes in the cgroup are taken, no matter recursive or not */
+    if (strcmp(tk->type, CGROUP_TASK_TYPE) == 0) {
+        return fill_task_cgroup_pids(tk);
     }
 
-    /* check the pid of target exists or not */
-    if (!check_task_pid_exists(pid)) {
-        etmemd_log(ETMEMD_LOG_DEBUG, "pid %s of task %s %s is not alive\n", pid, tk->type, tk->value);
-        return -1;
+    /* get the pid of target first */
+    if (!reuse_task_target(tk, pid)) {
+        if (get_pid_from_task_type(tk, pid) != 0) {
+            etmemd_free_task_pids(tk);
+            return -1;
+        }
+
+        /* check the pid of target exists or not */
+        if (!check_task_pid_exists(pid)) {
+            etmemd_log(ETMEMD_LOG_DEBUG, "pid %s of task %s %s is not alive\n", pid, tk->type, tk->value);
+            etmemd_free_task_pids(tk);
+            return -1;
+        }
     }
 
     /* first, insert the pid of task into the pids list */
@@ -379,6 +570,7 @@ static void clear_task_struct(struct task *task)
     etmemd_safe_free((void **)&task->type);
     etmemd_safe_free((void **)&task->value);
     etmemd_safe_free((void **)&task->name);
+    etmemd_cgroup_unwatch(&task->cgroup);
 }
 
 void etmemd_free_task_struct(struct task **tk)
@@ -426,8 +618,8 @@ static int fill_task_type(void *obj, void *val)
 {
     struct task *tk = (struct task *)obj;
     char *type = (char *)val;
-    if (strcmp(val, "pid") != 0 && strcmp(val, "name") != 0) {
-        etmemd_log(ETMEMD_LOG_ERR, "invalid task type, must be pid or name.\n");
+    if (strcmp(val, "pid") != 0 && strcmp(val, "name") != 0 && strcmp(val, CGROUP_TASK_TYPE) != 0) {
+        etmemd_log(ETMEMD_LOG_ERR, "invalid task type, must be pid, name or cgroup.\n");
         free(val);
         return -1;
     }
@@ -447,6 +639,11 @@ static int fill_task_value(void *obj, void *val)
         return -1;
     }
 
+    if (tk->type != NULL && strcmp(tk->type, CGROUP_TASK_TYPE) == 0 && etmemd_cgroup_check_value(value) != 0) {
+        free(val);
+        return -1;
+    }
+
     tk->value = value;
     return 0;
 }
@@ -28,6 +28,23 @@ static void threadtimer_cancel_unlock(void *arg)
     pthread_mutex_unlock(tmp_mutex);
 }
 
+static void threadtimer_cancel_lock(void *arg)
+{
+    pthread_mutex_t *tmp_mutex = arg;
+    pthread_mutex_lock(tmp_mutex);
+}
+
+/* run the functor without the mutex, so that a kick does not wait for the run */
+static void thread_timer_run(timer_thread *timer)
+{
+    timer->kicked = false;
+    pthread_mutex_unlock(&timer->cond_mutex);
+    /* take the mutex back on cancel, which is released by the handler of the routine */
+    pthread_cleanup_push(threadtimer_cancel_lock, &timer->cond_mutex);
+    (*timer->functor)(timer->user_param);
+    pthread_cleanup_pop(1);
+}
+
 static void *thread_timer_routine(void *arg)
 {
     timer_thread *timer = (timer_thread *)arg;
@@ -35,27 +52,32 @@ static void *thread_timer_routine(void *arg)
     int expired_time;
     struct timespec timespec;
 
-    expired_time = timer->expired_time;
-
     pthread_cleanup_push(threadtimer_cancel_unlock, &timer->cond_mutex);
     pthread_mutex_lock(&timer->cond_mutex);
     while (!timer->down) {
+        /* kicked is checked under the mutex of the kick, a kick during the last run is not lost */
+        if (timer->kicked) {
+            thread_timer_run(timer);
+            continue;
+        }
+
         if (clock_gettime(CLOCK_MONOTONIC, &timespec) != 0) {
             etmemd_log(ETMEMD_LOG_ERR, "clock get time fail!\n");
             break;
         }
 
+        expired_time = __atomic_load_n(&timer->expired_time, __ATOMIC_SEQ_CST);
         if (timespec.tv_sec > timespec.tv_sec + expired_time) {
             etmemd_log(ETMEMD_LOG_ERR, "clock of tv_sec overflows\n");
             timer->down = false;
             break;
         }
-        timespec.tv_sec += timer->expired_time;
+        timespec.tv_sec += expired_time;
         timespec.tv_nsec = 0;
         return_status = pthread_cond_timedwait(&timer->cond, &timer->cond_mutex, &timespec);
         if (return_status == ETIMEDOUT) {
-            (*timer->functor)(timer->user_param);
-        } else {
+            thread_timer_run(timer);
+        } else if (return_status != 0) {
             etmemd_log(ETMEMD_LOG_WARN, "timer will be exit ! \n");
             break;
         }
@@ -148,6 +170,28 @@ void thread_timer_stop(timer_thread* inst)
     etmemd_log(ETMEMD_LOG_DEBUG, "Timer instance stops ! \n");
 }
 
+void thread_timer_kick(timer_thread* inst)
+{
+    if (inst == NULL) {
+        return;
+    }
+
+    /* the timer holds the mutex from the check of kicked to the wait, so the kick is not lost */
+    pthread_mutex_lock(&inst->cond_mutex);
+    inst->kicked = true;
+    pthread_cond_signal(&inst->cond);
+    pthread_mutex_unlock(&inst->cond_mutex);
+}
+
+void thread_timer_set_expired_time(timer_thread* inst, int seconds)
+{
+    if (inst == NULL || seconds <= 0) {
+        return;
+    }
+
+    __atomic_store_n(&inst->expired_time, seconds, __ATOMIC_SEQ_CST);
+}
+
 void thread_timer_destroy(timer_thread** inst)
 {
     timer_thread *timer = NULL;
@@ -0,0 +1,412 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a source file of the tracer of the stages of each scan cycle.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include "securec.h"
+#include "etmemd_log.h"
+#include "etmemd_trace.h"
+
+#define NSEC_PER_SEC            1000000000ULL
+#define NSEC_PER_USEC           1000ULL
+#define TRACE_OUT_BUF_LEN       (64 * 1024)
+#define TRACE_EVENT_STR_LEN     256
+
+/*
+ * Each thread records into its own ring without any lock: only the owner writes the events and
+ * moves head on, and the dumper only moves tail on. A ring is given to a new thread when its
+ * owner exits, with the events left in it, as each event has the tid of its own.
+ * */
+struct trace_buf {
+    struct trace_buf *next;
+    bool used;                  /* protected by g_trace_mtx */
+    uint32_t tid;
+    uint64_t head;              /* events recorded */
+    uint64_t tail;              /* events dumped */
+    struct trace_event events[TRACE_BUF_EVENTS];
+};
+
+struct trace_out {
+    int fd;
+    size_t len;
+    bool first;
+    char buf[TRACE_OUT_BUF_LEN];
+};
+
+static const char *g_trace_stage_name[TRACE_STAGE_END] = {
+    [TRACE_CYCLE] = "cycle",
+    [TRACE_GET_PIDS] = "get_task_pids",
+    [TRACE_POOL_WAIT] = "pool_wait",
+    [TRACE_CHECK_SWAP] = "check_should_swap",
+    [TRACE_SCAN] = "scan",
+    [TRACE_GET_VMAS] = "get_vmas",
+    [TRACE_READ_IDLE] = "read_idle_pages",
+    [TRACE_PARSE] = "parse_vma_result",
+    [TRACE_SCAN_SLEEP] = "scan_sleep",
+    [TRACE_SORT] = "sort_page_refs",
+    [TRACE_POLICY] = "policy",
+    [TRACE_EVICT] = "evict",
+    [TRACE_RECLAIM_SWAPCACHE] = "reclaim_swapcache",
+};
+
+static bool g_trace_enabled = false;
+static struct trace_buf *g_trace_bufs = NULL;
+static pthread_mutex_t g_trace_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_trace_key;
+static bool g_trace_key_ok = false;
+static __thread struct trace_buf *g_trace_buf = NULL;
+
+static void trace_buf_release(void *arg)
+{
+    struct trace_buf *buf = (struct trace_buf *)arg;
+
+    pthread_mutex_lock(&g_trace_mtx);
+    buf->used = false;
+    pthread_mutex_unlock(&g_trace_mtx);
+}
+
+static void trace_key_create(void)
+{
+    g_trace_key_ok = pthread_key_create(&g_trace_key, trace_buf_release) == 0;
+}
+
+static struct trace_buf *trace_buf_get(void)
+{
+    struct trace_buf *buf = NULL;
+
+    if (g_trace_buf != NULL) {
+        return g_trace_buf;
+    }
+
+    if (pthread_once(&g_trace_once, trace_key_create) != 0 || !g_trace_key_ok) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&g_trace_mtx);
+    for (buf = g_trace_bufs; buf != NULL; buf = buf->next) {
+        if (!buf->used) {
+            break;
+        }
+    }
+
+    if (buf == NULL) {
+        buf = (struct trace_buf *)calloc(1, sizeof(struct trace_buf));
+        if (buf == NULL) {
+            pthread_mutex_unlock(&g_trace_mtx);
+            etmemd_log(ETMEMD_LOG_ERR, "malloc for trace buffer fail\n");
+            return NULL;
+        }
+        buf->next = g_trace_bufs;
+        g_trace_bufs = buf;
+    }
+    buf->used = true;
+    buf->tid = (uint32_t)syscall(SYS_gettid);
+    pthread_mutex_unlock(&g_trace_mtx);
+
+    if (pthread_setspecific(g_trace_key, buf) != 0) {
+        trace_buf_release(buf);
+        return NULL;
+    }
+
+    g_trace_buf = buf;
+    return buf;
+}
+
+void etmemd_trace_start(void)
+{
+    __atomic_store_n(&g_trace_enabled, true, __ATOMIC_RELEASE);
+    etmemd_log(ETMEMD_LOG_INFO, "trace is started\n");
+}
+
+void etmemd_trace_stop(void)
+{
+    __atomic_store_n(&g_trace_enabled, false, __ATOMIC_RELEASE);
+    etmemd_log(ETMEMD_LOG_INFO, "trace is stopped\n");
+}
+
+bool etmemd_trace_enabled(void)
+{
+    return __atomic_load_n(&g_trace_enabled, __ATOMIC_RELAXED);
+}
+
+static void trace_record(enum trace_stage stage, unsigned int pid, char phase)
+{
+    struct trace_buf *buf = NULL;
+    struct trace_event *event = NULL;
+    struct timespec ts;
+    uint64_t head;
+
+    if (!etmemd_trace_enabled() || stage >= TRACE_STAGE_END) {
+        return;
+    }
+
+    buf = trace_buf_get();
+    if (buf == NULL) {
+        return;
+    }
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return;
+    }
+
+    head = buf->head;
+    event = &buf->events[head % TRACE_BUF_EVENTS];
+    event->time_ns = (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+    event->tid = buf->tid;
+    event->pid = pid;
+    event->stage = (uint16_t)stage;
+    event->phase = (uint16_t)phase;
+    /* the event is seen by the dumper no earlier than the head */
+    __atomic_store_n(&buf->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void etmemd_trace_begin(enum trace_stage stage, unsigned int pid)
+{
+    trace_record(stage, pid, 'B');
+}
+
+void etmemd_trace_end(enum trace_stage stage, unsigned int pid)
+{
+    trace_record(stage, pid, 'E');
+}
+
+static int trace_out_flush(struct trace_out *out)
+{
+    size_t done = 0;
+    ssize_t ret;
+
+    while (done < out->len) {
+        ret = write(out->fd, out->buf + done, out->len - done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            etmemd_log(ETMEMD_LOG_ERR, "write trace fail, error: %d\n", errno);
+            return -1;
+        }
+        done += (size_t)ret;
+    }
+
+    out->len = 0;
+    return 0;
+}
+
+static int trace_out_put(struct trace_out *out, const char *str, size_t len)
+{
+    if (out->len + len > sizeof(out->buf) && trace_out_flush(out) != 0) {
+        return -1;
+    }
+
+    if (memcpy_s(out->buf + out->len, sizeof(out->buf) - out->len, str, len) != EOK) {
+        return -1;
+    }
+    out->len += len;
+    return 0;
+}
+
+static int trace_out_event(struct trace_out *out, const struct trace_event *event, unsigned int etmemd_pid)
+{
+    char str[TRACE_EVENT_STR_LEN];
+    int len;
+
+    /* ts of trace-event is in microseconds */
+    len = snprintf_s(str, sizeof(str), sizeof(str) - 1,
+                     "%s\n{\"name\":\"%s\",\"cat\":\"etmemd\",\"ph\":\"%c\",\"ts\":%llu.%03llu,"
+                     "\"pid\":%u,\"tid\":%u,\"args\":{\"pid\":%u}}",
+                     out->first ? "" : ",", g_trace_stage_name[event->stage], (char)event->phase,
+                     (unsigned long long)(event->time_ns / NSEC_PER_USEC),
+                     (unsigned long long)(event->time_ns % NSEC_PER_USEC),
+                     etmemd_pid, event->tid, event->pid);
+    if (len <= 0) {
+        return -1;
+    }
+
+    out->first = false;
+    return trace_out_put(out, str, (size_t)len);
+}
+
+/*
+ * Find where a dump of the events [from, head) stops: at the oldest begin whose end is not
+ * recorded yet, so that the next dump emits the begin along with its end. Each owner of the ring
+ * has its own nesting, and the begins left open by an owner that is gone are never ended.
+ * */
+static uint64_t trace_dump_end(const struct trace_buf *buf, const struct trace_event *events,
+                               uint64_t start, uint64_t from, uint64_t head)
+{
+    uint64_t i;
+    uint64_t open = head;
+    unsigned int depth = 0;
+    uint32_t tid = 0;
+    const struct trace_event *event = NULL;
+
+    for (i = from; i < head; i++) {
+        event = &events[i - start];
+        if (event->stage >= TRACE_STAGE_END) {
+            continue;
+        }
+
+        if (event->tid != tid) {
+            tid = event->tid;
+            depth = 0;
+        }
+        if (event->phase != 'E') {
+            open = depth == 0 ? i : open;
+            depth++;
+        } else if (depth > 0) {
+            depth--;
+        }
+    }
+
+    return depth > 0 && buf->used && tid == buf->tid ? open : head;
+}
+
+/*
+ * Copy the events out first, and drop those overwritten by the owner meanwhile. An end without
+ * its begin, left by overwrite or by an earlier owner of the ring, is dropped as well.
+ * */
+static int trace_dump_buf(struct trace_out *out, struct trace_buf *buf, struct trace_event *events,
+                          unsigned int etmemd_pid)
+{
+    uint64_t head;
+    uint64_t start;
+    uint64_t valid;
+    uint64_t end;
+    uint64_t i;
+    unsigned int depth = 0;
+    uint32_t tid = 0;
+    const struct trace_event *event = NULL;
+
+    head = __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE);
+    start = head > TRACE_BUF_EVENTS ? head - TRACE_BUF_EVENTS : 0;
+    start = start > buf->tail ? start : buf->tail;
+    for (i = start; i < head; i++) {
+        events[i - start] = buf->events[i % TRACE_BUF_EVENTS];
+    }
+
+    /*
+     * Keep the copies above from being done after the reload of head. While head is h, the owner
+     * may be rewriting the slot of event h - N, so only the events after it are whole.
+     * */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    valid = __atomic_load_n(&buf->head, __ATOMIC_RELAXED);
+    valid = valid >= TRACE_BUF_EVENTS ? valid - TRACE_BUF_EVENTS + 1 : 0;
+    valid = start > valid ? start : valid;
+    end = trace_dump_end(buf, events, start, valid, head);
+    buf->tail = end;
+
+    for (i = valid; i < end; i++) {
+        event = &events[i - start];
+        if (event->stage >= TRACE_STAGE_END) {
+            continue;
+        }
+
+        if (event->tid != tid) {
+            tid = event->tid;
+            depth = 0;
+        }
+        if (event->phase == 'E') {
+            if (depth == 0) {
+                continue;
+            }
+            depth--;
+        } else {
+            depth++;
+        }
+
+        if (trace_out_event(out, event, etmemd_pid) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int etmemd_trace_dump(int fd)
+{
+    struct trace_out *out = NULL;
+    struct trace_event *events = NULL;
+    struct trace_buf *buf = NULL;
+    const char *head = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    const char *tail = "\n]}\n";
+    unsigned int etmemd_pid = (unsigned int)getpid();
+    int ret = -1;
+
+    out = (struct trace_out *)calloc(1, sizeof(struct trace_out));
+    events = (struct trace_event *)calloc(TRACE_BUF_EVENTS, sizeof(struct trace_event));
+    if (out == NULL || events == NULL) {
+        etmemd_log(ETMEMD_LOG_ERR, "malloc for trace dump fail\n");
+        goto free_out;
+    }
+    out->fd = fd;
+    out->first = true;
+
+    if (trace_out_put(out, head, strlen(head)) != 0) {
+        goto free_out;
+    }
+
+    /* the lock keeps the buffers from being freed and the dumps from running together */
+    pthread_mutex_lock(&g_trace_mtx);
+    for (buf = g_trace_bufs; buf != NULL; buf = buf->next) {
+        if (trace_dump_buf(out, buf, events, etmemd_pid) != 0) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_trace_mtx);
+
+    if (buf == NULL && trace_out_put(out, tail, strlen(tail)) == 0 && trace_out_flush(out) == 0) {
+        ret = 0;
+    }
+
+free_out:
+    free(events);
+    free(out);
+    return ret;
+}
+
+void etmemd_trace_exit(void)
+{
+    struct trace_buf **pos = NULL;
+    struct trace_buf *buf = NULL;
+
+    etmemd_trace_stop();
+
+    if (g_trace_buf != NULL) {
+        (void)pthread_setspecific(g_trace_key, NULL);
+        trace_buf_release(g_trace_buf);
+        g_trace_buf = NULL;
+    }
+
+    /* the buffers of the threads still alive are kept, which may record again */
+    pthread_mutex_lock(&g_trace_mtx);
+    pos = &g_trace_bufs;
+    while (*pos != NULL) {
+        buf = *pos;
+        if (buf->used) {
+            pos = &buf->next;
+            continue;
+        }
+        *pos = buf->next;
+        free(buf);
+    }
+    pthread_mutex_unlock(&g_trace_mtx);
+}
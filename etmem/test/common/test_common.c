@@ -76,6 +76,24 @@ void construct_proj_file(struct proj_test_param *param)
         CU_ASSERT_NOT_EQUAL(fprintf(file, CONFIG_SWAPCACHE_LOW_WMARK,
                                     param->swapcache_low_wmark), -1);
     }
+    if (param->evict_backend != NULL) {
+        CU_ASSERT_NOT_EQUAL(fprintf(file, CONFIG_EVICT_BACKEND, param->evict_backend), -1);
+    }
+    if (param->scan_backend != NULL) {
+        CU_ASSERT_NOT_EQUAL(fprintf(file, CONFIG_SCAN_BACKEND, param->scan_backend), -1);
+    }
+    if (param->psi_threshold != NULL) {
+        CU_ASSERT_NOT_EQUAL(fprintf(file, CONFIG_PSI_THRESHOLD, param->psi_threshold), -1);
+    }
+    if (param->psi_window != NULL) {
+        CU_ASSERT_NOT_EQUAL(fprintf(file, CONFIG_PSI_WINDOW, param->psi_window), -1);
+    }
+    if (param->bw_weight != NULL) {
+        CU_ASSERT_NOT_EQUAL(fprintf(file, CONFIG_BW_WEIGHT, param->bw_weight), -1);
+    }
+    if (param->priority != NULL) {
+        CU_ASSERT_NOT_EQUAL(fprintf(file, CONFIG_PRIORITY, param->priority), -1);
+    }
     fclose(file);
 }
 
@@ -99,6 +117,12 @@ void init_proj_param(struct proj_test_param *param)
     param->sysmem_threshold = NULL;
     param->swapcache_high_wmark = NULL;
     param->swapcache_low_wmark = NULL;
+    param->evict_backend = NULL;
+    param->scan_backend = NULL;
+    param->psi_threshold = NULL;
+    param->psi_window = NULL;
+    param->bw_weight = NULL;
+    param->priority = NULL;
     param->file_name = TMP_PROJ_CONFIG;
     param->proj_name = DEFAULT_PROJ;
     param->expt = OPT_SUCCESS;
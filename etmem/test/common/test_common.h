@@ -28,6 +28,12 @@
 #define CONFIG_SYSMEM_THRESHOLD             "sysmem_threshold=%s\n"
 #define CONFIG_SWAPCACHE_HIGH_WMARK         "swapcache_high_wmark=%s\n"
 #define CONFIG_SWAPCACHE_LOW_WMARK          "swapcache_low_wmark=%s\n"
+#define CONFIG_EVICT_BACKEND                "evict_backend=%s\n"
+#define CONFIG_SCAN_BACKEND                 "scan_backend=%s\n"
+#define CONFIG_PSI_THRESHOLD                "psi_threshold=%s\n"
+#define CONFIG_PSI_WINDOW                   "psi_window=%s\n"
+#define CONFIG_BW_WEIGHT                    "bw_weight=%s\n"
+#define CONFIG_PRIORITY                     "priority=%s\n"
 #define TMP_PROJ_CONFIG                     "proj_tmp.config"
 #define DEFAULT_PROJ                        "default_proj"
 
@@ -66,6 +72,12 @@ struct proj_test_param {
     const char *sysmem_threshold;
     const char *swapcache_high_wmark;
     const char *swapcache_low_wmark;
+    const char *evict_backend;
+    const char *scan_backend;
+    const char *psi_threshold;
+    const char *psi_window;
+    const char *bw_weight;
+    const char *priority;
     const char *proj_name;
     const char *file_name;
     enum opt_result expt;
@@ -23,6 +23,7 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include <CUnit/Basic.h>
 #include <CUnit/Automated.h>
@@ -33,12 +34,27 @@
 #include "etmemd_rpc.h"
 #include "etmemd_scan_exp.h"
 #include "etmemd_scan.h"
+#include "etmemd_meminfo.h"
+#include "etmemd_bandwidth.h"
+#include "etmemd_hotness.h"
+#include "etmemd_record.h"
+#include "etmemd_replay.h"
+#include "etmemd_trace.h"
 #include "securec.h"
 
 #define RECLAIM_SWAPCACHE_MAGIC      0x77
 #define RECLAIM_SWAPCACHE_ON         _IOW(RECLAIM_SWAPCACHE_MAGIC, 0x1, unsigned int)
 #define SET_SWAPCACHE_WMARK          _IOW(RECLAIM_SWAPCACHE_MAGIC, 0x2, unsigned int)
 
+#define HOTNESS_LLT_DIR              "/tmp/etmem_hotness_llt"
+#define HOTNESS_LLT_LOOP             3
+
+#define ROOT_LLT_DIR                 "/tmp/etmem_root_llt"
+#define ROOT_LLT_PID                 "5000000"
+
+#define TRACE_LLT_PID                1234
+#define TRACE_LLT_BUF_LEN            4096
+
 static FILE *open_conf_file(const char *file_name)
 {
     FILE *file = NULL;
@@ -96,6 +112,12 @@ static void test_parse_cmdline_error(void)
     char *cmd_para_redundant[] = {"./etmemd", "-l", "0", "-h", "-s", "sock"};
     char *cmd_lack_s[] = {"./etmemd", "-l", "0", "-h"};
     char *cmd_unwanted_para[] = {"./etmemd", "-l", "0", "-d", "file"};
+    char *cmd_bw_err[] = {"./etmemd", "-s", "sock", "-S", "1048577"};
+    char *cmd_bw_mul[] = {"./etmemd", "-s", "sock", "-M", "10", "-M", "20"};
+    char *cmd_warm_rel[] = {"./etmemd", "-s", "sock", "-w", "var/lib/etmem"};
+    char *cmd_record_replay[] = {"./etmemd", "-r", "record", "-R", "record"};
+    char *cmd_replay_config[] = {"./etmemd", "-s", "sock", "-c", "config"};
+    char *cmd_root_rel[] = {"./etmemd", "-s", "sock", "-P", "tmp"};
 
     CU_ASSERT_EQUAL(etmemd_parse_cmdline(0, NULL, &is_help), -1);
     clean_flags(&is_help);
@@ -128,6 +150,27 @@ static void test_parse_cmdline_error(void)
     clean_flags(&is_help);
     CU_ASSERT_EQUAL(etmemd_parse_cmdline(sizeof(cmd_unwanted_para) / sizeof(cmd_unwanted_para[0]), cmd_unwanted_para, &is_help), -1);
     clean_flags(&is_help);
+    CU_ASSERT_EQUAL(etmemd_parse_cmdline(sizeof(cmd_bw_err) / sizeof(cmd_bw_err[0]), cmd_bw_err, &is_help), -1);
+    etmemd_sock_name_free();
+    clean_flags(&is_help);
+    CU_ASSERT_EQUAL(etmemd_parse_cmdline(sizeof(cmd_bw_mul) / sizeof(cmd_bw_mul[0]), cmd_bw_mul, &is_help), -1);
+    etmemd_sock_name_free();
+    clean_flags(&is_help);
+    CU_ASSERT_EQUAL(etmemd_parse_cmdline(sizeof(cmd_warm_rel) / sizeof(cmd_warm_rel[0]), cmd_warm_rel, &is_help), -1);
+    CU_ASSERT_FALSE(etmemd_hotness_enabled());
+    etmemd_sock_name_free();
+    clean_flags(&is_help);
+    CU_ASSERT_EQUAL(etmemd_parse_cmdline(sizeof(cmd_record_replay) / sizeof(cmd_record_replay[0]), cmd_record_replay, &is_help), -1);
+    CU_ASSERT_FALSE(etmemd_record_set());
+    CU_ASSERT_FALSE(etmemd_replay_set());
+    clean_flags(&is_help);
+    CU_ASSERT_EQUAL(etmemd_parse_cmdline(sizeof(cmd_replay_config) / sizeof(cmd_replay_config[0]), cmd_replay_config, &is_help), -1);
+    CU_ASSERT_FALSE(etmemd_replay_config_set());
+    clean_flags(&is_help);
+    CU_ASSERT_EQUAL(etmemd_parse_cmdline(sizeof(cmd_root_rel) / sizeof(cmd_root_rel[0]), cmd_root_rel, &is_help), -1);
+    CU_ASSERT_FALSE(etmemd_root_set());
+    clean_flags(&is_help);
+    etmemd_bw_set_rate(BW_MIGRATE, 0);
 }
 
 static void test_parse_cmdline_ok(void)
@@ -138,6 +181,11 @@ static void test_parse_cmdline_ok(void)
     char *cmd_help[] = {"./etmemd", "--help"};
     char *cmd_ok[] = {"./etmemd", "-l", "0", "-s", "cmd_ok"};
     char *cmd_only_sock[] = {"./etmemd", "-s", "cmd_only_sock"};
+    char *cmd_bw[] = {"./etmemd", "-s", "cmd_bw", "--swap-bandwidth", "100", "-M", "50"};
+    char *cmd_all[] = {"./etmemd", "-l", "0", "-s", "cmd_all", "-S", "100", "-M", "50",
+                       "--warm-state", HOTNESS_LLT_DIR};
+    char *cmd_replay[] = {"./etmemd", "-l", "0", "--replay", "record", "-c", "config"};
+    char *cmd_root[] = {"./etmemd", "-s", "cmd_root", "--root", ROOT_LLT_DIR "/"};
 
     CU_ASSERT_EQUAL(etmemd_parse_cmdline(sizeof(cmd_ok) / sizeof(cmd_ok[0]), cmd_ok, &is_help), 0);
     etmemd_sock_name_free();
@@ -155,6 +203,93 @@ static void test_parse_cmdline_ok(void)
     CU_ASSERT_EQUAL(etmemd_parse_cmdline(sizeof(cmd_only_sock) / sizeof(cmd_only_sock[0]), cmd_only_sock, &is_help), 0);
     etmemd_sock_name_free();
     clean_flags(&is_help);
+
+    CU_ASSERT_EQUAL(etmemd_parse_cmdline(sizeof(cmd_bw) / sizeof(cmd_bw[0]), cmd_bw, &is_help), 0);
+    CU_ASSERT_TRUE(etmemd_bw_limited(BW_SWAP));
+    CU_ASSERT_TRUE(etmemd_bw_limited(BW_MIGRATE));
+    etmemd_sock_name_free();
+    clean_flags(&is_help);
+
+    CU_ASSERT_EQUAL(etmemd_parse_cmdline(sizeof(cmd_all) / sizeof(cmd_all[0]), cmd_all, &is_help), 0);
+    CU_ASSERT_TRUE(etmemd_hotness_enabled());
+    etmemd_sock_name_free();
+    clean_flags(&is_help);
+    CU_ASSERT_EQUAL(etmemd_bw_set_rate(BW_SWAP, 0), 0);
+    CU_ASSERT_EQUAL(etmemd_bw_set_rate(BW_MIGRATE, 0), 0);
+
+    /* no socket is listened to when replaying */
+    CU_ASSERT_EQUAL(etmemd_parse_cmdline(sizeof(cmd_replay) / sizeof(cmd_replay[0]), cmd_replay, &is_help), 0);
+    CU_ASSERT_TRUE(etmemd_replay_set());
+    CU_ASSERT_TRUE(etmemd_replay_config_set());
+    etmemd_replay_clear();
+    clean_flags(&is_help);
+
+    CU_ASSERT_EQUAL(etmemd_parse_cmdline(sizeof(cmd_root) / sizeof(cmd_root[0]), cmd_root, &is_help), 0);
+    CU_ASSERT_TRUE(etmemd_root_set());
+    CU_ASSERT_EQUAL(etmemd_set_root("/"), 0);
+    CU_ASSERT_FALSE(etmemd_root_set());
+    etmemd_sock_name_free();
+    clean_flags(&is_help);
+}
+
+static struct page_refs *alloc_llt_page_refs(uint64_t addr, int count, struct page_refs *next)
+{
+    struct page_refs *page_refs = (struct page_refs *)calloc(1, sizeof(struct page_refs));
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(page_refs);
+    page_refs->addr = addr;
+    page_refs->count = count;
+    page_refs->next = next;
+    return page_refs;
+}
+
+static void test_hotness_restart(void)
+{
+    struct vma vma_high = {.start = 3 * HOTNESS_REGION_SIZE, .end = 4 * HOTNESS_REGION_SIZE};
+    struct vma vma_low = {.start = HOTNESS_REGION_SIZE, .end = 3 * HOTNESS_REGION_SIZE, .next = &vma_high};
+    struct vmas vmas = {.vma_cnt = 2, .vma_list = &vma_low};
+    struct page_refs *page_refs = NULL;
+    unsigned int pid = (unsigned int)getpid();
+
+    CU_ASSERT_EQUAL(etmemd_hotness_set_dir("etmem_hotness_llt"), -1);
+    CU_ASSERT_EQUAL(etmemd_hotness_set_dir(HOTNESS_LLT_DIR), 0);
+    CU_ASSERT_EQUAL(etmemd_hotness_start(), 0);
+    CU_ASSERT_EQUAL(etmemd_hotness_scan_loops(pid, &vmas, HOTNESS_LLT_LOOP), HOTNESS_LLT_LOOP);
+
+    /* the first region is hot, the second is cold, and the third is warm */
+    page_refs = alloc_llt_page_refs(vma_high.start, 1, NULL);
+    page_refs = alloc_llt_page_refs(2 * HOTNESS_REGION_SIZE, 0, page_refs);
+    page_refs = alloc_llt_page_refs(vma_low.start, HOTNESS_LLT_LOOP, page_refs);
+    etmemd_hotness_update(pid, &vmas, page_refs, HOTNESS_LLT_LOOP, HOTNESS_LLT_LOOP);
+    etmemd_free_page_refs(page_refs);
+    etmemd_hotness_stop();
+    CU_ASSERT_EQUAL(access(HOTNESS_LLT_DIR "/" HOTNESS_FILE_NAME, F_OK), 0);
+
+    /* the pid scans once after restart, and the counts of the other scans come from the file */
+    CU_ASSERT_EQUAL(etmemd_hotness_start(), 0);
+    CU_ASSERT_EQUAL(etmemd_hotness_scan_loops(pid, &vmas, HOTNESS_LLT_LOOP), 1);
+    page_refs = alloc_llt_page_refs(vma_high.start, 0, NULL);
+    page_refs = alloc_llt_page_refs(2 * HOTNESS_REGION_SIZE, 0, page_refs);
+    page_refs = alloc_llt_page_refs(vma_low.start, 1, page_refs);
+    etmemd_hotness_update(pid, &vmas, page_refs, 1, HOTNESS_LLT_LOOP);
+    CU_ASSERT_EQUAL(page_refs->count, HOTNESS_LLT_LOOP);
+    CU_ASSERT_EQUAL(page_refs->next->count, 0);
+    CU_ASSERT_EQUAL(page_refs->next->next->count, 1);
+    etmemd_free_page_refs(page_refs);
+
+    /* the history is used once only */
+    CU_ASSERT_EQUAL(etmemd_hotness_scan_loops(pid, &vmas, HOTNESS_LLT_LOOP), HOTNESS_LLT_LOOP);
+    etmemd_hotness_stop();
+
+    /* the history of the vmas changed is not used */
+    CU_ASSERT_EQUAL(etmemd_hotness_start(), 0);
+    vma_low.end = 2 * HOTNESS_REGION_SIZE;
+    vma_high.start = 2 * HOTNESS_REGION_SIZE;
+    CU_ASSERT_EQUAL(etmemd_hotness_scan_loops(pid, &vmas, HOTNESS_LLT_LOOP), HOTNESS_LLT_LOOP);
+    etmemd_hotness_stop();
+
+    unlink(HOTNESS_LLT_DIR "/" HOTNESS_FILE_NAME);
+    rmdir(HOTNESS_LLT_DIR);
 }
 
 static void test_get_int_value_error(void)
@@ -270,6 +405,190 @@ static void test_get_mem_from_proc_file_ok(void)
     CU_ASSERT_EQUAL(get_mem_from_proc_file("1", "/status", &data, "VmRSS"), 0);
 }
 
+static void test_read_proc_snapshot_error(void)
+{
+    struct pid_status status;
+
+    CU_ASSERT_EQUAL(etmemd_read_pid_status("-1", &status), -1);
+    /* kernel threads have no memory info in status */
+    CU_ASSERT_EQUAL(etmemd_read_pid_status("2", &status), -1);
+}
+
+static void test_read_proc_snapshot_ok(void)
+{
+    struct meminfo info;
+    struct meminfo cached;
+    struct pid_status status;
+
+    CU_ASSERT_EQUAL(etmemd_read_meminfo(&info), 0);
+    CU_ASSERT_NOT_EQUAL(info.mem_total, 0);
+    CU_ASSERT_TRUE(info.mem_free <= info.mem_total);
+
+    CU_ASSERT_EQUAL(etmemd_refresh_meminfo(), 0);
+    CU_ASSERT_EQUAL(etmemd_get_meminfo(&cached), 0);
+    CU_ASSERT_EQUAL(cached.mem_total, info.mem_total);
+
+    CU_ASSERT_EQUAL(etmemd_read_pid_status("1", &status), 0);
+    CU_ASSERT_NOT_EQUAL(status.vm_rss, 0);
+}
+
+static void write_root_llt_file(const char *path, const char *data)
+{
+    FILE *file = fopen(path, "w");
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    CU_ASSERT_TRUE(fputs(data, file) >= 0);
+    CU_ASSERT_EQUAL(fclose(file), 0);
+}
+
+static void test_read_proc_under_root(void)
+{
+    struct meminfo info;
+    struct pid_status status;
+    char buf[PATH_MAX];
+    FILE *fp = NULL;
+
+    CU_ASSERT_EQUAL(etmemd_set_root("tmp"), -1);
+    CU_ASSERT_PTR_EQUAL(etmemd_root_path("/proc/meminfo", buf, sizeof(buf)), "/proc/meminfo");
+
+    CU_ASSERT_EQUAL(mkdir(ROOT_LLT_DIR, S_IRWXU), 0);
+    CU_ASSERT_EQUAL(mkdir(ROOT_LLT_DIR "/proc", S_IRWXU), 0);
+    CU_ASSERT_EQUAL(mkdir(ROOT_LLT_DIR "/proc/" ROOT_LLT_PID, S_IRWXU), 0);
+    write_root_llt_file(ROOT_LLT_DIR "/proc/meminfo", "MemTotal: 4096 kB\nMemFree: 1024 kB\n");
+    write_root_llt_file(ROOT_LLT_DIR "/proc/" ROOT_LLT_PID "/status",
+                        "VmRSS: 2048 kB\nRssAnon: 2048 kB\nRssFile: 0 kB\nVmSwap: 512 kB\n");
+
+    CU_ASSERT_EQUAL(etmemd_set_root(ROOT_LLT_DIR "//"), 0);
+    CU_ASSERT_TRUE(etmemd_root_set());
+    CU_ASSERT_STRING_EQUAL(etmemd_root_path("/proc/meminfo", buf, sizeof(buf)), ROOT_LLT_DIR "/proc/meminfo");
+
+    CU_ASSERT_EQUAL(etmemd_read_meminfo(&info), 0);
+    CU_ASSERT_EQUAL(info.mem_total, 4096);
+    CU_ASSERT_EQUAL(info.mem_free, 1024);
+    CU_ASSERT_EQUAL(etmemd_read_pid_status(ROOT_LLT_PID, &status), 0);
+    CU_ASSERT_EQUAL(status.vm_rss, 2048);
+    CU_ASSERT_EQUAL(status.vm_swap, 512);
+
+    fp = etmemd_get_proc_file(ROOT_LLT_PID, "/status", "r");
+    CU_ASSERT_PTR_NOT_NULL(fp);
+    if (fp != NULL) {
+        fclose(fp);
+    }
+    /* the pids of the host are not seen under the root */
+    CU_ASSERT_PTR_NULL(etmemd_get_proc_file("1", "/status", "r"));
+
+    CU_ASSERT_EQUAL(etmemd_set_root("/"), 0);
+    CU_ASSERT_FALSE(etmemd_root_set());
+    CU_ASSERT_EQUAL(etmemd_read_pid_status(ROOT_LLT_PID, &status), -1);
+
+    unlink(ROOT_LLT_DIR "/proc/" ROOT_LLT_PID "/status");
+    unlink(ROOT_LLT_DIR "/proc/meminfo");
+    rmdir(ROOT_LLT_DIR "/proc/" ROOT_LLT_PID);
+    rmdir(ROOT_LLT_DIR "/proc");
+    rmdir(ROOT_LLT_DIR);
+}
+
+static void *trace_llt_worker(void *arg)
+{
+    etmemd_trace_begin(TRACE_SCAN, TRACE_LLT_PID);
+    etmemd_trace_begin(TRACE_READ_IDLE, TRACE_LLT_PID);
+    etmemd_trace_end(TRACE_READ_IDLE, TRACE_LLT_PID);
+    etmemd_trace_end(TRACE_SCAN, TRACE_LLT_PID);
+    return NULL;
+}
+
+/* exits with its begin left open, as a cancelled worker does */
+static void *trace_llt_exit_worker(void *arg)
+{
+    etmemd_trace_begin(TRACE_SCAN, TRACE_LLT_PID);
+    return NULL;
+}
+
+static void *trace_llt_next_worker(void *arg)
+{
+    etmemd_trace_end(TRACE_SCAN, TRACE_LLT_PID);
+    etmemd_trace_begin(TRACE_READ_IDLE, TRACE_LLT_PID);
+    etmemd_trace_end(TRACE_READ_IDLE, TRACE_LLT_PID);
+    return NULL;
+}
+
+static void read_trace_llt(FILE *file, char *buf, size_t len)
+{
+    size_t size;
+
+    rewind(file);
+    size = fread(buf, 1, len - 1, file);
+    buf[size] = '\0';
+    CU_ASSERT_EQUAL(ftruncate(fileno(file), 0), 0);
+    CU_ASSERT_EQUAL(lseek(fileno(file), 0, SEEK_SET), 0);
+}
+
+static void test_trace_dump(void)
+{
+    char buf[TRACE_LLT_BUF_LEN];
+    FILE *file = tmpfile();
+    pthread_t worker;
+    const char *end = NULL;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+
+    /* nothing is recorded before start */
+    etmemd_trace_begin(TRACE_CYCLE, 0);
+    CU_ASSERT_FALSE(etmemd_trace_enabled());
+
+    etmemd_trace_start();
+    CU_ASSERT_TRUE(etmemd_trace_enabled());
+    /* an end without its begin is not dumped */
+    etmemd_trace_end(TRACE_CYCLE, 0);
+    etmemd_trace_begin(TRACE_CYCLE, 0);
+    CU_ASSERT_EQUAL(pthread_create(&worker, NULL, trace_llt_worker, NULL), 0);
+    CU_ASSERT_EQUAL(pthread_join(worker, NULL), 0);
+    etmemd_trace_end(TRACE_CYCLE, 0);
+
+    CU_ASSERT_EQUAL(etmemd_trace_dump(fileno(file)), 0);
+    read_trace_llt(file, buf, sizeof(buf));
+    CU_ASSERT_PTR_NOT_NULL(strstr(buf, "\"traceEvents\":["));
+    CU_ASSERT_PTR_NOT_NULL(strstr(buf, "\"name\":\"read_idle_pages\",\"cat\":\"etmemd\",\"ph\":\"B\""));
+    CU_ASSERT_PTR_NOT_NULL(strstr(buf, "\"args\":{\"pid\":1234}"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(buf, "\"name\":\"cycle\",\"cat\":\"etmemd\",\"ph\":\"B\""));
+    end = strstr(buf, "\"name\":\"cycle\",\"cat\":\"etmemd\",\"ph\":\"E\"");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(end);
+    CU_ASSERT_PTR_NULL(strstr(end + 1, "\"name\":\"cycle\",\"cat\":\"etmemd\",\"ph\":\"E\""));
+
+    /* a begin still open is kept for the dump that sees its end */
+    etmemd_trace_begin(TRACE_CYCLE, 0);
+    CU_ASSERT_EQUAL(etmemd_trace_dump(fileno(file)), 0);
+    read_trace_llt(file, buf, sizeof(buf));
+    CU_ASSERT_PTR_NULL(strstr(buf, "\"name\":\"cycle\""));
+    etmemd_trace_end(TRACE_CYCLE, 0);
+    CU_ASSERT_EQUAL(etmemd_trace_dump(fileno(file)), 0);
+    read_trace_llt(file, buf, sizeof(buf));
+    CU_ASSERT_PTR_NOT_NULL(strstr(buf, "\"name\":\"cycle\",\"cat\":\"etmemd\",\"ph\":\"B\""));
+    CU_ASSERT_PTR_NOT_NULL(strstr(buf, "\"name\":\"cycle\",\"cat\":\"etmemd\",\"ph\":\"E\""));
+
+    /* the begin left open by an exited thread is not ended by the next owner of its ring */
+    CU_ASSERT_EQUAL(pthread_create(&worker, NULL, trace_llt_exit_worker, NULL), 0);
+    CU_ASSERT_EQUAL(pthread_join(worker, NULL), 0);
+    CU_ASSERT_EQUAL(pthread_create(&worker, NULL, trace_llt_next_worker, NULL), 0);
+    CU_ASSERT_EQUAL(pthread_join(worker, NULL), 0);
+    CU_ASSERT_EQUAL(etmemd_trace_dump(fileno(file)), 0);
+    read_trace_llt(file, buf, sizeof(buf));
+    CU_ASSERT_PTR_NOT_NULL(strstr(buf, "\"name\":\"scan\",\"cat\":\"etmemd\",\"ph\":\"B\""));
+    CU_ASSERT_PTR_NULL(strstr(buf, "\"name\":\"scan\",\"cat\":\"etmemd\",\"ph\":\"E\""));
+    CU_ASSERT_PTR_NOT_NULL(strstr(buf, "\"name\":\"read_idle_pages\",\"cat\":\"etmemd\",\"ph\":\"E\""));
+
+    /* only the events since the last dump are dumped, and none after stop */
+    etmemd_trace_stop();
+    etmemd_trace_begin(TRACE_CYCLE, 0);
+    CU_ASSERT_EQUAL(etmemd_trace_dump(fileno(file)), 0);
+    read_trace_llt(file, buf, sizeof(buf));
+    CU_ASSERT_PTR_NULL(strstr(buf, "\"name\""));
+    CU_ASSERT_PTR_NOT_NULL(strstr(buf, "]}"));
+
+    etmemd_trace_exit();
+    fclose(file);
+}
+
 static void test_get_swap_threshold_inKB_error(void)
 {
     char *swap_threshold = "50m";
@@ -428,10 +747,15 @@ int main(int argc, const char **argv)
         CU_ADD_TEST(suite, test_file_check_ok) == NULL ||
         CU_ADD_TEST(suite, test_parse_cmdline_error) == NULL ||
         CU_ADD_TEST(suite, test_parse_cmdline_ok) == NULL ||
+        CU_ADD_TEST(suite, test_hotness_restart) == NULL ||
         CU_ADD_TEST(suite, test_get_proc_file_error) == NULL ||
         CU_ADD_TEST(suite, test_get_proc_file_ok) == NULL ||
         CU_ADD_TEST(suite, test_get_mem_from_proc_file_error) == NULL ||
         CU_ADD_TEST(suite, test_get_mem_from_proc_file_ok) == NULL ||
+        CU_ADD_TEST(suite, test_read_proc_snapshot_error) == NULL ||
+        CU_ADD_TEST(suite, test_read_proc_snapshot_ok) == NULL ||
+        CU_ADD_TEST(suite, test_read_proc_under_root) == NULL ||
+        CU_ADD_TEST(suite, test_trace_dump) == NULL ||
         CU_ADD_TEST(suite, test_get_swap_threshold_inKB_error) == NULL ||
         CU_ADD_TEST(suite, test_get_swap_threshold_inKB_ok) == NULL ||
         CU_ADD_TEST(suite, test_etmemd_send_ioctl_cmd_error) == NULL ||
@@ -58,6 +58,13 @@ static char *g_vmflags_array[] = {
     "ht",
 };
 
+static struct page_scan g_page_scan = {
+    .loop = TEST_LOOP,
+    .interval = 1,
+    .sleep = 1,
+    .backend = SCAN_BACKEND_IDLE_PAGES,
+};
+
 static void add_default_proj(void)
 {
     init_proj_param(&g_proj_param);
@@ -639,6 +646,7 @@ static void init_cslide_params(struct cslide_pid_params **pid_params,
     eng_params->loop = TEST_LOOP;
     eng_params->interval = 1;
     eng_params->sleep = 1;
+    eng_params->page_scan = &g_page_scan;
     eng_params->hot_threshold = 1;
     eng_params->mig_quota = DEFAULT_MIG_QUOTA;
     eng_params->hot_reserve = 0;
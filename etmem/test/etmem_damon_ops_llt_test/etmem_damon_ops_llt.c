@@ -0,0 +1,232 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a source file of the unit test for the config of damon engine.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include <CUnit/Basic.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Console.h>
+
+#include "etmemd_engine.h"
+#include "etmemd_damon.h"
+#include "securec.h"
+
+#include "test_common.h"
+
+#include "etmemd_damon.c"
+
+#define DAMON_CONFIG_LEN        1024
+#define DAMON_SCHEME_CONFIG     "min_size=0\nmax_size=4294967295\nmin_acc=0\nmax_acc=0\n" \
+                                "min_age=10\nmax_age=4294967295\naction=pageout\n"
+
+/* fill a damon engine with scheme 0 and the extra keys in config_str, then clear it */
+static int damon_fill_eng_config(const char *config_str, struct damon_eng_params *out)
+{
+    char buf[DAMON_CONFIG_LEN] = {0};
+    struct engine eng = {0};
+    GKeyFile *config = NULL;
+    int ret;
+
+    CU_ASSERT_NOT_EQUAL(snprintf_s(buf, sizeof(buf), sizeof(buf) - 1, "[engine]\n" CONFIG_NAME
+                                   DAMON_SCHEME_CONFIG "%s", "damon", config_str), -1);
+    config = g_key_file_new();
+    CU_ASSERT_PTR_NOT_NULL(config);
+    CU_ASSERT_NOT_EQUAL(g_key_file_load_from_data(config, buf, strlen(buf), G_KEY_FILE_NONE, NULL), FALSE);
+
+    ret = damon_fill_eng(config, &eng);
+    if (ret == 0) {
+        CU_ASSERT_PTR_NOT_NULL(eng.params);
+        if (out != NULL) {
+            *out = *(struct damon_eng_params *)eng.params;
+        }
+        damon_clear_eng(&eng);
+        CU_ASSERT_PTR_NULL(eng.params);
+    }
+    g_key_file_free(config);
+    return ret;
+}
+
+static void test_etmem_damon_schemes_error(void)
+{
+    /* unknown action */
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("schemes=0,4096,0,0,10,100,evict\n", NULL), 0);
+    /* too few fields */
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("schemes=0,4096,0,0,10,pageout\n", NULL), 0);
+    /* too many fields */
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("schemes=0,4096,0,0,10,100,pageout,1\n", NULL), 0);
+    /* not a number */
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("schemes=0,4k,0,0,10,100,pageout\n", NULL), 0);
+    /* min larger than max */
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("schemes=8192,4096,0,0,10,100,pageout\n", NULL), 0);
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("schemes=0,4096,5,1,10,100,pageout\n", NULL), 0);
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("schemes=0,4096,0,0,100,10,pageout\n", NULL), 0);
+    /* more than DAMON_MAX_SCHEMES with scheme 0 */
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("schemes=0,1,0,0,0,1,cold;0,1,0,0,0,1,cold;0,1,0,0,0,1,cold;"
+                                              "0,1,0,0,0,1,cold;0,1,0,0,0,1,cold;0,1,0,0,0,1,cold;"
+                                              "0,1,0,0,0,1,cold;0,1,0,0,0,1,cold\n", NULL), 0);
+}
+
+static void test_etmem_damon_schemes_ok(void)
+{
+    struct damon_eng_params params;
+
+    CU_ASSERT_EQUAL(damon_fill_eng_config("", &params), 0);
+    CU_ASSERT_EQUAL(params.nr_schemes, 1);
+    CU_ASSERT_EQUAL(params.schemes[0].action, DAMOS_PAGEOUT);
+    CU_ASSERT_EQUAL(params.kdamond, -1);
+
+    /* ',' and ' ' both separate the fields */
+    CU_ASSERT_EQUAL(damon_fill_eng_config("schemes=0,4096,0,0,10,100,cold;0 8192 1 5 0 0 willneed\n",
+                                          &params), 0);
+    CU_ASSERT_EQUAL(params.nr_schemes, 3);
+    CU_ASSERT_EQUAL(params.schemes[1].max_sz_region, 4096);
+    CU_ASSERT_EQUAL(params.schemes[1].action, DAMOS_COLD);
+    CU_ASSERT_EQUAL(params.schemes[2].max_nr_accesses, 5);
+    CU_ASSERT_EQUAL(params.schemes[2].action, DAMOS_WILLNEED);
+
+    /* DAMON_MAX_SCHEMES with scheme 0 */
+    CU_ASSERT_EQUAL(damon_fill_eng_config("schemes=0,1,0,0,0,1,cold;0,1,0,0,0,1,cold;0,1,0,0,0,1,cold;"
+                                          "0,1,0,0,0,1,cold;0,1,0,0,0,1,cold;0,1,0,0,0,1,cold;"
+                                          "0,1,0,0,0,1,stat\n", &params), 0);
+    CU_ASSERT_EQUAL(params.nr_schemes, DAMON_MAX_SCHEMES);
+    CU_ASSERT_EQUAL(params.schemes[DAMON_MAX_SCHEMES - 1].action, DAMOS_STAT);
+}
+
+static void test_etmem_damon_quota_error(void)
+{
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("quota_ms=10\n", NULL), 0);
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("quota_bytes=1048576\n", NULL), 0);
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("quota_ms=10\nquota_reset_interval=0\n", NULL), 0);
+}
+
+static void test_etmem_damon_quota_ok(void)
+{
+    struct damon_eng_params params;
+
+    CU_ASSERT_EQUAL(damon_fill_eng_config("quota_reset_interval=1000\n", &params), 0);
+    CU_ASSERT_EQUAL(damon_fill_eng_config("quota_ms=10\nquota_bytes=1048576\nquota_reset_interval=1000\n"
+                                          "schemes=0,4096,0,0,10,100,cold\n", &params), 0);
+    CU_ASSERT_EQUAL(params.quota.ms, 10);
+    CU_ASSERT_EQUAL(params.quota.bytes, 1048576);
+    CU_ASSERT_EQUAL(params.quota.reset_interval, 1000);
+    /* the quota is shared by all the schemes */
+    CU_ASSERT_EQUAL(params.schemes[0].quota.bytes, 1048576);
+    CU_ASSERT_EQUAL(params.schemes[1].quota.ms, 10);
+}
+
+static void test_etmem_damon_wmarks_error(void)
+{
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("wmark_metric=free_mem\n", NULL), 0);
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("wmark_metric=\n", NULL), 0);
+    /* no interval */
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("wmark_metric=free_mem_rate\nwmark_high=500\n"
+                                              "wmark_mid=400\nwmark_low=200\n", NULL), 0);
+    /* high larger than DAMOS_WMARK_MAX */
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("wmark_metric=free_mem_rate\nwmark_interval=1000000\n"
+                                              "wmark_high=1001\nwmark_mid=400\nwmark_low=200\n", NULL), 0);
+    /* high lower than mid */
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("wmark_metric=free_mem_rate\nwmark_interval=1000000\n"
+                                              "wmark_high=300\nwmark_mid=400\nwmark_low=200\n", NULL), 0);
+    /* mid lower than low */
+    CU_ASSERT_NOT_EQUAL(damon_fill_eng_config("wmark_metric=free_mem_rate\nwmark_interval=1000000\n"
+                                              "wmark_high=500\nwmark_mid=100\nwmark_low=200\n", NULL), 0);
+}
+
+static void test_etmem_damon_wmarks_ok(void)
+{
+    struct damon_eng_params params;
+
+    /* watermarks are not checked without a metric */
+    CU_ASSERT_EQUAL(damon_fill_eng_config("wmark_metric=none\nwmark_high=300\nwmark_mid=400\n", &params), 0);
+    CU_ASSERT_EQUAL(params.wmarks.metric, DAMOS_WMARK_NONE);
+
+    CU_ASSERT_EQUAL(damon_fill_eng_config("wmark_metric=free_mem_rate\nwmark_interval=1000000\n"
+                                          "wmark_high=1000\nwmark_mid=400\nwmark_low=400\n"
+                                          "schemes=0,4096,0,0,10,100,cold\n", &params), 0);
+    CU_ASSERT_EQUAL(params.wmarks.metric, DAMOS_WMARK_FREE_MEM_RATE);
+    CU_ASSERT_EQUAL(params.wmarks.interval, 1000000);
+    CU_ASSERT_EQUAL(params.wmarks.high, 1000);
+    CU_ASSERT_EQUAL(params.wmarks.low, 400);
+    /* the watermarks are shared by all the schemes */
+    CU_ASSERT_EQUAL(params.schemes[0].wmarks.metric, DAMOS_WMARK_FREE_MEM_RATE);
+    CU_ASSERT_EQUAL(params.schemes[1].wmarks.mid, 400);
+}
+
+typedef enum {
+    CUNIT_SCREEN = 0,
+    CUNIT_XMLFILE,
+    CUNIT_CONSOLE
+} cu_run_mode;
+
+int main(int argc, const char **argv)
+{
+    CU_pSuite suite;
+    unsigned int num_failures;
+    cu_run_mode cunit_mode = CUNIT_SCREEN;
+    int error_num;
+
+    if (argc > 1) {
+        cunit_mode = atoi(argv[1]);
+    }
+
+    if (CU_initialize_registry() != CUE_SUCCESS) {
+        return -CU_get_error();
+    }
+
+    suite = CU_add_suite("etmem_damon_ops", NULL, NULL);
+    if (suite == NULL) {
+        goto ERROR;
+    }
+
+    if (CU_ADD_TEST(suite, test_etmem_damon_schemes_error) == NULL ||
+        CU_ADD_TEST(suite, test_etmem_damon_schemes_ok) == NULL ||
+        CU_ADD_TEST(suite, test_etmem_damon_quota_error) == NULL ||
+        CU_ADD_TEST(suite, test_etmem_damon_quota_ok) == NULL ||
+        CU_ADD_TEST(suite, test_etmem_damon_wmarks_error) == NULL ||
+        CU_ADD_TEST(suite, test_etmem_damon_wmarks_ok) == NULL) {
+            printf("CU_ADD_TEST fail. \n");
+            goto ERROR;
+    }
+
+    switch (cunit_mode) {
+        case CUNIT_SCREEN:
+            CU_basic_set_mode(CU_BRM_VERBOSE);
+            CU_basic_run_tests();
+            break;
+        case CUNIT_XMLFILE:
+            CU_set_output_filename("etmemd_damon.c");
+            CU_automated_run_tests();
+            break;
+        case CUNIT_CONSOLE:
+            CU_console_run_tests();
+            break;
+        default:
+            printf("not support cunit mode, only support: "
+                   "0 for CUNIT_SCREEN, 1 for CUNIT_XMLFILE, 2 for CUNIT_CONSOLE\n");
+            goto ERROR;
+    }
+
+    num_failures = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    return num_failures;
+
+ERROR:
+    error_num = CU_get_error();
+    CU_cleanup_registry();
+    return -error_num;
+}
@@ -14,9 +14,14 @@
  ******************************************************************************/
 
 #include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "etmemd.h"
 #include "etmemd_migrate.h"
@@ -25,12 +30,26 @@
 #include "etmemd_engine_exp.h"
 #include "etmemd_task_exp.h"
 #include "etmemd_task.h"
+#include "etmemd_meminfo.h"
+#include "etmemd_bandwidth.h"
 
 #include <CUnit/Basic.h>
 #include <CUnit/Automated.h>
 #include <CUnit/Console.h>
 
 #define WATER_LINE_TEMP 2
+#define EVICT_TEST_PAGES 64
+#define EVICT_TEST_FILE "evict_test.data"
+
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434
+#endif
+
+/* 4 MB/s split by weight 1 and 3 */
+#define BW_TEST_RATE        4
+#define BW_TEST_LIGHT       1
+#define BW_TEST_HEAVY       3
+#define BW_TEST_MB          (1UL << 20)
 
 /* Function replacement used for mock test. This function is used only in dt. */
 int get_mem_from_proc_file(const char *pid, const char *file_name,
@@ -40,6 +59,21 @@ int get_mem_from_proc_file(const char *pid, const char *file_name,
     return 0;
 }
 
+int etmemd_get_meminfo(struct meminfo *info)
+{
+    info->mem_total = 100;
+    info->mem_free = 100;
+    info->swap_cached = 100;
+    return 0;
+}
+
+int etmemd_read_pid_status(const char *pid, struct pid_status *status)
+{
+    status->vm_rss = 100;
+    status->vm_swap = 100;
+    return 0;
+}
+
 void init_task_pid_param(struct task_pid *param)
 {
     param->pid = 1;
@@ -83,15 +117,15 @@ static void test_etmem_migrate_error(void)
     memory_grade = (struct memory_grade *)calloc(1, sizeof(struct memory_grade));
     CU_ASSERT_PTR_NOT_NULL(memory_grade);
 
-    CU_ASSERT_EQUAL(etmemd_grade_migrate("", memory_grade), 0);
-    CU_ASSERT_EQUAL(etmemd_grade_migrate("no123", memory_grade), 0);
+    CU_ASSERT_EQUAL(etmemd_grade_migrate("", memory_grade, NULL), 0);
+    CU_ASSERT_EQUAL(etmemd_grade_migrate("no123", memory_grade, NULL), 0);
 
     free(memory_grade);
 
     memory_grade = get_memory_grade();
     CU_ASSERT_PTR_NOT_NULL(memory_grade);
-    CU_ASSERT_EQUAL(etmemd_grade_migrate("", memory_grade), -1);
-    CU_ASSERT_EQUAL(etmemd_grade_migrate("no123", memory_grade), -1);
+    CU_ASSERT_EQUAL(etmemd_grade_migrate("", memory_grade, NULL), -1);
+    CU_ASSERT_EQUAL(etmemd_grade_migrate("no123", memory_grade, NULL), -1);
 
     clean_memory_grade_unexpected(&memory_grade);
     CU_ASSERT_PTR_NULL(memory_grade);
@@ -103,12 +137,66 @@ static void test_etmem_migrate_ok(void)
 
     memory_grade = get_memory_grade();
     CU_ASSERT_PTR_NOT_NULL(memory_grade);
-    CU_ASSERT_EQUAL(etmemd_grade_migrate("1", memory_grade), 0);
+    CU_ASSERT_EQUAL(etmemd_grade_migrate("1", memory_grade, NULL), 0);
 
     clean_memory_grade_unexpected(&memory_grade);
     CU_ASSERT_PTR_NULL(memory_grade);
 }
 
+static void test_etmem_evict_madvise(void)
+{
+    struct page_refs page_refs[EVICT_TEST_PAGES] = {0};
+    struct memory_grade memory_grade = {0};
+    struct project proj = {0};
+    char pid_str[PID_STR_MAX_LEN] = {0};
+    long pagesize = sysconf(_SC_PAGESIZE);
+    size_t len = EVICT_TEST_PAGES * pagesize;
+    char *addr = NULL;
+    int pidfd;
+    int fd;
+    int i;
+
+    init_g_page_size();
+    fd = open(EVICT_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    CU_ASSERT_NOT_EQUAL(fd, -1);
+    CU_ASSERT_EQUAL(ftruncate(fd, len), 0);
+    addr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    CU_ASSERT_NOT_EQUAL(addr, MAP_FAILED);
+
+    /* cold pages in reverse order with a duplicate, they are sorted and merged before advise */
+    for (i = 0; i < EVICT_TEST_PAGES; i++) {
+        addr[i * pagesize] = 1;
+        page_refs[i].addr = (uint64_t)(uintptr_t)(addr + (i == 0 ? pagesize : i * pagesize));
+        page_refs[i].type = PTE_TYPE;
+        page_refs[i].next = memory_grade.cold_pages;
+        memory_grade.cold_pages = &page_refs[i];
+    }
+    CU_ASSERT_EQUAL(msync(addr, len, MS_SYNC), 0);
+
+    CU_ASSERT_NOT_EQUAL(snprintf(pid_str, PID_STR_MAX_LEN, "%d", getpid()), -1);
+    proj.evict_backend = EVICT_PAGEOUT;
+    CU_ASSERT_EQUAL(etmemd_grade_evict(pid_str, -1, &memory_grade, &proj), 0);
+    CU_ASSERT_EQUAL(etmemd_grade_evict("no123", -1, &memory_grade, &proj), -1);
+    proj.evict_backend = EVICT_COLD;
+    CU_ASSERT_EQUAL(etmemd_grade_evict(pid_str, -1, &memory_grade, &proj), 0);
+
+    /* the pidfd held is used and left open */
+    pidfd = (int)syscall(__NR_pidfd_open, getpid(), 0);
+    CU_ASSERT_NOT_EQUAL(pidfd, -1);
+    CU_ASSERT_EQUAL(etmemd_grade_evict(pid_str, pidfd, &memory_grade, &proj), 0);
+    CU_ASSERT_NOT_EQUAL(fcntl(pidfd, F_GETFD), -1);
+    close(pidfd);
+    CU_ASSERT_EQUAL(etmemd_resolve_evict_backend(EVICT_COLD), EVICT_COLD);
+    CU_ASSERT_NOT_EQUAL(etmemd_resolve_evict_backend(EVICT_AUTO), EVICT_AUTO);
+
+    munmap(addr, len);
+    /* the ranges are gone, nothing could be advised */
+    proj.evict_backend = EVICT_PAGEOUT;
+    CU_ASSERT_EQUAL(etmemd_grade_evict(pid_str, -1, &memory_grade, &proj), -1);
+    close(fd);
+    unlink(EVICT_TEST_FILE);
+}
+
 static void test_etmemd_reclaim_swapcache_error(void)
 {
     struct project proj = {0};
@@ -161,6 +249,98 @@ static void test_etmemd_reclaim_swapcache_ok(void)
     CU_ASSERT_EQUAL(etmemd_reclaim_swapcache(&tk_pid), 0);
 }
 
+static double bw_test_elapsed(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1000000000;
+}
+
+static void bw_test_shares(struct bw_share **light, struct bw_share **heavy)
+{
+    /* the shares start empty, and set_rate drops the spare left by earlier cases */
+    CU_ASSERT_EQUAL(etmemd_bw_set_rate(BW_SWAP, 0), 0);
+    *light = etmemd_bw_share_alloc("light", BW_TEST_LIGHT);
+    *heavy = etmemd_bw_share_alloc("heavy", BW_TEST_HEAVY);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(*light);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(*heavy);
+    CU_ASSERT_EQUAL(etmemd_bw_set_rate(BW_SWAP, BW_TEST_RATE), 0);
+}
+
+static void test_bw_acquire_error(void)
+{
+    struct bw_share *share = NULL;
+    struct timespec start;
+
+    CU_ASSERT_PTR_NULL(etmemd_bw_share_alloc("zero", 0));
+    CU_ASSERT_PTR_NULL(etmemd_bw_share_alloc("large", BW_WEIGHT_MAX + 1));
+    CU_ASSERT_EQUAL(etmemd_bw_set_rate(BW_SWAP, BW_RATE_MAX + 1), -1);
+    CU_ASSERT_EQUAL(etmemd_bw_set_rate(BW_CLASS_NR, 1), -1);
+
+    /* no limit, nothing waits however much is taken */
+    CU_ASSERT_EQUAL(etmemd_bw_set_rate(BW_SWAP, 0), 0);
+    share = etmemd_bw_share_alloc("free", BW_WEIGHT_DEFAULT);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(share);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    etmemd_bw_acquire(share, BW_SWAP, BW_RATE_MAX * BW_TEST_MB);
+    etmemd_bw_acquire(share, BW_SWAP, BW_RATE_MAX * BW_TEST_MB);
+    etmemd_bw_acquire(NULL, BW_SWAP, BW_RATE_MAX * BW_TEST_MB);
+    CU_ASSERT_TRUE(bw_test_elapsed(&start) < 0.1);
+    etmemd_bw_share_free(share);
+    etmemd_bw_share_free(NULL);
+}
+
+static void test_bw_acquire_weight(void)
+{
+    struct bw_share *light = NULL;
+    struct bw_share *heavy = NULL;
+    struct timespec start;
+    double heavy_wait, light_wait;
+
+    bw_test_shares(&light, &heavy);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* the first request of each is granted at once and overdraws the share */
+    etmemd_bw_acquire(light, BW_SWAP, BW_TEST_MB);
+    etmemd_bw_acquire(heavy, BW_SWAP, BW_TEST_MB);
+    CU_ASSERT_TRUE(bw_test_elapsed(&start) < 0.1);
+
+    /* the next waits until the debt is paid back, 1 MB at 3 MB/s and at 1 MB/s */
+    etmemd_bw_acquire(heavy, BW_SWAP, 1);
+    heavy_wait = bw_test_elapsed(&start);
+    etmemd_bw_acquire(light, BW_SWAP, 1);
+    light_wait = bw_test_elapsed(&start);
+    CU_ASSERT_TRUE(heavy_wait > 0.25 && heavy_wait < 0.6);
+    CU_ASSERT_TRUE(light_wait > 0.85 && light_wait < 1.5);
+
+    etmemd_bw_share_free(light);
+    etmemd_bw_share_free(heavy);
+    CU_ASSERT_EQUAL(etmemd_bw_set_rate(BW_SWAP, 0), 0);
+}
+
+static void test_bw_acquire_spare(void)
+{
+    struct bw_share *light = NULL;
+    struct bw_share *heavy = NULL;
+    struct timespec start;
+
+    bw_test_shares(&light, &heavy);
+
+    /* both shares are full after 1.5s, 1 MB and 3 MB, and 2 MB more overflows to the spare */
+    usleep(1500000);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    etmemd_bw_acquire(light, BW_SWAP, 2 * BW_TEST_MB);
+    etmemd_bw_acquire(light, BW_SWAP, BW_TEST_MB / 2);
+    etmemd_bw_acquire(light, BW_SWAP, BW_TEST_MB / 2);
+    /* 3 MB taken by the light share, which refills only 1 MB/s itself */
+    CU_ASSERT_TRUE(bw_test_elapsed(&start) < 0.5);
+
+    etmemd_bw_share_free(light);
+    etmemd_bw_share_free(heavy);
+    CU_ASSERT_EQUAL(etmemd_bw_set_rate(BW_SWAP, 0), 0);
+}
+
 typedef enum {
     CUNIT_SCREEN = 0,
     CUNIT_XMLFILE,
@@ -190,6 +370,10 @@ int main(int argc, const char **argv)
 
     if (CU_ADD_TEST(suite, test_etmem_migrate_error) == NULL ||
         CU_ADD_TEST(suite, test_etmem_migrate_ok) == NULL ||
+        CU_ADD_TEST(suite, test_etmem_evict_madvise) == NULL ||
+        CU_ADD_TEST(suite, test_bw_acquire_error) == NULL ||
+        CU_ADD_TEST(suite, test_bw_acquire_weight) == NULL ||
+        CU_ADD_TEST(suite, test_bw_acquire_spare) == NULL ||
         CU_ADD_TEST(suite, test_etmemd_reclaim_swapcache_error) == NULL ||
         CU_ADD_TEST(suite, test_etmemd_reclaim_swapcache_ok) == NULL) {
             printf("CU_ADD_TEST fail. \n");
@@ -272,6 +272,183 @@ static void etmem_pro_add_swapcache_mark_ok(void)
     destroy_proj_config(config);
 }
 
+static void etmem_pro_add_evict_backend_error(void)
+{
+    struct proj_test_param param;
+    GKeyFile *config = NULL;
+
+    init_proj_param(&param);
+
+    param.evict_backend = "abc";
+    config = construct_proj_config(&param);
+    CU_ASSERT_EQUAL(etmemd_project_add(config), OPT_INVAL);
+    destroy_proj_config(config);
+
+    param.evict_backend = "pageout,cold";
+    config = construct_proj_config(&param);
+    CU_ASSERT_EQUAL(etmemd_project_add(config), OPT_INVAL);
+    destroy_proj_config(config);
+}
+
+static void etmem_pro_add_evict_backend_ok(void)
+{
+    const char *backends[] = {"auto", "swap_pages", "pageout", "cold"};
+    struct proj_test_param param;
+    GKeyFile *config = NULL;
+    unsigned int i;
+
+    init_proj_param(&param);
+
+    for (i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        param.evict_backend = backends[i];
+        config = construct_proj_config(&param);
+        CU_ASSERT_EQUAL(etmemd_project_add(config), OPT_SUCCESS);
+        CU_ASSERT_EQUAL(etmemd_project_remove(config), OPT_SUCCESS);
+        destroy_proj_config(config);
+    }
+}
+
+static void etmem_pro_add_scan_backend_error(void)
+{
+    struct proj_test_param param;
+    GKeyFile *config = NULL;
+
+    init_proj_param(&param);
+
+    param.scan_backend = "pagemap";
+    config = construct_proj_config(&param);
+    CU_ASSERT_EQUAL(etmemd_project_add(config), OPT_INVAL);
+    destroy_proj_config(config);
+}
+
+static void etmem_pro_add_scan_backend_ok(void)
+{
+    const char *backends[] = {"auto", "idle_pages", "page_idle", "pagemap_scan", "damon"};
+    struct proj_test_param param;
+    GKeyFile *config = NULL;
+    unsigned int i;
+
+    init_proj_param(&param);
+
+    for (i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        param.scan_backend = backends[i];
+        config = construct_proj_config(&param);
+        CU_ASSERT_EQUAL(etmemd_project_add(config), OPT_SUCCESS);
+        CU_ASSERT_EQUAL(etmemd_project_remove(config), OPT_SUCCESS);
+        destroy_proj_config(config);
+    }
+}
+
+static void etmem_pro_add_psi_error(void)
+{
+    struct proj_test_param param;
+    GKeyFile *config = NULL;
+
+    init_proj_param(&param);
+
+    param.psi_threshold = "100000";
+    param.psi_window = "100000";
+    config = construct_proj_config(&param);
+    CU_ASSERT_EQUAL(etmemd_project_add(config), OPT_INVAL);
+    destroy_proj_config(config);
+
+    param.psi_threshold = "3000000";
+    param.psi_window = "2000000";
+    config = construct_proj_config(&param);
+    CU_ASSERT_EQUAL(etmemd_project_add(config), OPT_INVAL);
+    destroy_proj_config(config);
+}
+
+static void etmem_pro_add_bw_weight_error(void)
+{
+    const char *weights[] = {"0", "101", "-1"};
+    struct proj_test_param param;
+    GKeyFile *config = NULL;
+    unsigned int i;
+
+    init_proj_param(&param);
+
+    for (i = 0; i < sizeof(weights) / sizeof(weights[0]); i++) {
+        param.bw_weight = weights[i];
+        config = construct_proj_config(&param);
+        CU_ASSERT_EQUAL(etmemd_project_add(config), OPT_INVAL);
+        destroy_proj_config(config);
+    }
+}
+
+static void etmem_pro_add_bw_weight_ok(void)
+{
+    const char *weights[] = {"1", "100"};
+    struct proj_test_param param;
+    GKeyFile *config = NULL;
+    unsigned int i;
+
+    init_proj_param(&param);
+
+    for (i = 0; i < sizeof(weights) / sizeof(weights[0]); i++) {
+        param.bw_weight = weights[i];
+        config = construct_proj_config(&param);
+        CU_ASSERT_EQUAL(etmemd_project_add(config), OPT_SUCCESS);
+        CU_ASSERT_EQUAL(etmemd_project_remove(config), OPT_SUCCESS);
+        destroy_proj_config(config);
+    }
+}
+
+static void etmem_pro_add_priority_error(void)
+{
+    const char *priorities[] = {"-1", "8"};
+    struct proj_test_param param;
+    GKeyFile *config = NULL;
+    unsigned int i;
+
+    init_proj_param(&param);
+
+    for (i = 0; i < sizeof(priorities) / sizeof(priorities[0]); i++) {
+        param.priority = priorities[i];
+        config = construct_proj_config(&param);
+        CU_ASSERT_EQUAL(etmemd_project_add(config), OPT_INVAL);
+        destroy_proj_config(config);
+    }
+}
+
+static void etmem_pro_add_priority_ok(void)
+{
+    const char *priorities[] = {"0", "7"};
+    struct proj_test_param param;
+    GKeyFile *config = NULL;
+    unsigned int i;
+
+    init_proj_param(&param);
+
+    for (i = 0; i < sizeof(priorities) / sizeof(priorities[0]); i++) {
+        param.priority = priorities[i];
+        config = construct_proj_config(&param);
+        CU_ASSERT_EQUAL(etmemd_project_add(config), OPT_SUCCESS);
+        CU_ASSERT_EQUAL(etmemd_project_remove(config), OPT_SUCCESS);
+        destroy_proj_config(config);
+    }
+}
+
+static void etmem_pro_add_psi_ok(void)
+{
+    struct proj_test_param param;
+    GKeyFile *config = NULL;
+
+    init_proj_param(&param);
+
+    param.psi_threshold = "150000";
+    config = construct_proj_config(&param);
+    CU_ASSERT_EQUAL(etmemd_project_add(config), OPT_SUCCESS);
+    CU_ASSERT_EQUAL(etmemd_project_remove(config), OPT_SUCCESS);
+    destroy_proj_config(config);
+
+    param.psi_window = "10000000";
+    config = construct_proj_config(&param);
+    CU_ASSERT_EQUAL(etmemd_project_add(config), OPT_SUCCESS);
+    CU_ASSERT_EQUAL(etmemd_project_remove(config), OPT_SUCCESS);
+    destroy_proj_config(config);
+}
+
 static void etmem_pro_add_loop(void)
 {
     struct proj_test_param param;
@@ -388,6 +565,11 @@ void test_etmem_prj_add_error(void)
     etmem_pro_lack_loop();
     etmem_pro_add_sysmem_threshold_error();
     etmem_pro_add_swapcache_mark_error();
+    etmem_pro_add_evict_backend_error();
+    etmem_pro_add_scan_backend_error();
+    etmem_pro_add_psi_error();
+    etmem_pro_add_bw_weight_error();
+    etmem_pro_add_priority_error();
 }
 
 void test_etmem_prj_del_error(void)
@@ -415,6 +597,11 @@ static void add_project_once(void)
 
     etmem_pro_add_sysmem_threshold_ok();
     etmem_pro_add_swapcache_mark_ok();
+    etmem_pro_add_evict_backend_ok();
+    etmem_pro_add_scan_backend_ok();
+    etmem_pro_add_psi_ok();
+    etmem_pro_add_bw_weight_ok();
+    etmem_pro_add_priority_ok();
     init_proj_param(&param);
 
     CU_ASSERT_EQUAL(etmemd_project_show(NULL, 0), OPT_SUCCESS);
@@ -15,14 +15,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 
 #include <CUnit/Basic.h>
 #include <CUnit/Automated.h>
 #include <CUnit/Console.h>
 
 #include "etmemd_scan.h"
+#include "etmemd_page_idle.h"
+#include "etmemd_damon_scan.h"
 #include "etmemd_project.h"
 #include "etmemd_engine.h"
+#include "etmemd_record.h"
+
+#include "etmemd_page_idle.c"
+
+#define RECORD_LLT_FILE "/tmp/etmem_record_llt"
+#define PAGEMAP_LLT_PAGES 64
 
 static struct task_pid *alloc_tkpid(unsigned int pid, struct task *tk)
 {
@@ -311,6 +323,218 @@ static void test_etmem_scan_ok(void)
     etmemd_scan_exit();
 }
 
+static void test_page_idle_scan(void)
+{
+    const char *pid = "1";
+    struct vmas *vmas = NULL;
+    struct page_refs *page_refs = NULL;
+    unsigned long use_rss = 0;
+    int expect = page_idle_supported() ? 0 : -1;
+
+    CU_ASSERT_EQUAL(etmemd_scan_init(), 0);
+
+    vmas = get_vmas(pid);
+    CU_ASSERT_PTR_NOT_NULL(vmas);
+
+    CU_ASSERT_EQUAL(etmemd_resolve_scan_backend(SCAN_BACKEND_PAGE_IDLE), SCAN_BACKEND_PAGE_IDLE);
+    CU_ASSERT_NOT_EQUAL(etmemd_resolve_scan_backend(SCAN_BACKEND_AUTO), SCAN_BACKEND_AUTO);
+
+    // pid not exist
+    CU_ASSERT_EQUAL(get_page_refs_by_page_idle(vmas, "0", &page_refs, NULL), -1);
+    CU_ASSERT_PTR_NULL(page_refs);
+
+    // the first pass sees all the pages accessed, the second one only the pages touched between
+    CU_ASSERT_EQUAL(get_page_refs_by_page_idle(vmas, pid, &page_refs, &use_rss), expect);
+    if (expect == 0) {
+        CU_ASSERT_PTR_NOT_NULL(page_refs);
+        CU_ASSERT_NOT_EQUAL(use_rss, 0);
+        CU_ASSERT_EQUAL(get_page_refs_by_page_idle(vmas, pid, &page_refs, NULL), 0);
+    }
+
+    etmemd_free_page_refs(page_refs);
+    free_vmas(vmas);
+    etmemd_scan_exit();
+}
+
+static void test_page_idle_huge_page(void)
+{
+    struct page_idle_ctx ctx = {0};
+    struct page_refs *page_refs = NULL;
+    unsigned long use_rss = 0;
+    unsigned int words;
+    uint64_t start;
+    unsigned int i;
+
+    CU_ASSERT_EQUAL(etmemd_scan_init(), 0);
+    ctx.pte_size = (uint64_t)page_type_to_size(PTE_TYPE);
+    ctx.pmd_size = (uint64_t)page_type_to_size(PMD_TYPE);
+    ctx.pages_per_pmd = (unsigned int)(ctx.pmd_size / ctx.pte_size);
+    words = (ctx.pages_per_pmd + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
+    ctx.pagemap = (uint64_t *)calloc(ctx.pages_per_pmd, sizeof(uint64_t));
+    ctx.present = (uint64_t *)calloc(words, sizeof(uint64_t));
+    ctx.idle = (uint64_t *)calloc(words, sizeof(uint64_t));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(ctx.pagemap);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(ctx.present);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(ctx.idle);
+
+    // a pmd mapped huge page, whose head is idle and whose tails read as accessed
+    start = ctx.pmd_size * 16;
+    for (i = 0; i < ctx.pages_per_pmd; i++) {
+        ctx.pagemap[i] = PAGEMAP_PRESENT | (ctx.pages_per_pmd * 8 + i);
+        set_bit64(ctx.present, i);
+    }
+    set_bit64(ctx.idle, 0);
+    CU_ASSERT_PTR_NOT_NULL(record_batch(&ctx, start, ctx.pages_per_pmd, &page_refs, &use_rss));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(page_refs);
+    CU_ASSERT_EQUAL(page_refs->addr, start);
+    CU_ASSERT_EQUAL(page_refs->type, PMD_TYPE);
+    CU_ASSERT_EQUAL(page_refs->count, IDLE_TYPE_WEIGHT);
+    CU_ASSERT_PTR_NULL(page_refs->next);
+    CU_ASSERT_EQUAL(use_rss, 0);
+    etmemd_free_page_refs(page_refs);
+    page_refs = NULL;
+
+    // the head accessed, whatever the tails read
+    memset(ctx.idle, 0xff, words * sizeof(uint64_t));
+    ctx.idle[0] &= ~1ULL;
+    CU_ASSERT_PTR_NOT_NULL(record_batch(&ctx, start, ctx.pages_per_pmd, &page_refs, &use_rss));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(page_refs);
+    CU_ASSERT_EQUAL(page_refs->type, PMD_TYPE);
+    CU_ASSERT_EQUAL(page_refs->count, READ_TYPE_WEIGHT);
+    CU_ASSERT_EQUAL(use_rss, 1);
+    etmemd_free_page_refs(page_refs);
+
+    free(ctx.pagemap);
+    free(ctx.present);
+    free(ctx.idle);
+    etmemd_scan_exit();
+}
+
+/* a child with some pages written, which is scanned instead of a process of the host */
+static pid_t fork_pagemap_child(void)
+{
+    long page_size = sysconf(_SC_PAGESIZE);
+    char ready = 0;
+    char *addr = NULL;
+    int fds[2];
+    pid_t child;
+
+    CU_ASSERT_EQUAL_FATAL(pipe(fds), 0);
+    child = fork();
+    if (child == 0) {
+        close(fds[0]);
+        addr = mmap(NULL, page_size * PAGEMAP_LLT_PAGES, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr != MAP_FAILED) {
+            memset(addr, 1, page_size * PAGEMAP_LLT_PAGES);
+        }
+        if (write(fds[1], &ready, 1) != 1) {
+            _exit(1);
+        }
+        while (true) {
+            pause();
+        }
+    }
+
+    close(fds[1]);
+    CU_ASSERT_NOT_EQUAL(child, -1);
+    CU_ASSERT_EQUAL(read(fds[0], &ready, 1), 1);
+    close(fds[0]);
+    return child;
+}
+
+static void test_pagemap_scan(void)
+{
+    char pid[PID_STR_MAX_LEN] = {0};
+    struct vmas *vmas = NULL;
+    struct page_refs *page_refs = NULL;
+    unsigned long use_rss = 0;
+    pid_t child;
+
+    CU_ASSERT_EQUAL(etmemd_scan_init(), 0);
+
+    /* pagemap_scan sees the pages only read idle, and is never chosen by auto */
+    CU_ASSERT_NOT_EQUAL(etmemd_resolve_scan_backend(SCAN_BACKEND_AUTO), SCAN_BACKEND_PAGEMAP_SCAN);
+
+    if (!pagemap_scan_supported()) {
+        CU_ASSERT_EQUAL(etmemd_resolve_scan_backend(SCAN_BACKEND_PAGEMAP_SCAN), SCAN_BACKEND_IDLE_PAGES);
+        etmemd_scan_exit();
+        return;
+    }
+
+    CU_ASSERT_EQUAL(etmemd_resolve_scan_backend(SCAN_BACKEND_PAGEMAP_SCAN), SCAN_BACKEND_PAGEMAP_SCAN);
+
+    child = fork_pagemap_child();
+    CU_ASSERT_NOT_EQUAL(snprintf(pid, sizeof(pid), "%d", child), -1);
+    vmas = get_vmas(pid);
+    CU_ASSERT_PTR_NOT_NULL(vmas);
+
+    // pid not exist
+    CU_ASSERT_EQUAL(get_page_refs_by_pagemap_scan(vmas, "0", &page_refs, NULL), -1);
+    CU_ASSERT_PTR_NULL(page_refs);
+
+    // the pages written by the child are soft dirty before the first clear
+    CU_ASSERT_EQUAL(get_page_refs_by_pagemap_scan(vmas, pid, &page_refs, &use_rss), 0);
+    CU_ASSERT_PTR_NOT_NULL(page_refs);
+    CU_ASSERT_NOT_EQUAL(use_rss, 0);
+    CU_ASSERT_EQUAL(get_page_refs_by_pagemap_scan(vmas, pid, &page_refs, NULL), 0);
+
+    etmemd_free_page_refs(page_refs);
+    free_vmas(vmas);
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    etmemd_scan_exit();
+}
+
+static void test_damon_scan(void)
+{
+    struct page_refs *page_refs = NULL;
+    struct page_refs *iter = NULL;
+    struct region_scan attrs;
+    struct vma vma = {0};
+    struct vmas vmas = {1, &vma};
+    struct damon_region regions[2];
+    unsigned long use_rss = 0;
+    char pid[PID_STR_MAX_LEN] = {0};
+    long page_size = sysconf(_SC_PAGESIZE);
+    char *addr = NULL;
+    int nr = 0;
+
+    CU_ASSERT_EQUAL(etmemd_scan_init(), 0);
+    damon_scan_default_attrs(&attrs);
+
+    if (damon_scan_supported()) {
+        CU_ASSERT_EQUAL(etmemd_resolve_scan_backend(SCAN_BACKEND_DAMON), SCAN_BACKEND_DAMON);
+    } else {
+        CU_ASSERT_EQUAL(etmemd_resolve_scan_backend(SCAN_BACKEND_DAMON), SCAN_BACKEND_IDLE_PAGES);
+    }
+
+    // pid not exist
+    CU_ASSERT_EQUAL(get_page_refs_by_damon(&vmas, "0", &attrs, &page_refs, NULL), -1);
+    CU_ASSERT_PTR_NULL(page_refs);
+
+    // the first region is hot and the second one cold, the last page is never touched
+    addr = mmap(NULL, page_size * 4, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CU_ASSERT_NOT_EQUAL(addr, MAP_FAILED);
+    memset(addr, 1, page_size * 3);
+    vma.start = (uint64_t)addr;
+    vma.end = (uint64_t)addr + page_size * 4;
+    regions[0] = (struct damon_region){vma.start, vma.start + page_size * 2, 20, 0};
+    regions[1] = (struct damon_region){vma.start + page_size * 2, vma.end, 0, 10};
+
+    CU_ASSERT_NOT_EQUAL(snprintf(pid, sizeof(pid), "%d", getpid()), -1);
+    CU_ASSERT_EQUAL(damon_regions_to_page_refs(&vmas, pid, regions, 2, 20, &page_refs, &use_rss), 0);
+    for (iter = page_refs; iter != NULL; iter = iter->next, nr++) {
+        CU_ASSERT_EQUAL(iter->count, nr < 2 ? MAX_ACCESS_WEIGHT : IDLE_TYPE_WEIGHT);
+    }
+    CU_ASSERT_EQUAL(nr, 3);
+    CU_ASSERT_EQUAL(use_rss, 2);
+
+    etmemd_free_page_refs(page_refs);
+    munmap(addr, page_size * 4);
+    etmemd_scan_exit();
+}
+
 static void test_add_pg_to_mem_grade()
 {
     const char *pid = "1";
@@ -332,6 +556,71 @@ static void test_add_pg_to_mem_grade()
     etmemd_scan_exit();
 }
 
+static void test_record_scan(void)
+{
+    struct vma vma = {0};
+    struct vmas vmas = {1, &vma};
+    struct pid_status status = {1, 2, 3, 4};
+    struct record_reader reader = {0};
+    const struct record_entry *entry = NULL;
+    const void *payload = NULL;
+    struct page_refs *page_refs = NULL;
+    struct page_refs **pos = &page_refs;
+    struct page_refs *iter = NULL;
+    char pid[PID_STR_MAX_LEN] = {0};
+    uint64_t start = 0x7f0000200000ULL;
+    /* set the address to start, then 3 accessed and 2 idle pages of 4k */
+    unsigned char buf[] = {PIP_CMD_SET_HVA, 0x00, 0x00, 0x7f, 0x00, 0x00, 0x20, 0x00, 0x00,
+                           (PTE_ACCESS << 4) | 3, (PTE_IDLE << 4) | 2};
+    int nr = 0;
+
+    CU_ASSERT_EQUAL(etmemd_scan_init(), 0);
+    CU_ASSERT_NOT_EQUAL(snprintf(pid, sizeof(pid), "%d", getpid()), -1);
+    vma.start = start;
+    vma.end = start + 5 * page_type_to_size(PTE_TYPE);
+
+    /* nothing is written before the record starts */
+    etmemd_record_scan(getpid(), start, buf, sizeof(buf));
+    CU_ASSERT_EQUAL(etmemd_record_set_file(RECORD_LLT_FILE), 0);
+    CU_ASSERT_EQUAL(etmemd_record_start(), 0);
+    etmemd_record_vmas("invalid", &vmas);
+    etmemd_record_vmas(pid, &vmas);
+    etmemd_record_scan(getpid(), start, buf, sizeof(buf));
+    etmemd_record_pid_status(pid, &status);
+    etmemd_record_stop();
+
+    CU_ASSERT_EQUAL(etmemd_record_open(RECORD_LLT_FILE, &reader), 0);
+    CU_ASSERT_EQUAL(etmemd_record_next(&reader, &entry, &payload), 1);
+    CU_ASSERT_EQUAL(entry->type, RECORD_VMAS);
+    CU_ASSERT_EQUAL(entry->pid, (uint32_t)getpid());
+    CU_ASSERT_EQUAL(((const struct record_vmas *)payload)->nr, 1);
+    CU_ASSERT_EQUAL(((const struct record_vmas *)payload)->vma[0].end, vma.end);
+
+    CU_ASSERT_EQUAL(etmemd_record_next(&reader, &entry, &payload), 1);
+    CU_ASSERT_EQUAL(entry->type, RECORD_SCAN);
+    CU_ASSERT_EQUAL(((const struct record_scan *)payload)->start, start);
+    CU_ASSERT_EQUAL(etmemd_parse_scan_buf(((const struct record_scan *)payload)->buf,
+                                          entry->len - sizeof(struct record_scan), &pos), 0);
+    for (iter = page_refs; iter != NULL; iter = iter->next, nr++) {
+        CU_ASSERT_EQUAL(iter->addr, start + nr * page_type_to_size(PTE_TYPE));
+        CU_ASSERT_EQUAL(iter->count, nr < 3 ? READ_TYPE_WEIGHT : IDLE_TYPE_WEIGHT);
+    }
+    CU_ASSERT_EQUAL(nr, 5);
+    etmemd_free_page_refs(page_refs);
+
+    CU_ASSERT_EQUAL(etmemd_record_next(&reader, &entry, &payload), 1);
+    CU_ASSERT_EQUAL(entry->type, RECORD_PID_STATUS);
+    CU_ASSERT_EQUAL(((const struct record_pid_status *)payload)->rss_file, 4);
+    CU_ASSERT_EQUAL(etmemd_record_next(&reader, &entry, &payload), 0);
+    etmemd_record_close(&reader);
+
+    /* not a record file */
+    CU_ASSERT_EQUAL(etmemd_record_open("/proc/self/status", &reader), -1);
+
+    unlink(RECORD_LLT_FILE);
+    etmemd_scan_exit();
+}
+
 typedef enum {
     CUNIT_SCREEN = 0,
     CUNIT_XMLFILE,
@@ -363,7 +652,12 @@ int main(int argc, const char **argv)
         CU_ADD_TEST(suite, test_get_page_refs) == NULL ||
         CU_ADD_TEST(suite, test_scan_error) == NULL ||
         CU_ADD_TEST(suite, test_etmem_scan_ok) == NULL ||
-        CU_ADD_TEST(suite, test_add_pg_to_mem_grade) == NULL) {
+        CU_ADD_TEST(suite, test_page_idle_scan) == NULL ||
+        CU_ADD_TEST(suite, test_page_idle_huge_page) == NULL ||
+        CU_ADD_TEST(suite, test_pagemap_scan) == NULL ||
+        CU_ADD_TEST(suite, test_damon_scan) == NULL ||
+        CU_ADD_TEST(suite, test_add_pg_to_mem_grade) == NULL ||
+        CU_ADD_TEST(suite, test_record_scan) == NULL) {
             goto ERROR;
     }
 
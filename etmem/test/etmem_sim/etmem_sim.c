@@ -0,0 +1,465 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2021. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: build a simulated /proc tree of many large processes for etmemd -P to run against
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "securec.h"
+
+#define SIM_COMM                "etmem_sim"
+#define SIM_DEFAULT_NR          1000
+#define SIM_DEFAULT_SIZE_GB     256
+#define SIM_DEFAULT_VMA_GB      1
+#define SIM_DEFAULT_HOT         20
+/* above PID_MAX_LIMIT, so that no pid simulated is the one of a real process */
+#define SIM_DEFAULT_PID         5000000
+#define SIM_PID_MAX             0xFFFFFFFFU
+
+#define SIM_BASE_ADDR           0x100000000ULL
+#define SIM_PMD_SIZE            (2ULL << 20)
+#define SIM_GB                  (1ULL << 30)
+#define SIM_KB                  1024ULL
+#define SIM_PERCENT             100
+
+/* the same as enum page_idle_type of etmemd_scan.h */
+#define SIM_PMD_ACCESS          1
+#define SIM_PMD_IDLE            6
+#define SIM_PIP_CMD             10
+#define SIM_PIP_CMD_SET_HVA     (unsigned char)((SIM_PIP_CMD << 4) & 0xF0)
+#define SIM_PIP_NR_MAX          0xF
+#define SIM_ADDR_BYTES          8
+#define SIM_BYTE_BITS           8
+
+#define SIM_BUF_LEN             4096
+
+struct sim_param {
+    const char *dir;
+    const char *config;
+    unsigned int nr;
+    unsigned long long size;    /* bytes of each process */
+    unsigned long long vma;     /* bytes of each vma */
+    unsigned int hot;           /* percent of 2M pages accessed */
+    unsigned int pid;           /* the first pid */
+};
+
+static void usage(void)
+{
+    printf("\nUsage of etmem_sim:\n"
+           "    etmem_sim -d|--dir <dir> [options]\n\n"
+           "Build a simulated /proc under <dir> for etmemd -P <dir>, pids from -p are named "
+           SIM_COMM ".\n\n"
+           "Options:\n"
+           "   -d|--dir <dir>        root of the tree, which is better on a tmpfs\n"
+           "   -n|--nr <nr>          number of processes, %u by default\n"
+           "   -s|--size <GB>        memory of each process, %u by default\n"
+           "   -v|--vma <GB>         size of each vma, %u by default\n"
+           "   -H|--hot <percent>    2M pages accessed in each scan, %u by default\n"
+           "   -p|--pid <pid>        the first pid, %u by default\n"
+           "   -c|--config <file>    write a slide project with a task for each process to file\n"
+           "   -h|--help             show this message\n",
+           SIM_DEFAULT_NR, SIM_DEFAULT_SIZE_GB, SIM_DEFAULT_VMA_GB, SIM_DEFAULT_HOT, SIM_DEFAULT_PID);
+}
+
+static int parse_uint(const char *str, unsigned long long min, unsigned long long max,
+                      unsigned long long *val)
+{
+    char *end = NULL;
+
+    errno = 0;
+    *val = strtoull(str, &end, 0);
+    if (errno != 0 || end == str || *end != '\0' || *val < min || *val > max) {
+        printf("invalid value %s\n", str);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int parse_param(int argc, char *argv[], struct sim_param *param)
+{
+    const char *op_str = "d:n:s:v:H:p:c:h";
+    const struct option opts[] = {
+        {"dir", required_argument, NULL, 'd'},
+        {"nr", required_argument, NULL, 'n'},
+        {"size", required_argument, NULL, 's'},
+        {"vma", required_argument, NULL, 'v'},
+        {"hot", required_argument, NULL, 'H'},
+        {"pid", required_argument, NULL, 'p'},
+        {"config", required_argument, NULL, 'c'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    unsigned long long val;
+    int opt;
+    int ret = 0;
+
+    while (ret == 0 && (opt = getopt_long(argc, argv, op_str, opts, NULL)) != -1) {
+        switch (opt) {
+            case 'd':
+                param->dir = optarg;
+                break;
+            case 'n':
+                ret = parse_uint(optarg, 1, UINT_MAX, &val);
+                param->nr = (unsigned int)val;
+                break;
+            case 's':
+                ret = parse_uint(optarg, 1, UINT_MAX, &val);
+                param->size = val * SIM_GB;
+                break;
+            case 'v':
+                ret = parse_uint(optarg, 1, UINT_MAX, &val);
+                param->vma = val * SIM_GB;
+                break;
+            case 'H':
+                ret = parse_uint(optarg, 0, SIM_PERCENT, &val);
+                param->hot = (unsigned int)val;
+                break;
+            case 'p':
+                ret = parse_uint(optarg, 1, UINT_MAX, &val);
+                param->pid = (unsigned int)val;
+                break;
+            case 'c':
+                param->config = optarg;
+                break;
+            case 'h':
+                usage();
+                exit(0);
+            default:
+                ret = -1;
+                break;
+        }
+    }
+
+    if (ret != 0 || optind < argc || param->dir == NULL || param->dir[0] != '/') {
+        usage();
+        return -1;
+    }
+
+    if (param->vma > param->size) {
+        param->vma = param->size;
+    }
+
+    if ((unsigned long long)param->pid + param->nr - 1 > SIM_PID_MAX) {
+        printf("pids from %u overflow\n", param->pid);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int write_file(const char *path, const char *data, size_t len)
+{
+    int fd;
+    ssize_t ret;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        printf("open %s fail: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    ret = write(fd, data, len);
+    close(fd);
+    if (ret < 0 || (size_t)ret != len) {
+        printf("write %s fail\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int make_dir(const char *path)
+{
+    if (mkdir(path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) != 0 && errno != EEXIST) {
+        printf("mkdir %s fail: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/* xorshift, seeded by pid so that the same tree is built each time */
+static uint32_t sim_rand(uint32_t *seed)
+{
+    uint32_t x = *seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+static size_t put_run(unsigned char *buf, size_t pos, unsigned char type, unsigned int nr)
+{
+    while (nr > 0) {
+        unsigned int n = nr > SIM_PIP_NR_MAX ? SIM_PIP_NR_MAX : nr;
+
+        buf[pos++] = (unsigned char)((type << 4) | n);
+        nr -= n;
+    }
+
+    return pos;
+}
+
+/*
+ * The idle_pages of a vma is what the kernel returns for a read from its start: set the address,
+ * then runs of 2M pages accessed or idle. The rest of the read is zero, which means nothing.
+ * */
+static int write_vma_idle(int fd, unsigned long long start, unsigned long long len,
+                          unsigned int hot, uint32_t *seed)
+{
+    unsigned long long nr_pmd = len / SIM_PMD_SIZE;
+    /* the address, and a byte for each page at most */
+    size_t size = 1 + SIM_ADDR_BYTES + nr_pmd;
+    unsigned char *buf = NULL;
+    unsigned char type = 0;
+    unsigned int run = 0;
+    unsigned long long i;
+    size_t pos = 0;
+    int ret = 0;
+
+    buf = (unsigned char *)malloc(size);
+    if (buf == NULL) {
+        printf("malloc for idle pages fail\n");
+        return -1;
+    }
+
+    buf[pos++] = SIM_PIP_CMD_SET_HVA;
+    for (i = 0; i < SIM_ADDR_BYTES; i++) {
+        buf[pos++] = (unsigned char)(start >> ((SIM_ADDR_BYTES - 1 - i) * SIM_BYTE_BITS));
+    }
+
+    for (i = 0; i < nr_pmd; i++) {
+        unsigned char cur = sim_rand(seed) % SIM_PERCENT < hot ? SIM_PMD_ACCESS : SIM_PMD_IDLE;
+
+        if (run > 0 && cur != type) {
+            pos = put_run(buf, pos, type, run);
+            run = 0;
+        }
+        type = cur;
+        run++;
+    }
+    pos = put_run(buf, pos, type, run);
+
+    if (pwrite(fd, buf, pos, (off_t)start) != (ssize_t)pos) {
+        printf("write idle pages at %llx fail: %s\n", start, strerror(errno));
+        ret = -1;
+    }
+
+    free(buf);
+    return ret;
+}
+
+static int write_maps_and_idle(const char *dir, const struct sim_param *param, unsigned int pid)
+{
+    char path[PATH_MAX];
+    unsigned long long start = SIM_BASE_ADDR;
+    unsigned long long left = param->size;
+    uint32_t seed = pid | 1;
+    FILE *maps = NULL;
+    int fd;
+    int ret = 0;
+
+    if (snprintf_s(path, PATH_MAX, PATH_MAX - 1, "%s/maps", dir) <= 0) {
+        return -1;
+    }
+    maps = fopen(path, "w");
+    if (maps == NULL) {
+        printf("open %s fail: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (snprintf_s(path, PATH_MAX, PATH_MAX - 1, "%s/idle_pages", dir) <= 0) {
+        fclose(maps);
+        return -1;
+    }
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        printf("open %s fail: %s\n", path, strerror(errno));
+        fclose(maps);
+        return -1;
+    }
+
+    while (ret == 0 && left > 0) {
+        unsigned long long len = left > param->vma ? param->vma : left;
+
+        /* anonymous vma, the name is blank as the kernel pads it */
+        if (fprintf(maps, "%llx-%llx rw-p 00000000 00:00 0    \n", start, start + len) < 0) {
+            ret = -1;
+            break;
+        }
+        ret = write_vma_idle(fd, start, len, param->hot, &seed);
+        left -= len;
+        /* leave a hole so that vmas are not merged */
+        start += len + SIM_PMD_SIZE;
+    }
+
+    close(fd);
+    if (fclose(maps) != 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+static int write_pid(const struct sim_param *param, unsigned int pid)
+{
+    char dir[PATH_MAX];
+    char path[PATH_MAX];
+    char buf[SIM_BUF_LEN];
+    unsigned long long rss = param->size / SIM_KB;
+    int len;
+
+    if (snprintf_s(dir, PATH_MAX, PATH_MAX - 1, "%s/proc/%u", param->dir, pid) <= 0 ||
+        make_dir(dir) != 0) {
+        return -1;
+    }
+
+    if (snprintf_s(path, PATH_MAX, PATH_MAX - 1, "%s/comm", dir) <= 0 ||
+        write_file(path, SIM_COMM "\n", strlen(SIM_COMM "\n")) != 0) {
+        return -1;
+    }
+
+    len = snprintf_s(buf, SIM_BUF_LEN, SIM_BUF_LEN - 1,
+                     "Name:\t%s\nPid:\t%u\nVmRSS:\t%llu kB\nRssAnon:\t%llu kB\nRssFile:\t0 kB\n"
+                     "VmSwap:\t0 kB\n", SIM_COMM, pid, rss, rss);
+    if (len <= 0 || snprintf_s(path, PATH_MAX, PATH_MAX - 1, "%s/status", dir) <= 0 ||
+        write_file(path, buf, (size_t)len) != 0) {
+        return -1;
+    }
+
+    /* starttime is the 22nd field, and all processes start at the same time */
+    len = snprintf_s(buf, SIM_BUF_LEN, SIM_BUF_LEN - 1,
+                     "%u (%s) S 1 %u %u 0 -1 0 0 0 0 0 0 0 0 0 20 0 1 0 1 0 0\n",
+                     pid, SIM_COMM, pid, pid);
+    if (len <= 0 || snprintf_s(path, PATH_MAX, PATH_MAX - 1, "%s/stat", dir) <= 0 ||
+        write_file(path, buf, (size_t)len) != 0) {
+        return -1;
+    }
+
+    /* what etmemd swaps out is written to it, and it is never read */
+    if (snprintf_s(path, PATH_MAX, PATH_MAX - 1, "%s/swap_pages", dir) <= 0 ||
+        write_file(path, "", 0) != 0) {
+        return -1;
+    }
+
+    return write_maps_and_idle(dir, param, pid);
+}
+
+static int write_proc(const struct sim_param *param)
+{
+    char path[PATH_MAX];
+    char buf[SIM_BUF_LEN];
+    /* half of the memory is used by the processes */
+    unsigned long long total = (unsigned long long)param->nr * param->size / SIM_KB * 2;
+    int len;
+
+    if (snprintf_s(path, PATH_MAX, PATH_MAX - 1, "%s/proc", param->dir) <= 0 ||
+        make_dir(param->dir) != 0 || make_dir(path) != 0) {
+        return -1;
+    }
+
+    len = snprintf_s(buf, SIM_BUF_LEN, SIM_BUF_LEN - 1,
+                     "MemTotal:       %llu kB\nMemFree:        %llu kB\nMemAvailable:   %llu kB\n"
+                     "Cached:         0 kB\nSwapCached:     0 kB\nSwapTotal:      %llu kB\n"
+                     "SwapFree:       %llu kB\n", total, total / 2, total / 2, total, total);
+    if (len <= 0 || snprintf_s(path, PATH_MAX, PATH_MAX - 1, "%s/proc/meminfo", param->dir) <= 0 ||
+        write_file(path, buf, (size_t)len) != 0) {
+        return -1;
+    }
+
+    /* etmemd probes for the scan and evict backends by them */
+    if (snprintf_s(path, PATH_MAX, PATH_MAX - 1, "%s/proc/self", param->dir) <= 0 || make_dir(path) != 0 ||
+        snprintf_s(path, PATH_MAX, PATH_MAX - 1, "%s/proc/self/idle_pages", param->dir) <= 0 ||
+        write_file(path, "", 0) != 0 ||
+        snprintf_s(path, PATH_MAX, PATH_MAX - 1, "%s/proc/self/swap_pages", param->dir) <= 0 ||
+        write_file(path, "", 0) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int write_config(const struct sim_param *param)
+{
+    FILE *file = NULL;
+    unsigned int i;
+    int ret = 0;
+
+    file = fopen(param->config, "w");
+    if (file == NULL) {
+        printf("open %s fail: %s\n", param->config, strerror(errno));
+        return -1;
+    }
+
+    if (fprintf(file, "[project]\nname=sim\nscan_type=page\nloop=1\ninterval=1\nsleep=1\n\n"
+                "[engine]\nname=slide\nproject=sim\n") < 0) {
+        ret = -1;
+    }
+
+    for (i = 0; ret == 0 && i < param->nr; i++) {
+        if (fprintf(file, "\n[task]\nproject=sim\nengine=slide\nname=sim_%u\ntype=pid\nvalue=%u\n"
+                    "T=1\nmax_threads=1\n", param->pid + i, param->pid + i) < 0) {
+            ret = -1;
+        }
+    }
+
+    if (fclose(file) != 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    struct sim_param param = {
+        .nr = SIM_DEFAULT_NR,
+        .size = SIM_DEFAULT_SIZE_GB * SIM_GB,
+        .vma = SIM_DEFAULT_VMA_GB * SIM_GB,
+        .hot = SIM_DEFAULT_HOT,
+        .pid = SIM_DEFAULT_PID,
+    };
+    unsigned int i;
+
+    if (parse_param(argc, argv, &param) != 0) {
+        return -1;
+    }
+
+    if (write_proc(&param) != 0) {
+        return -1;
+    }
+
+    for (i = 0; i < param.nr; i++) {
+        if (write_pid(&param, param.pid + i) != 0) {
+            printf("build pid %u fail\n", param.pid + i);
+            return -1;
+        }
+    }
+
+    if (param.config != NULL && write_config(&param) != 0) {
+        return -1;
+    }
+
+    printf("%u processes of %llu GB are built under %s\n", param.nr, param.size / SIM_GB, param.dir);
+    return 0;
+}
@@ -15,6 +15,9 @@
 
 #include <sys/file.h>
 #include <sys/prctl.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -43,6 +46,7 @@
 #define PID_PROCESS_SLEEP_TIME  60
 #define WATER_LINT_TEMP         3
 #define RAND_STR_ARRAY_LEN      62
+#define SLIDE_CGROUP_DIR        "/tmp/etmem_slide_cgroup_llt/"
 
 static void test_engine_name_invalid(void)
 {
@@ -229,6 +233,15 @@ static void test_etmem_slide_task_001(void)
     task_test_fini();
 }
 
+static int slide_do_migrate_pid(unsigned int pid, const struct memory_grade *memory_grade)
+{
+    struct task_pid tk_pid = {0};
+
+    tk_pid.pid = pid;
+    tk_pid.pidfd = -1;
+    return slide_do_migrate(&tk_pid, memory_grade);
+}
+
 static void test_etmem_task_swap_flag_error(void)
 {
     struct slide_task_test_param slide_task;
@@ -276,7 +289,7 @@ static void test_etmem_task_swap_flag_error(void)
     destroy_slide_task_config(config);
 
     /* run slide_do_migrate fail */
-    CU_ASSERT_EQUAL(slide_do_migrate(1, NULL), -1);
+    CU_ASSERT_EQUAL(slide_do_migrate_pid(1, NULL), -1);
 
     task_test_fini();
 }
@@ -353,7 +366,7 @@ static void test_etmem_task_swap_threshold_error(void)
     destroy_slide_task_config(config);
 
     /* run slide_do_migrate fail */
-    CU_ASSERT_EQUAL(slide_do_migrate(1, NULL), -1);
+    CU_ASSERT_EQUAL(slide_do_migrate_pid(1, NULL), -1);
 
     task_test_fini();
 }
@@ -566,7 +579,7 @@ static void test_task_slide_invalid_config(void)
     destroy_slide_task_config(config);
 
     /* run slide_do_migrate fail */
-    CU_ASSERT_EQUAL(slide_do_migrate(1, NULL), -1);
+    CU_ASSERT_EQUAL(slide_do_migrate_pid(1, NULL), -1);
 }
 
 void test_etmem_slide_task_002(void)
@@ -579,6 +592,137 @@ void test_etmem_slide_task_002(void)
     task_test_fini();
 }
 
+static int count_page_refs(const struct page_refs *page_refs)
+{
+    int n = 0;
+
+    for (; page_refs != NULL; page_refs = page_refs->next) {
+        n++;
+    }
+    return n;
+}
+
+static void fill_cold_pages(struct memory_grade *memory_grade, int nr)
+{
+    struct page_refs *page_refs = NULL;
+    int i;
+
+    for (i = 0; i < nr; i++) {
+        page_refs = calloc(1, sizeof(struct page_refs));
+        CU_ASSERT_PTR_NOT_NULL_FATAL(page_refs);
+        page_refs->addr = (uint64_t)i << 12;
+        page_refs->count = i % 2;
+        page_refs->type = PTE_TYPE;
+        page_refs->next = memory_grade->cold_pages;
+        memory_grade->cold_pages = page_refs;
+    }
+}
+
+static void test_etmem_slide_arbitrate(void)
+{
+    struct page_scan page_scan = {.loop = 1, .interval = 1, .sleep = 1};
+    struct project proj = {0};
+    struct engine eng = {0};
+    struct task tk = {0};
+    struct task_pid tk_pid = {0};
+    struct memory_grade memory_grade = {0};
+
+    CU_ASSERT_EQUAL(init_g_page_size(), 0);
+    proj.scan_param = &page_scan;
+    eng.proj = &proj;
+    tk.eng = &eng;
+    tk_pid.tk = &tk;
+    tk_pid.pid = 1;
+
+    /* no sysmem_threshold, all the cold pages are evicted */
+    proj.sysmem_threshold = -1;
+    fill_cold_pages(&memory_grade, 8);
+    slide_arbitrate(&tk_pid, &memory_grade);
+    CU_ASSERT_EQUAL(count_page_refs(memory_grade.cold_pages), 8);
+    CU_ASSERT_PTR_NULL(memory_grade.hot_pages);
+
+    /* the host has enough free memory, no page needs to go */
+    proj.sysmem_threshold = 0;
+    slide_arbitrate(&tk_pid, &memory_grade);
+    CU_ASSERT_PTR_NULL(memory_grade.cold_pages);
+    CU_ASSERT_EQUAL(count_page_refs(memory_grade.hot_pages), 8);
+
+    /* the host can never be free enough, the pages are evicted anyway */
+    proj.sysmem_threshold = 100;
+    etmemd_free_page_refs(memory_grade.hot_pages);
+    memory_grade.hot_pages = NULL;
+    fill_cold_pages(&memory_grade, 8);
+    slide_arbitrate(&tk_pid, &memory_grade);
+    CU_ASSERT_EQUAL(count_page_refs(memory_grade.cold_pages), 8);
+
+    etmemd_arb_forget(&proj);
+    etmemd_free_page_refs(memory_grade.cold_pages);
+    etmemd_free_page_refs(memory_grade.hot_pages);
+}
+
+static void write_slide_cgroup_file(const char *name, const char *val)
+{
+    char path[PATH_MAX] = {0};
+    FILE *file = NULL;
+
+    CU_ASSERT_NOT_EQUAL(snprintf_s(path, PATH_MAX, PATH_MAX - 1, "%s%s", SLIDE_CGROUP_DIR, name), -1);
+    file = fopen(path, "w");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    CU_ASSERT_NOT_EQUAL(fputs(val, file), EOF);
+    fclose(file);
+}
+
+static void test_etmem_slide_arbitrate_cgroup(void)
+{
+    struct page_scan page_scan = {.loop = 1, .interval = 1, .sleep = 1};
+    struct project proj = {0};
+    struct engine eng = {0};
+    struct task tk = {0};
+    struct task_pid tk_pid = {0};
+    struct memory_grade memory_grade = {0};
+
+    CU_ASSERT_EQUAL(init_g_page_size(), 0);
+    proj.scan_param = &page_scan;
+    eng.proj = &proj;
+    tk.eng = &eng;
+    tk_pid.tk = &tk;
+    tk_pid.pid = 1;
+    /* the host is never that short of free memory, only the cgroup is */
+    proj.sysmem_threshold = 1;
+
+    /* the cgroup is full at its limit of 1600KB, 16KB short of the 1% free */
+    CU_ASSERT_TRUE(mkdir(SLIDE_CGROUP_DIR, S_IRWXU) == 0 || errno == EEXIST);
+    write_slide_cgroup_file("memory.current", "1638400\n");
+    write_slide_cgroup_file("memory.max", "1638400\n");
+    write_slide_cgroup_file("memory.stat", "anon 1638400\nfile 0\nfile_mapped 0\n");
+    tk.cgroup = etmemd_cgroup_watch(SLIDE_CGROUP_DIR);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(tk.cgroup);
+    CU_ASSERT_EQUAL(check_sysmem_lower_threshold(&tk_pid), DO_SWAP);
+
+    fill_cold_pages(&memory_grade, 8);
+    slide_arbitrate(&tk_pid, &memory_grade);
+    CU_ASSERT_EQUAL(count_page_refs(memory_grade.cold_pages), 16 * 1024 / page_type_to_size(PTE_TYPE));
+    CU_ASSERT_EQUAL(count_page_refs(memory_grade.cold_pages) + count_page_refs(memory_grade.hot_pages), 8);
+
+    etmemd_cgroup_unwatch(&tk.cgroup);
+    etmemd_arb_forget(&proj);
+    etmemd_free_page_refs(memory_grade.cold_pages);
+    etmemd_free_page_refs(memory_grade.hot_pages);
+    (void)remove(SLIDE_CGROUP_DIR "memory.current");
+    (void)remove(SLIDE_CGROUP_DIR "memory.max");
+    (void)remove(SLIDE_CGROUP_DIR "memory.stat");
+    (void)rmdir(SLIDE_CGROUP_DIR);
+}
+
+static void test_etmem_arbiter_rank(void)
+{
+    CU_ASSERT_EQUAL(etmemd_arb_rank(0, 3, 0), 0);
+    CU_ASSERT_EQUAL(etmemd_arb_rank(3, 3, 0), ARB_COLD_LEVELS - 1);
+    CU_ASSERT_EQUAL(etmemd_arb_rank(0, 3, ARB_PRIORITY_MAX), ARB_PRIORITY_MAX);
+    CU_ASSERT_EQUAL(etmemd_arb_rank(100, 3, 100), ARB_RANK_NR - 1);
+    CU_ASSERT_TRUE(etmemd_arb_rank(1, 3, 0) < etmemd_arb_rank(2, 3, 0));
+}
+
 typedef enum {
     CUNIT_SCREEN = 0,
     CUNIT_XMLFILE,
@@ -619,6 +763,9 @@ int main(int argc, const char **argv)
         CU_ADD_TEST(suite, test_etmem_task_swap_flag_ok) == NULL ||
         CU_ADD_TEST(suite, test_etmem_task_swap_threshold_error) == NULL ||
         CU_ADD_TEST(suite, test_etmem_task_swap_threshold_ok) == NULL ||
+        CU_ADD_TEST(suite, test_etmem_arbiter_rank) == NULL ||
+        CU_ADD_TEST(suite, test_etmem_slide_arbitrate) == NULL ||
+        CU_ADD_TEST(suite, test_etmem_slide_arbitrate_cgroup) == NULL ||
         CU_ADD_TEST(suite, test_slide) == NULL) {
             printf("CU_ADD_TEST fail. \n");
             goto ERROR;
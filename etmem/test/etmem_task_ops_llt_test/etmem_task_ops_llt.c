@@ -15,10 +15,13 @@
 
 #include <sys/file.h>
 #include <sys/prctl.h>
+#include <sys/wait.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <limits.h>
 #include <glib.h>
 
 #include <CUnit/Basic.h>
@@ -38,6 +41,7 @@
 #define PID_PROCESS_MEM         5000
 #define PID_PROCESS_SLEEP_TIME  60
 #define WATER_LINT_TEMP         3
+#define CGROUP_TEST_DIR         "/tmp/etmem_cgroup_llt/"
 
 static void get_task_pids_errinput(char *pid_val, char *pid_type, int exp)
 {
@@ -197,6 +201,124 @@ static void test_get_task_withname_ok(void)
     CU_ASSERT_PTR_NULL(tk);
 }
 
+static void test_get_task_pid_exit(void)
+{
+    char pid_val[PID_STR_MAX_LEN] = {0};
+    struct task *tk = NULL;
+    siginfo_t info;
+    pid_t pid;
+
+    pid = fork();
+    CU_ASSERT_NOT_EQUAL_FATAL(pid, -1);
+    if (pid == 0) {
+        pause();
+        exit(0);
+    }
+
+    CU_ASSERT_NOT_EQUAL(snprintf_s(pid_val, PID_STR_MAX_LEN, PID_STR_MAX_LEN - 1, "%d", pid), -1);
+    tk = alloc_task("pid", pid_val);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(tk);
+
+    CU_ASSERT_EQUAL(etmemd_get_task_pids(tk, false), 0);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(tk->pids);
+    CU_ASSERT_TRUE(etmemd_task_pid_alive(tk->pids));
+
+    /* the exit is seen through pidfd even before the process is reaped */
+    CU_ASSERT_EQUAL(kill(pid, SIGKILL), 0);
+    CU_ASSERT_EQUAL(waitid(P_PID, pid, &info, WEXITED | WNOWAIT), 0);
+    if (tk->pids->pidfd >= 0) {
+        CU_ASSERT_FALSE(etmemd_task_pid_alive(tk->pids));
+    }
+
+    CU_ASSERT_EQUAL(waitpid(pid, NULL, 0), pid);
+    CU_ASSERT_FALSE(etmemd_task_pid_alive(tk->pids));
+    CU_ASSERT_EQUAL(etmemd_get_task_pids(tk, false), -1);
+    CU_ASSERT_PTR_NULL(tk->pids);
+
+    etmemd_free_task_struct(&tk);
+}
+
+static void write_cgroup_file(const char *name, const char *val)
+{
+    char path[PATH_MAX] = {0};
+    FILE *file = NULL;
+
+    CU_ASSERT_NOT_EQUAL(snprintf_s(path, PATH_MAX, PATH_MAX - 1, "%s%s", CGROUP_TEST_DIR, name), -1);
+    file = fopen(path, "w");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    CU_ASSERT_NOT_EQUAL(fputs(val, file), EOF);
+    fclose(file);
+}
+
+static int count_task_pids(const struct task *tk)
+{
+    const struct task_pid *tk_pid = NULL;
+    int n = 0;
+
+    for (tk_pid = tk->pids; tk_pid != NULL; tk_pid = tk_pid->next) {
+        if (tk_pid->next != NULL) {
+            CU_ASSERT_TRUE(tk_pid->pid < tk_pid->next->pid);
+        }
+        n++;
+    }
+    return n;
+}
+
+static void test_get_task_withcgroup(void)
+{
+    struct task *tk = NULL;
+    struct task_pid *first = NULL;
+
+    CU_ASSERT_EQUAL(system("rm -rf " CGROUP_TEST_DIR " && mkdir -p " CGROUP_TEST_DIR), 0);
+    write_cgroup_file("cgroup.events", "populated 1\nfrozen 0\n");
+    write_cgroup_file("cgroup.procs", "300\n100\n200\n");
+
+    tk = alloc_task("cgroup", CGROUP_TEST_DIR);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(tk);
+
+    /* the pids are sorted and taken no matter recursive or not */
+    CU_ASSERT_EQUAL(etmemd_get_task_pids(tk, false), 0);
+    CU_ASSERT_EQUAL(count_task_pids(tk), 3);
+    CU_ASSERT_EQUAL(tk->pids->pid, 100);
+
+    /* the same cgroup keeps the pids */
+    first = tk->pids;
+    CU_ASSERT_EQUAL(etmemd_get_task_pids(tk, true), 0);
+    CU_ASSERT_PTR_EQUAL(tk->pids, first);
+
+    /* the pids joining and leaving are merged into the list */
+    write_cgroup_file("cgroup.procs", "50\n200\n400\n300\n");
+    CU_ASSERT_EQUAL(etmemd_get_task_pids(tk, true), 0);
+    CU_ASSERT_EQUAL(count_task_pids(tk), 4);
+    CU_ASSERT_EQUAL(tk->pids->pid, 50);
+
+    /* an empty cgroup has no pids */
+    write_cgroup_file("cgroup.events", "populated 0\nfrozen 0\n");
+    CU_ASSERT_EQUAL(etmemd_get_task_pids(tk, true), -1);
+    CU_ASSERT_PTR_NULL(tk->pids);
+
+    write_cgroup_file("cgroup.events", "populated 1\nfrozen 0\n");
+    CU_ASSERT_EQUAL(etmemd_get_task_pids(tk, true), 0);
+    CU_ASSERT_EQUAL(count_task_pids(tk), 4);
+
+    /* the pids of the descendants are taken, even if the cgroup itself has none */
+    CU_ASSERT_EQUAL(system("mkdir -p " CGROUP_TEST_DIR "child/grandchild"), 0);
+    write_cgroup_file("cgroup.procs", "");
+    write_cgroup_file("child/cgroup.procs", "500\n");
+    write_cgroup_file("child/grandchild/cgroup.procs", "600\n500\n");
+    CU_ASSERT_EQUAL(etmemd_get_task_pids(tk, true), 0);
+    CU_ASSERT_EQUAL(count_task_pids(tk), 2);
+    CU_ASSERT_EQUAL(tk->pids->pid, 500);
+
+    /* so is a removed cgroup */
+    CU_ASSERT_EQUAL(system("rm -rf " CGROUP_TEST_DIR), 0);
+    CU_ASSERT_EQUAL(etmemd_get_task_pids(tk, true), -1);
+    CU_ASSERT_PTR_NULL(tk->pids);
+
+    etmemd_free_task_struct(&tk);
+    CU_ASSERT_PTR_NULL(tk);
+}
+
 static int get_task_pid(char *type, char *value, struct task *tk)
 {
     char pid[PID_STR_MAX_LEN] = {0};
@@ -245,6 +367,7 @@ static void test_free_task_pids(void)
     tk_pid = (struct task_pid *)calloc(1, sizeof(struct task_pid));
     CU_ASSERT_PTR_NOT_NULL(tk_pid);
     tk_pid->pid = 1;
+    tk_pid->pidfd = -1;
 
     s_param = (struct slide_params *)calloc(1, sizeof(struct slide_params));
     CU_ASSERT_PTR_NOT_NULL(s_param);
@@ -298,6 +421,8 @@ int main(int argc, const char **argv)
     if (CU_ADD_TEST(suite, test_get_task_pids_error) == NULL ||
         CU_ADD_TEST(suite, test_get_task_withpid_ok) == NULL ||
         CU_ADD_TEST(suite, test_get_task_withname_ok) == NULL ||
+        CU_ADD_TEST(suite, test_get_task_withcgroup) == NULL ||
+        CU_ADD_TEST(suite, test_get_task_pid_exit) == NULL ||
         CU_ADD_TEST(suite, test_get_pid_error) == NULL ||
         CU_ADD_TEST(suite, test_get_pid_ok) == NULL ||
         CU_ADD_TEST(suite, test_free_task_pids) == NULL) {
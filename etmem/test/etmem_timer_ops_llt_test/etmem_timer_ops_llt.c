@@ -26,6 +26,9 @@
 
 #include "etmemd_threadtimer.h"
 
+#define TIMER_KICK_TIMES     100
+#define TIMER_KICK_WAIT_MS   1000
+
 static int g_timer_exec_time = 0;
 
 typedef void *(*timer_exector)(void *);
@@ -120,6 +123,38 @@ static void test_timer_stop(void)
     thread_timer_destroy(&timer);
 }
 
+static void test_timer_kick(void)
+{
+    char *timer_args = "for timer kick test.\n";
+    timer_exector exector = threadtimer_exector;
+    timer_thread *timer = NULL;
+    int exec_time;
+    int wait;
+    int i;
+
+    thread_timer_kick(timer);
+
+    timer = thread_timer_create(60);
+    CU_ASSERT_PTR_NOT_NULL(timer);
+    CU_ASSERT_EQUAL(thread_timer_start(timer, exector, timer_args), 0);
+
+    /* each kick runs the timer long before it expires, however close to the wait it comes */
+    for (i = 0; i < TIMER_KICK_TIMES; i++) {
+        exec_time = __atomic_load_n(&g_timer_exec_time, __ATOMIC_SEQ_CST);
+        thread_timer_kick(timer);
+        for (wait = 0; wait < TIMER_KICK_WAIT_MS; wait++) {
+            if (__atomic_load_n(&g_timer_exec_time, __ATOMIC_SEQ_CST) != exec_time) {
+                break;
+            }
+            usleep(1000);
+        }
+        CU_ASSERT_NOT_EQUAL(wait, TIMER_KICK_WAIT_MS);
+    }
+
+    thread_timer_stop(timer);
+    thread_timer_destroy(&timer);
+}
+
 typedef enum {
     CUNIT_SCREEN = 0,
     CUNIT_XMLFILE,
@@ -150,7 +185,8 @@ int main(int argc, const char **argv)
     if (CU_ADD_TEST(suite, test_timer_create_delete) == NULL ||
         CU_ADD_TEST(suite, test_timer_start_error) == NULL ||
         CU_ADD_TEST(suite, test_timer_start_ok) == NULL ||
-        CU_ADD_TEST(suite, test_timer_stop) == NULL) {
+        CU_ADD_TEST(suite, test_timer_stop) == NULL ||
+        CU_ADD_TEST(suite, test_timer_kick) == NULL) {
             goto ERROR;
     }
 
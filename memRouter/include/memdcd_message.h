@@ -24,6 +24,8 @@ enum memdcd_cmd_type {
 
 enum SwapType {
     SWAP_TYPE_VMA_ADDR = 0xFFFFFF01,
+    SWAP_TYPE_VMA_STREAM,
+    SWAP_TYPE_VMA_ACK,
     SWAP_TYPE_MAX
 };
 
@@ -40,10 +42,19 @@ struct vma_addr_with_count {
 
 struct swap_vma {
     enum SwapType type;
+    uint32_t seq;
     uint64_t length;
     struct vma_addr vma_addrs[MAX_VMA_NUM];
 };
 
+/* ack of one SWAP_TYPE_VMA_STREAM frame sent back by userswap, one result per range */
+struct swap_ack {
+    enum SwapType type;
+    uint32_t seq;
+    uint64_t length;
+    int results[MAX_VMA_NUM];
+};
+
 enum MEMDCD_MESSAGE_STATUS {
     MEMDCD_SEND_START,
     MEMDCD_SEND_PROCESS,
@@ -17,5 +17,6 @@
 #include "memdcd_process.h"
 
 int send_to_userswap(int pid, const struct migrate_page_list *pages);
+int send_to_numa(int pid, const struct migrate_page_list *pages);
 
 #endif /* MEMDCD_CONNECT_H */
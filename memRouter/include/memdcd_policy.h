@@ -19,6 +19,9 @@
 
 enum mem_policy_type {
     POL_TYPE_THRESHOLD,
+    POL_TYPE_WATERMARK,
+    POL_TYPE_COLDEST,
+    POL_TYPE_NODE,
     POL_TYPE_MAX,
 };
 
@@ -38,5 +41,12 @@ struct memdcd_policy_opt {
 struct mem_policy *get_policy(void);
 int init_mem_policy(char *path);
 
+/* helpers shared by policy plugins */
+int policy_size_to_bytes(const char *unit, uint64_t value, uint64_t *bytes);
+int policy_check_node(int node);
+int policy_locate_pages(int pid, struct migrate_page_list *page_list);
+void policy_sort_by_count(struct migrate_page_list *page_list);
+struct migrate_page_list *policy_alloc_page_list(uint64_t length);
+
 #endif /* MEMDCD_POLICY_H */
 
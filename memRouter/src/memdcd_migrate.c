@@ -20,6 +20,8 @@
 #include <sys/un.h>
 #include <unistd.h>
 #include <stddef.h>
+#include <pthread.h>
+#include <numaif.h>
 
 #include "memdcd_policy.h"
 #include "memdcd_process.h"
@@ -27,8 +29,19 @@
 #include "memdcd_migrate.h"
 
 #define CLIENT_RECV_DEFAULT_TIME 10 // default 10s
-#define RESP_MSG_MAX_LEN 10
 #define FILEPATH_MAX_LEN 64
+#define USWAP_MAX_INFLIGHT 8
+#define USWAP_MAX_CONN 16
+
+struct uswap_conn {
+    int pid;
+    int fd;
+};
+
+/* connections kept open across page lists, a free slot has pid 0 */
+static struct uswap_conn g_uswap_conns[USWAP_MAX_CONN];
+static int g_uswap_conn_victim;
+static pthread_mutex_t g_uswap_conn_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static int uswap_init_connection(int server_pid, time_t recv_timeout)
 {
@@ -74,31 +87,127 @@ static int uswap_init_connection(int server_pid, time_t recv_timeout)
     return socket_fd;
 }
 
-static int uswap_send_data(int client_fd, int server_pid, const struct swap_vma *swap_vma)
+/* a kept connection is usable only if userswap neither closed it nor has unread acks on it */
+static int uswap_conn_alive(int client_fd)
 {
-    int ret = 0;
-    int read_bytes;
-    int write_bytes;
-    int in_datalen;
-    char buff[RESP_MSG_MAX_LEN] = {0};
-    int len = strlen("success");
-
-    in_datalen = swap_vma->length + sizeof(int) + sizeof(long);
-    write_bytes = write(client_fd, swap_vma, in_datalen);
-    if (write_bytes <= 0) {
-        memdcd_log(_LOG_DEBUG, "memdcd_uswap: Write to pid %d server, bytes: %d.", server_pid, write_bytes);
+    char c;
+
+    return recv(client_fd, &c, sizeof(c), MSG_PEEK | MSG_DONTWAIT) < 0 &&
+        (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+/* take the kept connection of pid out of the table, or open a new one */
+static int uswap_get_connection(int server_pid)
+{
+    int client_fd = -1;
+    int i;
+
+    pthread_mutex_lock(&g_uswap_conn_mutex);
+    for (i = 0; i < USWAP_MAX_CONN; i++) {
+        if (g_uswap_conns[i].pid == server_pid) {
+            client_fd = g_uswap_conns[i].fd;
+            g_uswap_conns[i].pid = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_uswap_conn_mutex);
+
+    if (client_fd >= 0) {
+        if (uswap_conn_alive(client_fd))
+            return client_fd;
+        close(client_fd);
+    }
+    return uswap_init_connection(server_pid, CLIENT_RECV_DEFAULT_TIME);
+}
+
+/* keep the connection for the next page list of pid, the oldest slot is reused when full */
+static void uswap_put_connection(int server_pid, int client_fd)
+{
+    int slot = -1;
+    int i;
+
+    pthread_mutex_lock(&g_uswap_conn_mutex);
+    for (i = 0; i < USWAP_MAX_CONN; i++) {
+        if (g_uswap_conns[i].pid == server_pid) {
+            /* another page list of pid opened its own connection meanwhile */
+            pthread_mutex_unlock(&g_uswap_conn_mutex);
+            close(client_fd);
+            return;
+        }
+        if (slot < 0 && g_uswap_conns[i].pid == 0)
+            slot = i;
+    }
+    if (slot < 0) {
+        slot = g_uswap_conn_victim;
+        g_uswap_conn_victim = (g_uswap_conn_victim + 1) % USWAP_MAX_CONN;
+        close(g_uswap_conns[slot].fd);
+    }
+    g_uswap_conns[slot].pid = server_pid;
+    g_uswap_conns[slot].fd = client_fd;
+    pthread_mutex_unlock(&g_uswap_conn_mutex);
+}
+
+static int uswap_write_frame(int client_fd, const struct swap_vma *swap_vma)
+{
+    ssize_t write_bytes;
+    size_t done = 0;
+    size_t in_datalen = offsetof(struct swap_vma, vma_addrs) + swap_vma->length;
+
+    while (done < in_datalen) {
+        write_bytes = send(client_fd, (const char *)swap_vma + done, in_datalen - done, MSG_NOSIGNAL);
+        if (write_bytes < 0 && errno == EINTR)
+            continue;
+        if (write_bytes <= 0)
+            return -1;
+        done += write_bytes;
+    }
+
+    return 0;
+}
+
+static int uswap_read_full(int client_fd, void *buf, size_t len)
+{
+    ssize_t read_bytes;
+    size_t done = 0;
+
+    while (done < len) {
+        read_bytes = read(client_fd, (char *)buf + done, len - done);
+        if (read_bytes < 0 && errno == EINTR)
+            continue;
+        if (read_bytes <= 0)
+            return -1;
+        done += read_bytes;
+    }
+
+    return 0;
+}
+
+/* wait for one ack from userswap, return the number of ranges failed to swap out */
+static int uswap_recv_ack(int client_fd, int server_pid, struct swap_ack *ack)
+{
+    uint64_t i, nr;
+    int failed = 0;
+
+    if (uswap_read_full(client_fd, ack, offsetof(struct swap_ack, results)) != 0 ||
+        ack->type != SWAP_TYPE_VMA_ACK || ack->length > sizeof(ack->results)) {
+        memdcd_log(_LOG_DEBUG, "memdcd_uswap: Recv ack from pid %d server failed.", server_pid);
         return -1;
     }
 
-    read_bytes = read(client_fd, buff, RESP_MSG_MAX_LEN - 1);
-    if (read_bytes >= len && strncmp(buff, "success", len) == 0) {
-        memdcd_log(_LOG_DEBUG, "memdcd_uswap: Recv respond success.");
-    } else {
-        memdcd_log(_LOG_DEBUG, "memdcd_uswap: Recv respond failed.");
-        ret = -1;
+    if (uswap_read_full(client_fd, ack->results, ack->length) != 0) {
+        memdcd_log(_LOG_DEBUG, "memdcd_uswap: Recv ack results from pid %d server failed.", server_pid);
+        return -1;
     }
 
-    return ret;
+    nr = ack->length / sizeof(int);
+    for (i = 0; i < nr; i++) {
+        if (ack->results[i] < 0)
+            failed++;
+    }
+    if (failed != 0)
+        memdcd_log(_LOG_DEBUG, "memdcd_uswap: %d of %lu ranges in frame %u failed.", failed, nr, ack->seq);
+
+    return failed;
 }
 
 static int min(int a, int b)
@@ -106,45 +215,144 @@ static int min(int a, int b)
     return a < b ? a : b;
 }
 
+/*
+ * All ranges are streamed as framed chunks over a connection that is kept
+ * open for the next page list of the same process. Userswap acks every frame
+ * with per-range results, up to USWAP_MAX_INFLIGHT frames may be sent before
+ * the first of them is acked.
+ */
 int send_to_userswap(int pid, const struct migrate_page_list *page_list)
 {
     int ret = 0;
     struct swap_vma *swap_vma = NULL;
+    struct swap_ack *ack = NULL;
     int client_fd;
+    int inflight = 0;
+    int failed;
+    int broken = 0;
+    uint32_t seq = 0;
     uint64_t i, rest, size;
     uint64_t dst;
-    if (page_list->pages == NULL) {
+    if (page_list->length == 0) {
         memdcd_log(_LOG_WARN, "memdcd_uswap: Mig_addrs NULL.");
         return 0;
     }
     memdcd_log(_LOG_INFO, "Send %lu addresses to userswap: pid %d.", page_list->length, pid);
     swap_vma = (struct swap_vma *)malloc(sizeof(struct swap_vma));
-    if (swap_vma == NULL) {
+    ack = (struct swap_ack *)malloc(sizeof(struct swap_ack));
+    if (swap_vma == NULL || ack == NULL) {
         memdcd_log(_LOG_WARN, "memdcd_uswap: Malloc for swap vma failed.");
-        return -ENOMEM;
+        ret = -ENOMEM;
+        goto free_out;
     }
-    swap_vma->type = SWAP_TYPE_VMA_ADDR;
+
+    client_fd = uswap_get_connection(pid);
+    if (client_fd < 0) {
+        ret = -1;
+        goto free_out;
+    }
+
+    swap_vma->type = SWAP_TYPE_VMA_STREAM;
     rest = page_list->length;
     while (rest > 0) {
-        client_fd = uswap_init_connection(pid, CLIENT_RECV_DEFAULT_TIME);
-        if (client_fd < 0) {
-            ret = -1;
-            break;
-        }
         size = min(rest, MAX_VMA_NUM);
 
+        swap_vma->seq = seq++;
         swap_vma->length = size * sizeof(struct vma_addr);
         for (i = 0; i < size; i++) {
             dst = page_list->length - rest + i;
             swap_vma->vma_addrs[i].start_addr = page_list->pages[dst].addr;
             swap_vma->vma_addrs[i].vma_len = page_list->pages[dst].length;
         }
-        if (uswap_send_data(client_fd, pid, swap_vma) != 0)
+        if (uswap_write_frame(client_fd, swap_vma) != 0) {
+            memdcd_log(_LOG_DEBUG, "memdcd_uswap: Write frame %u to pid %d server failed.", swap_vma->seq, pid);
             ret = -1;
-        close(client_fd);
+            broken = 1;
+            break;
+        }
+        inflight++;
         rest -= size;
+
+        if (inflight < USWAP_MAX_INFLIGHT)
+            continue;
+        failed = uswap_recv_ack(client_fd, pid, ack);
+        if (failed != 0)
+            ret = -1;
+        if (failed < 0) {
+            inflight = 0;
+            broken = 1;
+            break;
+        }
+        inflight--;
+    }
+
+    while (inflight > 0) {
+        failed = uswap_recv_ack(client_fd, pid, ack);
+        if (failed != 0)
+            ret = -1;
+        if (failed < 0) {
+            broken = 1;
+            break;
+        }
+        inflight--;
     }
 
+    /* a failed connection may still carry unacked frames, do not reuse it */
+    if (broken)
+        close(client_fd);
+    else
+        uswap_put_connection(pid, client_fd);
+free_out:
     free(swap_vma);
+    free(ack);
+    return ret;
+}
+
+int send_to_numa(int pid, const struct migrate_page_list *page_list)
+{
+    int ret = 0;
+    int *nodes = NULL;
+    int *status = NULL;
+    void **addrs = NULL;
+    uint64_t i, failed = 0;
+    uint64_t length = page_list->length;
+    char error_str[ERROR_STR_MAX_LEN] = {0};
+
+    if (length == 0)
+        return 0;
+
+    memdcd_log(_LOG_INFO, "Demote %lu addresses to numa nodes: pid %d.", length, pid);
+    addrs = malloc(sizeof(void *) * length);
+    nodes = malloc(sizeof(int) * length);
+    status = malloc(sizeof(int) * length);
+    if (addrs == NULL || nodes == NULL || status == NULL) {
+        memdcd_log(_LOG_WARN, "memdcd_numa: Malloc for move pages failed.");
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    for (i = 0; i < length; i++) {
+        addrs[i] = (void *)page_list->pages[i].addr;
+        nodes[i] = page_list->pages[i].numanode;
+    }
+
+    if (move_pages(pid, length, addrs, nodes, status, MPOL_MF_MOVE) < 0) {
+        memdcd_log(_LOG_ERROR, "memdcd_numa: Move pages of pid %d failed. err: %s",
+            pid, strerror_r(errno, error_str, ERROR_STR_MAX_LEN));
+        ret = -1;
+        goto out;
+    }
+
+    for (i = 0; i < length; i++) {
+        if (status[i] < 0)
+            failed++;
+    }
+    if (failed != 0)
+        memdcd_log(_LOG_DEBUG, "memdcd_numa: %lu of %lu pages of pid %d are not moved.", failed, length, pid);
+
+out:
+    free(addrs);
+    free(nodes);
+    free(status);
     return ret;
-}
\ No newline at end of file
+}
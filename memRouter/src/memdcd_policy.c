@@ -30,9 +30,15 @@
 
 #include "memdcd_log.h"
 #include "memdcd_policy_threshold.h"
+#include "memdcd_policy_watermark.h"
+#include "memdcd_policy_coldest.h"
+#include "memdcd_policy_node.h"
 #include "memdcd_policy.h"
 
 #define FULL_PERMISSION 0777
+#define BYTE_SHIFT_KB 10
+#define BYTE_SHIFT_MB 20
+#define BYTE_SHIFT_GB 30
 
 static struct {
     char *name;
@@ -40,6 +46,9 @@ static struct {
     struct memdcd_policy_opt * (*get_opt)(void);
 } mem_policy_opts[] = {
     {"mig_policy_threshold", POL_TYPE_THRESHOLD, get_threshold_policy},
+    {"mig_policy_watermark", POL_TYPE_WATERMARK, get_watermark_policy},
+    {"mig_policy_coldest", POL_TYPE_COLDEST, get_coldest_policy},
+    {"mig_policy_node", POL_TYPE_NODE, get_node_policy},
     {NULL, POL_TYPE_MAX, NULL},
 };
 
@@ -130,3 +139,113 @@ struct mem_policy *get_policy(void)
 {
     return &g_policy;
 }
+
+int policy_size_to_bytes(const char *unit, uint64_t value, uint64_t *bytes)
+{
+    int shift;
+
+    if (unit == NULL)
+        return -1;
+
+    if (strcmp("B", unit) == 0) {
+        shift = 0;
+    } else if (strcmp("KB", unit) == 0) {
+        shift = BYTE_SHIFT_KB;
+    } else if (strcmp("MB", unit) == 0) {
+        shift = BYTE_SHIFT_MB;
+    } else if (strcmp("GB", unit) == 0) {
+        shift = BYTE_SHIFT_GB;
+    } else {
+        memdcd_log(_LOG_ERROR, "Invalid unit %s, only B/KB/MB/GB is allowed.", unit);
+        return -1;
+    }
+
+    /* judge if Integer Overflow happen */
+    if (shift != 0 && (value >> (64 - shift)) != 0) {
+        memdcd_log(_LOG_ERROR, "Size %lu%s overflow.", value, unit);
+        return -1;
+    }
+
+    *bytes = value << shift;
+    return 0;
+}
+
+int policy_check_node(int node)
+{
+    if (numa_available() < 0) {
+        memdcd_log(_LOG_ERROR, "NUMA is not available on this system.");
+        return -1;
+    }
+
+    if (node < 0 || node > numa_max_node()) {
+        memdcd_log(_LOG_ERROR, "Invalid numa node %d, allowed range is [0, %d].", node, numa_max_node());
+        return -1;
+    }
+
+    return 0;
+}
+
+/* fill numanode of every page with the node it currently locates on, negative means not on a numa node */
+int policy_locate_pages(int pid, struct migrate_page_list *page_list)
+{
+    int ret = 0;
+    int *status = NULL;
+    void **addrs = NULL;
+    uint64_t i;
+    uint64_t length = page_list->length;
+
+    if (length == 0)
+        return 0;
+
+    status = malloc(sizeof(int) * length);
+    if (status == NULL)
+        return -1;
+
+    addrs = malloc(sizeof(void *) * length);
+    if (addrs == NULL) {
+        free(status);
+        return -1;
+    }
+
+    for (i = 0; i < length; i++)
+        addrs[i] = (void *)page_list->pages[i].addr;
+
+    if (move_pages(pid, length, addrs, NULL, status, MPOL_MF_MOVE) < 0) {
+        memdcd_log(_LOG_ERROR, "Error when locate node for src_addr by move_page.");
+        ret = -1;
+        goto out;
+    }
+
+    for (i = 0; i < length; i++)
+        page_list->pages[i].numanode = status[i];
+
+out:
+    free(status);
+    free(addrs);
+    return ret;
+}
+
+static int addr_cmp_by_count(const void *a, const void *b)
+{
+    return ((struct migrate_page *)a)->visit_count - ((struct migrate_page *)b)->visit_count;
+}
+
+/* sort pages from the coldest to the hottest */
+void policy_sort_by_count(struct migrate_page_list *page_list)
+{
+    qsort(page_list->pages, page_list->length, sizeof(struct migrate_page), addr_cmp_by_count);
+}
+
+struct migrate_page_list *policy_alloc_page_list(uint64_t length)
+{
+    struct migrate_page_list *list = NULL;
+
+    list = malloc(sizeof(struct migrate_page) * length + sizeof(struct migrate_page_list));
+    if (list == NULL) {
+        memdcd_log(_LOG_ERROR, "Error allocating space for %lu pages.", length);
+        return NULL;
+    }
+    list->length = 0;
+
+    return list;
+}
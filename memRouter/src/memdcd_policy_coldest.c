@@ -0,0 +1,144 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2021. All rights reserved.
+ * etmem/memRouter licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: function of top-N coldest policy
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <json-c/json.h>
+#include <json-c/json_util.h>
+#include <json-c/json_object.h>
+
+#include "memdcd_log.h"
+#include "memdcd_policy.h"
+#include "memdcd_process.h"
+#include "memdcd_policy_coldest.h"
+
+/*
+ * Select the N coldest pages of the process in each round. Selected pages are
+ * swapped out, or demoted to target_node if it is configured.
+ */
+struct coldest_policy {
+    uint64_t count;
+    int target_node;
+};
+
+int coldest_policy_init(struct mem_policy *policy, const char *path);
+int coldest_policy_parse(const struct mem_policy *policy, int pid, struct migrate_page_list *page_list,
+    struct migrate_page_list **pages_to_numa, struct migrate_page_list **pages_to_swap);
+int coldest_policy_destroy(struct mem_policy *policy);
+
+struct memdcd_policy_opt coldest_policy_opt = {
+    .init = coldest_policy_init,
+    .parse = coldest_policy_parse,
+    .destroy = coldest_policy_destroy,
+};
+
+int coldest_policy_init(struct mem_policy *policy, const char *path)
+{
+    int ret = -1;
+    int count;
+    json_object *root = NULL, *obj_policy = NULL, *obj_count = NULL, *target = NULL;
+    struct coldest_policy *c = (struct coldest_policy *)malloc(sizeof(struct coldest_policy));
+    if (c == NULL)
+        return -1;
+
+    root = json_object_from_file(path);
+    if (root == NULL)
+        goto err_out;
+
+    obj_policy = json_object_object_get(root, "policy");
+    if (obj_policy == NULL)
+        goto err_out;
+
+    obj_count = json_object_object_get(obj_policy, "count");
+    if (obj_count == NULL)
+        goto err_out;
+
+    count = json_object_get_int(obj_count);
+    if (count == INT32_MAX || count <= 0) {
+        memdcd_log(_LOG_ERROR, "Invalid count value, allowed range is (0, INT_MAX).");
+        goto err_out;
+    }
+    c->count = (uint64_t)count;
+
+    c->target_node = -1;
+    target = json_object_object_get(obj_policy, "target_node");
+    if (target != NULL) {
+        c->target_node = json_object_get_int(target);
+        if (policy_check_node(c->target_node) != 0)
+            goto err_out;
+    }
+
+    memdcd_log(_LOG_INFO, "Coldest policy loaded.");
+    policy->type = POL_TYPE_COLDEST;
+    policy->opt = &coldest_policy_opt;
+    policy->private = c;
+
+    return 0;
+
+err_out:
+    free(c);
+    return ret;
+}
+
+int coldest_policy_parse(const struct mem_policy *policy, int pid, struct migrate_page_list *page_list,
+    struct migrate_page_list **pages_to_numa, struct migrate_page_list **pages_to_swap)
+{
+    struct coldest_policy *c = (struct coldest_policy *)policy->private;
+    struct migrate_page_list *selected = NULL;
+    uint64_t i;
+
+    policy_sort_by_count(page_list);
+    if (policy_locate_pages(pid, page_list) != 0)
+        return -1;
+
+    selected = policy_alloc_page_list(page_list->length < c->count ? page_list->length : c->count);
+    if (selected == NULL)
+        return -1;
+
+    for (i = 0; i < page_list->length && selected->length < c->count; i++) {
+        /* skip pages not on a numa node and pages already on the target node */
+        if (page_list->pages[i].numanode < 0 || page_list->pages[i].numanode == c->target_node)
+            continue;
+
+        selected->pages[selected->length] = page_list->pages[i];
+        selected->pages[selected->length].numanode = c->target_node;
+        selected->length++;
+    }
+
+    if (c->target_node >= 0)
+        *pages_to_numa = selected;
+    else
+        *pages_to_swap = selected;
+
+    return 0;
+}
+
+int coldest_policy_destroy(struct mem_policy *policy)
+{
+    if (policy == NULL) {
+        return -1;
+    }
+    if (policy->private == NULL) {
+        return -1;
+    }
+    free(policy->private);
+    policy->private = NULL;
+    return 0;
+}
+
+struct memdcd_policy_opt *get_coldest_policy(void)
+{
+    return &coldest_policy_opt;
+}
@@ -0,0 +1,219 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2021. All rights reserved.
+ * etmem/memRouter licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: function of per-numa-node capacity policy
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <json-c/json.h>
+#include <json-c/json_util.h>
+#include <json-c/json_object.h>
+
+#include "memdcd_log.h"
+#include "memdcd_policy.h"
+#include "memdcd_process.h"
+#include "memdcd_policy_node.h"
+
+/*
+ * Each rule limits the memory a process may use on one numa node. Once the
+ * pages of the process on that node exceed the capacity, the coldest of them
+ * are demoted to the target (far memory) node.
+ */
+struct node_rule {
+    int node;
+    int target;
+    uint64_t capacity;
+};
+
+struct node_policy {
+    int nr_rules;
+    struct node_rule rules[];
+};
+
+int node_policy_init(struct mem_policy *policy, const char *path);
+int node_policy_parse(const struct mem_policy *policy, int pid, struct migrate_page_list *page_list,
+    struct migrate_page_list **pages_to_numa, struct migrate_page_list **pages_to_swap);
+int node_policy_destroy(struct mem_policy *policy);
+
+struct memdcd_policy_opt node_policy_opt = {
+    .init = node_policy_init,
+    .parse = node_policy_parse,
+    .destroy = node_policy_destroy,
+};
+
+static int parse_node_rule(json_object *obj_rule, const char *unit, struct node_rule *rule)
+{
+    int capacity;
+    json_object *node = NULL, *target = NULL, *obj_capacity = NULL;
+
+    node = json_object_object_get(obj_rule, "node");
+    target = json_object_object_get(obj_rule, "target");
+    obj_capacity = json_object_object_get(obj_rule, "capacity");
+    if (node == NULL || target == NULL || obj_capacity == NULL) {
+        memdcd_log(_LOG_ERROR, "Node rule should contain node, target and capacity.");
+        return -1;
+    }
+
+    rule->node = json_object_get_int(node);
+    rule->target = json_object_get_int(target);
+    if (policy_check_node(rule->node) != 0 || policy_check_node(rule->target) != 0)
+        return -1;
+
+    if (rule->node == rule->target) {
+        memdcd_log(_LOG_ERROR, "Target of node %d should not be itself.", rule->node);
+        return -1;
+    }
+
+    capacity = json_object_get_int(obj_capacity);
+    if (capacity == INT32_MAX || capacity < 0) {
+        memdcd_log(_LOG_ERROR, "Invalid capacity value, allowed range is [0, INT_MAX).");
+        return -1;
+    }
+
+    return policy_size_to_bytes(unit, (uint64_t)capacity, &rule->capacity);
+}
+
+int node_policy_init(struct mem_policy *policy, const char *path)
+{
+    int i, j;
+    int nr_rules;
+    json_object *root = NULL, *obj_policy = NULL, *unit = NULL, *nodes = NULL;
+    const char *str = NULL;
+    struct node_policy *n = NULL;
+
+    root = json_object_from_file(path);
+    if (root == NULL)
+        return -1;
+
+    obj_policy = json_object_object_get(root, "policy");
+    if (obj_policy == NULL)
+        return -1;
+
+    unit = json_object_object_get(obj_policy, "unit");
+    if (unit == NULL)
+        return -1;
+
+    str = json_object_get_string(unit);
+    if (str == NULL)
+        return -1;
+
+    nodes = json_object_object_get(obj_policy, "nodes");
+    if (nodes == NULL || !json_object_is_type(nodes, json_type_array))
+        return -1;
+
+    nr_rules = (int)json_object_array_length(nodes);
+    if (nr_rules <= 0) {
+        memdcd_log(_LOG_ERROR, "No node rule is configured.");
+        return -1;
+    }
+
+    n = (struct node_policy *)malloc(sizeof(struct node_policy) + sizeof(struct node_rule) * nr_rules);
+    if (n == NULL)
+        return -1;
+    n->nr_rules = nr_rules;
+
+    for (i = 0; i < nr_rules; i++) {
+        if (parse_node_rule(json_object_array_get_idx(nodes, i), str, &n->rules[i]) != 0)
+            goto err_out;
+
+        for (j = 0; j < i; j++) {
+            if (n->rules[j].node == n->rules[i].node) {
+                memdcd_log(_LOG_ERROR, "Node %d is configured more than once.", n->rules[i].node);
+                goto err_out;
+            }
+        }
+    }
+
+    memdcd_log(_LOG_INFO, "Node policy loaded.");
+    policy->type = POL_TYPE_NODE;
+    policy->opt = &node_policy_opt;
+    policy->private = n;
+
+    return 0;
+
+err_out:
+    free(n);
+    return -1;
+}
+
+static void demote_node_pages(const struct node_rule *rule, const struct migrate_page_list *page_list,
+    struct migrate_page_list *selected)
+{
+    uint64_t i;
+    uint64_t used = 0;
+    uint64_t demoted = 0;
+
+    for (i = 0; i < page_list->length; i++) {
+        if (page_list->pages[i].numanode == rule->node)
+            used += page_list->pages[i].length;
+    }
+
+    if (used <= rule->capacity)
+        return;
+
+    /* pages are sorted from the coldest, demote until node usage drops to capacity */
+    for (i = 0; i < page_list->length && used - demoted > rule->capacity; i++) {
+        if (page_list->pages[i].numanode != rule->node)
+            continue;
+
+        selected->pages[selected->length] = page_list->pages[i];
+        selected->pages[selected->length].numanode = rule->target;
+        selected->length++;
+        demoted += page_list->pages[i].length;
+    }
+
+    memdcd_log(_LOG_DEBUG, "Demote %lu bytes from node %d to node %d, usage %lu capacity %lu.",
+        demoted, rule->node, rule->target, used, rule->capacity);
+}
+
+int node_policy_parse(const struct mem_policy *policy, int pid, struct migrate_page_list *page_list,
+    struct migrate_page_list **pages_to_numa, struct migrate_page_list **pages_to_swap)
+{
+    struct node_policy *n = (struct node_policy *)policy->private;
+    struct migrate_page_list *selected = NULL;
+    int i;
+
+    (void)pages_to_swap;
+
+    policy_sort_by_count(page_list);
+    if (policy_locate_pages(pid, page_list) != 0)
+        return -1;
+
+    selected = policy_alloc_page_list(page_list->length);
+    if (selected == NULL)
+        return -1;
+
+    for (i = 0; i < n->nr_rules; i++)
+        demote_node_pages(&n->rules[i], page_list, selected);
+
+    *pages_to_numa = selected;
+    return 0;
+}
+
+int node_policy_destroy(struct mem_policy *policy)
+{
+    if (policy == NULL) {
+        return -1;
+    }
+    if (policy->private == NULL) {
+        return -1;
+    }
+    free(policy->private);
+    policy->private = NULL;
+    return 0;
+}
+
+struct memdcd_policy_opt *get_node_policy(void)
+{
+    return &node_policy_opt;
+}
@@ -89,15 +89,7 @@ int threshold_policy_init(struct mem_policy *policy, const char *path)
     }
 
     memdcd_log(_LOG_INFO, "Threshold policy loaded.");
-    if (strcmp("B", str) == 0) {
-        t->threshold = th_val;
-    } else if (strcmp("KB", str) == 0) {
-        t->threshold = (uint64_t)th_val * 1024;
-    } else if (strcmp("MB", str) == 0) {
-        t->threshold = (uint64_t)th_val * 1024 * 1024;
-    } else if (strcmp("GB", str) == 0) {
-        t->threshold = (uint64_t)th_val * 1024 * 1024 * 1024;
-    } else {
+    if (policy_size_to_bytes(str, (uint64_t)th_val, &t->threshold) != 0) {
         memdcd_log(_LOG_ERROR, "Detected invalid threshold setting. Abort.");
         ret = -1;
         goto err_out;
@@ -114,57 +106,30 @@ err_out:
     return ret;
 }
 
-static int addr_cmp_by_count(const void *a, const void *b)
-{
-    return ((struct migrate_page *)a)->visit_count - ((struct migrate_page *)b)->visit_count;
-}
-
 int threshold_policy_parse(const struct mem_policy *policy, int pid, struct migrate_page_list *page_list,
     struct migrate_page_list **pages_to_numa, struct migrate_page_list **pages_to_swap)
 {
-    int ret = 0;
     uint64_t swap_count = 0;
     uint64_t sum_size = 0;
-    int *status = NULL;
-    uint64_t *move_addr = NULL;
     uint64_t length = page_list->length;
 
     (void)pages_to_numa;
 
-    qsort(page_list->pages, length, sizeof(struct migrate_page), addr_cmp_by_count);
+    policy_sort_by_count(page_list);
 
-    status = malloc(sizeof(int) * length);
-    if (status == NULL)
+    if (policy_locate_pages(pid, page_list) != 0)
         return -1;
 
-    move_addr = malloc(sizeof(uint64_t) * length);
-    if (move_addr == NULL) {
-        free(status);
-        return -1;
-    }
-
-    for (uint64_t i = 0; i < length; i++)
-        move_addr[i] = page_list->pages[i].addr;
-
-    if (move_pages(pid, length, (void **)move_addr, NULL, status, MPOL_MF_MOVE) < 0) {
-        memdcd_log(_LOG_ERROR, "Error when locate node for src_addr by move_page.");
-        ret = -1;
-        goto tpp_err_out;
-    }
-
     for (int64_t i = length - 1; i >= 0; i--) {
-        page_list->pages[i].numanode = status[i];
-        if (status[i] < 0) { // negative means not on a numa node
+        if (page_list->pages[i].numanode < 0) { // negative means not on a numa node
             memdcd_log(_LOG_DEBUG, "memdcd_migrate: Error getting current node of page %lx: %d, %ld.",
-                move_addr[i], status[i], i);
+                page_list->pages[i].addr, page_list->pages[i].numanode, i);
             continue;
         }
 
         /*judge if Integer Overflow happen*/
-        if (sum_size + page_list->pages[i].length < sum_size) {
-            ret = -1;
-            goto tpp_err_out;
-        }
+        if (sum_size + page_list->pages[i].length < sum_size)
+            return -1;
         sum_size += page_list->pages[i].length;
         if (sum_size < ((struct threshold_policy *)policy->private)->threshold)
             continue;
@@ -174,20 +139,14 @@ int threshold_policy_parse(const struct mem_policy *policy, int pid, struct migr
         page_list->pages[length - swap_count] = page_list->pages[i];
     }
 
-    *pages_to_swap = malloc(sizeof(struct migrate_page) * swap_count + sizeof(struct migrate_page_list));
-    if (*pages_to_swap == NULL) {
-        memdcd_log(_LOG_ERROR, "memdcd_migrate: error allocating space for pages_to_swap.");
-        ret = -1;
-        goto tpp_err_out;
-    }
+    *pages_to_swap = policy_alloc_page_list(swap_count);
+    if (*pages_to_swap == NULL)
+        return -1;
 
     memcpy((*pages_to_swap)->pages, page_list->pages + length - swap_count, sizeof(struct migrate_page) * swap_count);
     (*pages_to_swap)->length = swap_count;
 
-tpp_err_out:
-    free(status);
-    free(move_addr);
-    return ret;
+    return 0;
 }
 
 int threshold_policy_destroy(struct mem_policy *policy)
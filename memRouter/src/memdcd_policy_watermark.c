@@ -0,0 +1,251 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2021. All rights reserved.
+ * etmem/memRouter licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: function of watermark policy
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <numa.h>
+#include <json-c/json.h>
+#include <json-c/json_util.h>
+#include <json-c/json_object.h>
+
+#include "memdcd_log.h"
+#include "memdcd_policy.h"
+#include "memdcd_process.h"
+#include "memdcd_policy_watermark.h"
+
+#define PROC_MEMINFO "/proc/meminfo"
+#define MEMINFO_LINE_MAX_LEN 256
+#define MEM_AVAILABLE_KEY "MemAvailable:"
+#define KB_TO_BYTE 1024
+
+/*
+ * When the available memory of the system falls below the low watermark,
+ * the coldest pages are reclaimed until the available memory reaches the
+ * high watermark. Reclaimed pages are swapped out, or demoted to target_node
+ * if it is configured. Demotion does not raise the available memory of the
+ * system, so with target_node the watermarks are of the free memory of the
+ * other nodes, which the demoted pages come from.
+ */
+struct watermark_policy {
+    uint64_t low;
+    uint64_t high;
+    int target_node;
+};
+
+int watermark_policy_init(struct mem_policy *policy, const char *path);
+int watermark_policy_parse(const struct mem_policy *policy, int pid, struct migrate_page_list *page_list,
+    struct migrate_page_list **pages_to_numa, struct migrate_page_list **pages_to_swap);
+int watermark_policy_destroy(struct mem_policy *policy);
+
+struct memdcd_policy_opt watermark_policy_opt = {
+    .init = watermark_policy_init,
+    .parse = watermark_policy_parse,
+    .destroy = watermark_policy_destroy,
+};
+
+static int get_watermark_value(json_object *obj_policy, const char *unit, const char *key, uint64_t *value)
+{
+    int val;
+    json_object *obj = json_object_object_get(obj_policy, key);
+    if (obj == NULL) {
+        memdcd_log(_LOG_ERROR, "Watermark %s is not set.", key);
+        return -1;
+    }
+
+    val = json_object_get_int(obj);
+    if (val == INT32_MAX || val < 0) {
+        memdcd_log(_LOG_ERROR, "Invalid watermark %s value, allowed range is [0, INT_MAX).", key);
+        return -1;
+    }
+
+    return policy_size_to_bytes(unit, (uint64_t)val, value);
+}
+
+int watermark_policy_init(struct mem_policy *policy, const char *path)
+{
+    int ret = -1;
+    json_object *root = NULL, *obj_policy = NULL, *unit = NULL, *target = NULL;
+    const char *str = NULL;
+    struct watermark_policy *w = (struct watermark_policy *)malloc(sizeof(struct watermark_policy));
+    if (w == NULL)
+        return -1;
+
+    root = json_object_from_file(path);
+    if (root == NULL)
+        goto err_out;
+
+    obj_policy = json_object_object_get(root, "policy");
+    if (obj_policy == NULL)
+        goto err_out;
+
+    unit = json_object_object_get(obj_policy, "unit");
+    if (unit == NULL)
+        goto err_out;
+
+    str = json_object_get_string(unit);
+    if (str == NULL)
+        goto err_out;
+
+    if (get_watermark_value(obj_policy, str, "low", &w->low) != 0 ||
+        get_watermark_value(obj_policy, str, "high", &w->high) != 0)
+        goto err_out;
+
+    if (w->low > w->high) {
+        memdcd_log(_LOG_ERROR, "Watermark low should not be greater than high.");
+        goto err_out;
+    }
+
+    w->target_node = -1;
+    target = json_object_object_get(obj_policy, "target_node");
+    if (target != NULL) {
+        w->target_node = json_object_get_int(target);
+        if (policy_check_node(w->target_node) != 0)
+            goto err_out;
+    }
+
+    memdcd_log(_LOG_INFO, "Watermark policy loaded.");
+    policy->type = POL_TYPE_WATERMARK;
+    policy->opt = &watermark_policy_opt;
+    policy->private = w;
+
+    return 0;
+
+err_out:
+    free(w);
+    return ret;
+}
+
+static int get_mem_available(uint64_t *avail)
+{
+    FILE *fp = NULL;
+    char line[MEMINFO_LINE_MAX_LEN] = {0};
+    unsigned long val;
+    int ret = -1;
+
+    fp = fopen(PROC_MEMINFO, "r");
+    if (fp == NULL) {
+        memdcd_log(_LOG_ERROR, "Error opening %s.", PROC_MEMINFO);
+        return -1;
+    }
+
+    while (fgets(line, MEMINFO_LINE_MAX_LEN, fp) != NULL) {
+        if (strncmp(line, MEM_AVAILABLE_KEY, strlen(MEM_AVAILABLE_KEY)) != 0)
+            continue;
+        if (sscanf(line + strlen(MEM_AVAILABLE_KEY), "%lu", &val) == 1) {
+            *avail = (uint64_t)val * KB_TO_BYTE;
+            ret = 0;
+        }
+        break;
+    }
+
+    fclose(fp);
+    return ret;
+}
+
+/* free memory of all the nodes except target_node */
+static int get_source_free(int target_node, uint64_t *avail)
+{
+    long long free_size = 0;
+    uint64_t sum = 0;
+    int nr_nodes = 0;
+    int node;
+
+    for (node = 0; node <= numa_max_node(); node++) {
+        if (node == target_node || numa_node_size64(node, &free_size) < 0)
+            continue;
+        sum += (uint64_t)free_size;
+        nr_nodes++;
+    }
+
+    if (nr_nodes == 0) {
+        memdcd_log(_LOG_ERROR, "No node with memory other than target node %d.", target_node);
+        return -1;
+    }
+
+    *avail = sum;
+    return 0;
+}
+
+int watermark_policy_parse(const struct mem_policy *policy, int pid, struct migrate_page_list *page_list,
+    struct migrate_page_list **pages_to_numa, struct migrate_page_list **pages_to_swap)
+{
+    struct watermark_policy *w = (struct watermark_policy *)policy->private;
+    struct migrate_page_list *selected = NULL;
+    uint64_t avail = 0;
+    uint64_t need;
+    uint64_t sum_size = 0;
+    uint64_t i;
+
+    if (w->target_node >= 0) {
+        if (get_source_free(w->target_node, &avail) != 0)
+            return -1;
+    } else if (get_mem_available(&avail) != 0) {
+        return -1;
+    }
+
+    selected = policy_alloc_page_list(page_list->length);
+    if (selected == NULL)
+        return -1;
+
+    if (avail >= w->low) {
+        memdcd_log(_LOG_DEBUG, "Available memory %lu is above low watermark %lu.", avail, w->low);
+        goto out;
+    }
+    need = w->high - avail;
+
+    policy_sort_by_count(page_list);
+    if (policy_locate_pages(pid, page_list) != 0) {
+        free(selected);
+        return -1;
+    }
+
+    for (i = 0; i < page_list->length && sum_size < need; i++) {
+        if (page_list->pages[i].numanode < 0 || page_list->pages[i].numanode == w->target_node)
+            continue;
+
+        selected->pages[selected->length] = page_list->pages[i];
+        selected->pages[selected->length].numanode = w->target_node;
+        selected->length++;
+        sum_size += page_list->pages[i].length;
+    }
+    memdcd_log(_LOG_INFO, "Available memory %lu below low watermark %lu, reclaim %lu bytes of process %d.",
+        avail, w->low, sum_size, pid);
+
+out:
+    if (w->target_node >= 0)
+        *pages_to_numa = selected;
+    else
+        *pages_to_swap = selected;
+
+    return 0;
+}
+
+int watermark_policy_destroy(struct mem_policy *policy)
+{
+    if (policy == NULL) {
+        return -1;
+    }
+    if (policy->private == NULL) {
+        return -1;
+    }
+    free(policy->private);
+    policy->private = NULL;
+    return 0;
+}
+
+struct memdcd_policy_opt *get_watermark_policy(void)
+{
+    return &watermark_policy_opt;
+}
@@ -280,7 +280,10 @@ static void *memdcd_migrate(void *args)
         goto free_pages;
     }
 
-    if (pages_to_swap->pages != NULL)
+    if (pages_to_numa != NULL && pages_to_numa->length > 0)
+        send_to_numa(process->pid, pages_to_numa);
+
+    if (pages_to_swap != NULL && pages_to_swap->length > 0)
         send_to_userswap(process->pid, pages_to_swap);
 
     if (pages_to_numa != NULL)
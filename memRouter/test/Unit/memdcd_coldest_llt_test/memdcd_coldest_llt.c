@@ -0,0 +1,92 @@
+/* *****************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: Cunit test for memdcd_coldest
+ * **************************************************************************** */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <CUnit/Automated.h>
+#include "memdcd_policy.h"
+#include "memdcd_policy_coldest.h"
+#include "memdcd_process.h"
+
+#define TEST_PAGE_NUM 256
+#define TEST_COLDEST_NUM 100
+
+static void test_memdcd_coldest(void)
+{
+    struct migrate_page_list *pages = NULL, *pages_to_numa = NULL, *pages_to_swap = NULL;
+    struct mem_policy policy = {0};
+    struct memdcd_policy_opt *coldest_policy_opt = get_coldest_policy();
+    int pagesize = getpagesize();
+    char *buf = NULL;
+
+    CU_ASSERT_EQUAL(coldest_policy_opt->destroy(NULL), -1);
+    CU_ASSERT_EQUAL(coldest_policy_opt->init(&policy, "not_exist.json"), -1);
+    CU_ASSERT_EQUAL(coldest_policy_opt->init(&policy, "./config/policy_coldest_invalid.json"), -1);
+    CU_ASSERT_EQUAL(coldest_policy_opt->destroy(&policy), -1);
+
+    CU_ASSERT_EQUAL(coldest_policy_opt->init(&policy, "./config/policy_coldest.json"), 0);
+    CU_ASSERT_EQUAL(policy.type, POL_TYPE_COLDEST);
+
+    if (posix_memalign((void **)&buf, pagesize, pagesize * TEST_PAGE_NUM) != 0) {
+        printf("memalign error in test_memdcd_coldest");
+        return;
+    }
+    memset(buf, 1, pagesize * TEST_PAGE_NUM);
+    pages = (struct migrate_page_list *)malloc(sizeof(struct migrate_page) * TEST_PAGE_NUM +
+        sizeof(struct migrate_page_list));
+    if (pages == NULL) {
+        free(buf);
+        printf("malloc error in test_memdcd_coldest");
+        return;
+    }
+    pages->length = TEST_PAGE_NUM;
+    for (int i = 0; i < TEST_PAGE_NUM; i++) {
+        pages->pages[i].addr = (uint64_t)(buf + i * pagesize);
+        pages->pages[i].length = pagesize;
+        pages->pages[i].visit_count = TEST_PAGE_NUM - i;
+    }
+
+    CU_ASSERT_EQUAL(coldest_policy_opt->parse(&policy, getpid(), pages, &pages_to_numa, &pages_to_swap), 0);
+    CU_ASSERT_PTR_NULL(pages_to_numa);
+    CU_ASSERT_PTR_NOT_NULL(pages_to_swap);
+    if (pages_to_swap != NULL) {
+        CU_ASSERT_EQUAL(pages_to_swap->length, TEST_COLDEST_NUM);
+        for (uint64_t i = 0; i < pages_to_swap->length; i++) {
+            CU_ASSERT(pages_to_swap->pages[i].visit_count <= TEST_COLDEST_NUM);
+        }
+        free(pages_to_swap);
+    }
+
+    CU_ASSERT_EQUAL(coldest_policy_opt->destroy(&policy), 0);
+    free(pages);
+    free(buf);
+}
+
+int add_tests(void)
+{
+    /* add test case for memdcd_coldest */
+    CU_pSuite suite_memdcd_coldest = CU_add_suite("memdcd_coldest", NULL, NULL);
+    if (suite_memdcd_coldest == NULL) {
+        return -1;
+    }
+
+    if (CU_ADD_TEST(suite_memdcd_coldest, test_memdcd_coldest) == NULL) {
+        return -1;
+    }
+
+    CU_set_output_filename("memdcd");
+    return 0;
+}
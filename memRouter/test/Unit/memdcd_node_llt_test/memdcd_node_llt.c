@@ -0,0 +1,99 @@
+/* *****************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: Cunit test for memdcd_node
+ * **************************************************************************** */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <numa.h>
+#include <CUnit/Automated.h>
+#include "memdcd_policy.h"
+#include "memdcd_policy_node.h"
+#include "memdcd_process.h"
+
+#define TEST_PAGE_NUM 64
+
+static void test_memdcd_node(void)
+{
+    struct migrate_page_list *pages = NULL, *pages_to_numa = NULL, *pages_to_swap = NULL;
+    struct mem_policy policy = {0};
+    struct memdcd_policy_opt *node_policy_opt = get_node_policy();
+    int pagesize = getpagesize();
+    char *buf = NULL;
+
+    CU_ASSERT_EQUAL(node_policy_opt->destroy(NULL), -1);
+    CU_ASSERT_EQUAL(node_policy_opt->init(&policy, "not_exist.json"), -1);
+    CU_ASSERT_EQUAL(node_policy_opt->init(&policy, "./config/policy_node_invalid.json"), -1);
+    CU_ASSERT_EQUAL(node_policy_opt->destroy(&policy), -1);
+    CU_ASSERT_EQUAL(node_policy_opt->init(&policy, "./config/policy_threshold.json"), -1);
+
+    /* demotion needs a second numa node */
+    if (numa_available() < 0 || numa_max_node() < 1) {
+        CU_ASSERT_EQUAL(node_policy_opt->init(&policy, "./config/policy_node.json"), -1);
+        return;
+    }
+
+    CU_ASSERT_EQUAL(node_policy_opt->init(&policy, "./config/policy_node.json"), 0);
+    CU_ASSERT_EQUAL(policy.type, POL_TYPE_NODE);
+
+    buf = numa_alloc_onnode(pagesize * TEST_PAGE_NUM, 0);
+    if (buf == NULL) {
+        printf("numa_alloc_onnode error in test_memdcd_node");
+        return;
+    }
+    memset(buf, 1, pagesize * TEST_PAGE_NUM);
+    pages = (struct migrate_page_list *)malloc(sizeof(struct migrate_page) * TEST_PAGE_NUM +
+        sizeof(struct migrate_page_list));
+    if (pages == NULL) {
+        numa_free(buf, pagesize * TEST_PAGE_NUM);
+        printf("malloc error in test_memdcd_node");
+        return;
+    }
+    pages->length = TEST_PAGE_NUM;
+    for (int i = 0; i < TEST_PAGE_NUM; i++) {
+        pages->pages[i].addr = (uint64_t)(buf + i * pagesize);
+        pages->pages[i].length = pagesize;
+        pages->pages[i].visit_count = i;
+    }
+
+    /* capacity of node 0 is 0, so every page is demoted to node 1 */
+    CU_ASSERT_EQUAL(node_policy_opt->parse(&policy, getpid(), pages, &pages_to_numa, &pages_to_swap), 0);
+    CU_ASSERT_PTR_NULL(pages_to_swap);
+    CU_ASSERT_PTR_NOT_NULL(pages_to_numa);
+    if (pages_to_numa != NULL) {
+        CU_ASSERT_EQUAL(pages_to_numa->length, TEST_PAGE_NUM);
+        CU_ASSERT_EQUAL(pages_to_numa->pages[0].numanode, 1);
+        free(pages_to_numa);
+    }
+
+    CU_ASSERT_EQUAL(node_policy_opt->destroy(&policy), 0);
+    free(pages);
+    numa_free(buf, pagesize * TEST_PAGE_NUM);
+}
+
+int add_tests(void)
+{
+    /* add test case for memdcd_node */
+    CU_pSuite suite_memdcd_node = CU_add_suite("memdcd_node", NULL, NULL);
+    if (suite_memdcd_node == NULL) {
+        return -1;
+    }
+
+    if (CU_ADD_TEST(suite_memdcd_node, test_memdcd_node) == NULL) {
+        return -1;
+    }
+
+    CU_set_output_filename("memdcd");
+    return 0;
+}
@@ -38,6 +38,21 @@ static void test_memdcd_policy(void)
     chmod("./config/policy_threshold_GB.json", 0600);
     CU_ASSERT_EQUAL(init_mem_policy("./config/policy_threshold_GB.json"), 0);
 
+    chmod("./config/policy_watermark.json", 0600);
+    CU_ASSERT_EQUAL(init_mem_policy("./config/policy_watermark.json"), 0);
+
+    chmod("./config/policy_watermark_invalid.json", 0600);
+    CU_ASSERT_EQUAL(init_mem_policy("./config/policy_watermark_invalid.json"), -1);
+
+    chmod("./config/policy_coldest.json", 0600);
+    CU_ASSERT_EQUAL(init_mem_policy("./config/policy_coldest.json"), 0);
+
+    chmod("./config/policy_coldest_invalid.json", 0600);
+    CU_ASSERT_EQUAL(init_mem_policy("./config/policy_coldest_invalid.json"), -1);
+
+    chmod("./config/policy_node_invalid.json", 0600);
+    CU_ASSERT_EQUAL(init_mem_policy("./config/policy_node_invalid.json"), -1);
+
     chmod("./config/policy_threshold_invalid_unit.json", 0600);
     CU_ASSERT_EQUAL(init_mem_policy("./config/policy_threshold_invalid_unit.json"), -1);
 
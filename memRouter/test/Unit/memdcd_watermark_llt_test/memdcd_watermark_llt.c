@@ -0,0 +1,108 @@
+/* *****************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: Cunit test for memdcd_watermark
+ * **************************************************************************** */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <numa.h>
+#include <CUnit/Automated.h>
+#include "memdcd_policy.h"
+#include "memdcd_policy_watermark.h"
+#include "memdcd_process.h"
+
+#define TEST_PAGE_NUM 64
+
+static void test_memdcd_watermark(void)
+{
+    struct migrate_page_list *pages = NULL, *pages_to_numa = NULL, *pages_to_swap = NULL;
+    struct mem_policy policy = {0};
+    struct memdcd_policy_opt *watermark_policy_opt = get_watermark_policy();
+    int pagesize = getpagesize();
+    char *buf = NULL;
+
+    CU_ASSERT_EQUAL(watermark_policy_opt->destroy(NULL), -1);
+    CU_ASSERT_EQUAL(watermark_policy_opt->init(&policy, "not_exist.json"), -1);
+    CU_ASSERT_EQUAL(watermark_policy_opt->destroy(&policy), -1);
+    CU_ASSERT_EQUAL(watermark_policy_opt->init(&policy, "./config/policy_watermark_invalid.json"), -1);
+    CU_ASSERT_EQUAL(watermark_policy_opt->destroy(&policy), -1);
+    CU_ASSERT_EQUAL(watermark_policy_opt->init(&policy, "./config/policy_threshold.json"), -1);
+
+    /* the low watermark is far above the memory of any test machine, so every present page is selected */
+    CU_ASSERT_EQUAL(watermark_policy_opt->init(&policy, "./config/policy_watermark.json"), 0);
+    CU_ASSERT_EQUAL(policy.type, POL_TYPE_WATERMARK);
+
+    if (posix_memalign((void **)&buf, pagesize, pagesize * TEST_PAGE_NUM) != 0) {
+        printf("memalign error in test_memdcd_watermark");
+        return;
+    }
+    memset(buf, 1, pagesize * TEST_PAGE_NUM);
+    pages = (struct migrate_page_list *)malloc(sizeof(struct migrate_page) * TEST_PAGE_NUM +
+        sizeof(struct migrate_page_list));
+    if (pages == NULL) {
+        free(buf);
+        printf("malloc error in test_memdcd_watermark");
+        return;
+    }
+    pages->length = TEST_PAGE_NUM;
+    for (int i = 0; i < TEST_PAGE_NUM; i++) {
+        pages->pages[i].addr = (uint64_t)(buf + i * pagesize);
+        pages->pages[i].length = pagesize;
+        pages->pages[i].visit_count = i;
+    }
+
+    CU_ASSERT_EQUAL(watermark_policy_opt->parse(&policy, getpid(), pages, &pages_to_numa, &pages_to_swap), 0);
+    CU_ASSERT_PTR_NULL(pages_to_numa);
+    CU_ASSERT_PTR_NOT_NULL(pages_to_swap);
+    if (pages_to_swap != NULL) {
+        CU_ASSERT_EQUAL(pages_to_swap->length, TEST_PAGE_NUM);
+        CU_ASSERT_EQUAL(pages_to_swap->pages[0].visit_count, 0);
+        free(pages_to_swap);
+    }
+
+    CU_ASSERT_EQUAL(watermark_policy_opt->destroy(&policy), 0);
+
+    /* with target_node the free memory of the other nodes is measured, and there is none on one node */
+    CU_ASSERT_EQUAL(watermark_policy_opt->init(&policy, "./config/policy_watermark_node.json"), 0);
+    pages_to_numa = NULL;
+    pages_to_swap = NULL;
+    if (numa_max_node() == 0) {
+        CU_ASSERT_EQUAL(watermark_policy_opt->parse(&policy, getpid(), pages, &pages_to_numa, &pages_to_swap), -1);
+    } else {
+        CU_ASSERT_EQUAL(watermark_policy_opt->parse(&policy, getpid(), pages, &pages_to_numa, &pages_to_swap), 0);
+        CU_ASSERT_PTR_NULL(pages_to_swap);
+        CU_ASSERT_PTR_NOT_NULL(pages_to_numa);
+        free(pages_to_numa);
+    }
+    CU_ASSERT_EQUAL(watermark_policy_opt->destroy(&policy), 0);
+
+    free(pages);
+    free(buf);
+}
+
+int add_tests(void)
+{
+    /* add test case for memdcd_watermark */
+    CU_pSuite suite_memdcd_watermark = CU_add_suite("memdcd_watermark", NULL, NULL);
+    if (suite_memdcd_watermark == NULL) {
+        return -1;
+    }
+
+    if (CU_ADD_TEST(suite_memdcd_watermark, test_memdcd_watermark) == NULL) {
+        return -1;
+    }
+
+    CU_set_output_filename("memdcd");
+    return 0;
+}
@@ -21,6 +21,7 @@
 #include <sys/prctl.h>
 #include <sys/un.h>
 #include <errno.h>
+#include <stddef.h>
 #include <numa.h>
 #include <numaif.h>
 #include <time.h>
@@ -269,6 +270,21 @@ int sock_handle_respond(int client_fd, int result)
     return 0;
 }
 
+static int sock_send_ack(int client_fd, const struct swap_vma *swap_vma)
+{
+    struct swap_ack ack = {0};
+    int len;
+
+    ack.type = SWAP_TYPE_VMA_ACK;
+    ack.seq = swap_vma->seq;
+    ack.length = swap_vma->length / sizeof(struct vma_addr) * sizeof(int);
+    len = offsetof(struct swap_ack, results) + ack.length;
+    if (write(client_fd, &ack, len) != len) {
+        return -1;
+    }
+    return 0;
+}
+
 int simulate_uswap(int pid, struct vma_addr **recv_msg)
 {
     struct swap_vma swap_vma;
@@ -311,7 +327,12 @@ int simulate_uswap(int pid, struct vma_addr **recv_msg)
             continue;
         }
         memcpy(*recv_msg, swap_vma.vma_addrs, swap_vma.length);
-        sock_handle_respond(client_fd, 0);
+        if (swap_vma.type == SWAP_TYPE_VMA_STREAM) {
+            sock_send_ack(client_fd, &swap_vma);
+            close(client_fd);
+        } else {
+            sock_handle_respond(client_fd, 0);
+        }
         break;
     }
 
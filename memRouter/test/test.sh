@@ -27,3 +27,6 @@ chown $USER $pwd/config/*
 ./build/test_bin/memdcd_policy_llt
 ./build/test_bin/memdcd_process_llt
 ./build/test_bin/memdcd_threshold_llt
+./build/test_bin/memdcd_watermark_llt
+./build/test_bin/memdcd_coldest_llt
+./build/test_bin/memdcd_node_llt
@@ -24,9 +24,13 @@
 #define USWAP_ALREADY_SWAPPED	(-3)
 #define USWAP_ABORT				(-4)
 #define USWAP_ALREADY_SWAPIN	(-5)
+#define USWAP_NOT_SWAPPED		(-6)
 
 #define MAX_USWAP_NAME_LEN 32
 #define MAX_SWAPIN_THREAD_NUMS 5
+#define MAX_SWAPOUT_THREAD_NUMS 16
+#define MAX_PREFETCH_WINDOW 32
+#define USWAP_DEFAULT_PREFETCH_WINDOW 4
 
 /* flag field of struct swap_data */
 #define USWAP_DATA_DIRTY	0x1
@@ -42,11 +46,21 @@ struct swap_data {
      *   dirty if this bit is set.
      * Bit 1 (Abort Flag):
      *   This bit only takes affect in do_swapout. It indicates
-     *   aborting the swapout operation if it is set.
+     *   aborting the swapout operation if it is set. It is also set when
+     *   the whole range is zero pages, uswap installs them by itself on
+     *   swapin and the backend must not keep the range.
      */
     size_t flag;
 };
 
+/*
+ * do_swapin returns USWAP_NOT_SWAPPED if the page of the fault was never
+ * swapped out, which is the first touch of it. uswap installs a zero page
+ * for such a fault, and swapin prefetch stops at it. A fault in a range
+ * waits until the do_swapout of the range returns, so the backend should
+ * fail get_swapout_buf rather than do_swapout, after which the pages are
+ * already taken away from the process.
+ */
 struct uswap_operations {
     int (*get_swapout_buf) (const void *, size_t, struct swap_data *);
     int (*do_swapout) (struct swap_data *);
@@ -60,10 +74,48 @@ int register_userfaultfd(void *addr, size_t size);
 
 int unregister_userfaultfd(void *addr, size_t size);
 
+/*
+ * Set how many ranges are prefetched ahead of a sequential or strided fault
+ * stream in the registered regions overlapping 'addr ~ addr+size'.
+ * Window 0 disables prefetch.
+ */
+int set_uswap_prefetch_window(void *addr, size_t size, int window);
+
 int register_uswap(const char *name, size_t len,
                    const struct uswap_operations *ops);
 
+/*
+ * Zero-copy swapout. Instead of copying the range into the buffer from
+ * get_swapout_buf, do_swapout_zc gets the temporary mapping of the range
+ * in 'buf' and may consume it in place (write, vmsplice, ...). The mapping
+ * belongs to the backend afterwards, which must release it with
+ * uswap_release_swapout_va, also when the call fails. 'buf' is NULL if
+ * USWAP_DATA_ABORT is set. Pass NULL to go back to the copying path.
+ * Must be called after register_uswap and before uswap_init.
+ */
+int set_uswap_zero_copy(int (*do_swapout_zc) (struct swap_data *));
+
+int uswap_release_swapout_va(struct swap_data *swapout_data);
+
+/*
+ * Batched swapin. A swapin thread passes all the faults it has to resolve
+ * at once, so the backend can keep their reads in flight together. On
+ * success swapin_datas[i] holds the data of fault_addrs[i], each one is
+ * given back by release_buf. Its 'buf' is NULL if the page was never
+ * swapped out, like USWAP_NOT_SWAPPED of do_swapin. Must be called after
+ * register_uswap and before uswap_init.
+ */
+int set_uswap_swapin_batch(int (*do_swapin_batch) (void *const *fault_addrs, int nums,
+                                                   struct swap_data *swapin_datas));
+
 int force_swapout(const void *addr, size_t len);
 
-int uswap_init(int swapin_nums);
+/*
+ * Bind every swapout worker to one numa node in turn and allocate its
+ * memory locally, so buffers got from get_swapout_buf are node local.
+ * Must be called before uswap_init.
+ */
+int set_uswap_swapout_numa_local(int enable);
+
+int uswap_init(int swapin_nums, int swapout_nums);
 #endif
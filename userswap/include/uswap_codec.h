@@ -0,0 +1,29 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2021. All rights reserved.
+ * userswap licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: built-in page codec of the uswap compressed ram backend
+ ******************************************************************************/
+
+#ifndef __USWAP_CODEC_H__
+#define __USWAP_CODEC_H__
+
+#include <stddef.h>
+
+/*
+ * LZF style codec: literal runs of up to 32 bytes and back references of
+ * 3 to 264 bytes within an 8K window. Both functions return the produced
+ * length, or 0 if it does not fit into 'dst_len'.
+ */
+size_t uswap_lzf_compress(const void *src, size_t src_len, void *dst, size_t dst_len);
+
+size_t uswap_lzf_decompress(const void *src, size_t src_len, void *dst, size_t dst_len);
+#endif
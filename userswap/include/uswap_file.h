@@ -0,0 +1,44 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2021. All rights reserved.
+ * userswap licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: file backend of userswap
+ ******************************************************************************/
+
+#ifndef __USWAP_FILE_H__
+#define __USWAP_FILE_H__
+
+#include <stddef.h>
+
+#define USWAP_FILE_NAME "uswap_file"
+
+struct uswap_file_stats {
+    unsigned long total_blocks;
+    unsigned long free_blocks;
+    unsigned long stored_pages;
+    /* pages whose write is still in flight, served from memory meanwhile */
+    unsigned long pending_pages;
+    unsigned long swapout_pages;
+    unsigned long swapin_pages;
+    unsigned long swapin_ns_total;
+    unsigned long swapin_ns_max;
+    unsigned long io_errors;
+};
+
+/*
+ * Register the file backend. 'capacity' bytes of 'path' are preallocated
+ * and used as page sized blocks with O_DIRECT io, through io_uring when
+ * the kernel has it and io threads otherwise.
+ */
+int register_uswap_file(const char *path, size_t capacity);
+
+int uswap_file_get_stats(struct uswap_file_stats *stats);
+#endif
@@ -0,0 +1,78 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2021. All rights reserved.
+ * userswap licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: asynchronous io engine of the uswap file backend
+ ******************************************************************************/
+
+#ifndef __USWAP_IO_H__
+#define __USWAP_IO_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+enum uswap_io_op {
+    USWAP_IO_READ = 0,
+    USWAP_IO_WRITE,
+};
+
+struct uswap_io {
+    enum uswap_io_op op;
+    int fd;
+    void *buf;
+    size_t len;
+    off_t offset;
+    /* bytes done or -errno, set before done is called */
+    ssize_t res;
+    /* called from the completion context, must not block on io */
+    void (*done) (struct uswap_io *io);
+    void *priv;
+    /* engine private */
+    struct iovec iov;
+    struct uswap_io *next;
+};
+
+/* wait for a set of ios, use uswap_io_wait_done as their done callback */
+struct uswap_io_waiter {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int pending;
+    int error;
+};
+
+/*
+ * Start the engine: io_uring with 'queue_depth' entries when the kernel has
+ * it, otherwise 'threads' threads doing pread/pwrite.
+ */
+int uswap_io_init(unsigned int queue_depth, int threads);
+
+bool uswap_io_is_uring(void);
+
+/*
+ * Queue the ios with one submission and return how many of ios[0..] were
+ * queued, USWAP_ERROR if the engine is not started. Only the queued ios
+ * get their done callback, the caller still owns the rest.
+ */
+int uswap_io_submit(struct uswap_io **ios, int nums);
+
+void uswap_io_waiter_init(struct uswap_io_waiter *waiter, int pending);
+
+void uswap_io_wait_done(struct uswap_io *io);
+
+/* stop waiting for 'nums' ios which were never queued, they count as failed */
+void uswap_io_waiter_cancel(struct uswap_io_waiter *waiter, int nums);
+
+/* return USWAP_ERROR if any of the ios failed */
+int uswap_io_wait(struct uswap_io_waiter *waiter);
+#endif
@@ -0,0 +1,38 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2021. All rights reserved.
+ * userswap licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: radix tree of per page metadata used by the uswap backends
+ ******************************************************************************/
+
+#ifndef __USWAP_RADIX_H__
+#define __USWAP_RADIX_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Radix tree keyed by virtual page number. Leaves hold the fixed size
+ * entries inline, zero filled when created. Nodes are kept until
+ * uswap_radix_destroy, the caller does the locking.
+ */
+struct uswap_radix {
+    void *root;
+    size_t entry_size;
+};
+
+void uswap_radix_init(struct uswap_radix *tree, size_t entry_size);
+
+/* return the entry of 'key', NULL if it is absent and 'create' is false or on ENOMEM */
+void *uswap_radix_lookup(struct uswap_radix *tree, unsigned long key, bool create);
+
+void uswap_radix_destroy(struct uswap_radix *tree);
+#endif
@@ -16,10 +16,15 @@
 #ifndef __USWAP_SERVER_H__
 #define __USWAP_SERVER_H__
 
+#include <stddef.h>
+
 #define MAX_VMA_NUM 512
 
 enum swap_type {
     SWAP_TYPE_VMA_ADDR = 0xFFFFFF01,
+    /* framed request on a persistent connection, acked by SWAP_TYPE_VMA_ACK */
+    SWAP_TYPE_VMA_STREAM,
+    SWAP_TYPE_VMA_ACK,
     SWAP_TYPE_MAX
 };
 
@@ -30,11 +35,26 @@ struct vma_addr {
 
 struct swap_vma {
     enum swap_type type;
+    unsigned int seq;
     unsigned long length;
     struct vma_addr vma_addrs[MAX_VMA_NUM];
 };
 
+/* per-range result of one SWAP_TYPE_VMA_STREAM frame, results[i] is for vma_addrs[i] */
+struct swap_ack {
+    enum swap_type type;
+    unsigned int seq;
+    unsigned long length;
+    int results[MAX_VMA_NUM];
+};
+
+#define SWAP_VMA_HDR_LEN (offsetof(struct swap_vma, vma_addrs))
+#define SWAP_ACK_HDR_LEN (offsetof(struct swap_ack, results))
+
 int init_socket(void);
+int sock_handle_accept(int fd);
 int sock_handle_rec(int fd, struct swap_vma *swap_vma);
 int sock_handle_respond(int client_fd, int result);
+int sock_read_frame(int client_fd, struct swap_vma *swap_vma);
+int sock_send_ack(int client_fd, const struct swap_ack *ack);
 #endif
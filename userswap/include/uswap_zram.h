@@ -0,0 +1,58 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2021. All rights reserved.
+ * userswap licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: compressed ram backend of userswap
+ ******************************************************************************/
+
+#ifndef __USWAP_ZRAM_H__
+#define __USWAP_ZRAM_H__
+
+#include <stddef.h>
+
+#define USWAP_ZRAM_NAME "uswap_zram"
+
+/*
+ * Page codec of the compressed ram backend. Both callbacks return the
+ * produced length, or 0 if the output does not fit into 'dst_len'.
+ */
+struct uswap_codec {
+    const char *name;
+    size_t (*compress) (const void *src, size_t src_len, void *dst, size_t dst_len);
+    size_t (*decompress) (const void *src, size_t src_len, void *dst, size_t dst_len);
+};
+
+struct uswap_zram_stats {
+    unsigned long stored_pages;
+    /* pages which do not compress and are stored as is */
+    unsigned long raw_pages;
+    /* size of the stored pages before and after compression */
+    unsigned long orig_bytes;
+    unsigned long compr_bytes;
+    /* memory taken by the slabs of all numa pools */
+    unsigned long pool_bytes;
+    unsigned long swapout_pages;
+    unsigned long swapin_pages;
+    unsigned long swapin_ns_total;
+    unsigned long swapin_ns_max;
+};
+
+/*
+ * Set the codec used by the pool, NULL selects the built-in LZF codec.
+ * Fails once pages are stored.
+ */
+int uswap_zram_set_codec(const struct uswap_codec *codec);
+
+/* register the compressed ram backend as the uswap operations */
+int register_uswap_zram(void);
+
+int uswap_zram_get_stats(struct uswap_zram_stats *stats);
+#endif
@@ -36,7 +36,9 @@
 #include <sys/wait.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sched.h>
 #include <linux/userfaultfd.h>
+#include <linux/mempolicy.h>
 #include "uswap_server.h"
 #include "uswap_log.h"
 #include "uswap_api.h"
@@ -47,10 +49,25 @@
 #endif
 #define MMAP_RETVAL_DIRTY_MASK 0x01L
 #define MAX_TRY_NUMS 10
+#define REGION_INIT_CAPACITY 16
+#define PREFETCH_MIN_HITS 2
+#define PREFETCH_QUEUE_LEN 64
+#define ZERO_CHECK_WORDS 8
+#define BITS_PER_LONG (sizeof(unsigned long) * CHAR_BIT)
+#define UFFD_MSG_BATCH 32
+#define FAULT_QUEUE_LEN 256
+/* faults in the same 2M chunk go to the same swapin thread */
+#define FAULT_SHARD_SHIFT 21
+#define NODE_SYSFS_PATH "/sys/devices/system/node"
+#define NODE_CPULIST_MAX_LEN 1024
+#define SWAPOUT_QUEUE_LEN 8
+#define MAX_SWAPOUT_CONN_NUM 4
 
 struct uswap_dev {
     char name[MAX_USWAP_NAME_LEN];
     struct uswap_operations *ops;
+    int (*do_swapout_zc) (struct swap_data *);
+    int (*do_swapin_batch) (void *const *, int, struct swap_data *);
     bool enabled;
     bool alive;
     int uffd;
@@ -58,6 +75,71 @@ struct uswap_dev {
     pthread_mutex_t mutex;
 };
 
+/*
+ * Registered userfaultfd regions, sorted by start address. Besides the range,
+ * each region keeps the fault stream state used by swapin prefetch and the
+ * bitmap of its pages swapped out as zero pages, allocated on first use.
+ */
+struct uswap_region {
+    unsigned long start;
+    unsigned long end;
+    unsigned long *zero_bitmap;
+    int prefetch_window;
+    int hits;
+    long stride;
+    unsigned long last_start;
+    unsigned long next_addr;
+};
+
+struct uswap_region_table {
+    struct uswap_region *regions;
+    int nums;
+    int capacity;
+    pthread_mutex_t mutex;
+};
+
+static struct uswap_region_table g_regions = {
+    .regions = NULL,
+    .nums = 0,
+    .capacity = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+struct uswap_prefetch_req {
+    unsigned long addr;
+    long stride;
+    int nums;
+};
+
+struct uswap_prefetch_queue {
+    struct uswap_prefetch_req reqs[PREFETCH_QUEUE_LEN];
+    int head;
+    int tail;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+};
+
+static struct uswap_prefetch_queue g_prefetch_queue = {
+    .head = 0,
+    .tail = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+/* pending fault addresses of one swapin thread */
+struct uswap_fault_queue {
+    unsigned long addrs[FAULT_QUEUE_LEN];
+    int head;
+    int tail;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    /* signaled when addresses are popped, the reader waits on it while the queue is full */
+    pthread_cond_t space_cond;
+};
+
+static struct uswap_fault_queue g_fault_queues[MAX_SWAPIN_THREAD_NUMS];
+static int g_swapin_nums = 1;
+
 static struct uswap_dev g_dev = {
     .name = "",
     .ops = NULL,
@@ -68,6 +150,94 @@ static struct uswap_dev g_dev = {
     .mutex = PTHREAD_MUTEX_INITIALIZER,
 };
 
+/*
+ * Ranges of one swapout request are claimed one by one by the swapout
+ * workers. A range is always swapped out by exactly one worker, and the next
+ * request is dispatched only after every range of the current one is done,
+ * so swapout of the same range is never reordered.
+ */
+struct uswap_swapout_pool {
+    int nums;
+    bool numa_local;
+    const struct vma_addr *vmas;
+    int *results;
+    int total;
+    int next;
+    int done;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+};
+
+static struct uswap_swapout_pool g_swapout_pool = {
+    .nums = 1,
+    .numa_local = false,
+    .vmas = NULL,
+    .results = NULL,
+    .total = 0,
+    .next = 0,
+    .done = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .work_cond = PTHREAD_COND_INITIALIZER,
+    .done_cond = PTHREAD_COND_INITIALIZER,
+};
+
+/*
+ * A request read from a client and not swapped out yet. 'closed' marks that
+ * the receiver is done with client_fd, the swapout thread closes it once the
+ * requests queued before are acked.
+ */
+struct uswap_swapout_req {
+    int client_fd;
+    bool closed;
+    struct swap_vma vma;
+};
+
+/* requests are read by the receiver while the swapout thread works on the head */
+struct uswap_swapout_queue {
+    struct uswap_swapout_req reqs[SWAPOUT_QUEUE_LEN];
+    int head;
+    int tail;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_cond_t space_cond;
+};
+
+static struct uswap_swapout_queue g_swapout_queue = {
+    .head = 0,
+    .tail = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .space_cond = PTHREAD_COND_INITIALIZER,
+};
+
+/*
+ * Ranges taken away from the process by MAP_REPLACE whose do_swapout has
+ * not returned yet. The backend does not have their data meanwhile, so a
+ * fault in them waits until it does instead of reading a miss as zero.
+ * The entries live on the stack of the swapout, 'seq' counts the swapouts
+ * started.
+ */
+struct uswap_inflight {
+    unsigned long start;
+    unsigned long end;
+    struct uswap_inflight *next;
+};
+
+struct uswap_inflight_list {
+    struct uswap_inflight *head;
+    unsigned long seq;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+};
+
+static struct uswap_inflight_list g_inflight = {
+    .head = NULL,
+    .seq = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
 static size_t get_page_size(void)
 {
     static size_t page_size = 0;
@@ -134,6 +304,16 @@ static int call_do_swapout(struct swap_data *swapout_data)
     return g_dev.ops->do_swapout(swapout_data);
 }
 
+static int call_do_swapout_zc(struct swap_data *swapout_data)
+{
+    return g_dev.do_swapout_zc(swapout_data);
+}
+
+static int call_do_swapin_batch(void *const *fault_addrs, int nums, struct swap_data *swapin_datas)
+{
+    return g_dev.do_swapin_batch(fault_addrs, nums, swapin_datas);
+}
+
 static int call_do_swapin(const void *fault_addr, struct swap_data *swapin_data)
 {
     return g_dev.ops->do_swapin(fault_addr, swapin_data);
@@ -165,6 +345,186 @@ static int init_userfaultfd(void)
     return ret;
 }
 
+/* return index of the first region whose end is above addr */
+static int region_lower_bound(unsigned long addr)
+{
+    int low = 0;
+    int high = g_regions.nums;
+
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (g_regions.regions[mid].end <= addr) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/* caller must hold g_regions.mutex */
+static struct uswap_region *region_find(unsigned long addr)
+{
+    int index = region_lower_bound(addr);
+
+    if (index < g_regions.nums && g_regions.regions[index].start <= addr) {
+        return &g_regions.regions[index];
+    }
+    return NULL;
+}
+
+static int region_insert_at(int index, unsigned long start, unsigned long end,
+                            int prefetch_window)
+{
+    struct uswap_region *regions = NULL;
+    int capacity;
+
+    if (g_regions.nums == g_regions.capacity) {
+        capacity = g_regions.capacity == 0 ? REGION_INIT_CAPACITY : g_regions.capacity * 2;
+        regions = realloc(g_regions.regions, capacity * sizeof(struct uswap_region));
+        if (regions == NULL) {
+            return USWAP_ERROR;
+        }
+        g_regions.regions = regions;
+        g_regions.capacity = capacity;
+    }
+
+    memmove(&g_regions.regions[index + 1], &g_regions.regions[index],
+            (g_regions.nums - index) * sizeof(struct uswap_region));
+    memset(&g_regions.regions[index], 0, sizeof(struct uswap_region));
+    g_regions.regions[index].start = start;
+    g_regions.regions[index].end = end;
+    g_regions.regions[index].prefetch_window = prefetch_window;
+    g_regions.nums++;
+    return USWAP_SUCCESS;
+}
+
+static void region_remove_at(int index)
+{
+    free(g_regions.regions[index].zero_bitmap);
+    memmove(&g_regions.regions[index], &g_regions.regions[index + 1],
+            (g_regions.nums - index - 1) * sizeof(struct uswap_region));
+    g_regions.nums--;
+}
+
+static unsigned long *zero_bitmap_alloc(unsigned long start, unsigned long end)
+{
+    size_t pages = (end - start) / get_page_size();
+
+    return calloc((pages + BITS_PER_LONG - 1) / BITS_PER_LONG, sizeof(unsigned long));
+}
+
+static bool zero_bitmap_test(const unsigned long *bitmap, size_t bit)
+{
+    return (bitmap[bit / BITS_PER_LONG] & (1UL << (bit % BITS_PER_LONG))) != 0;
+}
+
+static void zero_bitmap_set(unsigned long *bitmap, size_t bit)
+{
+    bitmap[bit / BITS_PER_LONG] |= 1UL << (bit % BITS_PER_LONG);
+}
+
+static void zero_bitmap_clear(unsigned long *bitmap, size_t bit)
+{
+    bitmap[bit / BITS_PER_LONG] &= ~(1UL << (bit % BITS_PER_LONG));
+}
+
+/* copy the bits of 'start ~ end' of a region starting at 'old_start' into a new bitmap */
+static unsigned long *zero_bitmap_slice(const unsigned long *bitmap, unsigned long old_start,
+                                        unsigned long start, unsigned long end)
+{
+    unsigned long *slice = NULL;
+    size_t page_size = get_page_size();
+    size_t offset = (start - old_start) / page_size;
+    size_t pages = (end - start) / page_size;
+
+    if (bitmap == NULL) {
+        return NULL;
+    }
+    slice = zero_bitmap_alloc(start, end);
+    if (slice == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < pages; i++) {
+        if (zero_bitmap_test(bitmap, offset + i)) {
+            zero_bitmap_set(slice, i);
+        }
+    }
+    return slice;
+}
+
+static int region_add(unsigned long start, unsigned long end)
+{
+    int ret;
+
+    pthread_mutex_lock(&g_regions.mutex);
+    ret = region_insert_at(region_lower_bound(start), start, end, USWAP_DEFAULT_PREFETCH_WINDOW);
+    pthread_mutex_unlock(&g_regions.mutex);
+    return ret;
+}
+
+/* remove 'start ~ end' from the table, regions partly covered are trimmed or split */
+static int region_del(unsigned long start, unsigned long end)
+{
+    struct uswap_region *region = NULL;
+    unsigned long *bitmap = NULL;
+    int index;
+    int ret = USWAP_SUCCESS;
+
+    pthread_mutex_lock(&g_regions.mutex);
+    index = region_lower_bound(start);
+    while (index < g_regions.nums && g_regions.regions[index].start < end) {
+        region = &g_regions.regions[index];
+        if (region->start < start && region->end > end) {
+            bitmap = zero_bitmap_slice(region->zero_bitmap, region->start, end, region->end);
+            ret = region_insert_at(index + 1, end, region->end, region->prefetch_window);
+            if (ret == USWAP_SUCCESS) {
+                g_regions.regions[index + 1].zero_bitmap = bitmap;
+            } else {
+                free(bitmap);
+            }
+            g_regions.regions[index].end = start;
+            break;
+        }
+        if (region->start < start) {
+            region->end = start;
+            index++;
+        } else if (region->end > end) {
+            bitmap = zero_bitmap_slice(region->zero_bitmap, region->start, end, region->end);
+            free(region->zero_bitmap);
+            region->zero_bitmap = bitmap;
+            region->start = end;
+            break;
+        } else {
+            region_remove_at(index);
+        }
+    }
+    pthread_mutex_unlock(&g_regions.mutex);
+    return ret;
+}
+
+int set_uswap_prefetch_window(void *addr, size_t size, int window)
+{
+    unsigned long start = (unsigned long)addr;
+    int index;
+    int found = 0;
+
+    if (addr == NULL || size > SSIZE_MAX || window < 0 || window > MAX_PREFETCH_WINDOW) {
+        return USWAP_ERROR;
+    }
+
+    pthread_mutex_lock(&g_regions.mutex);
+    index = region_lower_bound(start);
+    while (index < g_regions.nums && g_regions.regions[index].start < start + size) {
+        g_regions.regions[index].prefetch_window = window;
+        g_regions.regions[index].hits = 0;
+        found++;
+        index++;
+    }
+    pthread_mutex_unlock(&g_regions.mutex);
+    return found > 0 ? USWAP_SUCCESS : USWAP_UNREGISTER_MEM;
+}
+
 int register_userfaultfd(void *addr, size_t size)
 {
     struct uffdio_register uffdio_register;
@@ -200,6 +560,10 @@ int register_userfaultfd(void *addr, size_t size)
             uswap_log(USWAP_LOG_ERR, "register uffd failed\n");
             return USWAP_ERROR;
         }
+        if (region_add(uffdio_register.range.start,
+                       uffdio_register.range.start + uffdio_register.range.len) != USWAP_SUCCESS) {
+            uswap_log(USWAP_LOG_WARN, "record registered region failed\n");
+        }
         return USWAP_SUCCESS;
     }
     uswap_log(USWAP_LOG_ERR, "register uffd: the size smaller than page_size\n");
@@ -224,6 +588,10 @@ int unregister_userfaultfd(void *addr, size_t size)
         uswap_log(USWAP_LOG_ERR, "unregister userfaultfd failed\n");
         return USWAP_ERROR;
     }
+    if (region_del(uffdio_register.range.start,
+                   uffdio_register.range.start + uffdio_register.range.len) != USWAP_SUCCESS) {
+        uswap_log(USWAP_LOG_WARN, "remove registered region failed\n");
+    }
     return USWAP_SUCCESS;
 }
 
@@ -248,11 +616,48 @@ int register_uswap(const char *name, size_t len,
 
     snprintf(g_dev.name, MAX_USWAP_NAME_LEN, "%s", name);
     g_dev.ops = &uswap_ops;
+    /* the optional callbacks belong to the previous backend */
+    g_dev.do_swapout_zc = NULL;
+    g_dev.do_swapin_batch = NULL;
     g_dev.enabled = true;
     uswap_log(USWAP_LOG_INFO, "register uswap ops [%s] success\n", g_dev.name);
     return USWAP_SUCCESS;
 }
 
+int set_uswap_zero_copy(int (*do_swapout_zc) (struct swap_data *))
+{
+    if (!g_dev.enabled || is_uswap_threads_alive()) {
+        return USWAP_ERROR;
+    }
+    g_dev.do_swapout_zc = do_swapout_zc;
+    return USWAP_SUCCESS;
+}
+
+int set_uswap_swapin_batch(int (*do_swapin_batch) (void *const *, int, struct swap_data *))
+{
+    if (!g_dev.enabled || is_uswap_threads_alive()) {
+        return USWAP_ERROR;
+    }
+    g_dev.do_swapin_batch = do_swapin_batch;
+    return USWAP_SUCCESS;
+}
+
+int uswap_release_swapout_va(struct swap_data *swapout_data)
+{
+    if (swapout_data == NULL) {
+        return USWAP_ERROR;
+    }
+    if (swapout_data->buf == NULL) {
+        return USWAP_SUCCESS;
+    }
+    if (munmap(swapout_data->buf, swapout_data->len) != 0) {
+        uswap_log(USWAP_LOG_ERR, "unmap swapout va failed\n");
+        return USWAP_ERROR;
+    }
+    swapout_data->buf = NULL;
+    return USWAP_SUCCESS;
+}
+
 static int mlock_pthread_stack(pthread_t tid)
 {
     int ret;
@@ -277,27 +682,28 @@ static int mlock_pthread_stack(pthread_t tid)
     return USWAP_SUCCESS;
 }
 
-static int read_uffd_msg(int uffd, struct uffd_msg *msg)
+/*
+ * Drain up to 'max' messages with one read. Return the number of page
+ * fault addresses stored in 'addrs', other events are skipped.
+ */
+static int read_uffd_msgs(int uffd, struct uffd_msg *msgs, int max, unsigned long *addrs)
 {
-    int ret;
-    int msg_len = sizeof(struct uffd_msg);
+    ssize_t ret;
+    int nums = 0;
 
-    for (int i = 0; i < MAX_TRY_NUMS; i++) {
-        ret = read(uffd, msg, msg_len);
-        if (ret != msg_len) {
-            if (errno == EAGAIN) {
-                continue;
-            }
-            return USWAP_ERROR;
-        }
+    ret = read(uffd, msgs, max * sizeof(struct uffd_msg));
+    if (ret < 0) {
+        return errno == EAGAIN ? 0 : USWAP_ERROR;
+    }
 
-        if (msg->event != UFFD_EVENT_PAGEFAULT) {
+    for (int i = 0; i < ret / (ssize_t)sizeof(struct uffd_msg); i++) {
+        if (msgs[i].event != UFFD_EVENT_PAGEFAULT) {
             uswap_log(USWAP_LOG_ERR, "unexpected event on userfaultfd\n");
-            return USWAP_ERROR;
+            continue;
         }
-        return USWAP_SUCCESS;
+        addrs[nums++] = msgs[i].arg.pagefault.address;
     }
-    return USWAP_ABORT;
+    return nums;
 }
 
 static int ioctl_uffd_copy_pages(int uffd, const struct swap_data *swapin_data)
@@ -325,119 +731,746 @@ static int ioctl_uffd_copy_pages(int uffd, const struct swap_data *swapin_data)
     return USWAP_SUCCESS;
 }
 
-static int ioctl_uffd_copy(int uffd, struct swap_data *swapin_data)
+/*
+ * Copy 'src ~ src+len' to 'dst' which lies in one registered region, with
+ * as few UFFDIO_COPY as possible. A partial copy is resumed after the
+ * copied part, a page already present is skipped. Return the number of
+ * bytes skipped as present, or USWAP_ERROR.
+ */
+static long uffd_copy_range(int uffd, unsigned long dst, unsigned long src, size_t len)
 {
+    size_t page_size = get_page_size();
+    struct uffdio_copy uffdio_copy;
+    long existed = 0;
+    int tries = 0;
     int ret;
-    struct uffdio_copy uffdio_copy = {
-        .src = (unsigned long)swapin_data->buf,
-        .dst = (unsigned long)swapin_data->start_va,
-        .len = swapin_data->len,
-        .mode = 0,
-        .copy = 0,
-    };
-    for (int i = 0; i < MAX_TRY_NUMS; i++) {
-        ret = ioctl(uffd, UFFDIO_COPY, &uffdio_copy);
-        if (ret < 0) {
-            if (errno == EAGAIN) {
-                continue;
-            }
 
-            if (errno == EEXIST) {
-                return USWAP_ALREADY_SWAPIN;
-            }
-            /*
-            * 'start_va ~ start_va+len' may exceed the range of one vma.
-            * If that is the case, copy one page at a time.
-            */
-            ret = ioctl_uffd_copy_pages(uffd, swapin_data);
-            if (ret == USWAP_ERROR) {
-                return USWAP_ERROR;
-            }
+    while (len > 0) {
+        uffdio_copy.dst = dst;
+        uffdio_copy.src = src;
+        uffdio_copy.len = len;
+        uffdio_copy.mode = 0;
+        uffdio_copy.copy = 0;
+        ret = ioctl(uffd, UFFDIO_COPY, &uffdio_copy);
+        if (ret == 0) {
+            return existed;
         }
-        return USWAP_SUCCESS;
-    }
-    uswap_log(USWAP_LOG_ERR, "ioctl copy max try failed\n");
-    return USWAP_ERROR;
-}
-
-static void *swapin_thread(void *arg)
-{
-    struct swap_data swapin_data;
-    struct uffd_msg uffd_msg;
-    struct pollfd pollfd;
-    unsigned long fault_addr;
-    int uswap_uffd;
-    int ret;
-
-    prctl(PR_SET_NAME, "uswap-swapin", 0, 0, 0);
-
-    uswap_mutex_lock();
-    uswap_uffd = get_uswap_uffd();
-    while (uswap_uffd < 0) {
-        uswap_cond_wait();
-        uswap_uffd = get_uswap_uffd();
-    }
-    uswap_mutex_unlock();
-    while (1) {
-        pollfd.fd = uswap_uffd;
-        pollfd.events = POLLIN;
-        ret = poll(&pollfd, 1, -1);
-        if (ret < 0) {
-            uswap_log(USWAP_LOG_ERR, "poll failed\n");
-            usleep(10);
-            continue;
+        if (errno != EAGAIN && errno != EEXIST) {
+            uswap_log(USWAP_LOG_ERR, "uffd ioctl copy failed\n");
+            return USWAP_ERROR;
         }
-        ret = read_uffd_msg(uswap_uffd, &uffd_msg);
-        if (ret == USWAP_ABORT) {
+        if (uffdio_copy.copy > 0) {
+            dst += uffdio_copy.copy;
+            src += uffdio_copy.copy;
+            len -= uffdio_copy.copy;
+            tries = 0;
             continue;
-        } else if (ret == USWAP_ERROR) {
-            uswap_log(USWAP_LOG_ERR, "read uffd failed\n");
+        }
+        if (errno == EEXIST) {
+            /* the first page is present already, go on with the rest */
+            dst += page_size;
+            src += page_size;
+            len -= page_size;
+            existed += page_size;
             continue;
         }
+        if (++tries >= MAX_TRY_NUMS) {
+            uswap_log(USWAP_LOG_ERR, "ioctl copy max try failed\n");
+            return USWAP_ERROR;
+        }
+    }
+    return existed;
+}
 
-        fault_addr = uffd_msg.arg.pagefault.address;
-
-        ret = call_do_swapin((void *)fault_addr, &swapin_data);
-        if (ret == USWAP_ERROR) {
-            uswap_log(USWAP_LOG_ERR, "do_swapin failed\n");
-            exit(-1);
+/*
+ * Return the end of the piece of 'start ~ end' that starts at 'start' and
+ * lies in one registered region. 'in_region' tells whether the piece is in
+ * a region or in a gap between them.
+ */
+static unsigned long region_piece_end(unsigned long start, unsigned long end, bool *in_region)
+{
+    struct uswap_region *region = NULL;
+    unsigned long piece_end = end;
+    int index;
+
+    pthread_mutex_lock(&g_regions.mutex);
+    index = region_lower_bound(start);
+    if (index < g_regions.nums) {
+        region = &g_regions.regions[index];
+        if (region->start <= start) {
+            piece_end = region->end < end ? region->end : end;
+            *in_region = true;
+        } else {
+            piece_end = region->start < end ? region->start : end;
+            *in_region = false;
         }
+    } else {
+        *in_region = false;
+    }
+    pthread_mutex_unlock(&g_regions.mutex);
+    return piece_end;
+}
 
-        ret = ioctl_uffd_copy(uswap_uffd, &swapin_data);
-        if (ret == USWAP_ERROR) {
-            uswap_log(USWAP_LOG_ERR, "uffd ioctl copy failed\n");
-            exit(-1);
+/*
+ * The range from the backend may cross registered regions, and so vmas.
+ * Split it at the region boundaries up front and copy each piece at once.
+ */
+static int ioctl_uffd_copy(int uffd, struct swap_data *swapin_data)
+{
+    unsigned long start = (unsigned long)swapin_data->start_va;
+    unsigned long end = start + swapin_data->len;
+    unsigned long piece_end;
+    struct swap_data piece;
+    long existed = 0;
+    long ret;
+    bool in_region = false;
+
+    while (start < end) {
+        piece_end = region_piece_end(start, end, &in_region);
+        if (in_region) {
+            ret = uffd_copy_range(uffd, start, (unsigned long)swapin_data->buf +
+                                  (start - (unsigned long)swapin_data->start_va), piece_end - start);
+        } else {
+            /* not a known region, its vma layout is unknown, copy one page at a time */
+            piece.start_va = (void *)start;
+            piece.buf = (char *)swapin_data->buf + (start - (unsigned long)swapin_data->start_va);
+            piece.len = piece_end - start;
+            ret = ioctl_uffd_copy_pages(uffd, &piece);
         }
-        ret = call_release_buf(&swapin_data);
         if (ret == USWAP_ERROR) {
-            uswap_log(USWAP_LOG_ERR, "release buf failed\n");
+            return USWAP_ERROR;
         }
+        existed += in_region ? ret : 0;
+        start = piece_end;
+    }
+
+    if (existed == (long)swapin_data->len) {
+        return USWAP_ALREADY_SWAPIN;
     }
+    return USWAP_SUCCESS;
 }
 
-static void* mmap_tmpva(const void *start, size_t len, int *is_dirty)
+/* install a zero page at the page aligned 'addr' */
+static int uffd_zeropage(int uffd, unsigned long addr)
 {
-    unsigned long new_addr;
-    new_addr = syscall(__NR_mmap, start, len, PROT_READ | PROT_WRITE,
-                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_REPLACE, -1, 0);
-    if ((void *)new_addr == MAP_FAILED) {
-        if (errno != ENODEV) {
-            uswap_log(USWAP_LOG_ERR, "the addr can't be swapout\n");
+    struct uffdio_zeropage uffdio_zeropage;
+
+    uffdio_zeropage.range.start = addr;
+    uffdio_zeropage.range.len = get_page_size();
+    uffdio_zeropage.mode = 0;
+    for (int i = 0; i < MAX_TRY_NUMS; i++) {
+        if (ioctl(uffd, UFFDIO_ZEROPAGE, &uffdio_zeropage) == 0 || errno == EEXIST) {
+            return USWAP_SUCCESS;
+        }
+        if (errno != EAGAIN) {
+            break;
         }
-        return MAP_FAILED;
-    } else {
-        *is_dirty = new_addr & MMAP_RETVAL_DIRTY_MASK;
-        new_addr = new_addr & (~MMAP_RETVAL_DIRTY_MASK);
     }
-    return (void *)new_addr;
+    uswap_log(USWAP_LOG_ERR, "uffd ioctl zeropage failed\n");
+    return USWAP_ERROR;
 }
 
-static int do_swapout_once(const void *start, size_t len,
-                           struct swap_data *swapout_data)
+/*
+ * Resolve the fault at 'addr' with UFFDIO_ZEROPAGE if its page was swapped
+ * out as a zero page. Return false if the backend has to swap it in.
+ */
+static bool swapin_zero_page(int uffd, unsigned long addr)
 {
-    int ret;
-    int is_dirty = 1;
-    void *tmpva = NULL;
+    struct uswap_region *region = NULL;
+    size_t page_size = get_page_size();
+    size_t bit;
+
+    addr &= ~(page_size - 1);
+    pthread_mutex_lock(&g_regions.mutex);
+    region = region_find(addr);
+    if (region == NULL || region->zero_bitmap == NULL) {
+        pthread_mutex_unlock(&g_regions.mutex);
+        return false;
+    }
+    bit = (addr - region->start) / page_size;
+    if (!zero_bitmap_test(region->zero_bitmap, bit)) {
+        pthread_mutex_unlock(&g_regions.mutex);
+        return false;
+    }
+    zero_bitmap_clear(region->zero_bitmap, bit);
+    pthread_mutex_unlock(&g_regions.mutex);
+
+    return uffd_zeropage(uffd, addr) == USWAP_SUCCESS;
+}
+
+static void inflight_add(struct uswap_inflight *inflight, const void *start, size_t len)
+{
+    inflight->start = (unsigned long)start;
+    inflight->end = (unsigned long)start + len;
+    pthread_mutex_lock(&g_inflight.mutex);
+    inflight->next = g_inflight.head;
+    g_inflight.head = inflight;
+    g_inflight.seq++;
+    pthread_mutex_unlock(&g_inflight.mutex);
+}
+
+static void inflight_del(struct uswap_inflight *inflight)
+{
+    struct uswap_inflight **pos = NULL;
+
+    pthread_mutex_lock(&g_inflight.mutex);
+    for (pos = &g_inflight.head; *pos != NULL; pos = &(*pos)->next) {
+        if (*pos == inflight) {
+            *pos = inflight->next;
+            break;
+        }
+    }
+    pthread_cond_broadcast(&g_inflight.cond);
+    pthread_mutex_unlock(&g_inflight.mutex);
+}
+
+static bool inflight_find(unsigned long addr)
+{
+    for (struct uswap_inflight *inflight = g_inflight.head; inflight != NULL; inflight = inflight->next) {
+        if (addr >= inflight->start && addr < inflight->end) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Wait until the swapout of the range holding 'addr', if any, is done.
+ * Return the swapout seq to check a backend lookup made after it against.
+ */
+static unsigned long inflight_wait(unsigned long addr)
+{
+    unsigned long seq;
+
+    pthread_mutex_lock(&g_inflight.mutex);
+    while (inflight_find(addr)) {
+        pthread_cond_wait(&g_inflight.cond, &g_inflight.mutex);
+    }
+    seq = g_inflight.seq;
+    pthread_mutex_unlock(&g_inflight.mutex);
+    return seq;
+}
+
+/*
+ * Install a zero page at 'addr' unless a swapout started since 'seq', which
+ * may have taken the page away before the backend has it. No swapout can
+ * start before the page is installed.
+ */
+static bool inflight_zeropage(int uffd, unsigned long addr, unsigned long seq)
+{
+    bool installed = false;
+
+    pthread_mutex_lock(&g_inflight.mutex);
+    if (g_inflight.seq == seq) {
+        if (uffd_zeropage(uffd, addr) != USWAP_SUCCESS) {
+            exit(-1);
+        }
+        installed = true;
+    }
+    pthread_mutex_unlock(&g_inflight.mutex);
+    return installed;
+}
+
+static int wait_uswap_uffd(void)
+{
+    int uswap_uffd;
+
+    uswap_mutex_lock();
+    uswap_uffd = get_uswap_uffd();
+    while (uswap_uffd < 0) {
+        uswap_cond_wait();
+        uswap_uffd = get_uswap_uffd();
+    }
+    uswap_mutex_unlock();
+    return uswap_uffd;
+}
+
+static void prefetch_queue_push(unsigned long addr, long stride, int nums)
+{
+    struct uswap_prefetch_queue *queue = &g_prefetch_queue;
+    int next;
+
+    pthread_mutex_lock(&queue->mutex);
+    next = (queue->tail + 1) % PREFETCH_QUEUE_LEN;
+    if (next == queue->head) {
+        /* prefetch is best effort, drop the request when the queue is full */
+        pthread_mutex_unlock(&queue->mutex);
+        return;
+    }
+    queue->reqs[queue->tail].addr = addr;
+    queue->reqs[queue->tail].stride = stride;
+    queue->reqs[queue->tail].nums = nums;
+    queue->tail = next;
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+/*
+ * Track the fault stream of the region of the range just swapped in. Once
+ * PREFETCH_MIN_HITS faults have the same stride, the next prefetch_window
+ * ranges of the stream are queued for prefetch. Faults landing where the
+ * prefetched part of the stream ends keep the stream going.
+ */
+static void prefetch_track_fault(unsigned long start)
+{
+    struct uswap_region *region = NULL;
+    long delta;
+
+    pthread_mutex_lock(&g_regions.mutex);
+    region = region_find(start);
+    if (region == NULL || region->prefetch_window == 0) {
+        pthread_mutex_unlock(&g_regions.mutex);
+        return;
+    }
+
+    if (region->hits > 0 && start == region->next_addr) {
+        region->hits++;
+    } else {
+        delta = (long)(start - region->last_start);
+        if (region->hits > 0 && delta != 0 && delta == region->stride) {
+            region->hits++;
+        } else {
+            region->stride = delta;
+            region->hits = 1;
+        }
+    }
+    region->last_start = start;
+    region->next_addr = start + region->stride;
+
+    if (region->hits >= PREFETCH_MIN_HITS && region->stride != 0) {
+        region->next_addr = start + region->stride * (region->prefetch_window + 1);
+        prefetch_queue_push(start + region->stride, region->stride, region->prefetch_window);
+    }
+    pthread_mutex_unlock(&g_regions.mutex);
+}
+
+static bool prefetch_addr_valid(unsigned long addr)
+{
+    bool valid;
+
+    pthread_mutex_lock(&g_regions.mutex);
+    valid = region_find(addr) != NULL;
+    pthread_mutex_unlock(&g_regions.mutex);
+    return valid;
+}
+
+static void prefetch_one_stream(int uffd, const struct uswap_prefetch_req *req)
+{
+    struct swap_data swapin_data;
+    unsigned long addr;
+    int ret;
+
+    for (int i = 0; i < req->nums; i++) {
+        addr = req->addr + req->stride * i;
+        if (!prefetch_addr_valid(addr)) {
+            return;
+        }
+        inflight_wait(addr);
+        if (swapin_zero_page(uffd, addr)) {
+            continue;
+        }
+        /* the range may not be swapped out at all, stop at the first USWAP_NOT_SWAPPED */
+        if (call_do_swapin((void *)addr, &swapin_data) != USWAP_SUCCESS) {
+            return;
+        }
+        ret = ioctl_uffd_copy(uffd, &swapin_data);
+        call_release_buf(&swapin_data);
+        if (ret == USWAP_ERROR) {
+            return;
+        }
+    }
+}
+
+static void *prefetch_thread(void *arg)
+{
+    struct uswap_prefetch_queue *queue = &g_prefetch_queue;
+    struct uswap_prefetch_req req;
+    int uswap_uffd;
+
+    prctl(PR_SET_NAME, "uswap-prefetch", 0, 0, 0);
+
+    uswap_uffd = wait_uswap_uffd();
+    while (1) {
+        pthread_mutex_lock(&queue->mutex);
+        while (queue->head == queue->tail) {
+            pthread_cond_wait(&queue->cond, &queue->mutex);
+        }
+        req = queue->reqs[queue->head];
+        queue->head = (queue->head + 1) % PREFETCH_QUEUE_LEN;
+        pthread_mutex_unlock(&queue->mutex);
+
+        prefetch_one_stream(uswap_uffd, &req);
+    }
+    return NULL;
+}
+
+static int fault_shard(unsigned long addr)
+{
+    return (addr >> FAULT_SHARD_SHIFT) % g_swapin_nums;
+}
+
+/*
+ * The page of 'fault_addr' was not in the backend at the lookup made after
+ * 'seq'. It is first touched and reads as zero, unless a swapout started
+ * since then, return false for the lookup to be redone after that swapout.
+ */
+static bool swapin_not_swapped(int uffd, unsigned long fault_addr, struct swap_data *swapin_data,
+                               unsigned long seq)
+{
+    swapin_data->start_va = (void *)(fault_addr & ~(get_page_size() - 1));
+    swapin_data->len = get_page_size();
+    swapin_data->buf = NULL;
+    return inflight_zeropage(uffd, (unsigned long)swapin_data->start_va, seq);
+}
+
+static void swapin_one_fault(int uffd, unsigned long fault_addr, struct swap_data *swapin_data,
+                             unsigned long seq)
+{
+    int ret;
+
+    while ((ret = call_do_swapin((void *)fault_addr, swapin_data)) == USWAP_NOT_SWAPPED) {
+        if (swapin_not_swapped(uffd, fault_addr, swapin_data, seq)) {
+            return;
+        }
+        seq = inflight_wait(fault_addr);
+        if (swapin_zero_page(uffd, fault_addr)) {
+            return;
+        }
+    }
+    if (ret == USWAP_ERROR) {
+        uswap_log(USWAP_LOG_ERR, "do_swapin failed\n");
+        exit(-1);
+    }
+
+    ret = ioctl_uffd_copy(uffd, swapin_data);
+    if (ret == USWAP_ERROR) {
+        uswap_log(USWAP_LOG_ERR, "uffd ioctl copy failed\n");
+        exit(-1);
+    }
+    prefetch_track_fault((unsigned long)swapin_data->start_va);
+    ret = call_release_buf(swapin_data);
+    if (ret == USWAP_ERROR) {
+        uswap_log(USWAP_LOG_ERR, "release buf failed\n");
+    }
+}
+
+/*
+ * Resolve a batch of faults. UFFDIO_COPY wakes every thread waiting in the
+ * copied range, so faults inside a range already copied in this batch are
+ * skipped.
+ */
+static void swapin_faults_batch(int uffd, const unsigned long *addrs, int nums)
+{
+    struct swap_data swapin_datas[UFFD_MSG_BATCH];
+    void *fault_addrs[UFFD_MSG_BATCH];
+    unsigned long seqs[UFFD_MSG_BATCH];
+    unsigned long seq;
+    int fault_nums = 0;
+    int ret;
+
+    for (int i = 0; i < nums && fault_nums < UFFD_MSG_BATCH; i++) {
+        seq = inflight_wait(addrs[i]);
+        if (!swapin_zero_page(uffd, addrs[i])) {
+            seqs[fault_nums] = seq;
+            fault_addrs[fault_nums++] = (void *)addrs[i];
+        }
+    }
+    if (fault_nums == 0) {
+        return;
+    }
+
+    ret = call_do_swapin_batch(fault_addrs, fault_nums, swapin_datas);
+    if (ret == USWAP_ERROR) {
+        uswap_log(USWAP_LOG_ERR, "do_swapin_batch failed\n");
+        exit(-1);
+    }
+    for (int i = 0; i < fault_nums; i++) {
+        if (swapin_datas[i].buf == NULL) {
+            if (!swapin_not_swapped(uffd, (unsigned long)fault_addrs[i], &swapin_datas[i], seqs[i])) {
+                /* taken away by a swapout started since the lookup, look it up again after it */
+                seq = inflight_wait((unsigned long)fault_addrs[i]);
+                if (!swapin_zero_page(uffd, (unsigned long)fault_addrs[i])) {
+                    swapin_one_fault(uffd, (unsigned long)fault_addrs[i], &swapin_datas[i], seq);
+                }
+            }
+            continue;
+        }
+        ret = ioctl_uffd_copy(uffd, &swapin_datas[i]);
+        if (ret == USWAP_ERROR) {
+            uswap_log(USWAP_LOG_ERR, "uffd ioctl copy failed\n");
+            exit(-1);
+        }
+        prefetch_track_fault((unsigned long)swapin_datas[i].start_va);
+        ret = call_release_buf(&swapin_datas[i]);
+        if (ret == USWAP_ERROR) {
+            uswap_log(USWAP_LOG_ERR, "release buf failed\n");
+        }
+    }
+}
+
+static void swapin_faults(int uffd, const unsigned long *addrs, int nums)
+{
+    struct swap_data swapin_data;
+    unsigned long done_start[UFFD_MSG_BATCH];
+    unsigned long done_end[UFFD_MSG_BATCH];
+    unsigned long seq;
+    int done_nums = 0;
+    bool done;
+
+    /* the backend reads the whole batch with its requests in flight together */
+    if (g_dev.do_swapin_batch != NULL) {
+        swapin_faults_batch(uffd, addrs, nums);
+        return;
+    }
+
+    for (int i = 0; i < nums; i++) {
+        done = false;
+        for (int j = 0; j < done_nums; j++) {
+            if (addrs[i] >= done_start[j] && addrs[i] < done_end[j]) {
+                done = true;
+                break;
+            }
+        }
+        if (done) {
+            continue;
+        }
+
+        seq = inflight_wait(addrs[i]);
+        if (swapin_zero_page(uffd, addrs[i])) {
+            continue;
+        }
+        swapin_one_fault(uffd, addrs[i], &swapin_data, seq);
+        if (done_nums < UFFD_MSG_BATCH) {
+            done_start[done_nums] = (unsigned long)swapin_data.start_va;
+            done_end[done_nums] = (unsigned long)swapin_data.start_va + swapin_data.len;
+            done_nums++;
+        }
+    }
+}
+
+/* wait until the queue has room for all 'nums' addresses, which are at most UFFD_MSG_BATCH */
+static void fault_queue_push(struct uswap_fault_queue *queue, const unsigned long *addrs, int nums)
+{
+    pthread_mutex_lock(&queue->mutex);
+    while ((queue->tail - queue->head + FAULT_QUEUE_LEN) % FAULT_QUEUE_LEN + nums >= FAULT_QUEUE_LEN) {
+        pthread_cond_wait(&queue->space_cond, &queue->mutex);
+    }
+    for (int i = 0; i < nums; i++) {
+        queue->addrs[queue->tail] = addrs[i];
+        queue->tail = (queue->tail + 1) % FAULT_QUEUE_LEN;
+    }
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+static int fault_queue_pop(struct uswap_fault_queue *queue, unsigned long *addrs, int max)
+{
+    int nums = 0;
+
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->head == queue->tail) {
+        pthread_cond_wait(&queue->cond, &queue->mutex);
+    }
+    while (queue->head != queue->tail && nums < max) {
+        addrs[nums++] = queue->addrs[queue->head];
+        queue->head = (queue->head + 1) % FAULT_QUEUE_LEN;
+    }
+    pthread_cond_signal(&queue->space_cond);
+    pthread_mutex_unlock(&queue->mutex);
+    return nums;
+}
+
+/*
+ * Split the faults read by the reader into per thread batches. Faults on one
+ * page within the batch are dropped, the kernel wakes all of them with one
+ * copy. A fault repeated in a later read is handed over again, and its
+ * thread finds the page already there.
+ */
+static void dispatch_faults(const unsigned long *addrs, int nums)
+{
+    unsigned long shards[MAX_SWAPIN_THREAD_NUMS][UFFD_MSG_BATCH];
+    int shard_nums[MAX_SWAPIN_THREAD_NUMS] = {0};
+    unsigned long page_mask = ~(get_page_size() - 1);
+    unsigned long addr;
+    int shard;
+    bool dup;
+
+    for (int i = 0; i < nums; i++) {
+        addr = addrs[i] & page_mask;
+        dup = false;
+        for (int j = 0; j < i; j++) {
+            if ((addrs[j] & page_mask) == addr) {
+                dup = true;
+                break;
+            }
+        }
+        if (dup) {
+            continue;
+        }
+        shard = fault_shard(addr);
+        shards[shard][shard_nums[shard]++] = addr;
+    }
+
+    for (int i = 0; i < g_swapin_nums; i++) {
+        if (shard_nums[i] == 0) {
+            continue;
+        }
+        /* never drop a fault, the reader waits for a thread which falls behind */
+        fault_queue_push(&g_fault_queues[i], shards[i], shard_nums[i]);
+    }
+}
+
+/* a swapin thread resolves the faults of its own shard handed over by the reader */
+static void *swapin_thread(void *arg)
+{
+    unsigned long addrs[UFFD_MSG_BATCH];
+    int index = (int)(long)arg;
+    int uswap_uffd;
+    int nums;
+
+    prctl(PR_SET_NAME, "uswap-swapin", 0, 0, 0);
+
+    uswap_uffd = wait_uswap_uffd();
+    while (1) {
+        nums = fault_queue_pop(&g_fault_queues[index], addrs, UFFD_MSG_BATCH);
+        swapin_faults(uswap_uffd, addrs, nums);
+    }
+    return NULL;
+}
+
+/*
+ * The reader is the only thread reading the userfaultfd, so one event wakes
+ * one thread. It drains a batch of events per read and hands each fault to
+ * the swapin thread owning its shard, without resolving any itself, so no
+ * shard waits behind the faults of another one.
+ */
+static void *uffd_reader_thread(void *arg)
+{
+    struct uffd_msg msgs[UFFD_MSG_BATCH];
+    unsigned long addrs[UFFD_MSG_BATCH];
+    struct pollfd pollfd;
+    int uswap_uffd;
+    int nums;
+    int ret;
+
+    prctl(PR_SET_NAME, "uswap-reader", 0, 0, 0);
+
+    uswap_uffd = wait_uswap_uffd();
+    while (1) {
+        pollfd.fd = uswap_uffd;
+        pollfd.events = POLLIN;
+        ret = poll(&pollfd, 1, -1);
+        if (ret < 0) {
+            uswap_log(USWAP_LOG_ERR, "poll failed\n");
+            usleep(10);
+            continue;
+        }
+        nums = read_uffd_msgs(uswap_uffd, msgs, UFFD_MSG_BATCH, addrs);
+        if (nums < 0) {
+            uswap_log(USWAP_LOG_ERR, "read uffd failed\n");
+            continue;
+        }
+        dispatch_faults(addrs, nums);
+    }
+    return NULL;
+}
+
+static void* mmap_tmpva(const void *start, size_t len, int *is_dirty)
+{
+    unsigned long new_addr;
+    new_addr = syscall(__NR_mmap, start, len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_REPLACE, -1, 0);
+    if ((void *)new_addr == MAP_FAILED) {
+        if (errno != ENODEV) {
+            uswap_log(USWAP_LOG_ERR, "the addr can't be swapout\n");
+        }
+        return MAP_FAILED;
+    } else {
+        *is_dirty = new_addr & MMAP_RETVAL_DIRTY_MASK;
+        new_addr = new_addr & (~MMAP_RETVAL_DIRTY_MASK);
+    }
+    return (void *)new_addr;
+}
+
+/* check a page word by word, the inner loop is vectorized by the compiler */
+static bool page_is_zero(const void *page, size_t page_size)
+{
+    const unsigned long *words = page;
+    size_t nums = page_size / sizeof(unsigned long);
+    unsigned long acc;
+
+    for (size_t i = 0; i < nums; i += ZERO_CHECK_WORDS) {
+        acc = 0;
+        for (int j = 0; j < ZERO_CHECK_WORDS; j++) {
+            acc |= words[i + j];
+        }
+        if (acc != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Record the pages of 'start ~ start+len', whose data is at 'tmpva', in the
+ * zero bitmap of their region if all of them are zero, and return true, the
+ * backend does not need to keep the range then. Otherwise the backend keeps
+ * the whole range, zero pages included, and their bits are cleared so that
+ * its entries are read and released on swapin.
+ */
+static bool mark_zero_pages(const void *tmpva, unsigned long start, size_t len)
+{
+    struct uswap_region *region = NULL;
+    size_t page_size = get_page_size();
+    unsigned long addr;
+    size_t offset;
+    bool all_zero = true;
+
+    pthread_mutex_lock(&g_regions.mutex);
+    for (offset = 0; offset < len; offset += page_size) {
+        addr = start + offset;
+        region = region_find(addr);
+        if (region == NULL || !page_is_zero((const char *)tmpva + offset, page_size)) {
+            all_zero = false;
+            break;
+        }
+        if (region->zero_bitmap == NULL) {
+            region->zero_bitmap = zero_bitmap_alloc(region->start, region->end);
+        }
+        if (region->zero_bitmap == NULL) {
+            all_zero = false;
+            break;
+        }
+    }
+
+    for (offset = 0; offset < len; offset += page_size) {
+        addr = start + offset;
+        region = region_find(addr);
+        if (region == NULL || region->zero_bitmap == NULL) {
+            continue;
+        }
+        if (all_zero) {
+            zero_bitmap_set(region->zero_bitmap, (addr - region->start) / page_size);
+        } else {
+            zero_bitmap_clear(region->zero_bitmap, (addr - region->start) / page_size);
+        }
+    }
+    pthread_mutex_unlock(&g_regions.mutex);
+    return all_zero;
+}
+
+/*
+ * Zero-copy variant of do_swapout_once: the backend gets the temporary
+ * mapping of the range in 'buf' and owns it from then on, it releases the
+ * mapping by uswap_release_swapout_va once the data is consumed.
+ */
+static int do_swapout_once_zc(const void *start, size_t len,
+                              struct swap_data *swapout_data)
+{
+    struct uswap_inflight inflight;
+    int ret;
+    int is_dirty = 1;
+    void *tmpva = NULL;
 
     ret = call_get_swapout_buf(start, len, swapout_data);
     if (ret == USWAP_ALREADY_SWAPPED) {
@@ -448,11 +1481,60 @@ static int do_swapout_once(const void *start, size_t len,
         return ret;
     }
 
+    inflight_add(&inflight, swapout_data->start_va, swapout_data->len);
+    tmpva = mmap_tmpva(swapout_data->start_va, swapout_data->len, &is_dirty);
+
+    swapout_data->flag = 0;
+    if (tmpva != MAP_FAILED && mark_zero_pages(tmpva, (unsigned long)swapout_data->start_va,
+                                               swapout_data->len)) {
+        /* zero pages are installed by UFFDIO_ZEROPAGE, the backend drops the range */
+        munmap(tmpva, swapout_data->len);
+        swapout_data->buf = NULL;
+        swapout_data->flag |= USWAP_DATA_ABORT;
+    } else if (tmpva != MAP_FAILED) {
+        swapout_data->buf = tmpva;
+    } else {
+        swapout_data->buf = NULL;
+        swapout_data->flag |= USWAP_DATA_ABORT;
+    }
+
+    if (is_dirty != 0) {
+        swapout_data->flag |= USWAP_DATA_DIRTY;
+    }
+
+    ret = call_do_swapout_zc(swapout_data);
+    inflight_del(&inflight);
+    return ret;
+}
+
+static int do_swapout_once(const void *start, size_t len,
+                           struct swap_data *swapout_data)
+{
+    struct uswap_inflight inflight;
+    int ret;
+    int is_dirty = 1;
+    void *tmpva = NULL;
+
+    ret = call_get_swapout_buf(start, len, swapout_data);
+    if (ret == USWAP_ALREADY_SWAPPED) {
+        return USWAP_SUCCESS;
+    }
+    if (ret < 0) {
+        uswap_log(USWAP_LOG_ERR, "get swapout buf error\n");
+        return ret;
+    }
+
+    inflight_add(&inflight, swapout_data->start_va, swapout_data->len);
     tmpva = mmap_tmpva(swapout_data->start_va, swapout_data->len, &is_dirty);
 
     swapout_data->flag = 0;
     if (tmpva != MAP_FAILED) {
-        memcpy(swapout_data->buf, tmpva, swapout_data->len);
+        if (mark_zero_pages(tmpva, (unsigned long)swapout_data->start_va, swapout_data->len)) {
+            /* zero pages are installed by UFFDIO_ZEROPAGE, the backend drops the range */
+            swapout_data->flag |= USWAP_DATA_ABORT;
+        } else {
+            memcpy(swapout_data->buf, tmpva, swapout_data->len);
+        }
         munmap(tmpva, swapout_data->len);
     } else {
         swapout_data->flag |= USWAP_DATA_ABORT;
@@ -463,7 +1545,7 @@ static int do_swapout_once(const void *start, size_t len,
     }
 
     ret = call_do_swapout(swapout_data);
-
+    inflight_del(&inflight);
     return ret;
 }
 
@@ -474,7 +1556,11 @@ static int do_swapout(const void *start, size_t len)
     struct swap_data swapout_data;
 
     while (succ_len < len) {
-        ret = do_swapout_once(start + succ_len, len - succ_len, &swapout_data);
+        if (g_dev.do_swapout_zc != NULL) {
+            ret = do_swapout_once_zc(start + succ_len, len - succ_len, &swapout_data);
+        } else {
+            ret = do_swapout_once(start + succ_len, len - succ_len, &swapout_data);
+        }
         if (ret < 0) {
             return ret;
         }
@@ -487,7 +1573,11 @@ static int do_swapout(const void *start, size_t len)
     return succ_len;
 }
 
-static int vma_merge(const struct swap_vma *src, struct swap_vma *dst)
+/*
+ * Merge contiguous page-size ranges of src into dst. merged_idx[i] records
+ * which range of dst src->vma_addrs[i] belongs to, or -1 if it is invalid.
+ */
+static int vma_merge(const struct swap_vma *src, struct swap_vma *dst, int *merged_idx)
 {
     int index = 0;
     int swapout_nums;
@@ -500,28 +1590,290 @@ static int vma_merge(const struct swap_vma *src, struct swap_vma *dst)
     for (int i = 0; i < swapout_nums; i++) {
         if (src->vma_addrs[i].vma_len == 0 ||
             src->vma_addrs[i].vma_len > SSIZE_MAX) {
+            merged_idx[i] = -1;
             continue;
         }
         if (src->vma_addrs[i].vma_len == page_size) {
             int j = i + 1;
+            merged_idx[i] = index;
             dst->vma_addrs[index].start_addr = src->vma_addrs[i].start_addr;
             dst->vma_addrs[index].vma_len = page_size;
             while (j < swapout_nums &&
+                src->vma_addrs[j].vma_len == page_size &&
                 src->vma_addrs[j - 1].start_addr + page_size ==
                 src->vma_addrs[j].start_addr) {
+                merged_idx[j] = index;
                 j++;
                 dst->vma_addrs[index].vma_len += page_size;
             }
             i = j - 1;
             index++;
         } else {
+            merged_idx[i] = index;
             dst->vma_addrs[index].start_addr = src->vma_addrs[i].start_addr;
             dst->vma_addrs[index].vma_len = src->vma_addrs[i].vma_len;
             index++;
         }
     }
     dst->length = index * sizeof(struct vma_addr);
-    return USWAP_SUCCESS;
+    return swapout_nums;
+}
+
+/* read a sysfs range list like "0-3,8-11" into set */
+static int read_sysfs_list(const char *path, cpu_set_t *set)
+{
+    FILE *fp = NULL;
+    char buf[NODE_CPULIST_MAX_LEN] = {0};
+    char *cur = buf;
+    char *end = NULL;
+    unsigned long first, last;
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        return USWAP_ERROR;
+    }
+    if (fgets(buf, sizeof(buf), fp) == NULL) {
+        fclose(fp);
+        return USWAP_ERROR;
+    }
+    fclose(fp);
+
+    CPU_ZERO(set);
+    while (*cur >= '0' && *cur <= '9') {
+        first = strtoul(cur, &end, 10);
+        last = first;
+        if (*end == '-') {
+            last = strtoul(end + 1, &end, 10);
+        }
+        for (unsigned long id = first; id <= last && id < CPU_SETSIZE; id++) {
+            CPU_SET(id, set);
+        }
+        if (*end != ',') {
+            break;
+        }
+        cur = end + 1;
+    }
+    return CPU_COUNT(set) > 0 ? USWAP_SUCCESS : USWAP_ERROR;
+}
+
+/* the ids of the online nodes are not always contiguous, e.g. "0,2-3" */
+static int get_online_nodes(int *nodes, int max)
+{
+    cpu_set_t online;
+    int nums = 0;
+
+    if (read_sysfs_list(NODE_SYSFS_PATH "/online", &online) != USWAP_SUCCESS) {
+        return 0;
+    }
+    for (int node = 0; node < CPU_SETSIZE && nums < max; node++) {
+        if (CPU_ISSET(node, &online)) {
+            nodes[nums++] = node;
+        }
+    }
+    return nums;
+}
+
+static int parse_node_cpulist(int node, cpu_set_t *cpus)
+{
+    char path[PATH_MAX];
+
+    snprintf(path, sizeof(path), NODE_SYSFS_PATH "/node%d/cpulist", node);
+    return read_sysfs_list(path, cpus);
+}
+
+static void swapout_worker_bind_node(int index)
+{
+    cpu_set_t cpus;
+    int nodes[MAX_SWAPOUT_THREAD_NUMS];
+    int node_nums = get_online_nodes(nodes, MAX_SWAPOUT_THREAD_NUMS);
+    int node;
+
+    if (node_nums <= 0) {
+        return;
+    }
+    node = nodes[index % node_nums];
+    if (parse_node_cpulist(node, &cpus) != USWAP_SUCCESS ||
+        sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+        uswap_log(USWAP_LOG_WARN, "bind swapout worker %d to node %d failed\n", index, node);
+        return;
+    }
+    if (syscall(__NR_set_mempolicy, MPOL_LOCAL, NULL, 0) != 0) {
+        uswap_log(USWAP_LOG_WARN, "set local mempolicy of swapout worker %d failed\n", index);
+    }
+}
+
+static void *swapout_worker_thread(void *arg)
+{
+    struct uswap_swapout_pool *pool = &g_swapout_pool;
+    int index;
+    int ret;
+
+    prctl(PR_SET_NAME, "uswap-swapout-w", 0, 0, 0);
+    if (pool->numa_local) {
+        swapout_worker_bind_node((int)(long)arg);
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    while (1) {
+        while (pool->next >= pool->total) {
+            pthread_cond_wait(&pool->work_cond, &pool->mutex);
+        }
+        index = pool->next++;
+        pthread_mutex_unlock(&pool->mutex);
+
+        ret = do_swapout((void *)pool->vmas[index].start_addr, pool->vmas[index].vma_len);
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->results[index] = ret;
+        pool->done++;
+        if (pool->done == pool->total) {
+            pthread_cond_signal(&pool->done_cond);
+        }
+    }
+    return NULL;
+}
+
+/* split the ranges between the swapout workers and wait until all of them are done */
+static void swapout_pool_run(const struct vma_addr *vmas, int *results, int nums)
+{
+    struct uswap_swapout_pool *pool = &g_swapout_pool;
+
+    if (nums <= 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->vmas = vmas;
+    pool->results = results;
+    pool->next = 0;
+    pool->done = 0;
+    pool->total = nums;
+    pthread_cond_broadcast(&pool->work_cond);
+    while (pool->done < pool->total) {
+        pthread_cond_wait(&pool->done_cond, &pool->mutex);
+    }
+    pool->total = 0;
+    pool->next = 0;
+    pool->vmas = NULL;
+    pool->results = NULL;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/* swap out all ranges of one request, fill the result of each range into ack */
+static int swapout_vmas(const struct swap_vma *src, struct swap_ack *ack)
+{
+    struct swap_vma dst;
+    int merged_idx[MAX_VMA_NUM];
+    int merged_ret[MAX_VMA_NUM];
+    int src_nums, swapout_nums;
+    int ret = USWAP_SUCCESS;
+
+    src_nums = vma_merge(src, &dst, merged_idx);
+    swapout_nums = dst.length / sizeof(struct vma_addr);
+    if (g_swapout_pool.nums > 1) {
+        swapout_pool_run(dst.vma_addrs, merged_ret, swapout_nums);
+    } else {
+        for (int i = 0; i < swapout_nums; i++) {
+            merged_ret[i] = do_swapout((void *)dst.vma_addrs[i].start_addr,
+                                       dst.vma_addrs[i].vma_len);
+        }
+    }
+    for (int i = 0; i < swapout_nums; i++) {
+        if (merged_ret[i] < 0) {
+            uswap_log(USWAP_LOG_ERR, "do swapout once failed\n");
+            ret = USWAP_ERROR;
+        }
+    }
+
+    ack->type = SWAP_TYPE_VMA_ACK;
+    ack->seq = src->seq;
+    ack->length = src_nums * sizeof(int);
+    for (int i = 0; i < src_nums; i++) {
+        if (merged_idx[i] < 0) {
+            ack->results[i] = USWAP_ERROR;
+        } else {
+            ack->results[i] = merged_ret[merged_idx[i]] < 0 ? merged_ret[merged_idx[i]] : USWAP_SUCCESS;
+        }
+    }
+    return ret;
+}
+
+/* wait for a free slot, the request is not visible before swapout_queue_commit() */
+static struct uswap_swapout_req *swapout_queue_reserve(void)
+{
+    struct uswap_swapout_queue *queue = &g_swapout_queue;
+    struct uswap_swapout_req *req = NULL;
+
+    pthread_mutex_lock(&queue->mutex);
+    while ((queue->tail + 1) % SWAPOUT_QUEUE_LEN == queue->head) {
+        pthread_cond_wait(&queue->space_cond, &queue->mutex);
+    }
+    req = &queue->reqs[queue->tail];
+    pthread_mutex_unlock(&queue->mutex);
+    return req;
+}
+
+static void swapout_queue_commit(void)
+{
+    struct uswap_swapout_queue *queue = &g_swapout_queue;
+
+    pthread_mutex_lock(&queue->mutex);
+    queue->tail = (queue->tail + 1) % SWAPOUT_QUEUE_LEN;
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+static void swapout_queue_close(int client_fd)
+{
+    struct uswap_swapout_req *req = swapout_queue_reserve();
+
+    req->client_fd = client_fd;
+    req->closed = true;
+    swapout_queue_commit();
+}
+
+/* the head stays in its slot until swapout_queue_pop(), the receiver never reuses it before */
+static struct uswap_swapout_req *swapout_queue_peek(void)
+{
+    struct uswap_swapout_queue *queue = &g_swapout_queue;
+    struct uswap_swapout_req *req = NULL;
+
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->head == queue->tail) {
+        pthread_cond_wait(&queue->cond, &queue->mutex);
+    }
+    req = &queue->reqs[queue->head];
+    pthread_mutex_unlock(&queue->mutex);
+    return req;
+}
+
+static void swapout_queue_pop(void)
+{
+    struct uswap_swapout_queue *queue = &g_swapout_queue;
+
+    pthread_mutex_lock(&queue->mutex);
+    queue->head = (queue->head + 1) % SWAPOUT_QUEUE_LEN;
+    pthread_cond_signal(&queue->space_cond);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+/*
+ * Read the next request of a connection. Return false once the receiver is
+ * done with the connection, a one-shot request is answered and closed by the
+ * swapout thread.
+ */
+static bool swapout_recv_req(int client_fd)
+{
+    struct uswap_swapout_req *req = swapout_queue_reserve();
+
+    if (sock_read_frame(client_fd, &req->vma) <= 0) {
+        swapout_queue_close(client_fd);
+        return false;
+    }
+    req->client_fd = client_fd;
+    req->closed = false;
+    swapout_queue_commit();
+    return req->vma.type == SWAP_TYPE_VMA_STREAM;
 }
 
 static int swapout_source_init(void)
@@ -538,45 +1890,80 @@ static int swapout_source_init(void)
     return socket_fd;
 }
 
-static void *swapout_thread(void *arg)
+/*
+ * Read requests from the clients and queue them for the swapout thread. A
+ * stream connection stays open across requests, its next frame is read while
+ * the previous ones are still being swapped out.
+ */
+static void *swapout_recv_thread(void *arg)
 {
-    struct swap_vma src, dst;
-    unsigned long start;
-    size_t len;
-    int swapout_nums;
-    int succ_count = 0;
-    int socket_fd, client_fd;
+    struct pollfd fds[1 + MAX_SWAPOUT_CONN_NUM];
+    int nfds = 1;
+    int client_fd;
     int ret;
 
-    prctl(PR_SET_NAME, "uswap-swapout", 0, 0, 0);
+    prctl(PR_SET_NAME, "uswap-swapout-r", 0, 0, 0);
     ret = swapout_source_init();
     if (ret < 0) {
         uswap_log(USWAP_LOG_ERR, "swapout source init failed\n");
         return NULL;
     }
-    socket_fd = ret;
+    fds[0].fd = ret;
+    fds[0].events = POLLIN;
     while (1) {
-        client_fd = sock_handle_rec(socket_fd, &src);
+        if (poll(fds, nfds, -1) < 0) {
+            continue;
+        }
+        for (int i = nfds - 1; i > 0; i--) {
+            if (fds[i].revents != 0 && !swapout_recv_req(fds[i].fd)) {
+                fds[i] = fds[--nfds];
+            }
+        }
+        if ((fds[0].revents & POLLIN) == 0) {
+            continue;
+        }
+        client_fd = sock_handle_accept(fds[0].fd);
         if (client_fd <= 0) {
-            uswap_log(USWAP_LOG_DEBUG, "sock_handle_rec failed\n");
+            uswap_log(USWAP_LOG_DEBUG, "sock_handle_accept failed\n");
             continue;
         }
+        if (nfds > MAX_SWAPOUT_CONN_NUM) {
+            uswap_log(USWAP_LOG_ERR, "too many swapout connections\n");
+            close(client_fd);
+            continue;
+        }
+        fds[nfds].fd = client_fd;
+        fds[nfds].events = POLLIN;
+        fds[nfds].revents = 0;
+        nfds++;
+    }
+    close(fds[0].fd);
+}
 
-        vma_merge(&src, &dst);
-        ret = USWAP_SUCCESS;
-        swapout_nums = dst.length / sizeof(struct vma_addr);
-        for (int i = 0; i < swapout_nums; i++) {
-            len = dst.vma_addrs[i].vma_len;
-            start = dst.vma_addrs[i].start_addr;
-            succ_count = do_swapout((void *)start, len);
-            if (succ_count < 0) {
-                uswap_log(USWAP_LOG_ERR, "do swapout once failed\n");
-                ret = USWAP_ERROR;
+/* swap out the queued requests in order, ack each of them on its connection */
+static void *swapout_thread(void *arg)
+{
+    struct uswap_swapout_req *req = NULL;
+    struct swap_ack ack;
+    int ret;
+
+    prctl(PR_SET_NAME, "uswap-swapout", 0, 0, 0);
+    while (1) {
+        req = swapout_queue_peek();
+        if (req->closed) {
+            close(req->client_fd);
+        } else if (req->vma.type == SWAP_TYPE_VMA_STREAM) {
+            swapout_vmas(&req->vma, &ack);
+            if (sock_send_ack(req->client_fd, &ack) != 0) {
+                uswap_log(USWAP_LOG_ERR, "send ack of frame %u failed\n", req->vma.seq);
             }
+        } else {
+            ret = swapout_vmas(&req->vma, &ack);
+            sock_handle_respond(req->client_fd, ret);
         }
-        sock_handle_respond(client_fd, ret);
+        swapout_queue_pop();
     }
-    close(socket_fd);
+    return NULL;
 }
 
 int force_swapout(const void *addr, size_t len)
@@ -594,47 +1981,100 @@ int force_swapout(const void *addr, size_t len)
     return ret;
 }
 
-static int create_uswap_threads(int swapin_nums)
+static void cancel_uswap_threads(pthread_t *tids, int nums)
+{
+    for (int i = 0; i < nums; i++) {
+        pthread_cancel(tids[i]);
+    }
+}
+
+static int create_uswap_thread(pthread_t *tid, void *(*routine)(void *), void *arg)
+{
+    int ret;
+
+    ret = pthread_create(tid, NULL, routine, arg);
+    if (ret != 0) {
+        return USWAP_ERROR;
+    }
+    ret = mlock_pthread_stack(*tid);
+    if (ret == USWAP_ERROR) {
+        uswap_log(USWAP_LOG_ERR, "mlock thread stack failed\n");
+        pthread_cancel(*tid);
+        return USWAP_ERROR;
+    }
+    return USWAP_SUCCESS;
+}
+
+static int create_uswap_threads(int swapin_nums, int swapout_nums)
 {
     int ret;
-    pthread_t swapout_tid;
-    pthread_t swapin_tid[MAX_SWAPIN_THREAD_NUMS];
+    int created = 0;
+    /* swapout receiver and thread, swapout workers, swapin threads, uffd reader and prefetch thread */
+    pthread_t tids[2 + MAX_SWAPOUT_THREAD_NUMS + MAX_SWAPIN_THREAD_NUMS + 1 + 1];
 
     if (swapin_nums <= 0 || swapin_nums > MAX_SWAPIN_THREAD_NUMS) {
         return USWAP_ERROR;
     }
+    if (swapout_nums <= 0 || swapout_nums > MAX_SWAPOUT_THREAD_NUMS) {
+        return USWAP_ERROR;
+    }
+    g_swapout_pool.nums = swapout_nums;
+    g_swapin_nums = swapin_nums;
+    for (int i = 0; i < swapin_nums; i++) {
+        pthread_mutex_init(&g_fault_queues[i].mutex, NULL);
+        pthread_cond_init(&g_fault_queues[i].cond, NULL);
+        pthread_cond_init(&g_fault_queues[i].space_cond, NULL);
+    }
 
-    ret = pthread_create(&swapout_tid, NULL, swapout_thread, NULL);
-    if (ret < 0) {
-        uswap_log(USWAP_LOG_ERR, "can't create swapout thread");
+    ret = create_uswap_thread(&tids[created], swapout_thread, NULL);
+    if (ret == USWAP_ERROR) {
+        uswap_log(USWAP_LOG_ERR, "can't create swapout thread\n");
         return USWAP_ERROR;
     }
-    ret = mlock_pthread_stack(swapout_tid);
+    created++;
+
+    ret = create_uswap_thread(&tids[created], swapout_recv_thread, NULL);
     if (ret == USWAP_ERROR) {
-        uswap_log(USWAP_LOG_ERR, "mlock swapout thread stack failed\n");
-        pthread_cancel(swapout_tid);
+        uswap_log(USWAP_LOG_ERR, "can't create swapout receiver thread\n");
+        cancel_uswap_threads(tids, created);
         return USWAP_ERROR;
     }
+    created++;
 
-    for (int i = 0; i < swapin_nums; i++) {
-        ret = pthread_create(&swapin_tid[i], NULL, swapin_thread, NULL);
-        if (ret < 0) {
-            uswap_log(USWAP_LOG_ERR, "can't create swapin thread\n");
-            pthread_cancel(swapout_tid);
-            for (int j = 0; j < i; j++) {
-                pthread_cancel(swapin_tid[j]);
-            }
+    /* a single swapout thread does the swapout itself */
+    for (int i = 0; swapout_nums > 1 && i < swapout_nums; i++) {
+        ret = create_uswap_thread(&tids[created], swapout_worker_thread, (void *)(long)i);
+        if (ret == USWAP_ERROR) {
+            uswap_log(USWAP_LOG_ERR, "can't create swapout worker thread\n");
+            cancel_uswap_threads(tids, created);
             return USWAP_ERROR;
         }
-        ret = mlock_pthread_stack(swapin_tid[i]);
+        created++;
+    }
+
+    for (int i = 0; i < swapin_nums; i++) {
+        ret = create_uswap_thread(&tids[created], swapin_thread, (void *)(long)i);
         if (ret == USWAP_ERROR) {
-            uswap_log(USWAP_LOG_ERR, "mlock swapin thread stack failed\n");
-            pthread_cancel(swapout_tid);
-            for (int j = 0; j <= i; j++) {
-                pthread_cancel(swapin_tid[j]);
-            }
+            uswap_log(USWAP_LOG_ERR, "can't create swapin thread\n");
+            cancel_uswap_threads(tids, created);
             return USWAP_ERROR;
         }
+        created++;
+    }
+
+    ret = create_uswap_thread(&tids[created], uffd_reader_thread, NULL);
+    if (ret == USWAP_ERROR) {
+        uswap_log(USWAP_LOG_ERR, "can't create uffd reader thread\n");
+        cancel_uswap_threads(tids, created);
+        return USWAP_ERROR;
+    }
+    created++;
+
+    ret = create_uswap_thread(&tids[created], prefetch_thread, NULL);
+    if (ret == USWAP_ERROR) {
+        uswap_log(USWAP_LOG_ERR, "can't create prefetch thread\n");
+        cancel_uswap_threads(tids, created);
+        return USWAP_ERROR;
     }
 
     return USWAP_SUCCESS;
@@ -645,7 +2085,16 @@ int set_uswap_log_level(int log_level)
     return uswap_log_level_init(log_level);
 }
 
-int uswap_init(int swapin_nums)
+int set_uswap_swapout_numa_local(int enable)
+{
+    if (is_uswap_threads_alive()) {
+        return USWAP_ERROR;
+    }
+    g_swapout_pool.numa_local = (enable != 0);
+    return USWAP_SUCCESS;
+}
+
+int uswap_init(int swapin_nums, int swapout_nums)
 {
     int ret;
 
@@ -653,7 +2102,7 @@ int uswap_init(int swapin_nums)
         return USWAP_ERROR;
     }
 
-    ret = create_uswap_threads(swapin_nums);
+    ret = create_uswap_threads(swapin_nums, swapout_nums);
     if (ret == USWAP_ERROR) {
         return USWAP_ERROR;
     }
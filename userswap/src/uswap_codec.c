@@ -0,0 +1,175 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2021. All rights reserved.
+ * userswap licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: built-in page codec of the uswap compressed ram backend
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "uswap_codec.h"
+
+#define LZF_HASH_BITS 12
+#define LZF_HASH_SIZE (1 << LZF_HASH_BITS)
+#define LZF_MAX_LIT 32
+#define LZF_MAX_OFF (1 << 13)
+#define LZF_MIN_MATCH 3
+/* a match of 'len' is coded as len - 2, 7 means an extra length byte */
+#define LZF_MAX_MATCH (LZF_MIN_MATCH - 1 + 7 + 255)
+#define LZF_LONG_LEN 7
+#define LZF_LEN_SHIFT 5
+#define LZF_OFF_HIGH_MASK 0x1f
+#define LZF_BYTE_BITS 8
+#define LZF_BYTE_MASK 0xff
+
+static unsigned int lzf_hash(const uint8_t *p)
+{
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+
+    return (v * 2654435761U) >> (32 - LZF_HASH_BITS);
+}
+
+size_t uswap_lzf_compress(const void *src, size_t src_len, void *dst, size_t dst_len)
+{
+    const uint8_t *in = src;
+    uint8_t *out = dst;
+    /* position + 1 of the last occurrence of each hash, 0 for none */
+    uint32_t table[LZF_HASH_SIZE] = {0};
+    size_t ip = 0;
+    size_t op = 0;
+    size_t lit_pos;
+    size_t ref;
+    size_t off;
+    size_t len;
+    size_t max_len;
+    unsigned int h;
+    int lit = 0;
+
+    if (src == NULL || dst == NULL || src_len == 0 || dst_len == 0) {
+        return 0;
+    }
+
+    /* every literal run starts with a control byte, reserved here */
+    lit_pos = op++;
+    while (ip < src_len) {
+        if (ip + LZF_MIN_MATCH <= src_len) {
+            h = lzf_hash(in + ip);
+            ref = table[h];
+            table[h] = (uint32_t)(ip + 1);
+            if (ref != 0 && ip - (ref - 1) <= LZF_MAX_OFF &&
+                memcmp(in + ref - 1, in + ip, LZF_MIN_MATCH) == 0) {
+                ref--;
+                off = ip - ref - 1;
+                max_len = src_len - ip < LZF_MAX_MATCH ? src_len - ip : LZF_MAX_MATCH;
+                len = LZF_MIN_MATCH;
+                while (len < max_len && in[ref + len] == in[ip + len]) {
+                    len++;
+                }
+
+                /* close the literal run, or drop its unused control byte */
+                if (lit != 0) {
+                    out[lit_pos] = (uint8_t)(lit - 1);
+                } else {
+                    op--;
+                }
+                /* control, optional length and offset byte, then the next control byte */
+                if (op + 4 > dst_len) {
+                    return 0;
+                }
+                len -= 2;
+                if (len < LZF_LONG_LEN) {
+                    out[op++] = (uint8_t)((len << LZF_LEN_SHIFT) | (off >> LZF_BYTE_BITS));
+                } else {
+                    out[op++] = (uint8_t)((LZF_LONG_LEN << LZF_LEN_SHIFT) | (off >> LZF_BYTE_BITS));
+                    out[op++] = (uint8_t)(len - LZF_LONG_LEN);
+                }
+                out[op++] = (uint8_t)(off & LZF_BYTE_MASK);
+                ip += len + 2;
+
+                lit_pos = op++;
+                lit = 0;
+                continue;
+            }
+        }
+
+        if (op + 1 > dst_len) {
+            return 0;
+        }
+        out[op++] = in[ip++];
+        lit++;
+        if (lit == LZF_MAX_LIT) {
+            out[lit_pos] = (uint8_t)(lit - 1);
+            if (op + 1 > dst_len) {
+                return 0;
+            }
+            lit_pos = op++;
+            lit = 0;
+        }
+    }
+
+    if (lit != 0) {
+        out[lit_pos] = (uint8_t)(lit - 1);
+    } else {
+        op--;
+    }
+    return op;
+}
+
+size_t uswap_lzf_decompress(const void *src, size_t src_len, void *dst, size_t dst_len)
+{
+    const uint8_t *in = src;
+    uint8_t *out = dst;
+    size_t ip = 0;
+    size_t op = 0;
+    size_t len;
+    size_t off;
+    unsigned int ctrl;
+
+    if (src == NULL || dst == NULL) {
+        return 0;
+    }
+
+    while (ip < src_len) {
+        ctrl = in[ip++];
+        if (ctrl < LZF_MAX_LIT) {
+            len = ctrl + 1;
+            if (ip + len > src_len || op + len > dst_len) {
+                return 0;
+            }
+            memcpy(out + op, in + ip, len);
+            ip += len;
+            op += len;
+            continue;
+        }
+
+        len = ctrl >> LZF_LEN_SHIFT;
+        if (len == LZF_LONG_LEN) {
+            if (ip >= src_len) {
+                return 0;
+            }
+            len += in[ip++];
+        }
+        if (ip >= src_len) {
+            return 0;
+        }
+        off = (((size_t)ctrl & LZF_OFF_HIGH_MASK) << LZF_BYTE_BITS) + in[ip++] + 1;
+        len += 2;
+        if (off > op || op + len > dst_len) {
+            return 0;
+        }
+        /* the reference may overlap the output, copy byte by byte */
+        for (size_t i = 0; i < len; i++) {
+            out[op + i] = out[op - off + i];
+        }
+        op += len;
+    }
+    return op;
+}
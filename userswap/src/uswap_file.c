@@ -0,0 +1,628 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2021. All rights reserved.
+ * userswap licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: file backend of userswap
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "uswap_api.h"
+#include "uswap_log.h"
+#include "uswap_io.h"
+#include "uswap_radix.h"
+#include "uswap_file.h"
+
+#define FILE_MAX_RANGE_PAGES 64
+#define FILE_IO_QUEUE_DEPTH 256
+#define FILE_IO_THREAD_NUMS 8
+#define FILE_BITS_PER_LONG (sizeof(unsigned long) * CHAR_BIT)
+#define NSEC_PER_SEC 1000000000UL
+
+#define FILE_ENTRY_USED 0x1
+
+/*
+ * Where one page is stored. While the write of the page is in flight, or
+ * after it failed, 'pending' points to its data in the write request 'req'.
+ */
+struct file_entry {
+    unsigned long block;
+    unsigned long gen;
+    void *pending;
+    struct file_write_req *req;
+    unsigned long flags;
+};
+
+/*
+ * One swapout range. The blocks are reserved by get_swapout_buf, so a full
+ * file fails the swapout before the pages are taken away.
+ */
+struct file_write_req {
+    void *mem;
+    void *buf;
+    unsigned long start_va;
+    size_t pages;
+    unsigned long gen;
+    int pending_ios;
+    int errors;
+    /* pages of a failed write still served from 'buf' */
+    size_t kept;
+    unsigned long blocks[FILE_MAX_RANGE_PAGES];
+    struct uswap_io ios[FILE_MAX_RANGE_PAGES];
+};
+
+/* the page in front of every data buffer, kept so the buffers stay aligned for O_DIRECT */
+struct file_buf_hdr {
+    struct file_write_req *req;
+    unsigned long gen;
+};
+
+struct uswap_file {
+    int fd;
+    size_t page_size;
+    /* extent allocator, one bit per block of the file */
+    unsigned long *bitmap;
+    unsigned long cursor;
+    /* protects the allocator, the radix tree and the stats */
+    pthread_mutex_t mutex;
+    struct uswap_radix tree;
+    unsigned long gen;
+    struct uswap_file_stats stats;
+};
+
+static struct uswap_file g_file = {
+    .fd = -1,
+    .bitmap = NULL,
+    .cursor = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .tree = {
+        .root = NULL,
+        .entry_size = sizeof(struct file_entry),
+    },
+};
+
+static bool block_test(unsigned long block)
+{
+    return (g_file.bitmap[block / FILE_BITS_PER_LONG] & (1UL << (block % FILE_BITS_PER_LONG))) != 0;
+}
+
+static void block_set(unsigned long block)
+{
+    g_file.bitmap[block / FILE_BITS_PER_LONG] |= 1UL << (block % FILE_BITS_PER_LONG);
+}
+
+static void block_clear(unsigned long block)
+{
+    g_file.bitmap[block / FILE_BITS_PER_LONG] &= ~(1UL << (block % FILE_BITS_PER_LONG));
+}
+
+/* caller must hold g_file.mutex */
+static void blocks_free(const unsigned long *blocks, size_t nums)
+{
+    for (size_t i = 0; i < nums; i++) {
+        block_clear(blocks[i]);
+    }
+    g_file.stats.free_blocks += nums;
+}
+
+/*
+ * Next fit search of 'nums' free blocks in a row from the cursor, full
+ * words are skipped. Return the first block, or ULONG_MAX.
+ */
+static unsigned long extent_find(size_t nums)
+{
+    unsigned long total = g_file.stats.total_blocks;
+    unsigned long block = g_file.cursor;
+    unsigned long scanned = 0;
+    size_t run = 0;
+
+    while (scanned < total + nums) {
+        if (block >= total) {
+            block = 0;
+            run = 0;
+        }
+        if (run == 0 && block % FILE_BITS_PER_LONG == 0 &&
+            g_file.bitmap[block / FILE_BITS_PER_LONG] == ULONG_MAX) {
+            block += FILE_BITS_PER_LONG;
+            scanned += FILE_BITS_PER_LONG;
+            continue;
+        }
+        if (block_test(block)) {
+            run = 0;
+        } else if (++run == nums) {
+            return block + 1 - nums;
+        }
+        block++;
+        scanned++;
+    }
+    return ULONG_MAX;
+}
+
+/*
+ * Reserve blocks for 'nums' pages, in one extent when possible, otherwise
+ * block by block. Caller must hold g_file.mutex.
+ */
+static int extent_alloc(size_t nums, unsigned long *blocks)
+{
+    unsigned long start;
+
+    if (g_file.stats.free_blocks < nums) {
+        return USWAP_ERROR;
+    }
+
+    start = extent_find(nums);
+    for (size_t i = 0; i < nums; i++) {
+        /* free_blocks says there are enough, so the single block search cannot fail */
+        blocks[i] = start != ULONG_MAX ? start + i : extent_find(1);
+        block_set(blocks[i]);
+        g_file.cursor = blocks[i] + 1;
+    }
+    g_file.stats.free_blocks -= nums;
+    return USWAP_SUCCESS;
+}
+
+static void *file_buf_alloc(size_t len, struct file_buf_hdr **hdr)
+{
+    void *mem = NULL;
+
+    if (posix_memalign(&mem, g_file.page_size, g_file.page_size + len) != 0) {
+        return NULL;
+    }
+    *hdr = mem;
+    return (char *)mem + g_file.page_size;
+}
+
+static struct file_buf_hdr *file_buf_hdr(void *buf)
+{
+    return (struct file_buf_hdr *)((char *)buf - g_file.page_size);
+}
+
+static void file_write_req_free(struct file_write_req *req)
+{
+    free(req->mem);
+    free(req);
+}
+
+/*
+ * Drop the entry of a page and free its block, unless its write is still
+ * in flight. The write completion frees such a block as it no longer
+ * matches the entry. A page kept in memory after a failed write frees its
+ * block and the request with the last such page. Caller must hold
+ * g_file.mutex.
+ */
+static void file_entry_drop(struct file_entry *entry)
+{
+    struct file_write_req *req = entry->req;
+
+    if (entry->pending == NULL) {
+        blocks_free(&entry->block, 1);
+    } else {
+        g_file.stats.pending_pages--;
+        if (req->pending_ios == 0) {
+            blocks_free(&entry->block, 1);
+            if (--req->kept == 0) {
+                file_write_req_free(req);
+            }
+        }
+    }
+    g_file.stats.stored_pages--;
+    memset(entry, 0, sizeof(struct file_entry));
+}
+
+static void file_write_done(struct uswap_io *io)
+{
+    struct file_write_req *req = io->priv;
+    struct file_entry *entry = NULL;
+
+    pthread_mutex_lock(&g_file.mutex);
+    if (io->res != (ssize_t)io->len) {
+        req->errors++;
+        g_file.stats.io_errors++;
+    }
+    if (--req->pending_ios > 0) {
+        pthread_mutex_unlock(&g_file.mutex);
+        return;
+    }
+
+    for (size_t i = 0; i < req->pages; i++) {
+        entry = uswap_radix_lookup(&g_file.tree, req->start_va / g_file.page_size + i, false);
+        if (entry == NULL || !(entry->flags & FILE_ENTRY_USED) || entry->gen != req->gen) {
+            /* swapped in or out again while the write was in flight */
+            blocks_free(&req->blocks[i], 1);
+        } else if (req->errors == 0) {
+            entry->pending = NULL;
+            entry->req = NULL;
+            g_file.stats.pending_pages--;
+        } else {
+            /* the data is only in memory, keep serving it from there until the entry is dropped */
+            req->kept++;
+        }
+    }
+    if (req->errors != 0) {
+        uswap_log(USWAP_LOG_ERR, "write swapout range %lx failed, keep %zu pages in memory\n", req->start_va,
+                  req->kept);
+    }
+    if (req->kept == 0) {
+        file_write_req_free(req);
+    }
+    pthread_mutex_unlock(&g_file.mutex);
+}
+
+static int file_get_swapout_buf(const void *start_va, size_t len, struct swap_data *swapout_data)
+{
+    struct file_write_req *req = NULL;
+    struct file_buf_hdr *hdr = NULL;
+    size_t pages = len / g_file.page_size;
+    int ret;
+
+    if (pages == 0) {
+        return USWAP_ERROR;
+    }
+    pages = pages > FILE_MAX_RANGE_PAGES ? FILE_MAX_RANGE_PAGES : pages;
+    req = calloc(1, sizeof(struct file_write_req));
+    if (req == NULL) {
+        return USWAP_ERROR;
+    }
+    req->buf = file_buf_alloc(pages * g_file.page_size, &hdr);
+    if (req->buf == NULL) {
+        free(req);
+        return USWAP_ERROR;
+    }
+    req->mem = hdr;
+    hdr->req = req;
+    req->start_va = (unsigned long)start_va;
+    req->pages = pages;
+
+    pthread_mutex_lock(&g_file.mutex);
+    ret = extent_alloc(pages, req->blocks);
+    if (ret != USWAP_SUCCESS) {
+        pthread_mutex_unlock(&g_file.mutex);
+        uswap_log(USWAP_LOG_ERR, "no space left in swap file\n");
+        file_write_req_free(req);
+        return USWAP_ERROR;
+    }
+    /* create the entries now, so do_swapout cannot fail to publish a page */
+    for (size_t i = 0; i < pages; i++) {
+        if (uswap_radix_lookup(&g_file.tree, req->start_va / g_file.page_size + i, true) == NULL) {
+            blocks_free(req->blocks, pages);
+            pthread_mutex_unlock(&g_file.mutex);
+            uswap_log(USWAP_LOG_ERR, "alloc file tree node failed\n");
+            file_write_req_free(req);
+            return USWAP_ERROR;
+        }
+    }
+    pthread_mutex_unlock(&g_file.mutex);
+
+    swapout_data->start_va = (void *)start_va;
+    swapout_data->len = pages * g_file.page_size;
+    swapout_data->buf = req->buf;
+    swapout_data->flag = 0;
+    return USWAP_SUCCESS;
+}
+
+/*
+ * Publish the pages and queue their writes, one io per extent. The call
+ * returns once the writes are queued, faults meanwhile read the pages from
+ * the request buffer.
+ */
+static int file_do_swapout(struct swap_data *swapout_data)
+{
+    struct file_write_req *req = file_buf_hdr(swapout_data->buf)->req;
+    struct uswap_io *ios[FILE_MAX_RANGE_PAGES];
+    struct file_entry *entry = NULL;
+    size_t run;
+    int nums = 0;
+    int queued;
+
+    if (swapout_data->flag & USWAP_DATA_ABORT) {
+        pthread_mutex_lock(&g_file.mutex);
+        blocks_free(req->blocks, req->pages);
+        pthread_mutex_unlock(&g_file.mutex);
+        file_write_req_free(req);
+        return USWAP_SUCCESS;
+    }
+
+    for (size_t i = 0; i < req->pages; i += run) {
+        run = 1;
+        while (i + run < req->pages && req->blocks[i + run] == req->blocks[i] + run) {
+            run++;
+        }
+        req->ios[nums].op = USWAP_IO_WRITE;
+        req->ios[nums].fd = g_file.fd;
+        req->ios[nums].buf = (char *)req->buf + i * g_file.page_size;
+        req->ios[nums].len = run * g_file.page_size;
+        req->ios[nums].offset = (off_t)(req->blocks[i] * g_file.page_size);
+        req->ios[nums].done = file_write_done;
+        req->ios[nums].priv = req;
+        ios[nums] = &req->ios[nums];
+        nums++;
+    }
+
+    pthread_mutex_lock(&g_file.mutex);
+    req->gen = ++g_file.gen;
+    req->pending_ios = nums;
+    for (size_t i = 0; i < req->pages; i++) {
+        /* created by get_swapout_buf, tree nodes are never freed */
+        entry = uswap_radix_lookup(&g_file.tree, req->start_va / g_file.page_size + i, false);
+        if (entry->flags & FILE_ENTRY_USED) {
+            file_entry_drop(entry);
+        }
+        entry->block = req->blocks[i];
+        entry->gen = req->gen;
+        entry->pending = (char *)req->buf + i * g_file.page_size;
+        entry->req = req;
+        entry->flags = FILE_ENTRY_USED;
+        g_file.stats.stored_pages++;
+        g_file.stats.pending_pages++;
+        g_file.stats.swapout_pages++;
+    }
+    pthread_mutex_unlock(&g_file.mutex);
+
+    queued = uswap_io_submit(ios, nums);
+    /* complete the writes never queued as failed, so their pages stay in memory */
+    for (int i = queued < 0 ? 0 : queued; i < nums; i++) {
+        ios[i]->res = -EIO;
+        ios[i]->done(ios[i]);
+    }
+    return USWAP_SUCCESS;
+}
+
+static unsigned long file_elapsed_ns(const struct timespec *begin)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (unsigned long)(end.tv_sec - begin->tv_sec) * NSEC_PER_SEC + end.tv_nsec - begin->tv_nsec;
+}
+
+/*
+ * Read all the faulting pages with their ios in flight together. Pages
+ * still being written are copied from memory, pages never swapped out get
+ * a NULL 'buf'.
+ */
+static int file_do_swapin_batch(void *const *fault_addrs, int nums, struct swap_data *swapin_datas)
+{
+    struct uswap_io *ios = NULL;
+    struct uswap_io **submit = NULL;
+    struct uswap_io_waiter waiter;
+    struct file_buf_hdr *hdr = NULL;
+    struct file_entry *entry = NULL;
+    struct timespec begin;
+    unsigned long va;
+    unsigned long ns;
+    int reads = 0;
+    int queued;
+    int misses = 0;
+    int ret = USWAP_SUCCESS;
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    ios = calloc(nums, sizeof(struct uswap_io));
+    submit = calloc(nums, sizeof(struct uswap_io *));
+    if (ios == NULL || submit == NULL) {
+        free(ios);
+        free(submit);
+        return USWAP_ERROR;
+    }
+    for (int i = 0; i < nums; i++) {
+        swapin_datas[i].buf = file_buf_alloc(g_file.page_size, &hdr);
+        if (swapin_datas[i].buf == NULL) {
+            for (int j = 0; j < i; j++) {
+                free(file_buf_hdr(swapin_datas[j].buf));
+            }
+            free(ios);
+            free(submit);
+            return USWAP_ERROR;
+        }
+        hdr->req = NULL;
+        hdr->gen = 0;
+    }
+
+    pthread_mutex_lock(&g_file.mutex);
+    for (int i = 0; i < nums; i++) {
+        va = (unsigned long)fault_addrs[i] & ~(g_file.page_size - 1);
+        swapin_datas[i].start_va = (void *)va;
+        swapin_datas[i].len = g_file.page_size;
+        swapin_datas[i].flag = 0;
+
+        entry = uswap_radix_lookup(&g_file.tree, va / g_file.page_size, false);
+        if (entry == NULL || !(entry->flags & FILE_ENTRY_USED)) {
+            free(file_buf_hdr(swapin_datas[i].buf));
+            swapin_datas[i].buf = NULL;
+            misses++;
+            continue;
+        }
+        file_buf_hdr(swapin_datas[i].buf)->gen = entry->gen;
+        if (entry->pending != NULL) {
+            memcpy(swapin_datas[i].buf, entry->pending, g_file.page_size);
+            continue;
+        }
+        ios[reads].op = USWAP_IO_READ;
+        ios[reads].fd = g_file.fd;
+        ios[reads].buf = swapin_datas[i].buf;
+        ios[reads].len = g_file.page_size;
+        ios[reads].offset = (off_t)(entry->block * g_file.page_size);
+        ios[reads].done = uswap_io_wait_done;
+        ios[reads].priv = &waiter;
+        submit[reads] = &ios[reads];
+        reads++;
+    }
+    pthread_mutex_unlock(&g_file.mutex);
+
+    if (reads > 0) {
+        uswap_io_waiter_init(&waiter, reads);
+        queued = uswap_io_submit(submit, reads);
+        if (queued < reads) {
+            uswap_io_waiter_cancel(&waiter, reads - (queued < 0 ? 0 : queued));
+        }
+        /* the buffers are freed only after the reads queued are done */
+        ret = uswap_io_wait(&waiter);
+    }
+    free(ios);
+    free(submit);
+    if (ret != USWAP_SUCCESS) {
+        uswap_log(USWAP_LOG_ERR, "read swapin pages failed\n");
+        for (int i = 0; i < nums; i++) {
+            if (swapin_datas[i].buf != NULL) {
+                free(file_buf_hdr(swapin_datas[i].buf));
+            }
+        }
+        pthread_mutex_lock(&g_file.mutex);
+        g_file.stats.io_errors++;
+        pthread_mutex_unlock(&g_file.mutex);
+        return USWAP_ERROR;
+    }
+
+    ns = file_elapsed_ns(&begin);
+    pthread_mutex_lock(&g_file.mutex);
+    g_file.stats.swapin_pages += nums - misses;
+    g_file.stats.swapin_ns_total += ns * (nums - misses);
+    if (ns > g_file.stats.swapin_ns_max) {
+        g_file.stats.swapin_ns_max = ns;
+    }
+    pthread_mutex_unlock(&g_file.mutex);
+    return USWAP_SUCCESS;
+}
+
+static int file_do_swapin(const void *fault_addr, struct swap_data *swapin_data)
+{
+    void *fault_addrs[1] = { (void *)fault_addr };
+    int ret;
+
+    ret = file_do_swapin_batch(fault_addrs, 1, swapin_data);
+    if (ret == USWAP_SUCCESS && swapin_data->buf == NULL) {
+        return USWAP_NOT_SWAPPED;
+    }
+    return ret;
+}
+
+/* drop the entry the page was read from, unless it was swapped out again meanwhile */
+static int file_release_buf(struct swap_data *swap_data)
+{
+    struct file_buf_hdr *hdr = NULL;
+    struct file_entry *entry = NULL;
+
+    if (swap_data->buf == NULL) {
+        return USWAP_SUCCESS;
+    }
+    hdr = file_buf_hdr(swap_data->buf);
+
+    pthread_mutex_lock(&g_file.mutex);
+    entry = uswap_radix_lookup(&g_file.tree, (unsigned long)swap_data->start_va / g_file.page_size, false);
+    if (hdr->gen != 0 && entry != NULL && (entry->flags & FILE_ENTRY_USED) && entry->gen == hdr->gen) {
+        file_entry_drop(entry);
+    }
+    pthread_mutex_unlock(&g_file.mutex);
+
+    free(hdr);
+    swap_data->buf = NULL;
+    return USWAP_SUCCESS;
+}
+
+static int file_open(const char *path, size_t capacity)
+{
+    int fd;
+
+    fd = open(path, O_RDWR | O_CREAT | O_DIRECT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd < 0 && errno == EINVAL) {
+        /* tmpfs and some others do not support O_DIRECT */
+        uswap_log(USWAP_LOG_WARN, "%s does not support O_DIRECT, use buffered io\n", path);
+        fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    }
+    if (fd < 0) {
+        uswap_log(USWAP_LOG_ERR, "open swap file %s failed\n", path);
+        return -1;
+    }
+
+    if (fallocate(fd, 0, 0, (off_t)capacity) != 0 && ftruncate(fd, (off_t)capacity) != 0) {
+        uswap_log(USWAP_LOG_ERR, "preallocate swap file %s failed\n", path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int register_uswap_file(const char *path, size_t capacity)
+{
+    struct uswap_operations ops = {
+        .get_swapout_buf = file_get_swapout_buf,
+        .do_swapout = file_do_swapout,
+        .do_swapin = file_do_swapin,
+        .release_buf = file_release_buf,
+    };
+    unsigned long blocks;
+    long page_size;
+
+    page_size = sysconf(_SC_PAGESIZE);
+    if (path == NULL || page_size <= 0 || capacity < (size_t)page_size || capacity > LONG_MAX) {
+        return USWAP_ERROR;
+    }
+    if (g_file.fd >= 0) {
+        uswap_log(USWAP_LOG_ERR, "uswap file backend is already registered\n");
+        return USWAP_ERROR;
+    }
+
+    g_file.page_size = (size_t)page_size;
+    blocks = capacity / g_file.page_size;
+    g_file.bitmap = calloc((blocks + FILE_BITS_PER_LONG - 1) / FILE_BITS_PER_LONG, sizeof(unsigned long));
+    if (g_file.bitmap == NULL) {
+        return USWAP_ERROR;
+    }
+    /* the tail bits of the last word are never free */
+    for (unsigned long b = blocks; b % FILE_BITS_PER_LONG != 0; b++) {
+        block_set(b);
+    }
+    g_file.stats.total_blocks = blocks;
+    g_file.stats.free_blocks = blocks;
+
+    if (uswap_io_init(FILE_IO_QUEUE_DEPTH, FILE_IO_THREAD_NUMS) != USWAP_SUCCESS) {
+        uswap_log(USWAP_LOG_ERR, "init uswap io engine failed\n");
+        goto free_bitmap;
+    }
+    g_file.fd = file_open(path, blocks * g_file.page_size);
+    if (g_file.fd < 0) {
+        goto free_bitmap;
+    }
+    if (register_uswap(USWAP_FILE_NAME, strlen(USWAP_FILE_NAME), &ops) != USWAP_SUCCESS ||
+        set_uswap_swapin_batch(file_do_swapin_batch) != USWAP_SUCCESS) {
+        close(g_file.fd);
+        g_file.fd = -1;
+        goto free_bitmap;
+    }
+    uswap_log(USWAP_LOG_INFO, "uswap file backend on %s, %lu blocks, %s\n", path, blocks,
+              uswap_io_is_uring() ? "io_uring" : "io threads");
+    return USWAP_SUCCESS;
+
+free_bitmap:
+    free(g_file.bitmap);
+    g_file.bitmap = NULL;
+    return USWAP_ERROR;
+}
+
+int uswap_file_get_stats(struct uswap_file_stats *stats)
+{
+    if (stats == NULL) {
+        return USWAP_ERROR;
+    }
+
+    pthread_mutex_lock(&g_file.mutex);
+    *stats = g_file.stats;
+    pthread_mutex_unlock(&g_file.mutex);
+    return USWAP_SUCCESS;
+}
@@ -0,0 +1,411 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2021. All rights reserved.
+ * userswap licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: asynchronous io engine of the uswap file backend
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#ifdef __NR_io_uring_setup
+#include <linux/io_uring.h>
+#endif
+#include "uswap_api.h"
+#include "uswap_log.h"
+#include "uswap_io.h"
+
+#define MAX_IO_THREAD_NUMS 64
+
+#ifdef __NR_io_uring_setup
+struct uswap_uring {
+    int fd;
+    unsigned int entries;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+};
+#endif
+
+struct uswap_io_engine {
+    bool inited;
+    bool uring;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    /* ios queued to the threads, or taking a submission queue entry */
+    struct uswap_io *head;
+    struct uswap_io *tail;
+    unsigned int inflight;
+#ifdef __NR_io_uring_setup
+    struct uswap_uring ring;
+#endif
+};
+
+static struct uswap_io_engine g_io = {
+    .inited = false,
+    .uring = false,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .head = NULL,
+    .tail = NULL,
+    .inflight = 0,
+};
+
+static pthread_mutex_t g_io_init_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void io_complete(struct uswap_io *io, ssize_t res)
+{
+    io->res = res;
+    io->done(io);
+}
+
+static void *io_thread(void *arg)
+{
+    struct uswap_io *io = NULL;
+    ssize_t res;
+
+    prctl(PR_SET_NAME, "uswap-io", 0, 0, 0);
+    while (1) {
+        pthread_mutex_lock(&g_io.mutex);
+        while (g_io.head == NULL) {
+            pthread_cond_wait(&g_io.cond, &g_io.mutex);
+        }
+        io = g_io.head;
+        g_io.head = io->next;
+        if (g_io.head == NULL) {
+            g_io.tail = NULL;
+        }
+        pthread_mutex_unlock(&g_io.mutex);
+
+        if (io->op == USWAP_IO_READ) {
+            res = pread(io->fd, io->buf, io->len, io->offset);
+        } else {
+            res = pwrite(io->fd, io->buf, io->len, io->offset);
+        }
+        io_complete(io, res < 0 ? -errno : res);
+    }
+    return NULL;
+}
+
+static int io_threads_init(int threads)
+{
+    pthread_t tid;
+
+    if (threads <= 0 || threads > MAX_IO_THREAD_NUMS) {
+        return USWAP_ERROR;
+    }
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&tid, NULL, io_thread, NULL) != 0) {
+            /* the threads already started serve the queue */
+            return i == 0 ? USWAP_ERROR : USWAP_SUCCESS;
+        }
+        pthread_detach(tid);
+    }
+    return USWAP_SUCCESS;
+}
+
+static int io_threads_submit(struct uswap_io **ios, int nums)
+{
+    pthread_mutex_lock(&g_io.mutex);
+    for (int i = 0; i < nums; i++) {
+        ios[i]->next = NULL;
+        if (g_io.tail == NULL) {
+            g_io.head = ios[i];
+        } else {
+            g_io.tail->next = ios[i];
+        }
+        g_io.tail = ios[i];
+    }
+    pthread_cond_broadcast(&g_io.cond);
+    pthread_mutex_unlock(&g_io.mutex);
+    return nums;
+}
+
+#ifdef __NR_io_uring_setup
+static void uring_unmap(struct uswap_uring *ring)
+{
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring != NULL && ring->cq_ring != MAP_FAILED) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring != NULL && ring->sq_ring != MAP_FAILED) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+}
+
+static int uring_setup(struct uswap_uring *ring, unsigned int entries)
+{
+    struct io_uring_params params;
+
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(struct uswap_uring));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return USWAP_ERROR;
+    }
+    ring->entries = params.sq_entries;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        uring_unmap(ring);
+        close(ring->fd);
+        return USWAP_ERROR;
+    }
+
+    ring->sq_head = (unsigned int *)((char *)ring->sq_ring + params.sq_off.head);
+    ring->sq_tail = (unsigned int *)((char *)ring->sq_ring + params.sq_off.tail);
+    ring->sq_mask = (unsigned int *)((char *)ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *)((char *)ring->sq_ring + params.sq_off.array);
+    ring->cq_head = (unsigned int *)((char *)ring->cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned int *)((char *)ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask = (unsigned int *)((char *)ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((char *)ring->cq_ring + params.cq_off.cqes);
+    return USWAP_SUCCESS;
+}
+
+/* reap completions, only this thread touches the completion queue */
+static void *uring_complete_thread(void *arg)
+{
+    struct uswap_uring *ring = &g_io.ring;
+    struct io_uring_cqe *cqe = NULL;
+    unsigned int head;
+    unsigned int tail;
+    int reaped;
+    int ret;
+
+    prctl(PR_SET_NAME, "uswap-io", 0, 0, 0);
+    while (1) {
+        ret = (int)syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            uswap_log(USWAP_LOG_ERR, "io_uring wait completion failed\n");
+            usleep(10);
+            continue;
+        }
+
+        reaped = 0;
+        head = *ring->cq_head;
+        tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            cqe = &ring->cqes[head & *ring->cq_mask];
+            io_complete((struct uswap_io *)(unsigned long)cqe->user_data, cqe->res);
+            head++;
+            reaped++;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+        if (reaped != 0) {
+            pthread_mutex_lock(&g_io.mutex);
+            g_io.inflight -= reaped;
+            pthread_cond_broadcast(&g_io.cond);
+            pthread_mutex_unlock(&g_io.mutex);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Fill one entry per io and ring the doorbell once. The number of ios in
+ * flight is kept below the ring size so the completion queue never
+ * overflows. Entries the kernel did not consume are taken back from the
+ * ring, so the ios not queued are never read after the call.
+ */
+static int uring_submit(struct uswap_io **ios, int nums)
+{
+    struct uswap_uring *ring = &g_io.ring;
+    struct io_uring_sqe *sqe = NULL;
+    struct uswap_io *io = NULL;
+    unsigned int tail;
+    unsigned int index;
+    bool interrupted;
+    int queued = 0;
+    int submitted;
+    int batch;
+    int ret;
+
+    pthread_mutex_lock(&g_io.mutex);
+    while (queued < nums) {
+        while (g_io.inflight >= ring->entries) {
+            pthread_cond_wait(&g_io.cond, &g_io.mutex);
+        }
+        batch = 0;
+        tail = *ring->sq_tail;
+        while (queued + batch < nums && g_io.inflight + batch < ring->entries) {
+            io = ios[queued + batch];
+            index = tail & *ring->sq_mask;
+            sqe = &ring->sqes[index];
+            memset(sqe, 0, sizeof(struct io_uring_sqe));
+            sqe->opcode = io->op == USWAP_IO_READ ? IORING_OP_READV : IORING_OP_WRITEV;
+            sqe->fd = io->fd;
+            sqe->off = (unsigned long long)io->offset;
+            /* the iovec lives in the io, which outlives the request */
+            io->iov.iov_base = io->buf;
+            io->iov.iov_len = io->len;
+            sqe->addr = (unsigned long)&io->iov;
+            sqe->len = 1;
+            sqe->user_data = (unsigned long)io;
+            ring->sq_array[index] = index;
+            tail++;
+            batch++;
+        }
+        __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+        ret = (int)syscall(__NR_io_uring_enter, ring->fd, batch, 0, 0, NULL, 0);
+        interrupted = (ret < 0 && errno == EINTR);
+        submitted = ret < 0 ? 0 : ret;
+        if (submitted < batch) {
+            /* there is no sq polling, the kernel reads the ring only in io_uring_enter */
+            __atomic_store_n(ring->sq_tail, tail - (unsigned int)(batch - submitted), __ATOMIC_RELEASE);
+        }
+        queued += submitted;
+        g_io.inflight += (unsigned int)submitted;
+        if (submitted < batch && !interrupted) {
+            uswap_log(USWAP_LOG_ERR, "io_uring submit failed, %d of %d ios queued\n", queued, nums);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_io.mutex);
+    return queued;
+}
+
+static int io_uring_init(unsigned int queue_depth)
+{
+    pthread_t tid;
+
+    if (uring_setup(&g_io.ring, queue_depth) != USWAP_SUCCESS) {
+        return USWAP_ERROR;
+    }
+    if (pthread_create(&tid, NULL, uring_complete_thread, NULL) != 0) {
+        uring_unmap(&g_io.ring);
+        close(g_io.ring.fd);
+        return USWAP_ERROR;
+    }
+    pthread_detach(tid);
+    return USWAP_SUCCESS;
+}
+#endif
+
+int uswap_io_init(unsigned int queue_depth, int threads)
+{
+    int ret = USWAP_SUCCESS;
+
+    /* held until the engine is up, so two callers never both start one */
+    pthread_mutex_lock(&g_io_init_mutex);
+    if (g_io.inited) {
+        pthread_mutex_unlock(&g_io_init_mutex);
+        return USWAP_SUCCESS;
+    }
+
+#ifdef __NR_io_uring_setup
+    if (io_uring_init(queue_depth) == USWAP_SUCCESS) {
+        g_io.uring = true;
+    }
+#endif
+    if (!g_io.uring) {
+        uswap_log(USWAP_LOG_INFO, "io_uring is not available, use io threads\n");
+        ret = io_threads_init(threads);
+    }
+
+    g_io.inited = (ret == USWAP_SUCCESS);
+    pthread_mutex_unlock(&g_io_init_mutex);
+    return ret;
+}
+
+bool uswap_io_is_uring(void)
+{
+    return g_io.uring;
+}
+
+int uswap_io_submit(struct uswap_io **ios, int nums)
+{
+    if (!g_io.inited || ios == NULL || nums <= 0) {
+        return USWAP_ERROR;
+    }
+#ifdef __NR_io_uring_setup
+    if (g_io.uring) {
+        return uring_submit(ios, nums);
+    }
+#endif
+    return io_threads_submit(ios, nums);
+}
+
+void uswap_io_waiter_init(struct uswap_io_waiter *waiter, int pending)
+{
+    pthread_mutex_init(&waiter->mutex, NULL);
+    pthread_cond_init(&waiter->cond, NULL);
+    waiter->pending = pending;
+    waiter->error = 0;
+}
+
+void uswap_io_wait_done(struct uswap_io *io)
+{
+    struct uswap_io_waiter *waiter = io->priv;
+
+    pthread_mutex_lock(&waiter->mutex);
+    if (io->res != (ssize_t)io->len) {
+        waiter->error++;
+    }
+    waiter->pending--;
+    if (waiter->pending == 0) {
+        pthread_cond_signal(&waiter->cond);
+    }
+    pthread_mutex_unlock(&waiter->mutex);
+}
+
+void uswap_io_waiter_cancel(struct uswap_io_waiter *waiter, int nums)
+{
+    pthread_mutex_lock(&waiter->mutex);
+    waiter->error += nums;
+    waiter->pending -= nums;
+    pthread_mutex_unlock(&waiter->mutex);
+}
+
+int uswap_io_wait(struct uswap_io_waiter *waiter)
+{
+    int error;
+
+    pthread_mutex_lock(&waiter->mutex);
+    while (waiter->pending > 0) {
+        pthread_cond_wait(&waiter->cond, &waiter->mutex);
+    }
+    error = waiter->error;
+    pthread_mutex_unlock(&waiter->mutex);
+
+    pthread_mutex_destroy(&waiter->mutex);
+    pthread_cond_destroy(&waiter->cond);
+    return error == 0 ? USWAP_SUCCESS : USWAP_ERROR;
+}
@@ -0,0 +1,79 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2021. All rights reserved.
+ * userswap licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: radix tree of per page metadata used by the uswap backends
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include "uswap_radix.h"
+
+#define RADIX_BITS 9
+#define RADIX_SLOTS (1 << RADIX_BITS)
+#define RADIX_MASK (RADIX_SLOTS - 1)
+/* 5 levels of 9 bits index 2^45 pages, which covers 57 bit addresses */
+#define RADIX_LEVELS 5
+#define RADIX_KEY_BITS (RADIX_BITS * RADIX_LEVELS)
+
+void uswap_radix_init(struct uswap_radix *tree, size_t entry_size)
+{
+    tree->root = NULL;
+    tree->entry_size = entry_size;
+}
+
+void *uswap_radix_lookup(struct uswap_radix *tree, unsigned long key, bool create)
+{
+    void **slot = &tree->root;
+    size_t size;
+    int shift;
+
+    if (key >> RADIX_KEY_BITS != 0) {
+        return NULL;
+    }
+    for (int level = 0; level < RADIX_LEVELS; level++) {
+        if (*slot == NULL) {
+            if (!create) {
+                return NULL;
+            }
+            size = level == RADIX_LEVELS - 1 ? RADIX_SLOTS * tree->entry_size :
+                   RADIX_SLOTS * sizeof(void *);
+            *slot = calloc(1, size);
+            if (*slot == NULL) {
+                return NULL;
+            }
+        }
+        if (level == RADIX_LEVELS - 1) {
+            break;
+        }
+        shift = (RADIX_LEVELS - 1 - level) * RADIX_BITS;
+        slot = &((void **)*slot)[(key >> shift) & RADIX_MASK];
+    }
+    return (char *)*slot + (key & RADIX_MASK) * tree->entry_size;
+}
+
+static void radix_free_node(void *node, int level)
+{
+    if (node == NULL) {
+        return;
+    }
+    if (level < RADIX_LEVELS - 1) {
+        for (int i = 0; i < RADIX_SLOTS; i++) {
+            radix_free_node(((void **)node)[i], level + 1);
+        }
+    }
+    free(node);
+}
+
+void uswap_radix_destroy(struct uswap_radix *tree)
+{
+    radix_free_node(tree->root, 0);
+    tree->root = NULL;
+}
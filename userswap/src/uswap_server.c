@@ -22,6 +22,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/wait.h>
+#include <string.h>
 #include "uswap_log.h"
 #include "uswap_server.h"
 
@@ -86,10 +87,96 @@ static int check_socket_permission(int fd, int client_fd)
     return 0;
 }
 
-int sock_handle_rec(int fd, struct swap_vma *swap_vma)
+static ssize_t read_full(int fd, void *buf, size_t len)
+{
+    ssize_t ret;
+    size_t done = 0;
+
+    while (done < len) {
+        ret = read(fd, (char *)buf + done, len - done);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            return ret;
+        }
+        done += ret;
+    }
+    return done;
+}
+
+static ssize_t write_full(int fd, const void *buf, size_t len)
+{
+    ssize_t ret;
+    size_t done = 0;
+
+    while (done < len) {
+        ret = send(fd, (const char *)buf + done, len - done, MSG_NOSIGNAL);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            return -1;
+        }
+        done += ret;
+    }
+    return done;
+}
+
+static int read_frame_body(int client_fd, struct swap_vma *swap_vma)
+{
+    ssize_t readbytes;
+
+    if (swap_vma->length > sizeof(swap_vma->vma_addrs) ||
+        swap_vma->length % sizeof(struct vma_addr) != 0) {
+        uswap_log(USWAP_LOG_ERR, "invalid swap vma length %lu\n", swap_vma->length);
+        return -EINVAL;
+    }
+
+    if (swap_vma->type == SWAP_TYPE_VMA_STREAM) {
+        readbytes = read_full(client_fd, swap_vma->vma_addrs, swap_vma->length);
+        if (readbytes < 0 || (size_t)readbytes != swap_vma->length) {
+            return -EINVAL;
+        }
+        return SWAP_VMA_HDR_LEN + readbytes;
+    }
+
+    /* legacy one-shot request, the whole message is sent by a single write */
+    readbytes = read(client_fd, swap_vma->vma_addrs, swap_vma->length);
+    if (readbytes < 0) {
+        return -EINVAL;
+    }
+    return SWAP_VMA_HDR_LEN + readbytes;
+}
+
+int sock_read_frame(int client_fd, struct swap_vma *swap_vma)
+{
+    ssize_t readbytes;
+
+    if (client_fd < 0 || swap_vma == NULL) {
+        return -EINVAL;
+    }
+
+    readbytes = read_full(client_fd, swap_vma, SWAP_VMA_HDR_LEN);
+    if (readbytes == 0) {
+        /* peer closed the connection */
+        return 0;
+    }
+    if (readbytes < 0 || (size_t)readbytes != SWAP_VMA_HDR_LEN) {
+        return -EINVAL;
+    }
+
+    if (swap_vma->type != SWAP_TYPE_VMA_ADDR && swap_vma->type != SWAP_TYPE_VMA_STREAM) {
+        uswap_log(USWAP_LOG_ERR, "unknown swap vma type %x\n", swap_vma->type);
+        return -EINVAL;
+    }
+
+    return read_frame_body(client_fd, swap_vma);
+}
+
+int sock_handle_accept(int fd)
 {
     int client_fd;
-    int readbytes;
     struct sockaddr_un  clientun;
     socklen_t clientun_len = sizeof(clientun);
 
@@ -103,8 +190,19 @@ int sock_handle_rec(int fd, struct swap_vma *swap_vma)
         return -EPERM;
     }
 
-    readbytes = read(client_fd, swap_vma, sizeof(struct swap_vma));
-    if (readbytes <= 0) {
+    return client_fd;
+}
+
+int sock_handle_rec(int fd, struct swap_vma *swap_vma)
+{
+    int client_fd;
+
+    client_fd = sock_handle_accept(fd);
+    if (client_fd < 0) {
+        return client_fd;
+    }
+
+    if (sock_read_frame(client_fd, swap_vma) <= 0) {
         close(client_fd);
         return -EINVAL;
     }
@@ -112,6 +210,21 @@ int sock_handle_rec(int fd, struct swap_vma *swap_vma)
     return client_fd;
 }
 
+int sock_send_ack(int client_fd, const struct swap_ack *ack)
+{
+    size_t len;
+
+    if (client_fd < 0 || ack == NULL || ack->length > sizeof(ack->results)) {
+        return -EINVAL;
+    }
+
+    len = SWAP_ACK_HDR_LEN + ack->length;
+    if (write_full(client_fd, ack, len) != (ssize_t)len) {
+        return -EIO;
+    }
+    return 0;
+}
+
 int sock_handle_respond(int client_fd, int result)
 {
     int writebytes;
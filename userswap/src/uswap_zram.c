@@ -0,0 +1,549 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2020-2021. All rights reserved.
+ * userswap licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: compressed ram backend of userswap
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "uswap_api.h"
+#include "uswap_log.h"
+#include "uswap_codec.h"
+#include "uswap_radix.h"
+#include "uswap_zram.h"
+
+#define ZRAM_CLASS_ALIGN 32
+#define ZRAM_SLAB_PAGES 16
+#define ZRAM_MAX_NODES 64
+#define ZRAM_MAX_RANGE_PAGES 64
+#define ZRAM_NODE_SYSFS_PATH "/sys/devices/system/node"
+#define NSEC_PER_SEC 1000000000UL
+
+#define ZRAM_ENTRY_USED 0x1
+#define ZRAM_ENTRY_RAW 0x2
+
+/* one compressed page, 'len' is the size of the blob */
+struct zram_entry {
+    void *blob;
+    unsigned long gen;
+    unsigned int len;
+    unsigned short node;
+    unsigned short flags;
+};
+
+/*
+ * Objects of one size class. Free objects are linked through their first
+ * word, new ones are carved from the current slab.
+ */
+struct zram_class {
+    void *free_list;
+    char *cur;
+    size_t left;
+};
+
+/* slab allocator of one numa node, slabs are never given back */
+struct zram_pool {
+    pthread_mutex_t mutex;
+    struct zram_class *classes;
+    int node;
+};
+
+/* header of the swapin buffer, release_buf drops the entry it was read from */
+struct zram_swapin_buf {
+    unsigned long gen;
+    size_t pad;
+    char data[];
+};
+
+/*
+ * The swapout buffer is this header page, a scratch page for compression
+ * and the data. A raw object of every page is reserved with it, so storing
+ * cannot fail once the pages are taken away from the process.
+ */
+struct zram_swapout_buf {
+    void *raw[ZRAM_MAX_RANGE_PAGES];
+    int node;
+};
+
+struct uswap_zram {
+    bool inited;
+    size_t page_size;
+    size_t slab_size;
+    int class_nums;
+    int node_nums;
+    struct zram_pool pools[ZRAM_MAX_NODES];
+    struct uswap_codec codec;
+    /* protects the radix tree and the stats */
+    pthread_mutex_t mutex;
+    struct uswap_radix tree;
+    unsigned long gen;
+    struct uswap_zram_stats stats;
+};
+
+static struct uswap_zram g_zram = {
+    .inited = false,
+    .codec = {
+        .name = "lzf",
+        .compress = uswap_lzf_compress,
+        .decompress = uswap_lzf_decompress,
+    },
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .tree = {
+        .root = NULL,
+        .entry_size = sizeof(struct zram_entry),
+    },
+};
+
+static pthread_mutex_t g_zram_init_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int zram_node_nums(void)
+{
+    DIR *dir = NULL;
+    struct dirent *ent = NULL;
+    int max_node = -1;
+    int node;
+
+    dir = opendir(ZRAM_NODE_SYSFS_PATH);
+    if (dir == NULL) {
+        return 1;
+    }
+    while ((ent = readdir(dir)) != NULL) {
+        if (sscanf(ent->d_name, "node%d", &node) == 1 && node > max_node) {
+            max_node = node;
+        }
+    }
+    closedir(dir);
+
+    if (max_node < 0) {
+        return 1;
+    }
+    return max_node + 1 > ZRAM_MAX_NODES ? ZRAM_MAX_NODES : max_node + 1;
+}
+
+static int zram_current_node(void)
+{
+    unsigned int cpu;
+    unsigned int node;
+
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0 || node >= (unsigned int)g_zram.node_nums) {
+        return 0;
+    }
+    return (int)node;
+}
+
+static int zram_init(void)
+{
+    long page_size;
+
+    pthread_mutex_lock(&g_zram_init_mutex);
+    if (g_zram.inited) {
+        pthread_mutex_unlock(&g_zram_init_mutex);
+        return USWAP_SUCCESS;
+    }
+
+    page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0) {
+        pthread_mutex_unlock(&g_zram_init_mutex);
+        return USWAP_ERROR;
+    }
+    g_zram.page_size = (size_t)page_size;
+    g_zram.slab_size = g_zram.page_size * ZRAM_SLAB_PAGES;
+    g_zram.class_nums = (int)(g_zram.page_size / ZRAM_CLASS_ALIGN);
+    g_zram.node_nums = zram_node_nums();
+
+    for (int i = 0; i < g_zram.node_nums; i++) {
+        g_zram.pools[i].classes = calloc(g_zram.class_nums, sizeof(struct zram_class));
+        if (g_zram.pools[i].classes == NULL) {
+            for (int j = 0; j < i; j++) {
+                free(g_zram.pools[j].classes);
+                g_zram.pools[j].classes = NULL;
+            }
+            pthread_mutex_unlock(&g_zram_init_mutex);
+            return USWAP_ERROR;
+        }
+        pthread_mutex_init(&g_zram.pools[i].mutex, NULL);
+        g_zram.pools[i].node = i;
+    }
+
+    g_zram.inited = true;
+    pthread_mutex_unlock(&g_zram_init_mutex);
+    return USWAP_SUCCESS;
+}
+
+static void *zram_slab_alloc(int node)
+{
+    unsigned long mask[ZRAM_MAX_NODES / (sizeof(unsigned long) * CHAR_BIT)] = {0};
+    void *slab = NULL;
+
+    slab = mmap(NULL, g_zram.slab_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (slab == MAP_FAILED) {
+        return NULL;
+    }
+    if (g_zram.node_nums > 1) {
+        mask[node / (sizeof(unsigned long) * CHAR_BIT)] |= 1UL << (node % (sizeof(unsigned long) * CHAR_BIT));
+        /* preferred only, the pool may still grow when the node is full */
+        if (syscall(SYS_mbind, slab, g_zram.slab_size, MPOL_PREFERRED, mask, ZRAM_MAX_NODES, 0) != 0) {
+            uswap_log(USWAP_LOG_DEBUG, "mbind zram slab to node %d failed\n", node);
+        }
+    }
+    return slab;
+}
+
+static int zram_size_class(size_t len)
+{
+    return (int)((len + ZRAM_CLASS_ALIGN - 1) / ZRAM_CLASS_ALIGN) - 1;
+}
+
+static void *zram_obj_alloc(struct zram_pool *pool, size_t len)
+{
+    struct zram_class *cls = &pool->classes[zram_size_class(len)];
+    size_t obj_size = (size_t)(zram_size_class(len) + 1) * ZRAM_CLASS_ALIGN;
+    void *obj = NULL;
+
+    pthread_mutex_lock(&pool->mutex);
+    if (cls->free_list != NULL) {
+        obj = cls->free_list;
+        cls->free_list = *(void **)obj;
+        pthread_mutex_unlock(&pool->mutex);
+        return obj;
+    }
+    if (cls->left < obj_size) {
+        cls->cur = zram_slab_alloc(pool->node);
+        if (cls->cur == NULL) {
+            cls->left = 0;
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
+        }
+        cls->left = g_zram.slab_size;
+        pthread_mutex_lock(&g_zram.mutex);
+        g_zram.stats.pool_bytes += g_zram.slab_size;
+        pthread_mutex_unlock(&g_zram.mutex);
+    }
+    obj = cls->cur;
+    cls->cur += obj_size;
+    cls->left -= obj_size;
+    pthread_mutex_unlock(&pool->mutex);
+    return obj;
+}
+
+static void zram_obj_free(struct zram_pool *pool, void *obj, size_t len)
+{
+    struct zram_class *cls = &pool->classes[zram_size_class(len)];
+
+    pthread_mutex_lock(&pool->mutex);
+    *(void **)obj = cls->free_list;
+    cls->free_list = obj;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/* caller must hold g_zram.mutex */
+static struct zram_entry *zram_tree_lookup(unsigned long key, bool create)
+{
+    return uswap_radix_lookup(&g_zram.tree, key, create);
+}
+
+static void zram_entry_release(struct zram_entry *entry)
+{
+    zram_obj_free(&g_zram.pools[entry->node], entry->blob, entry->len);
+}
+
+/* use a size class if the page compresses and one is free, the reserved raw object otherwise */
+static void zram_store_page(unsigned long va, const void *page, void *scratch, void **reserved, int node)
+{
+    struct zram_entry new_entry = {0};
+    struct zram_entry old_entry = {0};
+    struct zram_entry *entry = NULL;
+    unsigned long key = va / g_zram.page_size;
+    size_t len;
+
+    /* pages which do not save a size class are kept uncompressed */
+    len = g_zram.codec.compress(page, g_zram.page_size, scratch, g_zram.page_size - ZRAM_CLASS_ALIGN);
+    if (len != 0) {
+        new_entry.blob = zram_obj_alloc(&g_zram.pools[node], len);
+    }
+    if (new_entry.blob != NULL) {
+        memcpy(new_entry.blob, scratch, len);
+    } else {
+        len = g_zram.page_size;
+        new_entry.blob = *reserved;
+        *reserved = NULL;
+        memcpy(new_entry.blob, page, len);
+        new_entry.flags |= ZRAM_ENTRY_RAW;
+    }
+    new_entry.len = (unsigned int)len;
+    new_entry.node = (unsigned short)node;
+    new_entry.flags |= ZRAM_ENTRY_USED;
+
+    pthread_mutex_lock(&g_zram.mutex);
+    /* created by get_swapout_buf, tree nodes are never freed */
+    entry = zram_tree_lookup(key, false);
+    if (entry->flags & ZRAM_ENTRY_USED) {
+        old_entry = *entry;
+        g_zram.stats.stored_pages--;
+        g_zram.stats.raw_pages -= (old_entry.flags & ZRAM_ENTRY_RAW) ? 1 : 0;
+        g_zram.stats.orig_bytes -= g_zram.page_size;
+        g_zram.stats.compr_bytes -= old_entry.len;
+    }
+    new_entry.gen = ++g_zram.gen;
+    *entry = new_entry;
+    g_zram.stats.stored_pages++;
+    g_zram.stats.raw_pages += (new_entry.flags & ZRAM_ENTRY_RAW) ? 1 : 0;
+    g_zram.stats.orig_bytes += g_zram.page_size;
+    g_zram.stats.compr_bytes += len;
+    g_zram.stats.swapout_pages++;
+    pthread_mutex_unlock(&g_zram.mutex);
+
+    if (old_entry.flags & ZRAM_ENTRY_USED) {
+        zram_entry_release(&old_entry);
+    }
+}
+
+static struct zram_swapout_buf *zram_swapout_header(void *buf)
+{
+    return (struct zram_swapout_buf *)((char *)buf - 2 * g_zram.page_size);
+}
+
+static void zram_swapout_buf_free(struct swap_data *swapout_data)
+{
+    struct zram_swapout_buf *out_buf = zram_swapout_header(swapout_data->buf);
+    size_t pages = swapout_data->len / g_zram.page_size;
+
+    for (size_t i = 0; i < pages; i++) {
+        if (out_buf->raw[i] != NULL) {
+            zram_obj_free(&g_zram.pools[out_buf->node], out_buf->raw[i], g_zram.page_size);
+        }
+    }
+    free(out_buf);
+    swapout_data->buf = NULL;
+}
+
+static int zram_get_swapout_buf(const void *start_va, size_t len, struct swap_data *swapout_data)
+{
+    struct zram_swapout_buf *out_buf = NULL;
+    size_t max_len = ZRAM_MAX_RANGE_PAGES * g_zram.page_size;
+    unsigned long key = (unsigned long)start_va / g_zram.page_size;
+    size_t pages;
+    int ret = USWAP_SUCCESS;
+
+    swapout_data->start_va = (void *)start_va;
+    swapout_data->len = len > max_len ? max_len : len;
+    swapout_data->flag = 0;
+    swapout_data->buf = NULL;
+    pages = swapout_data->len / g_zram.page_size;
+    if (posix_memalign((void **)&out_buf, g_zram.page_size, 2 * g_zram.page_size + swapout_data->len) != 0) {
+        return USWAP_ERROR;
+    }
+    memset(out_buf, 0, sizeof(struct zram_swapout_buf));
+    out_buf->node = zram_current_node();
+    swapout_data->buf = (char *)out_buf + 2 * g_zram.page_size;
+
+    for (size_t i = 0; i < pages; i++) {
+        out_buf->raw[i] = zram_obj_alloc(&g_zram.pools[out_buf->node], g_zram.page_size);
+        if (out_buf->raw[i] == NULL) {
+            uswap_log(USWAP_LOG_ERR, "alloc zram object failed\n");
+            zram_swapout_buf_free(swapout_data);
+            return USWAP_ERROR;
+        }
+    }
+
+    pthread_mutex_lock(&g_zram.mutex);
+    for (size_t i = 0; i < pages; i++) {
+        if (zram_tree_lookup(key + i, true) == NULL) {
+            ret = USWAP_ERROR;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_zram.mutex);
+    if (ret != USWAP_SUCCESS) {
+        uswap_log(USWAP_LOG_ERR, "alloc zram tree node failed\n");
+        zram_swapout_buf_free(swapout_data);
+    }
+    return ret;
+}
+
+static int zram_do_swapout(struct swap_data *swapout_data)
+{
+    struct zram_swapout_buf *out_buf = zram_swapout_header(swapout_data->buf);
+    void *scratch = (char *)out_buf + g_zram.page_size;
+
+    if (!(swapout_data->flag & USWAP_DATA_ABORT)) {
+        for (size_t offset = 0; offset < swapout_data->len; offset += g_zram.page_size) {
+            zram_store_page((unsigned long)swapout_data->start_va + offset, (char *)swapout_data->buf + offset,
+                            scratch, &out_buf->raw[offset / g_zram.page_size], out_buf->node);
+        }
+    }
+    zram_swapout_buf_free(swapout_data);
+    return USWAP_SUCCESS;
+}
+
+static unsigned long zram_elapsed_ns(const struct timespec *begin)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (unsigned long)(end.tv_sec - begin->tv_sec) * NSEC_PER_SEC + end.tv_nsec - begin->tv_nsec;
+}
+
+/*
+ * The entry is only read here and dropped by release_buf after the page is
+ * installed, so a racing fault and prefetch of one page both get its data.
+ * A page which was never swapped out is USWAP_NOT_SWAPPED.
+ */
+static int zram_do_swapin(const void *fault_addr, struct swap_data *swapin_data)
+{
+    struct zram_swapin_buf *in_buf = NULL;
+    struct zram_entry *entry = NULL;
+    unsigned long va = (unsigned long)fault_addr & ~(g_zram.page_size - 1);
+    struct timespec begin;
+    unsigned long ns;
+    size_t len;
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    in_buf = malloc(sizeof(struct zram_swapin_buf) + g_zram.page_size);
+    if (in_buf == NULL) {
+        return USWAP_ERROR;
+    }
+    in_buf->gen = 0;
+
+    pthread_mutex_lock(&g_zram.mutex);
+    entry = zram_tree_lookup(va / g_zram.page_size, false);
+    if (entry == NULL || !(entry->flags & ZRAM_ENTRY_USED)) {
+        pthread_mutex_unlock(&g_zram.mutex);
+        free(in_buf);
+        return USWAP_NOT_SWAPPED;
+    }
+    if (entry->flags & ZRAM_ENTRY_RAW) {
+        memcpy(in_buf->data, entry->blob, g_zram.page_size);
+        in_buf->gen = entry->gen;
+    } else {
+        len = g_zram.codec.decompress(entry->blob, entry->len, in_buf->data, g_zram.page_size);
+        if (len != g_zram.page_size) {
+            pthread_mutex_unlock(&g_zram.mutex);
+            free(in_buf);
+            uswap_log(USWAP_LOG_ERR, "decompress page %lx failed\n", va);
+            return USWAP_ERROR;
+        }
+        in_buf->gen = entry->gen;
+    }
+    pthread_mutex_unlock(&g_zram.mutex);
+
+    swapin_data->start_va = (void *)va;
+    swapin_data->len = g_zram.page_size;
+    swapin_data->buf = in_buf->data;
+    swapin_data->flag = 0;
+
+    ns = zram_elapsed_ns(&begin);
+    pthread_mutex_lock(&g_zram.mutex);
+    g_zram.stats.swapin_pages++;
+    g_zram.stats.swapin_ns_total += ns;
+    if (ns > g_zram.stats.swapin_ns_max) {
+        g_zram.stats.swapin_ns_max = ns;
+    }
+    pthread_mutex_unlock(&g_zram.mutex);
+    return USWAP_SUCCESS;
+}
+
+static int zram_release_buf(struct swap_data *swap_data)
+{
+    struct zram_swapin_buf *in_buf = NULL;
+    struct zram_entry old_entry = {0};
+    struct zram_entry *entry = NULL;
+    unsigned long key;
+
+    if (swap_data->buf == NULL) {
+        return USWAP_SUCCESS;
+    }
+    in_buf = (struct zram_swapin_buf *)((char *)swap_data->buf - offsetof(struct zram_swapin_buf, data));
+    key = (unsigned long)swap_data->start_va / g_zram.page_size;
+
+    pthread_mutex_lock(&g_zram.mutex);
+    entry = zram_tree_lookup(key, false);
+    /* the page may have been swapped out again meanwhile, keep the newer entry */
+    if (in_buf->gen != 0 && entry != NULL && (entry->flags & ZRAM_ENTRY_USED) &&
+        entry->gen == in_buf->gen) {
+        old_entry = *entry;
+        memset(entry, 0, sizeof(struct zram_entry));
+        g_zram.stats.stored_pages--;
+        g_zram.stats.raw_pages -= (old_entry.flags & ZRAM_ENTRY_RAW) ? 1 : 0;
+        g_zram.stats.orig_bytes -= g_zram.page_size;
+        g_zram.stats.compr_bytes -= old_entry.len;
+    }
+    pthread_mutex_unlock(&g_zram.mutex);
+
+    if (old_entry.flags & ZRAM_ENTRY_USED) {
+        zram_entry_release(&old_entry);
+    }
+    free(in_buf);
+    swap_data->buf = NULL;
+    return USWAP_SUCCESS;
+}
+
+int uswap_zram_set_codec(const struct uswap_codec *codec)
+{
+    int ret = USWAP_SUCCESS;
+
+    if (codec != NULL && (codec->compress == NULL || codec->decompress == NULL)) {
+        return USWAP_ERROR;
+    }
+
+    pthread_mutex_lock(&g_zram.mutex);
+    if (g_zram.stats.stored_pages != 0) {
+        ret = USWAP_ERROR;
+    } else if (codec == NULL) {
+        g_zram.codec.name = "lzf";
+        g_zram.codec.compress = uswap_lzf_compress;
+        g_zram.codec.decompress = uswap_lzf_decompress;
+    } else {
+        g_zram.codec = *codec;
+    }
+    pthread_mutex_unlock(&g_zram.mutex);
+    return ret;
+}
+
+int register_uswap_zram(void)
+{
+    struct uswap_operations ops = {
+        .get_swapout_buf = zram_get_swapout_buf,
+        .do_swapout = zram_do_swapout,
+        .do_swapin = zram_do_swapin,
+        .release_buf = zram_release_buf,
+    };
+
+    if (zram_init() != USWAP_SUCCESS) {
+        uswap_log(USWAP_LOG_ERR, "init zram pools failed\n");
+        return USWAP_ERROR;
+    }
+    return register_uswap(USWAP_ZRAM_NAME, strlen(USWAP_ZRAM_NAME), &ops);
+}
+
+int uswap_zram_get_stats(struct uswap_zram_stats *stats)
+{
+    if (stats == NULL) {
+        return USWAP_ERROR;
+    }
+
+    pthread_mutex_lock(&g_zram.mutex);
+    *stats = g_zram.stats;
+    pthread_mutex_unlock(&g_zram.mutex);
+    return USWAP_SUCCESS;
+}
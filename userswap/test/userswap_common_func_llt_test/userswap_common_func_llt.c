@@ -103,11 +103,26 @@ static void test_uswap_register_ops(void)
     CU_ASSERT_EQUAL(register_uswap("test", 4, &test_ops), USWAP_SUCCESS);
 }
 
+static void test_uswap_zero_copy(void)
+{
+    struct swap_data data = {0};
+
+    CU_ASSERT_EQUAL(set_uswap_zero_copy(test_do_swapout), USWAP_SUCCESS);
+    CU_ASSERT_EQUAL(set_uswap_zero_copy(NULL), USWAP_SUCCESS);
+    CU_ASSERT_EQUAL(uswap_release_swapout_va(NULL), USWAP_ERROR);
+    CU_ASSERT_EQUAL(uswap_release_swapout_va(&data), USWAP_SUCCESS);
+}
+
 static void test_uswap_init(void)
 {
-    CU_ASSERT_EQUAL(uswap_init(MAX_SWAPIN_THREAD_NUMS + 1), USWAP_ERROR);
-    CU_ASSERT_EQUAL(uswap_init(MAX_SWAPIN_THREAD_NUMS), USWAP_SUCCESS);
-    CU_ASSERT_EQUAL(uswap_init(MAX_SWAPIN_THREAD_NUMS), USWAP_ERROR);
+    CU_ASSERT_EQUAL(uswap_init(MAX_SWAPIN_THREAD_NUMS + 1, 1), USWAP_ERROR);
+    CU_ASSERT_EQUAL(uswap_init(MAX_SWAPIN_THREAD_NUMS, 0), USWAP_ERROR);
+    CU_ASSERT_EQUAL(uswap_init(MAX_SWAPIN_THREAD_NUMS, MAX_SWAPOUT_THREAD_NUMS + 1), USWAP_ERROR);
+    CU_ASSERT_EQUAL(set_uswap_swapout_numa_local(1), USWAP_SUCCESS);
+    CU_ASSERT_EQUAL(uswap_init(MAX_SWAPIN_THREAD_NUMS, MAX_SWAPOUT_THREAD_NUMS), USWAP_SUCCESS);
+    CU_ASSERT_EQUAL(uswap_init(MAX_SWAPIN_THREAD_NUMS, MAX_SWAPOUT_THREAD_NUMS), USWAP_ERROR);
+    CU_ASSERT_EQUAL(set_uswap_swapout_numa_local(0), USWAP_ERROR);
+    CU_ASSERT_EQUAL(set_uswap_zero_copy(NULL), USWAP_ERROR);
 }
 
 static void test_force_swapout(void)
@@ -122,6 +137,17 @@ static void test_force_swapout(void)
     free(addr);
 }
 
+static void test_uswap_prefetch_window(void)
+{
+    char buf[4096];
+
+    CU_ASSERT_EQUAL(set_uswap_prefetch_window(NULL, 4096, 1), USWAP_ERROR);
+    CU_ASSERT_EQUAL(set_uswap_prefetch_window(buf, SSIZE_MAX + 1UL, 1), USWAP_ERROR);
+    CU_ASSERT_EQUAL(set_uswap_prefetch_window(buf, sizeof(buf), -1), USWAP_ERROR);
+    CU_ASSERT_EQUAL(set_uswap_prefetch_window(buf, sizeof(buf), MAX_PREFETCH_WINDOW + 1), USWAP_ERROR);
+    CU_ASSERT_EQUAL(set_uswap_prefetch_window(buf, sizeof(buf), 0), USWAP_UNREGISTER_MEM);
+}
+
 typedef enum {
     CUNIT_SCREEN = 0,
     CUNIT_XMLFILE,
@@ -152,7 +178,9 @@ int main(int argc, const char **argv)
     if (CU_ADD_TEST(suite, test_uswap_set_log_level) == NULL ||
         CU_ADD_TEST(suite, test_uswap_register_userfaultfd) == NULL ||
 	CU_ADD_TEST(suite, test_uswap_unregister_userfaultfd) == NULL ||
+        CU_ADD_TEST(suite, test_uswap_prefetch_window) == NULL ||
 	CU_ADD_TEST(suite, test_uswap_register_ops) == NULL ||
+        CU_ADD_TEST(suite, test_uswap_zero_copy) == NULL ||
 	CU_ADD_TEST(suite, test_uswap_init) == NULL ||
 	CU_ADD_TEST(suite, test_force_swapout) == NULL) {
             printf("CU_ADD_TEST fail. \n");
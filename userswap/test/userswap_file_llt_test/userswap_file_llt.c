@@ -0,0 +1,113 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2022. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a source file of the unit test for the file backend in uswap.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "uswap_api.h"
+#include "uswap_file.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Console.h>
+
+#define TEST_SWAP_FILE "./uswap_file_llt.swap"
+#define TEST_SWAP_BLOCKS 256
+
+static void test_uswap_file_register(void)
+{
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    CU_ASSERT_EQUAL(register_uswap_file(NULL, TEST_SWAP_BLOCKS * page_size), USWAP_ERROR);
+    CU_ASSERT_EQUAL(register_uswap_file(TEST_SWAP_FILE, page_size - 1), USWAP_ERROR);
+    CU_ASSERT_EQUAL(register_uswap_file("/nonexistent/uswap.swap", TEST_SWAP_BLOCKS * page_size), USWAP_ERROR);
+    CU_ASSERT_EQUAL(register_uswap_file(TEST_SWAP_FILE, TEST_SWAP_BLOCKS * page_size), USWAP_SUCCESS);
+    CU_ASSERT_EQUAL(register_uswap_file(TEST_SWAP_FILE, TEST_SWAP_BLOCKS * page_size), USWAP_ERROR);
+}
+
+static void test_uswap_file_stats(void)
+{
+    struct uswap_file_stats stats;
+
+    CU_ASSERT_EQUAL(uswap_file_get_stats(NULL), USWAP_ERROR);
+    CU_ASSERT_EQUAL(uswap_file_get_stats(&stats), USWAP_SUCCESS);
+    CU_ASSERT_EQUAL(stats.total_blocks, TEST_SWAP_BLOCKS);
+    CU_ASSERT_EQUAL(stats.free_blocks, TEST_SWAP_BLOCKS);
+    CU_ASSERT_EQUAL(stats.stored_pages, 0);
+    unlink(TEST_SWAP_FILE);
+}
+
+typedef enum {
+    CUNIT_SCREEN = 0,
+    CUNIT_XMLFILE,
+    CUNIT_CONSOLE
+} cu_run_mode;
+
+int main(int argc, const char **argv)
+{
+    CU_pSuite suite;
+    CU_pTest pTest;
+    unsigned int num_failures;
+    cu_run_mode cunit_mode = CUNIT_SCREEN;
+    int error_num;
+
+    if (argc > 1) {
+        cunit_mode = atoi(argv[1]);
+    }
+
+    if (CU_initialize_registry() != CUE_SUCCESS) {
+        return -CU_get_error();
+    }
+
+    suite = CU_add_suite("uswap_file", NULL, NULL);
+    if (suite == NULL) {
+        goto ERROR;
+    }
+
+    if (CU_ADD_TEST(suite, test_uswap_file_register) == NULL ||
+        CU_ADD_TEST(suite, test_uswap_file_stats) == NULL) {
+            printf("CU_ADD_TEST fail. \n");
+            goto ERROR;
+    }
+
+    switch (cunit_mode) {
+        case CUNIT_SCREEN:
+            CU_basic_set_mode(CU_BRM_VERBOSE);
+            CU_basic_run_tests();
+            break;
+        case CUNIT_XMLFILE:
+            CU_set_output_filename("uswap_file.c");
+            CU_automated_run_tests();
+            break;
+        case CUNIT_CONSOLE:
+            CU_console_run_tests();
+            break;
+        default:
+            printf("not support cunit mode, only support: "
+                   "0 for CUNIT_SCREEN, 1 for CUNIT_XMLFILE, 2 for CUNIT_CONSOLE\n");
+            goto ERROR;
+    }
+
+    num_failures = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    return num_failures;
+
+ERROR:
+    error_num = CU_get_error();
+    CU_cleanup_registry();
+    return -error_num;
+}
@@ -19,6 +19,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <sys/socket.h>
 
 #include "uswap_server.h"
 
@@ -51,6 +52,74 @@ static void test_uswap_server_respond(void)
    CU_ASSERT_EQUAL(sock_handle_respond(-1, 0), -EINVAL);
 }
 
+static void test_uswap_server_frame(void)
+{
+    struct swap_ack ack = {0};
+
+    CU_ASSERT_EQUAL(sock_read_frame(-1, NULL), -EINVAL);
+    CU_ASSERT_EQUAL(sock_send_ack(-1, &ack), -EINVAL);
+    ack.length = sizeof(ack.results) + 1;
+    CU_ASSERT_EQUAL(sock_send_ack(0, &ack), -EINVAL);
+}
+
+static void fill_stream_frame(struct swap_vma *frame, unsigned int seq)
+{
+    frame->type = SWAP_TYPE_VMA_STREAM;
+    frame->seq = seq;
+    frame->length = 2 * sizeof(struct vma_addr);
+    frame->vma_addrs[0].start_addr = 0x100000 * seq;
+    frame->vma_addrs[0].vma_len = 0x1000;
+    frame->vma_addrs[1].start_addr = 0x100000 * seq + 0x2000;
+    frame->vma_addrs[1].vma_len = 0x3000;
+}
+
+static void test_uswap_server_stream(void)
+{
+    int fds[2];
+    struct swap_vma frame = {0};
+    struct swap_vma recv_frame = {0};
+    struct swap_ack ack = {0};
+    struct swap_ack recv_ack = {0};
+    ssize_t frame_len;
+    ssize_t ack_len;
+
+    CU_ASSERT_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    /* the client sends the next frame before the first one is acked */
+    fill_stream_frame(&frame, 1);
+    frame_len = SWAP_VMA_HDR_LEN + frame.length;
+    CU_ASSERT_EQUAL(write(fds[0], &frame, frame_len), frame_len);
+    fill_stream_frame(&frame, 2);
+    CU_ASSERT_EQUAL(write(fds[0], &frame, frame_len), frame_len);
+
+    for (unsigned int seq = 1; seq <= 2; seq++) {
+        fill_stream_frame(&frame, seq);
+        CU_ASSERT_EQUAL(sock_read_frame(fds[1], &recv_frame), frame_len);
+        CU_ASSERT_EQUAL(memcmp(&recv_frame, &frame, frame_len), 0);
+
+        ack.type = SWAP_TYPE_VMA_ACK;
+        ack.seq = seq;
+        ack.length = 2 * sizeof(int);
+        ack.results[0] = 0;
+        ack.results[1] = -EINVAL;
+        CU_ASSERT_EQUAL(sock_send_ack(fds[1], &ack), 0);
+    }
+
+    ack_len = SWAP_ACK_HDR_LEN + ack.length;
+    for (unsigned int seq = 1; seq <= 2; seq++) {
+        CU_ASSERT_EQUAL(read(fds[0], &recv_ack, ack_len), ack_len);
+        CU_ASSERT_EQUAL(recv_ack.type, SWAP_TYPE_VMA_ACK);
+        CU_ASSERT_EQUAL(recv_ack.seq, seq);
+        CU_ASSERT_EQUAL(recv_ack.results[0], 0);
+        CU_ASSERT_EQUAL(recv_ack.results[1], -EINVAL);
+    }
+
+    /* the connection stays usable until the client closes it */
+    close(fds[0]);
+    CU_ASSERT_EQUAL(sock_read_frame(fds[1], &recv_frame), 0);
+    close(fds[1]);
+}
+
 typedef enum {
     CUNIT_SCREEN = 0,
     CUNIT_XMLFILE,
@@ -80,7 +149,9 @@ int main(int argc, const char **argv)
 
     if (CU_ADD_TEST(suite, test_uswap_server_init) == NULL ||
         CU_ADD_TEST(suite, test_uswap_server_rev) == NULL ||
-	CU_ADD_TEST(suite, test_uswap_server_respond) == NULL) {
+	CU_ADD_TEST(suite, test_uswap_server_respond) == NULL ||
+	CU_ADD_TEST(suite, test_uswap_server_frame) == NULL ||
+	CU_ADD_TEST(suite, test_uswap_server_stream) == NULL) {
             printf("CU_ADD_TEST fail. \n");
             goto ERROR;
     }
@@ -0,0 +1,145 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2019-2022. All rights reserved.
+ * etmem is licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ * http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-18
+ * Description: This is a source file of the unit test for the compressed ram backend in uswap.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "uswap_api.h"
+#include "uswap_codec.h"
+#include "uswap_zram.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Console.h>
+
+#define TEST_PAGE_SIZE 4096
+
+static void test_uswap_lzf_codec(void)
+{
+    char src[TEST_PAGE_SIZE];
+    char compr[TEST_PAGE_SIZE];
+    char dst[TEST_PAGE_SIZE];
+    size_t compr_len;
+
+    for (int i = 0; i < TEST_PAGE_SIZE; i++) {
+        src[i] = (char)(i % 61);
+    }
+    compr_len = uswap_lzf_compress(src, sizeof(src), compr, sizeof(compr));
+    CU_ASSERT_TRUE(compr_len > 0 && compr_len < sizeof(src));
+    CU_ASSERT_EQUAL(uswap_lzf_decompress(compr, compr_len, dst, sizeof(dst)), sizeof(src));
+    CU_ASSERT_EQUAL(memcmp(src, dst, sizeof(src)), 0);
+
+    /* output too small for the data */
+    CU_ASSERT_EQUAL(uswap_lzf_compress(src, sizeof(src), compr, 1), 0);
+    CU_ASSERT_EQUAL(uswap_lzf_decompress(compr, compr_len, dst, 1), 0);
+
+    for (int i = 0; i < TEST_PAGE_SIZE; i++) {
+        src[i] = (char)rand();
+    }
+    compr_len = uswap_lzf_compress(src, sizeof(src), compr, sizeof(compr));
+    if (compr_len != 0) {
+        CU_ASSERT_EQUAL(uswap_lzf_decompress(compr, compr_len, dst, sizeof(dst)), sizeof(src));
+        CU_ASSERT_EQUAL(memcmp(src, dst, sizeof(src)), 0);
+    }
+}
+
+static void test_uswap_zram_codec(void)
+{
+    struct uswap_codec codec = {
+        .name = "test",
+        .compress = uswap_lzf_compress,
+        .decompress = NULL,
+    };
+
+    CU_ASSERT_EQUAL(uswap_zram_set_codec(&codec), USWAP_ERROR);
+    codec.decompress = uswap_lzf_decompress;
+    CU_ASSERT_EQUAL(uswap_zram_set_codec(&codec), USWAP_SUCCESS);
+    CU_ASSERT_EQUAL(uswap_zram_set_codec(NULL), USWAP_SUCCESS);
+}
+
+static void test_uswap_zram_register(void)
+{
+    struct uswap_zram_stats stats;
+
+    CU_ASSERT_EQUAL(register_uswap_zram(), USWAP_SUCCESS);
+    CU_ASSERT_EQUAL(uswap_zram_get_stats(NULL), USWAP_ERROR);
+    CU_ASSERT_EQUAL(uswap_zram_get_stats(&stats), USWAP_SUCCESS);
+    CU_ASSERT_EQUAL(stats.stored_pages, 0);
+    CU_ASSERT_EQUAL(stats.swapin_pages, 0);
+}
+
+typedef enum {
+    CUNIT_SCREEN = 0,
+    CUNIT_XMLFILE,
+    CUNIT_CONSOLE
+} cu_run_mode;
+
+int main(int argc, const char **argv)
+{
+    CU_pSuite suite;
+    CU_pTest pTest;
+    unsigned int num_failures;
+    cu_run_mode cunit_mode = CUNIT_SCREEN;
+    int error_num;
+
+    if (argc > 1) {
+        cunit_mode = atoi(argv[1]);
+    }
+
+    if (CU_initialize_registry() != CUE_SUCCESS) {
+        return -CU_get_error();
+    }
+
+    suite = CU_add_suite("uswap_zram", NULL, NULL);
+    if (suite == NULL) {
+        goto ERROR;
+    }
+
+    if (CU_ADD_TEST(suite, test_uswap_lzf_codec) == NULL ||
+        CU_ADD_TEST(suite, test_uswap_zram_codec) == NULL ||
+        CU_ADD_TEST(suite, test_uswap_zram_register) == NULL) {
+            printf("CU_ADD_TEST fail. \n");
+            goto ERROR;
+    }
+
+    switch (cunit_mode) {
+        case CUNIT_SCREEN:
+            CU_basic_set_mode(CU_BRM_VERBOSE);
+            CU_basic_run_tests();
+            break;
+        case CUNIT_XMLFILE:
+            CU_set_output_filename("uswap_zram.c");
+            CU_automated_run_tests();
+            break;
+        case CUNIT_CONSOLE:
+            CU_console_run_tests();
+            break;
+        default:
+            printf("not support cunit mode, only support: "
+                   "0 for CUNIT_SCREEN, 1 for CUNIT_XMLFILE, 2 for CUNIT_CONSOLE\n");
+            goto ERROR;
+    }
+
+    num_failures = CU_get_number_of_failures();
+    CU_cleanup_registry();
+    return num_failures;
+
+ERROR:
+    error_num = CU_get_error();
+    CU_cleanup_registry();
+    return -error_num;
+}